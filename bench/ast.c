@@ -0,0 +1,74 @@
+#include "grammar/grammar.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * A scope of n small functions, each with a few declarations and statements
+ */
+static size_t build_scope(char *buffer, const size_t n) {
+    size_t num_chars = 0;
+    for (size_t i = 0; i < n; ++i) {
+        num_chars += sprintf(buffer + num_chars,
+            "int func%zu(const char *str, int (*cb)(void *, int), struct Pair_t *pairs[]) {\n"
+            "    int total = 0;\n"
+            "    for (int i = 0; i < %zu; ++i) {\n"
+            "        total += cb((void *)pairs[i], str[i] * 2 + 1);\n"
+            "    }\n"
+            "    return total;\n"
+            "}\n", i, i + 1);
+    }
+    return num_chars;
+}
+
+static double seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main() {
+    static char buffer[1 << 24];
+    char path[0x100];
+    snprintf(path, sizeof(path), "/tmp/metac_bench_%d.ast", (int)getpid());
+    for (size_t n = 64; n <= 8192; n *= 4) {
+        const size_t len = build_scope(buffer, n);
+        ConstString_t str;
+        str.begin = buffer;
+        str.end = buffer + len;
+
+        ErrorLinkedListNode_t *errors = NULL;
+        ErrorLinkedListNode_t **errors_head = &errors;
+        ParseContext_t *context = new_parse_context();
+        ParseContext_t *prev_context = attach_parse_context(context);
+        double start = seconds();
+        TryScope_t parsed = parse_scope(str, &errors_head);
+        const double parse_time = seconds() - start;
+        attach_parse_context(prev_context);
+        if (parsed.status != TRY_SUCCESS) {
+            printf("  parse failed at n = %zu\n", n);
+            return 1;
+        }
+        start = seconds();
+        TrySize_t saved = save_scope(path, &parsed.value, str, false);
+        const double save_time = seconds() - start;
+        free_parse_context(context);
+
+        context = new_parse_context();
+        start = seconds();
+        TryScope_t loaded = load_scope(path, context);
+        const double load_time = seconds() - start;
+        free_parse_context(context);
+        if (saved.status != TRY_SUCCESS || loaded.status != TRY_SUCCESS) {
+            printf("  save/load failed at n = %zu\n", n);
+            return 1;
+        }
+        printf("  n = %5zu  %9zu bytes  parse %9.2f ms  save %7.2f ms  load %7.2f ms  (%zu byte file)\n",
+            n, len, 1e3 * parse_time, 1e3 * save_time, 1e3 * load_time, saved.value);
+    }
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "grammar/grammar.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef size_t (*BuildDeclaratorFunc_t)(char *buffer, const size_t n);
+
+/**
+ * int (*f)(int p0, int p1, ...)
+ */
+static size_t build_params(char *buffer, const size_t n) {
+    size_t num_chars = sprintf(buffer, "int (*f)(");
+    for (size_t i = 0; i < n; ++i) {
+        num_chars += sprintf(buffer + num_chars, "%sint (*p%zu)(char)", i ? ", " : "", i);
+    }
+    num_chars += sprintf(buffer + num_chars, ")");
+    return num_chars;
+}
+
+/**
+ * int (*(*(*f)(int))(int))(int) ...
+ */
+static size_t build_nested(char *buffer, const size_t n) {
+    size_t num_chars = sprintf(buffer, "int ");
+    for (size_t i = 0; i < n; ++i) {
+        num_chars += sprintf(buffer + num_chars, "(*");
+    }
+    num_chars += sprintf(buffer + num_chars, "f");
+    for (size_t i = 0; i < n; ++i) {
+        num_chars += sprintf(buffer + num_chars, ")(int)");
+    }
+    return num_chars;
+}
+
+/**
+ * int x[1][2][3] ...
+ */
+static size_t build_arrays(char *buffer, const size_t n) {
+    size_t num_chars = sprintf(buffer, "int x");
+    for (size_t i = 0; i < n; ++i) {
+        num_chars += sprintf(buffer + num_chars, "[%zu]", i + 1);
+    }
+    return num_chars;
+}
+
+static double seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, BuildDeclaratorFunc_t build) {
+    static char buffer[1 << 22];
+    printf("%s\n", name);
+    for (size_t n = 16; n <= 2048; n *= 2) {
+        const size_t len = build(buffer, n);
+        ConstString_t str;
+        str.begin = buffer;
+        str.end = buffer + len;
+        size_t iterations = 0;
+        const double start = seconds();
+        double elapsed = 0;
+        do {
+            TryVariable_t var = parse_variable(str);
+            if (var.status != TRY_SUCCESS) {
+                printf("  parse failed at n = %zu\n", n);
+                return;
+            }
+            ++iterations;
+            elapsed = seconds() - start;
+        } while (elapsed < 0.2);
+        printf("  n = %5zu  %8zu bytes  %10.1f us/parse  %6.1f ns/byte\n",
+            n, len, 1e6 * elapsed / iterations, 1e9 * elapsed / iterations / len);
+    }
+}
+
+int main() {
+    run("function pointer parameters", build_params);
+    run("nested function pointers", build_nested);
+    run("array dimensions", build_arrays);
+    return 0;
+}
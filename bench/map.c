@@ -0,0 +1,75 @@
+#include "common.h"
+
+#include <stdio.h>
+#include <time.h>
+
+static int cmp_uint32(const uint32_t a, const uint32_t b) {
+    return a < b ? -1 : a > b;
+}
+
+static uint32_t hash_uint32(const uint32_t key) {
+    return key * 0x9e3779b1u;
+}
+
+DEFINE_MAP(Tree, uint32_t, uint32_t, const uint32_t, const uint32_t, cmp_uint32)
+DEFINE_ORDERED_MAP(Avl, uint32_t, uint32_t, const uint32_t, const uint32_t, cmp_uint32)
+DEFINE_HASHMAP(Hash, uint32_t, uint32_t, const uint32_t, const uint32_t, hash_uint32, cmp_uint32)
+
+static double seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Insert keys 0..n-1 in sorted order, the worst case for the unbalanced tree,
+ * then look every key up again
+ */
+int main() {
+    for (uint32_t n = 1000; n <= 16000; n *= 2) {
+        uint64_t checksum = 0;
+        TreeMapNode_t *tree = NULL;
+        double start = seconds();
+        for (uint32_t key = 0; key < n; ++key) {
+            TreeMap_insert(&tree, key, key);
+        }
+        const double tree_insert = seconds() - start;
+        start = seconds();
+        for (uint32_t key = 0; key < n; ++key) {
+            checksum += TreeMap_find(tree, key)->value;
+        }
+        const double tree_find = seconds() - start;
+        TreeMap_free(&tree);
+
+        AvlMapNode_t *avl = NULL;
+        start = seconds();
+        for (uint32_t key = 0; key < n; ++key) {
+            AvlMap_insert(&avl, key, key);
+        }
+        const double avl_insert = seconds() - start;
+        start = seconds();
+        for (uint32_t key = 0; key < n; ++key) {
+            checksum += AvlMap_find(avl, key)->value;
+        }
+        const double avl_find = seconds() - start;
+        AvlMap_free(&avl);
+
+        HashMap_t hash = { NULL, 0, 0 };
+        start = seconds();
+        for (uint32_t key = 0; key < n; ++key) {
+            HashMap_insert(&hash, key, key);
+        }
+        const double hash_insert = seconds() - start;
+        start = seconds();
+        for (uint32_t key = 0; key < n; ++key) {
+            checksum += HashMap_find(&hash, key)->value;
+        }
+        const double hash_find = seconds() - start;
+        HashMap_free(&hash);
+
+        printf("  n = %5u  tree %8.2f / %8.2f ms  avl %6.2f / %6.2f ms  hash %6.2f / %6.2f ms  (insert / find, checksum %llu)\n",
+            n, 1e3 * tree_insert, 1e3 * tree_find, 1e3 * avl_insert, 1e3 * avl_find,
+            1e3 * hash_insert, 1e3 * hash_find, (unsigned long long)checksum);
+    }
+    return 0;
+}
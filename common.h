@@ -1,6 +1,8 @@
 #ifndef _COMMON_H_
 #define _COMMON_H_
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 typedef enum {
@@ -21,6 +23,9 @@ typedef enum {
     OP_CALL, OP_SUBSCRIPT, OP_MEM_ACCESS, OP_PTR_ACCESS
 } OperatorVariant_t;    
 
+/**
+ * Unbalanced binary search tree, one allocation per node
+ */
 #define DEFINE_MAP(name, ktype, vtype, const_ktype, const_vtype, kcmp) \
     typedef struct name ## MapNode { \
         ktype key; \
@@ -28,9 +33,9 @@ typedef enum {
         struct name ## MapNode *left; \
         struct name ## MapNode *right; \
     } name ## MapNode_t; \
-    const name ## MapNode_t **name ## Map_insert(name ## MapNode_t **const root, const_ktype key, const_vtype value) { \
+    static inline const name ## MapNode_t **name ## Map_insert(name ## MapNode_t **const root, const_ktype key, const_vtype value) { \
         name ## MapNode_t **head = root; \
-        while (head) { \
+        while (*head) { \
             int cmp_result = kcmp((*head)->key, key); \
             if (cmp_result == 0) return NULL; \
             head = cmp_result < 0 ? &(*head)->left : &(*head)->right; \
@@ -40,29 +45,247 @@ typedef enum {
         (*head)->value = value; \
         (*head)->left = NULL; \
         (*head)->right = NULL; \
-        return head; \
+        return (const name ## MapNode_t **)head; \
     } \
-    const name ## MapNode_t **name ## Map_find(const name ## MapNode_t *const root, const_ktype key) { \
-        name ## MapNode_t **head = &root; \
-        while (head) { \
-            int cmp_result = kcmp((*head)->key, key); \
-            if (cmp_result == 0) return head; \
-            head = cmp_result < 0 ? &(*head)->left : &(*head)->right; \
+    static inline const name ## MapNode_t *name ## Map_find(const name ## MapNode_t *root, const_ktype key) { \
+        while (root) { \
+            int cmp_result = kcmp(root->key, key); \
+            if (cmp_result == 0) return root; \
+            root = cmp_result < 0 ? root->left : root->right; \
         } \
         return NULL; \
     } \
-    void name ## Map_foreach(const name ## MapNode_t *const root, void (*func)(const name ## MapNode_t *node, void *args), void *args) { \
+    static inline void name ## Map_foreach(const name ## MapNode_t *const root, void (*func)(const name ## MapNode_t *node, void *args), void *args) { \
         if (!root) return; \
         name ## Map_foreach(root->left, func, args); \
         func(root, args); \
         name ## Map_foreach(root->right, func, args); \
     } \
-    void name ## Map_free(name ## MapNode_t **const root) { \
+    static inline void name ## Map_free(name ## MapNode_t **const root) { \
         if (!*root) return; \
-        name ## Map_free((*root)->left); \
-        name ## Map_free((*root)->right); \
+        name ## Map_free(&(*root)->left); \
+        name ## Map_free(&(*root)->right); \
         free(*root); \
         *root = NULL; \
     }
 
+/**
+ * AVL tree with the same interface as DEFINE_MAP, except that insert returns
+ * the node since rotations move links around. Keys are kept in ascending
+ * `kcmp` order and foreach visits them in that order. The height is at most
+ * 1.44 log2(n + 2), so insertion and iteration use fixed stacks instead of
+ * recursion, and free flattens the tree with rotations as it goes.
+ */
+#define ORDERED_MAP_MAX_HEIGHT 64
+#define DEFINE_ORDERED_MAP(name, ktype, vtype, const_ktype, const_vtype, kcmp) \
+    typedef struct name ## MapNode { \
+        ktype key; \
+        vtype value; \
+        struct name ## MapNode *left; \
+        struct name ## MapNode *right; \
+        int32_t height; \
+    } name ## MapNode_t; \
+    static inline int32_t name ## Map_height(const name ## MapNode_t *const node) { \
+        return node ? node->height : 0; \
+    } \
+    static inline void name ## Map_update(name ## MapNode_t *const node) { \
+        const int32_t left = name ## Map_height(node->left); \
+        const int32_t right = name ## Map_height(node->right); \
+        node->height = 1 + (left > right ? left : right); \
+    } \
+    static inline void name ## Map_rotate_left(name ## MapNode_t **const link) { \
+        name ## MapNode_t *node = *link; \
+        name ## MapNode_t *right = node->right; \
+        node->right = right->left; \
+        right->left = node; \
+        name ## Map_update(node); \
+        name ## Map_update(right); \
+        *link = right; \
+    } \
+    static inline void name ## Map_rotate_right(name ## MapNode_t **const link) { \
+        name ## MapNode_t *node = *link; \
+        name ## MapNode_t *left = node->left; \
+        node->left = left->right; \
+        left->right = node; \
+        name ## Map_update(node); \
+        name ## Map_update(left); \
+        *link = left; \
+    } \
+    static inline void name ## Map_rebalance(name ## MapNode_t **const link) { \
+        name ## MapNode_t *node = *link; \
+        const int32_t balance = name ## Map_height(node->left) - name ## Map_height(node->right); \
+        if (balance > 1) { \
+            if (name ## Map_height(node->left->left) < name ## Map_height(node->left->right)) name ## Map_rotate_left(&node->left); \
+            name ## Map_rotate_right(link); \
+        } \
+        else if (balance < -1) { \
+            if (name ## Map_height(node->right->right) < name ## Map_height(node->right->left)) name ## Map_rotate_right(&node->right); \
+            name ## Map_rotate_left(link); \
+        } \
+        else { \
+            name ## Map_update(node); \
+        } \
+    } \
+    static inline const name ## MapNode_t *name ## Map_insert(name ## MapNode_t **const root, const_ktype key, const_vtype value) { \
+        name ## MapNode_t **path[ORDERED_MAP_MAX_HEIGHT]; \
+        int depth = 0; \
+        name ## MapNode_t **link = root; \
+        while (*link) { \
+            int cmp_result = kcmp(key, (*link)->key); \
+            if (cmp_result == 0) return NULL; \
+            path[depth++] = link; \
+            link = cmp_result < 0 ? &(*link)->left : &(*link)->right; \
+        } \
+        name ## MapNode_t *node = malloc(sizeof(name ## MapNode_t)); \
+        node->key = key; \
+        node->value = value; \
+        node->left = NULL; \
+        node->right = NULL; \
+        node->height = 1; \
+        *link = node; \
+        /* Once a subtree keeps its height, nothing above it changes */ \
+        while (depth) { \
+            link = path[--depth]; \
+            const int32_t height = (*link)->height; \
+            name ## Map_rebalance(link); \
+            if ((*link)->height == height) break; \
+        } \
+        return node; \
+    } \
+    static inline const name ## MapNode_t *name ## Map_find(const name ## MapNode_t *root, const_ktype key) { \
+        while (root) { \
+            int cmp_result = kcmp(key, root->key); \
+            if (cmp_result == 0) return root; \
+            root = cmp_result < 0 ? root->left : root->right; \
+        } \
+        return NULL; \
+    } \
+    static inline void name ## Map_foreach(const name ## MapNode_t *root, void (*func)(const name ## MapNode_t *node, void *args), void *args) { \
+        const name ## MapNode_t *stack[ORDERED_MAP_MAX_HEIGHT]; \
+        int depth = 0; \
+        while (root || depth) { \
+            for (; root; root = root->left) stack[depth++] = root; \
+            root = stack[--depth]; \
+            func(root, args); \
+            root = root->right; \
+        } \
+    } \
+    static inline void name ## Map_free(name ## MapNode_t **const root) { \
+        name ## MapNode_t *node = *root; \
+        while (node) { \
+            if (node->left) { \
+                name ## MapNode_t *left = node->left; \
+                node->left = left->right; \
+                left->right = node; \
+                node = left; \
+            } \
+            else { \
+                name ## MapNode_t *right = node->right; \
+                free(node); \
+                node = right; \
+            } \
+        } \
+        *root = NULL; \
+    }
+
+/**
+ * Open-addressed hash map with Robin Hood probing over a flat slot array. Each
+ * slot caches its key's hash and its probe length (1 for the home slot, 0 for
+ * an empty slot), so lookups stop as soon as they reach a slot that is closer
+ * to its home than the key would be. A zeroed `name ## Map_t` is an empty map.
+ * Slot pointers are invalidated by the next insertion or removal.
+ */
+#define DEFINE_HASHMAP(name, ktype, vtype, const_ktype, const_vtype, khash, kcmp) \
+    typedef struct name ## MapSlot { \
+        ktype key; \
+        vtype value; \
+        uint32_t hash; \
+        uint32_t probe; \
+    } name ## MapSlot_t; \
+    typedef struct name ## Map { \
+        name ## MapSlot_t *slots; \
+        uint32_t capacity; \
+        uint32_t size; \
+    } name ## Map_t; \
+    static inline name ## MapSlot_t *name ## Map_place(name ## MapSlot_t *const slots, const uint32_t capacity, name ## MapSlot_t slot) { \
+        name ## MapSlot_t *output = NULL; \
+        uint32_t i = slot.hash & (capacity - 1); \
+        slot.probe = 1; \
+        while (slots[i].probe) { \
+            if (slots[i].probe < slot.probe) { \
+                const name ## MapSlot_t displaced = slots[i]; \
+                slots[i] = slot; \
+                slot = displaced; \
+                output = output ? output : &slots[i]; \
+            } \
+            i = (i + 1) & (capacity - 1); \
+            ++slot.probe; \
+        } \
+        slots[i] = slot; \
+        return output ? output : &slots[i]; \
+    } \
+    static inline const name ## MapSlot_t *name ## Map_find(const name ## Map_t *const map, const_ktype key) { \
+        if (!map->size) return NULL; \
+        const uint32_t hash = khash(key); \
+        uint32_t i = hash & (map->capacity - 1); \
+        for (uint32_t probe = 1; map->slots[i].probe >= probe; ++probe) { \
+            if (map->slots[i].hash == hash && kcmp(map->slots[i].key, key) == 0) return &map->slots[i]; \
+            i = (i + 1) & (map->capacity - 1); \
+        } \
+        return NULL; \
+    } \
+    /* Find for updating the value in place */ \
+    static inline name ## MapSlot_t *name ## Map_get(name ## Map_t *const map, const_ktype key) { \
+        return (name ## MapSlot_t *)name ## Map_find(map, key); \
+    } \
+    static inline void name ## Map_grow(name ## Map_t *const map) { \
+        const uint32_t capacity = map->capacity ? 2 * map->capacity : 16; \
+        name ## MapSlot_t *slots = calloc(capacity, sizeof(name ## MapSlot_t)); \
+        for (uint32_t i = 0; i < map->capacity; ++i) { \
+            if (map->slots[i].probe) name ## Map_place(slots, capacity, map->slots[i]); \
+        } \
+        free(map->slots); \
+        map->slots = slots; \
+        map->capacity = capacity; \
+    } \
+    /* Returns NULL if the key is already present, like DEFINE_MAP */ \
+    static inline name ## MapSlot_t *name ## Map_insert(name ## Map_t *const map, const_ktype key, const_vtype value) { \
+        if (name ## Map_find(map, key)) return NULL; \
+        if (4 * (map->size + 1) > 3 * map->capacity) name ## Map_grow(map); \
+        name ## MapSlot_t slot; \
+        slot.key = key; \
+        slot.value = value; \
+        slot.hash = khash(key); \
+        ++map->size; \
+        return name ## Map_place(map->slots, map->capacity, slot); \
+    } \
+    /* Shifts the following run back by one instead of leaving a tombstone */ \
+    static inline bool name ## Map_remove(name ## Map_t *const map, const_ktype key) { \
+        const name ## MapSlot_t *found = name ## Map_find(map, key); \
+        if (!found) return false; \
+        const uint32_t mask = map->capacity - 1; \
+        uint32_t i = found - map->slots; \
+        uint32_t next = (i + 1) & mask; \
+        while (map->slots[next].probe > 1) { \
+            map->slots[i] = map->slots[next]; \
+            --map->slots[i].probe; \
+            i = next; \
+            next = (next + 1) & mask; \
+        } \
+        map->slots[i].probe = 0; \
+        --map->size; \
+        return true; \
+    } \
+    static inline void name ## Map_foreach(const name ## Map_t *const map, void (*func)(const name ## MapSlot_t *slot, void *args), void *args) { \
+        for (uint32_t i = 0; i < map->capacity; ++i) { \
+            if (map->slots[i].probe) func(&map->slots[i], args); \
+        } \
+    } \
+    static inline void name ## Map_free(name ## Map_t *const map) { \
+        free(map->slots); \
+        map->slots = NULL; \
+        map->capacity = 0; \
+        map->size = 0; \
+    }
+
 #endif
\ No newline at end of file
@@ -0,0 +1,444 @@
+#include "flow.h"
+
+static DataOperand_t *new_operand(FlowBuilder_t *const builder, const DataOperandVariant_t variant, const DerivedType_t *const type) {
+    DataOperand_t *operand = flow_alloc(builder->program, sizeof(DataOperand_t));
+    operand->variant = variant;
+    operand->type = type;
+    return operand;
+}
+
+/**
+ * A decimal literal is an int, or a long if it does not fit, or failing that
+ * an unsigned long
+ */
+static DataOperand_t *new_constant(FlowBuilder_t *const builder, const uint64_t value) {
+    const PrimitiveVariant_t primitive = value <= INT32_MAX ? PRIMITIVE_INT : value <= INT64_MAX ? PRIMITIVE_LONG : PRIMITIVE_UNSIGNED_LONG;
+    DataOperand_t *operand = new_operand(builder, OPERAND_CONSTANT, primitive_derived_type(primitive));
+    operand->constant = value;
+    return operand;
+}
+
+/**
+ * A fresh temporary; returns the operand that defines it, and `use` gets a
+ * separate operand for reading it
+ */
+static DataOperand_t *new_temporary(FlowBuilder_t *const builder, const DerivedType_t *const type, DataOperand_t **const use) {
+    DataVariable_t *variable = new_data_variable(builder, NULL, type);
+    *use = new_variable_operand(builder, variable);
+    return new_variable_operand(builder, variable);
+}
+
+static const DerivedType_t *inner_type(const DerivedType_t *const type) {
+    if (!type) {
+        return NULL;
+    }
+    switch (type->variant) {
+        case DERIVED_TYPE_POINTER:
+            return type->pointer.inner_type;
+        case DERIVED_TYPE_ARRAY:
+            return type->array.inner_type;
+        default:
+            return NULL;
+    }
+}
+
+const DerivedType_t *resolve_type(FlowProgram_t *const program, const DerivedType_t *type) {
+    while (type && type->variant == DERIVED_TYPE_TERMINAL && type->terminal.type.variant == TYPE_NAMED) {
+        if (type->terminal.resolved) {
+            type = type->terminal.resolved;
+            continue;
+        }
+        const SymbolBinding_t *binding = lookup_symbol(&program->symbols, type->terminal.type.named, SYMBOL_NAMESPACE_TYPE);
+        if (!binding || binding->type == type) {
+            return type;
+        }
+        type = binding->type;
+    }
+    return type;
+}
+
+/**
+ * The type of a field of a struct or union type, if its definition is known
+ */
+static const DerivedType_t *member_type(FlowBuilder_t *const builder, const DerivedType_t *type, const Symbol_t *const member) {
+    type = resolve_type(builder->program, type);
+    if (!type || type->variant != DERIVED_TYPE_TERMINAL) {
+        return NULL;
+    }
+    const Type_t *terminal = &type->terminal.type;
+    if (terminal->variant != TYPE_STRUCT && terminal->variant != TYPE_UNION) {
+        return NULL;
+    }
+    if (!terminal->compound.is_definition && type->terminal.resolved && type->terminal.resolved->terminal.type.compound.is_definition) {
+        terminal = &type->terminal.resolved->terminal.type;
+    }
+    else if (!terminal->compound.is_definition && terminal->compound.has_name) {
+        const SymbolBinding_t *binding = lookup_symbol(&builder->program->symbols, terminal->compound.name, SYMBOL_NAMESPACE_TAG);
+        if (!binding || !binding->is_definition) {
+            return NULL;
+        }
+        terminal = &binding->type->terminal.type;
+    }
+    for (uint32_t i = 0; i < terminal->compound.su_fields.size; ++i) {
+        const Variable_t *field = &terminal->compound.su_fields.items[i];
+        if (field->has_name && field->name == member) {
+            return field->type;
+        }
+    }
+    return NULL;
+}
+
+static DataOperand_t *new_indirect(FlowBuilder_t *const builder, DataOperand_t *const base) {
+    DataOperand_t *operand = new_operand(builder, OPERAND_INDIRECT, base ? inner_type(resolve_type(builder->program, base->type)) : NULL);
+    operand->base = base;
+    return operand;
+}
+
+static DataOperand_t *new_member(FlowBuilder_t *const builder, DataOperand_t *const base, const Symbol_t *const member) {
+    DataOperand_t *operand = new_operand(builder, OPERAND_MEMBER, member_type(builder, base->type, member));
+    operand->base = base;
+    operand->member = member;
+    return operand;
+}
+
+static DataOperand_t *emit_value(FlowBuilder_t *const builder, const OperatorVariant_t op, const DerivedType_t *const type, DataOperand_t *const in1, DataOperand_t *const in2) {
+    DataOperand_t *use;
+    emit_operation(builder, op, new_temporary(builder, type, &use), in1, in2);
+    return use;
+}
+
+/**
+ * The declaration itself declares a variable in the current scope
+ */
+static DataOperand_t *flowify_declaration(FlowBuilder_t *const builder, const Variable_t *const decl) {
+    DataVariable_t *variable = new_data_variable(builder, decl->name, decl->type);
+    if (!declare_variable(&builder->program->symbols, decl->name, variable)) {
+        flow_error(builder, "Variable is already defined");
+    }
+    return new_variable_operand(builder, variable);
+}
+
+static DataOperand_t *flowify_identifier(FlowBuilder_t *const builder, const Symbol_t *const identifier) {
+    const SymbolBinding_t *binding = lookup_symbol(&builder->program->symbols, identifier, SYMBOL_NAMESPACE_VARIABLE);
+    if (binding) {
+        return new_variable_operand(builder, binding->variable);
+    }
+    DataOperand_t *operand = new_operand(builder, OPERAND_SYMBOL, NULL);
+    operand->symbol = identifier;
+    return operand;
+}
+
+const DerivedType_t *expression_type(FlowProgram_t *const program, const Expression_t *const expr) {
+    switch (expr->variant) {
+        case EXPRESSION_TYPE:
+            return expr->type;
+        case EXPRESSION_DECLARATION:
+            return expr->decl->type;
+        case EXPRESSION_IDENTIFIER: {
+            const SymbolBinding_t *binding = lookup_symbol(&program->symbols, expr->identifier, SYMBOL_NAMESPACE_VARIABLE);
+            if (binding) {
+                return binding->variable->type;
+            }
+            // sizeof(T) parses as a parenthesized name when T is a typedef
+            binding = lookup_symbol(&program->symbols, expr->identifier, SYMBOL_NAMESPACE_TYPE);
+            return binding ? binding->type : NULL;
+        }
+        case EXPRESSION_UINT_LIT: {
+            PrimitiveVariant_t primitive;
+            return integer_literal_type(expr->uint_lit, expr->uint_lit_base, expr->uint_lit_suffix, &primitive) ?
+                primitive_derived_type(primitive) : NULL;
+        }
+        case EXPRESSION_CHAR_LIT:
+            // A character constant is an int
+            return primitive_derived_type(PRIMITIVE_INT);
+        case EXPRESSION_OPERATOR:
+            if (expr->operator->variant == OP_DEREFERENCE) {
+                return inner_type(resolve_type(program, expression_type(program, expr->operator->uop)));
+            }
+            return NULL;
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * `a && b` and `a || b` evaluate `b` only if `a` did not decide the result
+ */
+static DataOperand_t *flowify_logical(FlowBuilder_t *const builder, const Operator_t *const op) {
+    const DerivedType_t *int_type = primitive_derived_type(PRIMITIVE_INT);
+    DataVariable_t *variable = new_data_variable(builder, NULL, int_type);
+    DataOperand_t *left = flowify_expression(builder, op->lop);
+    emit_operation(builder, OP_NE, new_variable_operand(builder, variable), left, new_constant(builder, 0));
+
+    BasicBlock_t *right_block = new_basic_block(builder);
+    BasicBlock_t *join_block = new_basic_block(builder);
+    if (op->variant == OP_LOGICAL_AND) {
+        branch_to(builder, new_variable_operand(builder, variable), right_block, join_block);
+    }
+    else {
+        branch_to(builder, new_variable_operand(builder, variable), join_block, right_block);
+    }
+    builder->block = right_block;
+    DataOperand_t *right = flowify_expression(builder, op->rop);
+    emit_operation(builder, OP_NE, new_variable_operand(builder, variable), right, new_constant(builder, 0));
+    jump_to(builder, join_block);
+    builder->block = join_block;
+    return new_variable_operand(builder, variable);
+}
+
+static DataOperand_t *flowify_conditional(FlowBuilder_t *const builder, const Operator_t *const op) {
+    DataOperand_t *predicate = flowify_expression(builder, op->pop);
+    BasicBlock_t *true_block = new_basic_block(builder);
+    BasicBlock_t *false_block = new_basic_block(builder);
+    BasicBlock_t *join_block = new_basic_block(builder);
+    branch_to(builder, predicate, true_block, false_block);
+
+    builder->block = true_block;
+    DataOperand_t *if_true = flowify_expression(builder, op->top);
+    DataVariable_t *variable = new_data_variable(builder, NULL, if_true ? if_true->type : NULL);
+    if (if_true) {
+        emit_operation(builder, OP_ASSIGN, new_variable_operand(builder, variable), if_true, NULL);
+    }
+    jump_to(builder, join_block);
+
+    builder->block = false_block;
+    DataOperand_t *if_false = flowify_expression(builder, op->fop);
+    if (if_false) {
+        emit_operation(builder, OP_ASSIGN, new_variable_operand(builder, variable), if_false, NULL);
+    }
+    jump_to(builder, join_block);
+    builder->block = join_block;
+    return if_true || if_false ? new_variable_operand(builder, variable) : NULL;
+}
+
+/**
+ * Arguments arrive as a left-nested comma expression
+ */
+static uint32_t count_arguments(const Expression_t *const expr) {
+    if (expr->variant == EXPRESSION_VOID) {
+        return 0;
+    }
+    if (expr->variant == EXPRESSION_OPERATOR && expr->operator->variant == OP_COMMA) {
+        return count_arguments(expr->operator->lop) + count_arguments(expr->operator->rop);
+    }
+    return 1;
+}
+
+static void collect_arguments(FlowBuilder_t *const builder, const Expression_t *const expr, DataOperation_t *const call) {
+    if (expr->variant == EXPRESSION_VOID) {
+        return;
+    }
+    if (expr->variant == EXPRESSION_OPERATOR && expr->operator->variant == OP_COMMA) {
+        collect_arguments(builder, expr->operator->lop, call);
+        collect_arguments(builder, expr->operator->rop, call);
+        return;
+    }
+    call->args[call->n_args++] = flowify_expression(builder, expr);
+}
+
+static DataOperand_t *flowify_call(FlowBuilder_t *const builder, const Operator_t *const op) {
+    DataOperand_t *callee = flowify_expression(builder, op->lop);
+    const DerivedType_t *callee_type = resolve_type(builder->program, callee ? callee->type : NULL);
+    if (callee_type && callee_type->variant == DERIVED_TYPE_POINTER) {
+        callee_type = resolve_type(builder->program, callee_type->pointer.inner_type);
+    }
+    const DerivedType_t *return_type = callee_type && callee_type->variant == DERIVED_TYPE_FUNCTION ?
+        callee_type->function.return_type :
+        NULL;
+    // Arguments are evaluated before the call, so it is emitted after them
+    DataOperation_t call;
+    memset(&call, 0, sizeof(DataOperation_t));
+    if (op->rop) {
+        call.args = flow_alloc(builder->program, count_arguments(op->rop) * sizeof(DataOperand_t *));
+        collect_arguments(builder, op->rop, &call);
+    }
+    DataOperand_t *use;
+    DataOperation_t *operation = emit_operation(builder, OP_CALL, new_temporary(builder, return_type, &use), callee, NULL);
+    operation->args = call.args;
+    operation->n_args = call.n_args;
+    return use;
+}
+
+static OperatorVariant_t compound_assignment_op(const OperatorVariant_t op) {
+    switch (op) {
+        case OP_ADD_ASSIGN: return OP_ADD;
+        case OP_SUB_ASSIGN: return OP_SUB;
+        case OP_MUL_ASSIGN: return OP_MUL;
+        case OP_DIV_ASSIGN: return OP_DIV;
+        case OP_MOD_ASSIGN: return OP_MOD;
+        case OP_SL_ASSIGN: return OP_SL;
+        case OP_SR_ASSIGN: return OP_SR;
+        case OP_AND_ASSIGN: return OP_BITWISE_AND;
+        case OP_XOR_ASSIGN: return OP_BITWISE_XOR;
+        case OP_OR_ASSIGN: return OP_BITWISE_OR;
+        default: return OP_ASSIGN;
+    }
+}
+
+static bool is_assignable(const DataOperand_t *const operand) {
+    return operand && (
+        (operand->variant == OPERAND_VARIABLE && operand->data->name) ||
+        operand->variant == OPERAND_SYMBOL ||
+        operand->variant == OPERAND_INDIRECT ||
+        operand->variant == OPERAND_MEMBER);
+}
+
+static DataOperand_t *flowify_operator(FlowBuilder_t *const builder, const Operator_t *const op) {
+    const DerivedType_t *int_type = primitive_derived_type(PRIMITIVE_INT);
+    switch (op->variant) {
+        case OP_COMMA:
+            flowify_expression(builder, op->lop);
+            return flowify_expression(builder, op->rop);
+        case OP_ASSIGN:
+        case OP_ADD_ASSIGN:
+        case OP_SUB_ASSIGN:
+        case OP_MUL_ASSIGN:
+        case OP_DIV_ASSIGN:
+        case OP_MOD_ASSIGN:
+        case OP_SL_ASSIGN:
+        case OP_SR_ASSIGN:
+        case OP_AND_ASSIGN:
+        case OP_XOR_ASSIGN:
+        case OP_OR_ASSIGN: {
+            // The target comes first, so a declaration is in scope for its initializer
+            DataOperand_t *target = flowify_expression(builder, op->lop);
+            if (!is_assignable(target)) {
+                flow_error(builder, "Expression is not assignable");
+                return flowify_expression(builder, op->rop);
+            }
+            DataOperand_t *value = flowify_expression(builder, op->rop);
+            if (op->variant == OP_ASSIGN) {
+                emit_operation(builder, OP_ASSIGN, target, value, NULL);
+            }
+            else {
+                emit_operation(builder, compound_assignment_op(op->variant), target, copy_operand(builder, target), value);
+            }
+            return copy_operand(builder, target);
+        }
+        case OP_COND:
+            return flowify_conditional(builder, op);
+        case OP_LOGICAL_OR:
+        case OP_LOGICAL_AND:
+            return flowify_logical(builder, op);
+        case OP_EQ:
+        case OP_NE:
+        case OP_GT:
+        case OP_LT:
+        case OP_GE:
+        case OP_LE: {
+            DataOperand_t *left = flowify_expression(builder, op->lop);
+            DataOperand_t *right = flowify_expression(builder, op->rop);
+            return emit_value(builder, op->variant, int_type, left, right);
+        }
+        case OP_BITWISE_OR:
+        case OP_BITWISE_XOR:
+        case OP_BITWISE_AND:
+        case OP_SL:
+        case OP_SR:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD: {
+            DataOperand_t *left = flowify_expression(builder, op->lop);
+            DataOperand_t *right = flowify_expression(builder, op->rop);
+            const DerivedType_t *type = left ? left->type : NULL;
+            const DerivedType_t *resolved = resolve_type(builder->program, type);
+            const DerivedType_t *integer = integer_operation_type(builder->program, op->variant, type, right ? right->type : NULL);
+            if (integer) {
+                type = integer;
+            }
+            else if (resolved && resolved->variant == DERIVED_TYPE_ARRAY) {
+                // Arrays decay to pointers in arithmetic
+                type = pointer_derived_type(resolved->array.inner_type);
+            }
+            return emit_value(builder, op->variant, type, left, right);
+        }
+        case OP_POS:
+        case OP_NEG:
+        case OP_BITWISE_NOT: {
+            DataOperand_t *operand = flowify_expression(builder, op->uop);
+            const DerivedType_t *type = operand ? operand->type : NULL;
+            const DerivedType_t *integer = integer_operation_type(builder->program, op->variant, type, NULL);
+            return emit_value(builder, op->variant, integer ? integer : type, operand, NULL);
+        }
+        case OP_LOGICAL_NOT:
+            return emit_value(builder, op->variant, int_type, flowify_expression(builder, op->uop), NULL);
+        case OP_CAST:
+            return emit_value(builder, OP_CAST, op->lop->type, flowify_expression(builder, op->rop), NULL);
+        case OP_DEREFERENCE:
+            return new_indirect(builder, flowify_expression(builder, op->uop));
+        case OP_ADDRESS: {
+            DataOperand_t *operand = flowify_expression(builder, op->uop);
+            if (operand && operand->variant == OPERAND_INDIRECT) {
+                // &*p and &a[i] are just the pointer
+                return operand->base;
+            }
+            if (operand && operand->variant == OPERAND_VARIABLE) {
+                operand->data->address_taken = true;
+            }
+            return emit_value(builder, OP_ADDRESS, pointer_derived_type(operand ? operand->type : NULL), operand, NULL);
+        }
+        case OP_SIZEOF:
+            return emit_value(builder, OP_SIZEOF, primitive_derived_type(PRIMITIVE_UNSIGNED_LONG),
+                new_operand(builder, OPERAND_TYPE, expression_type(builder->program, op->uop)), NULL);
+        case OP_CALL:
+            return flowify_call(builder, op);
+        case OP_SUBSCRIPT: {
+            // a[i] is *(a + i)
+            DataOperand_t *array = flowify_expression(builder, op->lop);
+            DataOperand_t *index = flowify_expression(builder, op->rop);
+            const DerivedType_t *element = inner_type(resolve_type(builder->program, array ? array->type : NULL));
+            return new_indirect(builder, emit_value(builder, OP_ADD, pointer_derived_type(element), array, index));
+        }
+        case OP_MEM_ACCESS:
+        case OP_PTR_ACCESS: {
+            DataOperand_t *base = flowify_expression(builder, op->lop);
+            if (!base || op->rop->variant != EXPRESSION_IDENTIFIER) {
+                flow_error(builder, "Member access needs an object and a field name");
+                return base;
+            }
+            if (op->variant == OP_PTR_ACCESS) {
+                base = new_indirect(builder, base);
+            }
+            return new_member(builder, base, op->rop->identifier);
+        }
+    }
+    return NULL;
+}
+
+DataOperand_t *flowify_expression(FlowBuilder_t *const builder, const Expression_t *const expr) {
+    if (!expr) {
+        return NULL;
+    }
+    DataOperand_t *operand;
+    switch (expr->variant) {
+        case EXPRESSION_OPERATOR:
+            return flowify_operator(builder, expr->operator);
+        case EXPRESSION_IDENTIFIER:
+            return flowify_identifier(builder, expr->identifier);
+        case EXPRESSION_TYPE:
+            return new_operand(builder, OPERAND_TYPE, expr->type);
+        case EXPRESSION_DECLARATION:
+            return flowify_declaration(builder, expr->decl);
+        case EXPRESSION_STR_LIT:
+            operand = new_operand(builder, OPERAND_STRING, pointer_derived_type(primitive_derived_type(PRIMITIVE_CHAR)));
+            operand->symbol = expr->str_lit;
+            return operand;
+        case EXPRESSION_CHAR_LIT:
+            operand = new_constant(builder, char_literal_value(expr->char_lit->str));
+            operand->type = primitive_derived_type(PRIMITIVE_CHAR);
+            return operand;
+        case EXPRESSION_UINT_LIT: {
+            operand = new_constant(builder, expr->uint_lit);
+            operand->type = expression_type(builder->program, expr);
+            if (!operand->type) {
+                flow_error(builder, "Integer constant is too large for its type");
+            }
+            return operand;
+        }
+        case EXPRESSION_VOID:
+            return NULL;
+    }
+    return NULL;
+}
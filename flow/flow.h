@@ -10,11 +10,25 @@ struct DataVariable;
 struct DataScope;
 struct DataOperand;
 struct DataOperation;
-struct Function;
+struct FlowFunction;
 struct BasicBlock;
+struct SymbolTable;
+struct FlowProgram;
+struct TypeLayout;
+struct DataPhi;
 
-DEFINE_MAP(DataVariable, AConstString_t, struct DataVariable *, const AConstString_t, struct DataVariable *const, cmp_alloc_const_str)
-DEFINE_MAP(TypeName, AConstString_t, DerivedType_t *, const AConstString_t, DerivedType_t *const, cmp_alloc_const_str)
+DEFINE_HASHMAP(DataVariable, const Symbol_t *, struct DataVariable *, const Symbol_t *const, struct DataVariable *const, hash_symbol, cmp_symbol)
+/**
+ * A typedef name or tag as its scope last declared it
+ */
+typedef struct TypeName {
+    const DerivedType_t *type;
+    bool is_definition;
+} TypeName_t;
+
+DEFINE_HASHMAP(TypeName, const Symbol_t *, TypeName_t, const Symbol_t *const, const TypeName_t, hash_symbol, cmp_symbol)
+DEFINE_HASHMAP(SymbolBinding, const Symbol_t *, uint32_t, const Symbol_t *const, const uint32_t, hash_symbol, cmp_symbol)
+DEFINE_HASHMAP(TypeLayout, const DerivedType_t *, struct TypeLayout *, const DerivedType_t *const, struct TypeLayout *const, hash_canonical_type, cmp_canonical_type)
 
 typedef struct DataLocation {
     struct DataScope *parent_scope;
@@ -24,10 +38,20 @@ typedef struct DataLocation {
     bool has_offset;
 } DataLocation_t;
 
+/**
+ * A named local or parameter, or a temporary (with no name) holding an
+ * intermediate value. Variables whose address may be taken, including all
+ * aggregates, live in memory; the others are plain values
+ */
 typedef struct DataVariable {
+    const Symbol_t *name;
+    const DerivedType_t *type; // NULL if it could not be determined
     struct DataLocation *location;
     struct DataScope *scope;
-    struct Function *function;
+    struct FlowFunction *function;
+    uint32_t id; // Index in the function's variables
+    bool address_taken;
+    bool is_ssa; // Renamed into versions by `build_ssa`
 } DataVariable_t;
 
 typedef struct DataScopeLinkedListNode {
@@ -35,23 +59,110 @@ typedef struct DataScopeLinkedListNode {
     struct DataScopeLinkedListNode *next;
 } DataScopeLinkedListNode_t;
 
+/**
+ * The scope's own declarations live in its maps; names visible from it are
+ * looked up in the symbol table it was entered into
+ */
 typedef struct DataScope {
     struct DataLocation location;
-    struct DataVariableMapNode *variables;
-    struct TypeNameMapNode *types;
+    DataVariableMap_t variables;
+    TypeNameMap_t types;
+    TypeNameMap_t tags;
     struct DataScopeLinkedListNode *scopes;
+    struct SymbolTable *symbols;
 } DataScope_t;
 
+/**
+ * SYMBOL TABLE
+ * One table holds every binding visible at the current point of a walk over
+ * nested scopes. Each name maps to its innermost binding, and each binding
+ * links to the one it shadows. Bindings are appended to a log that doubles as
+ * the undo log: leaving a scope pops its bindings and restores what they
+ * shadowed, so lookups cost O(1) however deep the nesting is.
+ */
+typedef enum SymbolNamespace {
+    SYMBOL_NAMESPACE_TYPE, // Typedef names
+    SYMBOL_NAMESPACE_TAG, // Struct, union and enum tags
+    SYMBOL_NAMESPACE_VARIABLE,
+    NUM_SYMBOL_NAMESPACES
+} SymbolNamespace_t;
+
+#define NO_SYMBOL_BINDING UINT32_MAX
+
+typedef struct SymbolBinding {
+    const Symbol_t *name;
+    SymbolNamespace_t ns;
+    const struct DataScope *scope;
+    bool is_definition;
+    union {
+        const DerivedType_t *type;
+        struct DataVariable *variable;
+    };
+    uint32_t shadowed; // Log index of the binding this one hides
+} SymbolBinding_t;
+
+typedef struct SymbolTableMark {
+    struct DataScope *scope;
+    uint32_t log_size;
+} SymbolTableMark_t;
+
+typedef struct SymbolTable {
+    SymbolBindingMap_t innermost[NUM_SYMBOL_NAMESPACES];
+    SymbolBinding_t *log;
+    uint32_t log_size;
+    uint32_t log_capacity;
+    SymbolTableMark_t *marks;
+    uint32_t depth;
+    uint32_t marks_capacity;
+} SymbolTable_t;
+
+/**
+ * FLOW IR
+ *
+ * Each function is a graph of basic blocks holding three-address operations.
+ * An operand is a variable, a literal or an unresolved name, or a memory
+ * operand: INDIRECT is the object its base points to, MEMBER is a field of
+ * the object its base denotes. Every operand is used by exactly one operation
+ * so that later passes can annotate uses individually.
+ */
+typedef enum DataOperandVariant {
+    OPERAND_VARIABLE,
+    OPERAND_CONSTANT,
+    OPERAND_STRING,
+    OPERAND_SYMBOL, // A name with no local binding, e.g. a function or global
+    OPERAND_TYPE, // Only the type, e.g. for sizeof
+    OPERAND_INDIRECT,
+    OPERAND_MEMBER
+} DataOperandVariant_t;
+
 typedef struct DataOperand {
-    struct DataVariable *data;
-    DerivedType_t *type;
+    DataOperandVariant_t variant;
+    union {
+        struct DataVariable *data;
+        uint64_t constant;
+        const Symbol_t *symbol; // STRING (with its quotes) or SYMBOL
+        struct {
+            struct DataOperand *base;
+            const Symbol_t *member;
+        };
+    };
+    const DerivedType_t *type; // Canonical, so types compare by pointer
+    uint32_t version; // Of an SSA variable; 0 is its value on entry
 } DataOperand_t;
 
+/**
+ * `out = in1 op in2`, or `out = op in1` for unary operators. OP_ASSIGN is a
+ * copy, OP_CAST converts to the type of `out`, OP_CALL calls `in1` with
+ * `args`. Compound assignments, logical operators, conditionals and commas
+ * never appear, they are lowered into these and control flow
+ */
 typedef struct DataOperation {
     OperatorVariant_t op;
     struct DataOperand *in1;
     struct DataOperand *in2;
     struct DataOperand *out;
+    struct DataOperand **args;
+    uint32_t n_args;
 } DataOperation_t;
 
 typedef struct DataOperationLinkedListNode {
@@ -59,19 +170,69 @@ typedef struct DataOperationLinkedListNode {
     struct DataOperationLinkedListNode *next;
 } DataOperationLinkedListNode_t;
 
-typedef struct Function {
+/**
+ * `out = phi(args)` at the top of a block, with one argument per predecessor
+ * in the order of the block's `preds`
+ */
+typedef struct DataPhi {
+    struct DataVariable *variable;
+    struct DataOperand *out;
+    struct DataOperand **args;
+} DataPhi_t;
+
+typedef struct DataPhiLinkedListNode {
+    struct DataPhi *value;
+    struct DataPhiLinkedListNode *next;
+} DataPhiLinkedListNode_t;
+
+/**
+ * A function without a name holds the statements outside any function
+ */
+typedef struct FlowFunction {
+    const Symbol_t *name;
     struct BasicBlock *head_block;
     struct DataScope *scope;
-    struct DataOperand *params;
-} Function_t;
+    struct DataVariable **params;
+    uint32_t n_params;
+    struct BasicBlock **blocks; // Indexed by block id
+    uint32_t n_blocks;
+    uint32_t blocks_capacity;
+    struct DataVariable **variables; // Indexed by variable id
+    uint32_t n_variables;
+    uint32_t variables_capacity;
+    uint64_t frame_size;
+    uint64_t unpacked_frame_size; // Without slots shared between scopes
+    struct BasicBlock **rpo; // Reachable blocks in reverse postorder
+    uint32_t n_rpo;
+    bool is_ssa;
+    struct FlowFunction *next;
+} FlowFunction_t;
 
+/**
+ * After its operations a block returns, or branches to `branch` when
+ * `predicate` is nonzero and to `next` otherwise, or jumps to `next`
+ */
 typedef struct BasicBlock {
     struct DataScope *scope;
     struct DataOperationLinkedListNode *ops;
+    struct DataOperationLinkedListNode *last_op;
     struct BasicBlock *next;
-    struct BasicBlock *predicate;
+    struct DataOperand *predicate;
     struct BasicBlock *branch;
+    struct DataOperand *return_value;
+    uint32_t id;
     bool returns;
+
+    // Filled in by `build_ssa`; unreachable blocks have no idom and no preds
+    struct BasicBlock **preds; // Reachable ones only
+    uint32_t n_preds;
+    struct BasicBlock *idom; // NULL for the head block
+    struct BasicBlock **frontier;
+    uint32_t n_frontier;
+    struct DataPhiLinkedListNode *phis;
+    uint32_t rpo_index; // UINT32_MAX if unreachable
+    uint32_t dom_pre; // Dominator tree preorder and postorder numbers
+    uint32_t dom_post;
 } BasicBlock_t;
 
 /**
@@ -93,9 +254,270 @@ typedef struct FlowError {
  */
 void append_error(FlowError_t ***errors, const FlowErrorVariant_t variant, const AConstString_t cause, const char *const desc);
 
-bool is_type_declared_in_scope(const AConstString_t type_name, const DataScope_t *const scope);
-bool is_defined_in_scope(const AConstString_t type_name, const DataScope_t *const scope);
+SymbolTable_t new_scoped_symbol_table();
+void free_scoped_symbol_table(SymbolTable_t *const table);
+
+/**
+ * Scopes must be left in the reverse order they were entered; a scope's
+ * bindings are only visible while it is entered
+ */
+void enter_scope(SymbolTable_t *const table, DataScope_t *const scope);
+void leave_scope(SymbolTable_t *const table);
+DataScope_t *current_scope(const SymbolTable_t *const table);
+
+/**
+ * Bind a name in the current scope, also recording it in the scope's own map;
+ * typedef names and tags are bound in separate namespaces, as in C
+ *  false: the name is already bound in the current scope (a type may still
+ *         be declared any number of times and defined once)
+ */
+bool declare_type(SymbolTable_t *const table, const Symbol_t *const name, const DerivedType_t *const type, const bool is_definition);
+bool declare_tag(SymbolTable_t *const table, const Symbol_t *const name, const DerivedType_t *const type, const bool is_definition);
+bool declare_variable(SymbolTable_t *const table, const Symbol_t *const name, DataVariable_t *const variable);
+
+/**
+ * The innermost visible binding, or NULL; valid until the next declaration
+ */
+const SymbolBinding_t *lookup_symbol(const SymbolTable_t *const table, const Symbol_t *const name, const SymbolNamespace_t ns);
+
+/**
+ * Whether a typedef name is visible from `scope`. The innermost entered scope
+ * is answered by the symbol table in O(1); any other scope, including every
+ * scope once its walk is over, by its own map and those of its parents, which
+ * hold each scope's declarations as they stood when it was left
+ */
+bool is_type_declared_in_scope(const Symbol_t *const type_name, const DataScope_t *const scope);
+bool is_defined_in_scope(const Symbol_t *const type_name, const DataScope_t *const scope);
+
+/**
+ * LAYOUT
+ *
+ * Sizes, alignments and field offsets as the x86-64 System V ABI lays them
+ * out. A type without a size, such as void, a function, an array without a
+ * constant size or a struct that is only declared, is incomplete and has
+ * size 0. Its alignment is 1, except that an array keeps the alignment of
+ * its elements so that it can end a struct.
+ */
+typedef struct TypeLayout {
+    uint64_t size;
+    uint64_t alignment;
+    uint64_t *offsets; // Of each field of a struct or union, NULL otherwise
+    uint32_t n_fields;
+    bool is_complete;
+    bool in_progress; // Only while the fields of a definition are laid out
+} TypeLayout_t;
+
+/**
+ * PROGRAMS
+ *
+ * Everything lowered from one translation unit is allocated from the
+ * program's arena and released with it. Types are canonical in the parse
+ * context of the AST, which must outlive the program
+ */
+typedef struct FlowProgram {
+    Arena_t arena;
+    ParseContext_t *context;
+    SymbolTable_t symbols;
+    DataScope_t *scope; // File scope
+    FlowFunction_t *top_level;
+    FlowFunction_t *functions; // In definition order, linked by `next`
+    FlowError_t *errors;
+    FlowError_t **errors_tail;
+    TypeLayoutMap_t layouts;
+} FlowProgram_t;
+
+/**
+ * Lower a parsed scope into basic blocks; problems such as redefinitions or
+ * a stray break are collected in `errors` and lowering carries on
+ */
+FlowProgram_t *flowify_scope(const Scope_t *const scope, ParseContext_t *const context);
+void free_flow_program(FlowProgram_t *const program);
+
+/**
+ * Allocation from the program's arena, zeroed
+ */
+void *flow_alloc(FlowProgram_t *const program, const size_t size);
+
+/**
+ * Lowering state for one function; blocks become current when code is added
+ * to them, and after a jump there is no current block until one is needed
+ */
+typedef struct FlowBuilder {
+    FlowProgram_t *program;
+    FlowFunction_t *function;
+    BasicBlock_t *block;
+    BasicBlock_t *break_target;
+    BasicBlock_t *continue_target;
+    const Statement_t *statement; // Blamed for errors
+} FlowBuilder_t;
+
+BasicBlock_t *new_basic_block(FlowBuilder_t *const builder);
+BasicBlock_t *current_block(FlowBuilder_t *const builder);
+void jump_to(FlowBuilder_t *const builder, BasicBlock_t *const target);
+void branch_to(FlowBuilder_t *const builder, DataOperand_t *const predicate, BasicBlock_t *const if_true, BasicBlock_t *const if_false);
+DataVariable_t *new_data_variable(FlowBuilder_t *const builder, const Symbol_t *const name, const DerivedType_t *const type);
+DataOperand_t *new_variable_operand(FlowBuilder_t *const builder, DataVariable_t *const variable);
+DataOperand_t *copy_operand(FlowBuilder_t *const builder, const DataOperand_t *const operand);
+DataOperation_t *emit_operation(FlowBuilder_t *const builder, const OperatorVariant_t op, DataOperand_t *const out, DataOperand_t *const in1, DataOperand_t *const in2);
+void flow_error(FlowBuilder_t *const builder, const char *const desc);
+
+/**
+ * Layouts are memoized per canonical type. Typedef names and struct and union
+ * tags in a bound type (see `bind_derived_type`) stand for the type they were
+ * bound to, so its layout is memoized and can be queried after lowering;
+ * other names are resolved in the current scope on every query, and types
+ * that depend on them are laid out afresh. A definition is laid out once,
+ * with the names its fields use resolved where it is first laid out, which
+ * lowering makes its point of definition
+ */
+const TypeLayout_t *derived_type_layout(FlowProgram_t *const program, const DerivedType_t *const type);
+
+/**
+ * The canonical type that records what each typedef name and struct or union
+ * tag in `type` stands for in the current scope, and the value of each array
+ * size that needs the scope; it prints as `type` does. Variables are
+ * declared with bound types
+ */
+const DerivedType_t *bind_derived_type(FlowProgram_t *const program, const DerivedType_t *const type);
+const TypeLayout_t *type_layout(FlowProgram_t *const program, const Type_t *const type);
+
+/**
+ * Size and alignment of a variable from its type; offsets are left alone
+ */
+void layout_data_location(FlowProgram_t *const program, DataLocation_t *const location, const DerivedType_t *const type);
+
+/**
+ * CONSTANT FOLDING, see `fold_constant_expression`, with typedef names and
+ * sizeof looked up in the current scope
+ */
+
+/**
+ * The expression with its largest constant subexpressions replaced by
+ * literals of the same value and type. New nodes are allocated in the
+ * program's parse context
+ */
+const Expression_t *fold_expression(FlowProgram_t *const program, const Expression_t *const expr);
+
+/**
+ * Size and signedness of an integer type, resolving typedef names in the
+ * current scope; enums are ints
+ *  false: the type is not an integer type, or is not known
+ */
+bool integer_type(FlowProgram_t *const program, const DerivedType_t *type, uint8_t *const size, bool *const is_signed);
+const DerivedType_t *integer_constant_type(const IntegerConstant_t value);
+
+/**
+ * Type of the result of an operator that `evaluate_integer_operation` applies
+ * on operands of these types, or NULL if they are not integers
+ */
+const DerivedType_t *integer_operation_type(FlowProgram_t *const program, const OperatorVariant_t op, const DerivedType_t *const in1, const DerivedType_t *const in2);
+
+/**
+ * The size of an array type: the value stored when it was parsed, or else
+ * its stored expression evaluated in the current scope
+ *  true: the size is a nonnegative constant; `depends_on_scope` is set when
+ *        the value relied on names in the current scope
+ */
+bool array_size_value(FlowProgram_t *const program, const DerivedType_t *const type, uint64_t *const size, bool *const depends_on_scope);
+
+/**
+ * Give every variable of complete type a stack slot, reusing the slots of
+ * scopes that have ended; file-scope variables get none. Scopes get the
+ * offset and size of the region their variables and inner scopes use. Runs
+ * once per function, at the end of `flowify_scope`
+ */
+void layout_frame(FlowFunction_t *const function);
+void layout_frames(FlowProgram_t *const program);
+
+/**
+ * SSA
+ *
+ * Dominators are computed with the iterative algorithm of Cooper, Harvey
+ * and Kennedy over reverse postorder, and dominance frontiers from the
+ * predecessors of join blocks. Phis are placed on the iterated dominance
+ * frontier of a variable's definitions, but only where the variable is live,
+ * which is found for each variable by walking back from its uses, and uses
+ * are renamed by a walk over the dominator tree. Variables that may
+ * be accessed through memory, i.e. whose address is taken, variables of other
+ * functions and file-scope variables are left alone.
+ */
+void compute_dominators(FlowProgram_t *const program, FlowFunction_t *const function);
+void compute_dominance_frontiers(FlowProgram_t *const program, FlowFunction_t *const function);
+bool dominates(const BasicBlock_t *const dominator, const BasicBlock_t *const block);
+
+/**
+ * Computes dominators and frontiers as well; runs once per function
+ */
+void build_ssa(FlowProgram_t *const program, FlowFunction_t *const function);
+void build_program_ssa(FlowProgram_t *const program);
+
+/**
+ * Successors in a fixed order, `branch` before `next`, each once; returns
+ * how many there are
+ */
+uint32_t block_successors(const BasicBlock_t *const block, BasicBlock_t *output[2]);
+
+/**
+ * Visit the SSA variables an operation reads, including the address it
+ * stores through, or that a block's return or branch reads; the definition
+ * is the SSA variable an operation writes, or NULL
+ */
+typedef void (*UseVisitor_t)(void *const user, DataOperand_t *const operand);
+void visit_operation_uses(DataOperation_t *const operation, const UseVisitor_t visit, void *const user);
+void visit_terminator_uses(BasicBlock_t *const block, const UseVisitor_t visit, void *const user);
+DataOperand_t *operation_definition(const DataOperation_t *const operation);
+
+/**
+ * SCCP
+ *
+ * Sparse conditional constant propagation, after Wegman and Zadeck, over a
+ * function in SSA form. Values start unknown and only ever move down to a
+ * constant and then to varying, and a block is only evaluated once an edge
+ * into it is known to be taken, so each operation is evaluated a bounded
+ * number of times and the whole pass is linear. Integer operations are
+ * evaluated as constant folding does; anything read from memory or returned
+ * by a call varies, and so do the values of variables on entry.
+ */
+
+/**
+ * Afterwards uses of constant values are constants, operations that compute
+ * one are copies of it, and phis that merge only one constant are gone. A
+ * branch on a constant becomes a jump, and dominators, frontiers and phi
+ * arguments are recomputed for the edges that are left, so blocks that are
+ * no longer reached are out of `rpo`
+ */
+void propagate_constants(FlowProgram_t *const program, FlowFunction_t *const function);
+void propagate_program_constants(FlowProgram_t *const program);
+
+/**
+ * Canonical types used by lowering
+ */
+const DerivedType_t *primitive_derived_type(const PrimitiveVariant_t primitive);
+const DerivedType_t *pointer_derived_type(const DerivedType_t *const inner);
+
+/**
+ * Lower an expression for its value; NULL for a void expression. Memory
+ * operands are returned as they are rather than loaded into temporaries
+ */
+DataOperand_t *flowify_expression(FlowBuilder_t *const builder, const Expression_t *const expr);
+void flowify_statement(FlowBuilder_t *const builder, const Statement_t *const statement);
+
+/**
+ * Typedef names resolved to what they were bound to, or else to what they
+ * stand for in the current scope
+ */
+const DerivedType_t *resolve_type(FlowProgram_t *const program, const DerivedType_t *type);
+
+/**
+ * Type of an expression without evaluating it, for sizeof; NULL when it would
+ * take more than a lookup
+ */
+const DerivedType_t *expression_type(FlowProgram_t *const program, const Expression_t *const expr);
 
-void flowify_statement(const Statement_t *statement, BasicBlock_t *block, DataScope_t *scope, FlowError_t ***errors);
+size_t print_operand(Sink_t *const sink, const DataOperand_t *const operand);
+size_t print_operation(Sink_t *const sink, const DataOperation_t *const operation);
+size_t print_flow_function(Sink_t *const sink, const FlowFunction_t *const function);
+size_t print_flow_program(Sink_t *const sink, const FlowProgram_t *const program);
+size_t print_frame_layout(Sink_t *const sink, const FlowFunction_t *const function);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "flow.h"
+
+bool integer_type(FlowProgram_t *const program, const DerivedType_t *type, uint8_t *const size, bool *const is_signed) {
+    type = resolve_type(program, type);
+    if (!type || type->variant != DERIVED_TYPE_TERMINAL) {
+        return false;
+    }
+    switch (type->terminal.type.variant) {
+        case TYPE_PRIMITIVE:
+            return integer_primitive(type->terminal.type.primitive, size, is_signed);
+        case TYPE_ENUM:
+            *size = 4;
+            *is_signed = true;
+            return true;
+        default:
+            return false;
+    }
+}
+
+const DerivedType_t *integer_constant_type(const IntegerConstant_t value) {
+    return primitive_derived_type(integer_constant_primitive(value));
+}
+
+const DerivedType_t *integer_operation_type(FlowProgram_t *const program, const OperatorVariant_t op, const DerivedType_t *const in1, const DerivedType_t *const in2) {
+    IntegerConstant_t left, right;
+    if (!integer_type(program, in1, &left.size, &left.is_signed)) {
+        return NULL;
+    }
+    left.bits = 0;
+    switch (op) {
+        case OP_POS:
+        case OP_NEG:
+        case OP_BITWISE_NOT:
+            return integer_constant_type(promote_integer(left));
+        case OP_LOGICAL_NOT:
+            return primitive_derived_type(PRIMITIVE_INT);
+        default:
+            break;
+    }
+    if (!integer_type(program, in2, &right.size, &right.is_signed)) {
+        return NULL;
+    }
+    right.bits = 0;
+    switch (op) {
+        case OP_SL:
+        case OP_SR:
+            return integer_constant_type(promote_integer(left));
+        case OP_EQ:
+        case OP_NE:
+        case OP_GT:
+        case OP_LT:
+        case OP_GE:
+        case OP_LE:
+            return primitive_derived_type(PRIMITIVE_INT);
+        default:
+            convert_integers(&left, &right);
+            return integer_constant_type(left);
+    }
+}
+
+
+static bool env_integer_type(void *const data, const DerivedType_t *const type, uint8_t *const size, bool *const is_signed) {
+    return integer_type(data, type, size, is_signed);
+}
+
+static bool env_size_of(void *const data, const Expression_t *const operand, uint64_t *const size) {
+    FlowProgram_t *program = data;
+    const DerivedType_t *type = expression_type(program, operand);
+    const TypeLayout_t *layout = type ? derived_type_layout(program, type) : NULL;
+    if (!layout || !layout->is_complete) {
+        return false;
+    }
+    *size = layout->size;
+    return true;
+}
+
+/**
+ * Typedef names and sizeof are looked up in the program's current scope
+ */
+static FoldEnv_t program_env(FlowProgram_t *const program) {
+    FoldEnv_t env = { program, env_integer_type, env_size_of };
+    return env;
+}
+
+const Expression_t *fold_expression(FlowProgram_t *const program, const Expression_t *const expr) {
+    const FoldEnv_t env = program_env(program);
+    ParseContext_t *prev_context = attach_parse_context(program->context);
+    const Expression_t *folded = fold_constant_expression(expr, &env);
+    attach_parse_context(prev_context);
+    return folded;
+}
+
+bool array_size_value(FlowProgram_t *const program, const DerivedType_t *const type, uint64_t *const size, bool *const depends_on_scope) {
+    if (type->variant != DERIVED_TYPE_ARRAY || !type->array.has_size) {
+        return false;
+    }
+    if (type->array.is_size_constant) {
+        *size = type->array.size_value;
+        return true;
+    }
+    if (!type->array.size_expr) {
+        return false;
+    }
+    const FoldEnv_t env = program_env(program);
+    IntegerConstant_t value;
+    if (!evaluate_constant(type->array.size_expr, &env, &value, depends_on_scope) ||
+            (value.is_signed && (int64_t)value.bits < 0)) {
+        return false;
+    }
+    *size = value.bits;
+    return true;
+}
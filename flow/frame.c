@@ -0,0 +1,143 @@
+#include "flow.h"
+
+typedef struct {
+    DataScope_t *scope;
+    uint64_t top; // Where the next variable of the scope goes
+    uint64_t end; // Furthest extent of the scope and the scopes inside it
+} FrameScope_t;
+
+typedef struct {
+    FrameScope_t *items;
+    uint32_t size;
+    uint32_t capacity;
+} FrameStack_t;
+
+static uint64_t align_up(const uint64_t offset, const uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+static FrameScope_t *grow_frame_stack(FrameStack_t *const stack, const uint32_t n) {
+    if (stack->size + n > stack->capacity) {
+        while (stack->size + n > stack->capacity) {
+            stack->capacity = stack->capacity ? 2 * stack->capacity : 16;
+        }
+        stack->items = realloc(stack->items, stack->capacity * sizeof(FrameScope_t));
+    }
+    stack->size += n;
+    return &stack->items[stack->size - n];
+}
+
+/**
+ * The scope is over, so whatever follows in its parent may reuse its slots
+ */
+static void pop_frame_scope(FrameStack_t *const stack) {
+    const FrameScope_t *item = &stack->items[--stack->size];
+    item->scope->location.size = item->end - item->scope->location.offset;
+    if (stack->size) {
+        FrameScope_t *parent = &stack->items[stack->size - 1];
+        parent->end = item->end > parent->end ? item->end : parent->end;
+    }
+}
+
+/**
+ * Make `scope` the innermost scope on the stack: scopes that are over are
+ * popped, and the scopes from the innermost live one down to `scope` start
+ * where that one is up to
+ */
+static void open_frame_scope(FrameStack_t *const stack, DataScope_t *const scope) {
+    DataScope_t *ancestor = scope;
+    uint32_t depth = 0;
+    while (!ancestor->location.has_offset) {
+        ancestor = ancestor->location.parent_scope;
+        ++depth;
+    }
+    while (stack->items[stack->size - 1].scope != ancestor) {
+        pop_frame_scope(stack);
+    }
+    const uint64_t offset = stack->items[stack->size - 1].top;
+    FrameScope_t *items = grow_frame_stack(stack, depth);
+    DataScope_t *it = scope;
+    for (uint32_t i = depth; i--; it = it->location.parent_scope) {
+        items[i].scope = it;
+        items[i].top = offset;
+        items[i].end = offset;
+        it->location.offset = offset;
+        it->location.has_offset = true;
+    }
+}
+
+/**
+ * Variables are created in program order and scopes nest, so walking them in
+ * order with a stack of open scopes sees each scope's variables after those
+ * of the enclosing scope declared before it. A scope's slots are given back
+ * when it ends, so sibling scopes, and anything declared after a scope in
+ * its parent, share them
+ */
+void layout_frame(FlowFunction_t *const function) {
+    FrameStack_t stack = { NULL, 0, 0 };
+    uint64_t unpacked_size = 0;
+    uint64_t alignment = 1;
+    FrameScope_t *root = grow_frame_stack(&stack, 1);
+    root->scope = function->scope;
+    root->top = 0;
+    root->end = 0;
+    function->scope->location.offset = 0;
+    function->scope->location.has_offset = true;
+    for (uint32_t i = 0; i < function->n_variables; ++i) {
+        DataVariable_t *variable = function->variables[i];
+        DataLocation_t *location = variable->location;
+        // Incomplete types take no slot, and top-level variables are not on a stack
+        if (!location->size || (!function->name && variable->scope == function->scope)) {
+            continue;
+        }
+        open_frame_scope(&stack, variable->scope);
+        FrameScope_t *top = &stack.items[stack.size - 1];
+        location->offset = align_up(top->top, location->alignment);
+        location->has_offset = true;
+        top->top = location->offset + location->size;
+        top->end = top->top > top->end ? top->top : top->end;
+        unpacked_size = align_up(unpacked_size, location->alignment) + location->size;
+        alignment = location->alignment > alignment ? location->alignment : alignment;
+    }
+    while (stack.size) {
+        pop_frame_scope(&stack);
+    }
+    free(stack.items);
+    function->frame_size = align_up(function->scope->location.size, alignment);
+    function->unpacked_frame_size = align_up(unpacked_size, alignment);
+}
+
+void layout_frames(FlowProgram_t *const program) {
+    layout_frame(program->top_level);
+    for (FlowFunction_t *it = program->functions; it; it = it->next) {
+        layout_frame(it);
+    }
+}
+
+size_t print_frame_layout(Sink_t *const sink, const FlowFunction_t *const function) {
+    const size_t begin = sink->written;
+    if (function->name) {
+        sink_write(sink, function->name->str.begin, function->name->str.end - function->name->str.begin);
+    }
+    else {
+        sink_puts(sink, "top level");
+    }
+    sink_printf(sink, ": %llu bytes, %llu unpacked\n",
+        (unsigned long long)function->frame_size, (unsigned long long)function->unpacked_frame_size);
+    for (uint32_t i = 0; i < function->n_variables; ++i) {
+        const DataVariable_t *variable = function->variables[i];
+        if (!variable->location->has_offset) {
+            continue;
+        }
+        sink_puts(sink, "    ");
+        if (variable->name) {
+            sink_write(sink, variable->name->str.begin, variable->name->str.end - variable->name->str.begin);
+        }
+        else {
+            sink_printf(sink, "t%u", variable->id);
+        }
+        sink_printf(sink, ": %llu (%llu)\n",
+            (unsigned long long)variable->location->offset, (unsigned long long)variable->location->size);
+    }
+    return sink->written - begin;
+}
@@ -0,0 +1,257 @@
+#include "flow.h"
+
+static const TypeLayout_t incomplete_layout = { 0, 1, NULL, 0, false, false };
+
+static const TypeLayout_t *layout_of(FlowProgram_t *const program, const DerivedType_t *const type, bool *const depends_on_scope);
+
+static uint64_t align_up(const uint64_t offset, const uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+static TypeLayout_t *new_layout(FlowProgram_t *const program, const uint64_t size, const uint64_t alignment, const bool is_complete) {
+    TypeLayout_t *layout = flow_alloc(program, sizeof(TypeLayout_t));
+    layout->size = size;
+    layout->alignment = alignment;
+    layout->is_complete = is_complete;
+    return layout;
+}
+
+/**
+ * Sizes of the primitives, which are also their alignments; 0 for void
+ */
+static uint64_t primitive_size(const PrimitiveVariant_t primitive) {
+    switch (primitive) {
+        case PRIMITIVE_VOID:
+            return 0;
+        case PRIMITIVE_CHAR:
+        case PRIMITIVE_UNSIGNED_CHAR:
+            return 1;
+        case PRIMITIVE_SHORT:
+        case PRIMITIVE_UNSIGNED_SHORT:
+            return 2;
+        case PRIMITIVE_INT:
+        case PRIMITIVE_UNSIGNED_INT:
+        case PRIMITIVE_FLOAT:
+            return 4;
+        case PRIMITIVE_LONG:
+        case PRIMITIVE_UNSIGNED_LONG:
+        case PRIMITIVE_LONG_LONG:
+        case PRIMITIVE_UNSIGNED_LONG_LONG:
+        case PRIMITIVE_DOUBLE:
+            return 8;
+    }
+    return 0;
+}
+
+/**
+ * Fields are placed in order at their alignment, or all at 0 in a union. A
+ * struct may end with an array without a size, which takes no space
+ */
+static const TypeLayout_t *layout_definition(FlowProgram_t *const program, const DerivedType_t *const type) {
+    const Type_t *terminal = &type->terminal.type;
+    const bool is_union = terminal->variant == TYPE_UNION;
+    const VariableSpan_t *fields = &terminal->compound.su_fields;
+    TypeLayout_t *layout = new_layout(program, 0, 1, true);
+    layout->in_progress = true;
+    layout->n_fields = fields->size;
+    layout->offsets = flow_alloc(program, fields->size * sizeof(uint64_t));
+    // Registered before the fields, so a definition that contains itself is incomplete
+    TypeLayoutMap_insert(&program->layouts, type, layout);
+
+    uint64_t size = 0;
+    for (uint32_t i = 0; i < fields->size; ++i) {
+        bool depends_on_scope = false;
+        const DerivedType_t *field_type = fields->items[i].type;
+        const TypeLayout_t *field = layout_of(program, field_type, &depends_on_scope);
+        const bool is_flexible = !is_union && i + 1 == fields->size && field_type->variant == DERIVED_TYPE_ARRAY && !field_type->array.has_size;
+        if (field->in_progress || (!field->is_complete && !is_flexible)) {
+            layout->is_complete = false;
+        }
+        if (field->alignment > layout->alignment) {
+            layout->alignment = field->alignment;
+        }
+        if (is_union) {
+            layout->offsets[i] = 0;
+            size = field->size > size ? field->size : size;
+        }
+        else {
+            layout->offsets[i] = align_up(size, field->alignment);
+            size = layout->offsets[i] + field->size;
+        }
+    }
+    layout->size = layout->is_complete ? align_up(size, layout->alignment) : 0;
+    layout->in_progress = false;
+    return layout;
+}
+
+/**
+ * The type a typedef name or struct/union tag stands for: the one it was
+ * bound to, or else the one in the current scope; NULL if there is none
+ */
+static const DerivedType_t *resolve_name(FlowProgram_t *const program, const DerivedType_t *const type, bool *const depends_on_scope) {
+    if (type->terminal.resolved) {
+        return type->terminal.resolved;
+    }
+    const Type_t *terminal = &type->terminal.type;
+    const SymbolBinding_t *binding;
+    if (terminal->variant == TYPE_NAMED) {
+        binding = lookup_symbol(&program->symbols, terminal->named, SYMBOL_NAMESPACE_TYPE);
+    }
+    else if (terminal->compound.has_name) {
+        binding = lookup_symbol(&program->symbols, terminal->compound.name, SYMBOL_NAMESPACE_TAG);
+    }
+    else {
+        return NULL;
+    }
+    *depends_on_scope = true;
+    return binding && binding->type != type ? binding->type : NULL;
+}
+
+static const TypeLayout_t *layout_terminal(FlowProgram_t *const program, const DerivedType_t *const type, bool *const depends_on_scope) {
+    const Type_t *terminal = &type->terminal.type;
+    const DerivedType_t *resolved;
+    switch (terminal->variant) {
+        case TYPE_PRIMITIVE: {
+            const uint64_t size = primitive_size(terminal->primitive);
+            return size ? new_layout(program, size, size, true) : &incomplete_layout;
+        }
+        case TYPE_ENUM:
+            return new_layout(program, 4, 4, true);
+        case TYPE_NAMED:
+            resolved = resolve_name(program, type, depends_on_scope);
+            return resolved ? layout_of(program, resolved, depends_on_scope) : &incomplete_layout;
+        case TYPE_STRUCT:
+        case TYPE_UNION:
+            if (terminal->compound.is_definition) {
+                return layout_definition(program, type);
+            }
+            resolved = resolve_name(program, type, depends_on_scope);
+            return resolved ? layout_of(program, resolved, depends_on_scope) : &incomplete_layout;
+    }
+    return &incomplete_layout;
+}
+
+/**
+ * Layouts that do not depend on the current scope are memoized, and so are
+ * definitions
+ */
+static const TypeLayout_t *layout_of(FlowProgram_t *const program, const DerivedType_t *const type, bool *const depends_on_scope) {
+    const TypeLayoutMapSlot_t *slot = TypeLayoutMap_find(&program->layouts, type);
+    if (slot) {
+        return slot->value;
+    }
+    bool own_depends_on_scope = false;
+    const TypeLayout_t *layout;
+    const TypeLayout_t *inner;
+    uint64_t n;
+    switch (type->variant) {
+        case DERIVED_TYPE_POINTER:
+            layout = new_layout(program, 8, 8, true);
+            break;
+        case DERIVED_TYPE_ARRAY:
+            inner = layout_of(program, type->array.inner_type, &own_depends_on_scope);
+            if (inner->is_complete && array_size_value(program, type, &n, &own_depends_on_scope)) {
+                layout = new_layout(program, n * inner->size, inner->alignment, true);
+            }
+            else {
+                layout = new_layout(program, 0, inner->alignment, false);
+            }
+            break;
+        case DERIVED_TYPE_FUNCTION:
+            return &incomplete_layout;
+        case DERIVED_TYPE_TERMINAL:
+            layout = layout_terminal(program, type, &own_depends_on_scope);
+            if (TypeLayoutMap_find(&program->layouts, type)) {
+                // A definition registers itself
+                return layout;
+            }
+            break;
+    }
+    if (own_depends_on_scope) {
+        *depends_on_scope = true;
+    }
+    else if (layout != &incomplete_layout) {
+        TypeLayoutMap_insert(&program->layouts, type, (TypeLayout_t *)layout);
+    }
+    return layout;
+}
+
+/**
+ * Function types are left as they are, since they have no layout
+ */
+static const DerivedType_t *bind_type(FlowProgram_t *const program, const DerivedType_t *const type) {
+    DerivedType_t der = *type;
+    uint64_t size;
+    bool depends_on_scope = false;
+    switch (type->variant) {
+        case DERIVED_TYPE_TERMINAL: {
+            const Type_t *terminal = &type->terminal.type;
+            const bool is_name =
+                terminal->variant == TYPE_NAMED ||
+                ((terminal->variant == TYPE_STRUCT || terminal->variant == TYPE_UNION) && !terminal->compound.is_definition);
+            const DerivedType_t *resolved = is_name ? resolve_name(program, type, &depends_on_scope) : NULL;
+            if (!resolved || type->terminal.resolved) {
+                return type;
+            }
+            der.terminal.resolved = bind_type(program, resolved);
+            break;
+        }
+        case DERIVED_TYPE_POINTER:
+            der.pointer.inner_type = (DerivedType_t *)bind_type(program, type->pointer.inner_type);
+            if (der.pointer.inner_type == type->pointer.inner_type) {
+                return type;
+            }
+            break;
+        case DERIVED_TYPE_ARRAY:
+            der.array.inner_type = (DerivedType_t *)bind_type(program, type->array.inner_type);
+            if (type->array.has_size && !type->array.is_size_constant && type->array.size_expr) {
+                der.array.is_size_constant = array_size_value(program, type, &size, &depends_on_scope);
+                if (der.array.is_size_constant) {
+                    der.array.size_value = size;
+                }
+                else {
+                    der.array.size_expr = NULL;
+                }
+            }
+            else if (der.array.inner_type == type->array.inner_type) {
+                return type;
+            }
+            break;
+        case DERIVED_TYPE_FUNCTION:
+            return type;
+    }
+    return canonical_derived_type(&der);
+}
+
+const DerivedType_t *bind_derived_type(FlowProgram_t *const program, const DerivedType_t *const type) {
+    if (!type) {
+        return NULL;
+    }
+    ParseContext_t *prev_context = attach_parse_context(program->context);
+    const DerivedType_t *bound = bind_type(program, type);
+    attach_parse_context(prev_context);
+    return bound;
+}
+
+const TypeLayout_t *derived_type_layout(FlowProgram_t *const program, const DerivedType_t *const type) {
+    bool depends_on_scope = false;
+    return type ? layout_of(program, type, &depends_on_scope) : &incomplete_layout;
+}
+
+const TypeLayout_t *type_layout(FlowProgram_t *const program, const Type_t *const type) {
+    DerivedType_t der;
+    memset(&der, 0, sizeof(DerivedType_t));
+    der.variant = DERIVED_TYPE_TERMINAL;
+    der.terminal.qualifier = QUALIFIER_NONE;
+    der.terminal.type = *type;
+    ParseContext_t *prev_context = attach_parse_context(program->context);
+    const DerivedType_t *canonical = canonical_derived_type(&der);
+    attach_parse_context(prev_context);
+    return derived_type_layout(program, canonical);
+}
+
+void layout_data_location(FlowProgram_t *const program, DataLocation_t *const location, const DerivedType_t *const type) {
+    const TypeLayout_t *layout = derived_type_layout(program, type);
+    location->size = layout->size;
+    location->alignment = layout->alignment;
+}
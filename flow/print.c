@@ -0,0 +1,213 @@
+#include "flow.h"
+
+static void print_symbol(Sink_t *const sink, const Symbol_t *const symbol) {
+    sink_write(sink, symbol->str.begin, symbol->str.end - symbol->str.begin);
+}
+
+static void print_operand_type(Sink_t *const sink, const DerivedType_t *const type) {
+    if (!type) {
+        sink_puts(sink, "?");
+        return;
+    }
+    Variable_t var;
+    var.name = NULL;
+    var.has_name = false;
+    var.type = (DerivedType_t *)type;
+    var.params.items = NULL;
+    var.params.size = 0;
+    print_variable(sink, &var);
+}
+
+/**
+ * Constants are sign-extended from signed types
+ */
+static bool is_signed_primitive(const DerivedType_t *const type) {
+    if (!type || type->variant != DERIVED_TYPE_TERMINAL || type->terminal.type.variant != TYPE_PRIMITIVE) {
+        return false;
+    }
+    switch (type->terminal.type.primitive) {
+        case PRIMITIVE_CHAR:
+        case PRIMITIVE_SHORT:
+        case PRIMITIVE_INT:
+        case PRIMITIVE_LONG:
+        case PRIMITIVE_LONG_LONG:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Named variables print as their names and temporaries as t<id>, followed by
+ * the version in SSA form
+ */
+size_t print_operand(Sink_t *const sink, const DataOperand_t *const operand) {
+    const size_t begin = sink->written;
+    if (!operand) {
+        sink_puts(sink, "?");
+        return sink->written - begin;
+    }
+    switch (operand->variant) {
+        case OPERAND_VARIABLE:
+            if (operand->data->name) {
+                print_symbol(sink, operand->data->name);
+            }
+            else {
+                sink_printf(sink, "t%u", operand->data->id);
+            }
+            if (operand->data->is_ssa) {
+                sink_printf(sink, ".%u", operand->version);
+            }
+            break;
+        case OPERAND_CONSTANT:
+            if (is_signed_primitive(operand->type)) {
+                sink_printf(sink, "%lld", (long long)operand->constant);
+            }
+            else {
+                sink_printf(sink, "%llu", (unsigned long long)operand->constant);
+            }
+            break;
+        case OPERAND_STRING:
+        case OPERAND_SYMBOL:
+            print_symbol(sink, operand->symbol);
+            break;
+        case OPERAND_TYPE:
+            print_operand_type(sink, operand->type);
+            break;
+        case OPERAND_INDIRECT:
+            sink_puts(sink, "*");
+            print_operand(sink, operand->base);
+            break;
+        case OPERAND_MEMBER:
+            if (operand->base && operand->base->variant == OPERAND_INDIRECT) {
+                print_operand(sink, operand->base->base);
+                sink_puts(sink, "->");
+            }
+            else {
+                print_operand(sink, operand->base);
+                sink_puts(sink, ".");
+            }
+            print_symbol(sink, operand->member);
+            break;
+    }
+    return sink->written - begin;
+}
+
+size_t print_operation(Sink_t *const sink, const DataOperation_t *const operation) {
+    const size_t begin = sink->written;
+    if (operation->out) {
+        print_operand(sink, operation->out);
+        sink_puts(sink, " = ");
+    }
+    switch (operation->op) {
+        case OP_ASSIGN:
+            print_operand(sink, operation->in1);
+            break;
+        case OP_CALL:
+            print_operand(sink, operation->in1);
+            sink_puts(sink, "(");
+            for (uint32_t i = 0; i < operation->n_args; ++i) {
+                if (i) {
+                    sink_puts(sink, ", ");
+                }
+                print_operand(sink, operation->args[i]);
+            }
+            sink_puts(sink, ")");
+            break;
+        case OP_CAST:
+            sink_puts(sink, "(");
+            print_operand_type(sink, operation->out ? operation->out->type : NULL);
+            sink_puts(sink, ")");
+            print_operand(sink, operation->in1);
+            break;
+        case OP_SIZEOF:
+            sink_puts(sink, "sizeof(");
+            print_operand(sink, operation->in1);
+            sink_puts(sink, ")");
+            break;
+        default:
+            if (operation->in2) {
+                print_operand(sink, operation->in1);
+                sink_printf(sink, " %s ", operator_token(operation->op));
+                print_operand(sink, operation->in2);
+            }
+            else {
+                sink_puts(sink, operator_token(operation->op));
+                print_operand(sink, operation->in1);
+            }
+            break;
+    }
+    return sink->written - begin;
+}
+
+/**
+ * Blocks print in creation order, each ending with how control leaves it;
+ * in SSA form, blocks that cannot be reached only say so
+ */
+size_t print_flow_function(Sink_t *const sink, const FlowFunction_t *const function) {
+    const size_t begin = sink->written;
+    if (function->name) {
+        print_symbol(sink, function->name);
+        sink_puts(sink, "(");
+        for (uint32_t i = 0; i < function->n_params; ++i) {
+            if (i) {
+                sink_puts(sink, ", ");
+            }
+            print_symbol(sink, function->params[i]->name);
+        }
+        sink_puts(sink, "):\n");
+    }
+    else {
+        sink_puts(sink, "top level:\n");
+    }
+    for (uint32_t i = 0; i < function->n_blocks; ++i) {
+        const BasicBlock_t *block = function->blocks[i];
+        sink_printf(sink, "b%u:\n", block->id);
+        if (function->is_ssa && block->rpo_index == UINT32_MAX) {
+            // Never renamed, so its operations would show stale versions
+            sink_puts(sink, "    unreachable\n");
+            continue;
+        }
+        for (const DataPhiLinkedListNode_t *it = block->phis; it; it = it->next) {
+            sink_puts(sink, "    ");
+            print_operand(sink, it->value->out);
+            sink_puts(sink, " = phi(");
+            for (uint32_t j = 0; j < block->n_preds; ++j) {
+                sink_printf(sink, "%sb%u: ", j ? ", " : "", block->preds[j]->id);
+                print_operand(sink, it->value->args[j]);
+            }
+            sink_puts(sink, ")\n");
+        }
+        for (const DataOperationLinkedListNode_t *it = block->ops; it; it = it->next) {
+            sink_puts(sink, "    ");
+            print_operation(sink, it->value);
+            sink_puts(sink, "\n");
+        }
+        if (block->returns) {
+            sink_puts(sink, "    return");
+            if (block->return_value) {
+                sink_puts(sink, " ");
+                print_operand(sink, block->return_value);
+            }
+            sink_puts(sink, "\n");
+        }
+        else if (block->branch) {
+            sink_puts(sink, "    if ");
+            print_operand(sink, block->predicate);
+            sink_printf(sink, " goto b%u else b%u\n", block->branch->id, block->next->id);
+        }
+        else if (block->next) {
+            sink_printf(sink, "    goto b%u\n", block->next->id);
+        }
+    }
+    return sink->written - begin;
+}
+
+size_t print_flow_program(Sink_t *const sink, const FlowProgram_t *const program) {
+    const size_t begin = sink->written;
+    print_flow_function(sink, program->top_level);
+    for (const FlowFunction_t *it = program->functions; it; it = it->next) {
+        print_flow_function(sink, it);
+    }
+    return sink->written - begin;
+}
@@ -0,0 +1,528 @@
+#include "flow.h"
+
+#include <assert.h>
+
+/**
+ * Unknown values have not been seen to take any value yet; a value only
+ * ever moves from unknown to constant to varying
+ */
+typedef enum {
+    LATTICE_UNKNOWN,
+    LATTICE_CONSTANT,
+    LATTICE_VARYING
+} LatticeLevel_t;
+
+typedef struct {
+    LatticeLevel_t level;
+    IntegerConstant_t value;
+} LatticeCell_t;
+
+/**
+ * Where a value is used: an operation, a phi, or the terminator of the
+ * block when both are NULL
+ */
+typedef struct {
+    BasicBlock_t *block;
+    DataOperation_t *operation;
+    DataPhi_t *phi;
+} UseSite_t;
+
+typedef struct {
+    BasicBlock_t *from;
+    uint32_t slot; // Index of the successor in `block_successors`
+} FlowEdge_t;
+
+typedef struct {
+    FlowProgram_t *program;
+    FlowFunction_t *function;
+    uint32_t *first_value; // Value of version 0 of each variable
+    LatticeCell_t *cells;
+    uint32_t *use_begin; // Uses of each value, as ranges of `uses`
+    UseSite_t *uses;
+    uint32_t n_uses;
+    bool *block_executable;
+    uint8_t *edge_executable; // One bit per successor slot
+    FlowEdge_t *edges; // Each edge is queued at most once
+    uint32_t n_edges;
+    UseSite_t *sites;
+    uint32_t n_sites;
+    uint32_t sites_capacity;
+    UseSite_t site; // While uses are collected
+} Sccp_t;
+
+static LatticeCell_t varying() {
+    LatticeCell_t cell;
+    memset(&cell, 0, sizeof(LatticeCell_t));
+    cell.level = LATTICE_VARYING;
+    return cell;
+}
+
+static LatticeCell_t unknown() {
+    LatticeCell_t cell;
+    memset(&cell, 0, sizeof(LatticeCell_t));
+    cell.level = LATTICE_UNKNOWN;
+    return cell;
+}
+
+static LatticeCell_t constant(const IntegerConstant_t value) {
+    LatticeCell_t cell;
+    cell.level = LATTICE_CONSTANT;
+    cell.value = value;
+    return cell;
+}
+
+static LatticeCell_t meet(const LatticeCell_t a, const LatticeCell_t b) {
+    if (a.level == LATTICE_UNKNOWN) {
+        return b;
+    }
+    if (b.level == LATTICE_UNKNOWN) {
+        return a;
+    }
+    if (a.level == LATTICE_VARYING || b.level == LATTICE_VARYING || a.value.bits != b.value.bits) {
+        return varying();
+    }
+    return a;
+}
+
+static uint32_t value_index(const Sccp_t *const sccp, const DataOperand_t *const operand) {
+    return sccp->first_value[operand->data->id] + operand->version;
+}
+
+static LatticeCell_t operand_cell(const Sccp_t *const sccp, const DataOperand_t *const operand) {
+    uint8_t size;
+    bool is_signed;
+    if (!operand) {
+        return varying();
+    }
+    switch (operand->variant) {
+        case OPERAND_CONSTANT:
+            if (integer_type(sccp->program, operand->type, &size, &is_signed)) {
+                return constant(new_integer_constant(operand->constant, size, is_signed));
+            }
+            return varying();
+        case OPERAND_VARIABLE:
+            return operand->data->is_ssa ? sccp->cells[value_index(sccp, operand)] : varying();
+        default:
+            return varying();
+    }
+}
+
+/**
+ * VALUES AND USES
+ * Versions of a variable are numbered from 0, so each variable gets a range
+ * of values as long as its highest version
+ */
+static void note_version(Sccp_t *const sccp, const DataOperand_t *const operand) {
+    uint32_t *highest = &sccp->first_value[operand->data->id];
+    *highest = operand->version > *highest ? operand->version : *highest;
+}
+
+static void number_values(Sccp_t *const sccp) {
+    const FlowFunction_t *function = sccp->function;
+    sccp->first_value = calloc(function->n_variables + 1, sizeof(uint32_t));
+    for (uint32_t i = 0; i < function->n_rpo; ++i) {
+        const BasicBlock_t *block = function->rpo[i];
+        for (const DataPhiLinkedListNode_t *it = block->phis; it; it = it->next) {
+            note_version(sccp, it->value->out);
+        }
+        for (const DataOperationLinkedListNode_t *it = block->ops; it; it = it->next) {
+            const DataOperand_t *def = operation_definition(it->value);
+            if (def) {
+                note_version(sccp, def);
+            }
+        }
+    }
+    uint32_t n_values = 0;
+    for (uint32_t v = 0; v < function->n_variables; ++v) {
+        const uint32_t n_versions = sccp->first_value[v] + 1;
+        sccp->first_value[v] = n_values;
+        n_values += n_versions;
+    }
+    sccp->first_value[function->n_variables] = n_values;
+    sccp->cells = malloc(n_values * sizeof(LatticeCell_t));
+    for (uint32_t v = 0; v < function->n_variables; ++v) {
+        // What a variable holds on entry is not known
+        sccp->cells[sccp->first_value[v]] = varying();
+        for (uint32_t i = sccp->first_value[v] + 1; i < sccp->first_value[v + 1]; ++i) {
+            sccp->cells[i] = unknown();
+        }
+    }
+}
+
+static void count_use(void *const user, DataOperand_t *const operand) {
+    Sccp_t *sccp = user;
+    ++sccp->use_begin[value_index(sccp, operand) + 1];
+}
+
+static void add_use(void *const user, DataOperand_t *const operand) {
+    Sccp_t *sccp = user;
+    sccp->uses[sccp->use_begin[value_index(sccp, operand)]++] = sccp->site;
+}
+
+/**
+ * Visit every use in the reachable blocks with the site it is in
+ */
+static void visit_uses(Sccp_t *const sccp, const UseVisitor_t visit) {
+    const FlowFunction_t *function = sccp->function;
+    for (uint32_t i = 0; i < function->n_rpo; ++i) {
+        BasicBlock_t *block = function->rpo[i];
+        sccp->site.block = block;
+        sccp->site.operation = NULL;
+        for (DataPhiLinkedListNode_t *it = block->phis; it; it = it->next) {
+            sccp->site.phi = it->value;
+            for (uint32_t j = 0; j < block->n_preds; ++j) {
+                visit(sccp, it->value->args[j]);
+            }
+        }
+        sccp->site.phi = NULL;
+        for (DataOperationLinkedListNode_t *it = block->ops; it; it = it->next) {
+            sccp->site.operation = it->value;
+            visit_operation_uses(it->value, visit, sccp);
+        }
+        sccp->site.operation = NULL;
+        visit_terminator_uses(block, visit, sccp);
+    }
+}
+
+/**
+ * Counted first, then filled, with `use_begin` shifted back into place
+ */
+static void collect_uses(Sccp_t *const sccp) {
+    const uint32_t n_values = sccp->first_value[sccp->function->n_variables];
+    sccp->use_begin = calloc(n_values + 1, sizeof(uint32_t));
+    visit_uses(sccp, count_use);
+    for (uint32_t i = 0; i < n_values; ++i) {
+        sccp->use_begin[i + 1] += sccp->use_begin[i];
+    }
+    sccp->n_uses = sccp->use_begin[n_values];
+    sccp->uses = malloc(sccp->n_uses * sizeof(UseSite_t));
+    visit_uses(sccp, add_use);
+    for (uint32_t i = n_values; i > 0; --i) {
+        sccp->use_begin[i] = sccp->use_begin[i - 1];
+    }
+    sccp->use_begin[0] = 0;
+}
+
+/**
+ * PROPAGATION
+ */
+static void queue_edge(Sccp_t *const sccp, BasicBlock_t *const from, const uint32_t slot) {
+    const uint8_t bit = 1 << slot;
+    if (sccp->edge_executable[from->id] & bit) {
+        return;
+    }
+    sccp->edge_executable[from->id] |= bit;
+    sccp->edges[sccp->n_edges].from = from;
+    sccp->edges[sccp->n_edges++].slot = slot;
+}
+
+static void queue_uses(Sccp_t *const sccp, const uint32_t value) {
+    const uint32_t n = sccp->use_begin[value + 1] - sccp->use_begin[value];
+    if (sccp->n_sites + n > sccp->sites_capacity) {
+        while (sccp->n_sites + n > sccp->sites_capacity) {
+            sccp->sites_capacity = sccp->sites_capacity ? 2 * sccp->sites_capacity : 64;
+        }
+        sccp->sites = realloc(sccp->sites, sccp->sites_capacity * sizeof(UseSite_t));
+    }
+    memcpy(&sccp->sites[sccp->n_sites], &sccp->uses[sccp->use_begin[value]], n * sizeof(UseSite_t));
+    sccp->n_sites += n;
+}
+
+static void update_cell(Sccp_t *const sccp, const DataOperand_t *const def, LatticeCell_t cell) {
+    const uint32_t value = value_index(sccp, def);
+    const LatticeCell_t old = sccp->cells[value];
+    if (old.level == LATTICE_CONSTANT && cell.level == LATTICE_CONSTANT && old.value.bits != cell.value.bits) {
+        cell = varying();
+    }
+    if (cell.level > old.level) {
+        sccp->cells[value] = cell;
+        queue_uses(sccp, value);
+    }
+}
+
+static bool edge_is_executable(const Sccp_t *const sccp, const BasicBlock_t *const from, const BasicBlock_t *const to) {
+    BasicBlock_t *succs[2];
+    const uint32_t n_succs = block_successors(from, succs);
+    for (uint32_t i = 0; i < n_succs; ++i) {
+        if (succs[i] == to && (sccp->edge_executable[from->id] >> i & 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void evaluate_phi(Sccp_t *const sccp, const BasicBlock_t *const block, const DataPhi_t *const phi) {
+    LatticeCell_t cell = unknown();
+    for (uint32_t j = 0; j < block->n_preds; ++j) {
+        if (edge_is_executable(sccp, block->preds[j], block)) {
+            cell = meet(cell, operand_cell(sccp, phi->args[j]));
+        }
+    }
+    update_cell(sccp, phi->out, cell);
+}
+
+/**
+ * A value is stored as the type of the variable it is assigned to
+ */
+static LatticeCell_t evaluate_operation_value(const Sccp_t *const sccp, const DataOperation_t *const operation, const DataOperand_t *const def) {
+    uint8_t size;
+    bool is_signed;
+    if (!integer_type(sccp->program, def->type, &size, &is_signed)) {
+        return varying();
+    }
+    LatticeCell_t in1, in2;
+    IntegerConstant_t value;
+    switch (operation->op) {
+        case OP_ASSIGN:
+        case OP_CAST:
+        case OP_POS:
+        case OP_NEG:
+        case OP_BITWISE_NOT:
+        case OP_LOGICAL_NOT:
+        case OP_SL:
+        case OP_SR:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_BITWISE_AND:
+        case OP_BITWISE_OR:
+        case OP_BITWISE_XOR:
+        case OP_EQ:
+        case OP_NE:
+        case OP_GT:
+        case OP_LT:
+        case OP_GE:
+        case OP_LE:
+            in1 = operand_cell(sccp, operation->in1);
+            in2 = operation->in2 ? operand_cell(sccp, operation->in2) : in1;
+            break;
+        default:
+            return varying();
+    }
+    if (in1.level == LATTICE_VARYING || in2.level == LATTICE_VARYING) {
+        return varying();
+    }
+    if (in1.level == LATTICE_UNKNOWN || in2.level == LATTICE_UNKNOWN) {
+        return unknown();
+    }
+    if (operation->op == OP_ASSIGN || operation->op == OP_CAST) {
+        value = in1.value;
+    }
+    else if (!evaluate_integer_operation(operation->op, in1.value, in2.value, &value)) {
+        return varying();
+    }
+    return constant(new_integer_constant(value.bits, size, is_signed));
+}
+
+static void evaluate_terminator(Sccp_t *const sccp, BasicBlock_t *const block) {
+    if (block->returns) {
+        return;
+    }
+    if (!block->branch) {
+        if (block->next) {
+            queue_edge(sccp, block, 0);
+        }
+        return;
+    }
+    const LatticeCell_t predicate = operand_cell(sccp, block->predicate);
+    if (predicate.level == LATTICE_UNKNOWN) {
+        return;
+    }
+    if (predicate.level == LATTICE_CONSTANT) {
+        // `branch` is the first successor, and `next` the second unless it is the same block
+        queue_edge(sccp, block, predicate.value.bits || block->next == block->branch ? 0 : 1);
+        return;
+    }
+    queue_edge(sccp, block, 0);
+    if (block->next != block->branch) {
+        queue_edge(sccp, block, 1);
+    }
+}
+
+static void evaluate_site(Sccp_t *const sccp, const UseSite_t *const site) {
+    if (site->phi) {
+        evaluate_phi(sccp, site->block, site->phi);
+    }
+    else if (site->operation) {
+        const DataOperand_t *def = operation_definition(site->operation);
+        if (def) {
+            update_cell(sccp, def, evaluate_operation_value(sccp, site->operation, def));
+        }
+    }
+    else {
+        evaluate_terminator(sccp, site->block);
+    }
+}
+
+/**
+ * The first edge into a block evaluates all of it; later ones can only
+ * change its phis
+ */
+static void visit_block(Sccp_t *const sccp, BasicBlock_t *const block) {
+    UseSite_t site = { block, NULL, NULL };
+    for (DataPhiLinkedListNode_t *it = block->phis; it; it = it->next) {
+        evaluate_phi(sccp, block, it->value);
+    }
+    if (sccp->block_executable[block->id]) {
+        return;
+    }
+    sccp->block_executable[block->id] = true;
+    for (DataOperationLinkedListNode_t *it = block->ops; it; it = it->next) {
+        site.operation = it->value;
+        evaluate_site(sccp, &site);
+    }
+    site.operation = NULL;
+    evaluate_site(sccp, &site);
+}
+
+static void propagate(Sccp_t *const sccp) {
+    uint32_t next_edge = 0;
+    visit_block(sccp, sccp->function->head_block);
+    while (next_edge < sccp->n_edges || sccp->n_sites) {
+        if (next_edge < sccp->n_edges) {
+            const FlowEdge_t edge = sccp->edges[next_edge++];
+            BasicBlock_t *succs[2];
+            block_successors(edge.from, succs);
+            visit_block(sccp, succs[edge.slot]);
+        }
+        else {
+            const UseSite_t site = sccp->sites[--sccp->n_sites];
+            if (sccp->block_executable[site.block->id]) {
+                evaluate_site(sccp, &site);
+            }
+        }
+    }
+}
+
+/**
+ * REWRITING
+ */
+static void replace_constant_use(void *const user, DataOperand_t *const operand) {
+    const Sccp_t *sccp = user;
+    const LatticeCell_t cell = operand_cell(sccp, operand);
+    if (cell.level == LATTICE_CONSTANT && operand->variant == OPERAND_VARIABLE) {
+        operand->variant = OPERAND_CONSTANT;
+        operand->constant = cell.value.bits;
+        operand->type = integer_constant_type(cell.value);
+        operand->version = 0;
+    }
+}
+
+static DataOperand_t *new_constant_operand(FlowProgram_t *const program, const IntegerConstant_t value) {
+    DataOperand_t *operand = flow_alloc(program, sizeof(DataOperand_t));
+    operand->variant = OPERAND_CONSTANT;
+    operand->constant = value.bits;
+    operand->type = integer_constant_type(value);
+    return operand;
+}
+
+static void rewrite_block(Sccp_t *const sccp, BasicBlock_t *const block) {
+    DataPhiLinkedListNode_t **phi = &block->phis;
+    while (*phi) {
+        if (operand_cell(sccp, (*phi)->value->out).level == LATTICE_CONSTANT) {
+            *phi = (*phi)->next;
+            continue;
+        }
+        for (uint32_t j = 0; j < block->n_preds; ++j) {
+            replace_constant_use(sccp, (*phi)->value->args[j]);
+        }
+        phi = &(*phi)->next;
+    }
+    for (DataOperationLinkedListNode_t *it = block->ops; it; it = it->next) {
+        DataOperation_t *operation = it->value;
+        const DataOperand_t *def = operation_definition(operation);
+        const LatticeCell_t cell = def ? operand_cell(sccp, def) : varying();
+        if (cell.level == LATTICE_CONSTANT) {
+            operation->op = OP_ASSIGN;
+            operation->in1 = new_constant_operand(sccp->program, cell.value);
+            operation->in2 = NULL;
+            operation->args = NULL;
+            operation->n_args = 0;
+        }
+        else {
+            visit_operation_uses(operation, replace_constant_use, sccp);
+        }
+    }
+    visit_terminator_uses(block, replace_constant_use, sccp);
+    if (!block->returns && block->branch && operand_cell(sccp, block->predicate).level == LATTICE_CONSTANT) {
+        block->next = block->predicate->constant ? block->branch : block->next;
+        block->branch = NULL;
+        block->predicate = NULL;
+    }
+}
+
+/**
+ * Recompute dominators and frontiers over the edges that are left, and keep
+ * each phi argument that still has its predecessor
+ */
+static void rebuild_control_flow(FlowProgram_t *const program, FlowFunction_t *const function) {
+    BasicBlock_t ***old_preds = malloc(function->n_blocks * sizeof(BasicBlock_t **));
+    uint32_t *old_n_preds = malloc(function->n_blocks * sizeof(uint32_t));
+    uint32_t *old_slot = malloc(function->n_blocks * sizeof(uint32_t));
+    for (uint32_t i = 0; i < function->n_blocks; ++i) {
+        old_preds[i] = function->blocks[i]->preds;
+        old_n_preds[i] = function->blocks[i]->n_preds;
+    }
+    compute_dominators(program, function);
+    compute_dominance_frontiers(program, function);
+    for (uint32_t i = 0; i < function->n_rpo; ++i) {
+        BasicBlock_t *block = function->rpo[i];
+        if (!block->phis) {
+            continue;
+        }
+        for (uint32_t j = 0; j < old_n_preds[block->id]; ++j) {
+            old_slot[old_preds[block->id][j]->id] = j;
+        }
+        for (DataPhiLinkedListNode_t *it = block->phis; it; it = it->next) {
+            DataOperand_t **args = flow_alloc(program, block->n_preds * sizeof(DataOperand_t *));
+            for (uint32_t j = 0; j < block->n_preds; ++j) {
+                args[j] = it->value->args[old_slot[block->preds[j]->id]];
+            }
+            it->value->args = args;
+        }
+    }
+    free(old_preds);
+    free(old_slot);
+    free(old_n_preds);
+}
+
+void propagate_constants(FlowProgram_t *const program, FlowFunction_t *const function) {
+    assert(function->is_ssa);
+    Sccp_t sccp;
+    memset(&sccp, 0, sizeof(Sccp_t));
+    sccp.program = program;
+    sccp.function = function;
+    number_values(&sccp);
+    collect_uses(&sccp);
+    sccp.block_executable = calloc(function->n_blocks, sizeof(bool));
+    sccp.edge_executable = calloc(function->n_blocks, sizeof(uint8_t));
+    sccp.edges = malloc(2 * function->n_blocks * sizeof(FlowEdge_t));
+    propagate(&sccp);
+
+    // Types of new constants are canonical, so they live in the parse context
+    ParseContext_t *prev_context = attach_parse_context(program->context);
+    for (uint32_t i = 0; i < function->n_rpo; ++i) {
+        if (sccp.block_executable[function->rpo[i]->id]) {
+            rewrite_block(&sccp, function->rpo[i]);
+        }
+    }
+    attach_parse_context(prev_context);
+    rebuild_control_flow(program, function);
+    free(sccp.first_value);
+    free(sccp.cells);
+    free(sccp.use_begin);
+    free(sccp.uses);
+    free(sccp.block_executable);
+    free(sccp.edge_executable);
+    free(sccp.edges);
+    free(sccp.sites);
+}
+
+void propagate_program_constants(FlowProgram_t *const program) {
+    propagate_constants(program, program->top_level);
+    for (FlowFunction_t *it = program->functions; it; it = it->next) {
+        propagate_constants(program, it);
+    }
+}
@@ -1,11 +1,159 @@
 #include "flow.h"
 
-bool is_declared_in_scope(const AConstString_t type_name, const DataScope_t *const scope) {
-    if (TypeNameMap_find(scope->types, type_name)) {
+#include <assert.h>
+
+SymbolTable_t new_scoped_symbol_table() {
+    SymbolTable_t output;
+    memset(&output, 0, sizeof(SymbolTable_t));
+    return output;
+}
+
+void free_scoped_symbol_table(SymbolTable_t *const table) {
+    for (int ns = 0; ns < NUM_SYMBOL_NAMESPACES; ++ns) {
+        SymbolBindingMap_free(&table->innermost[ns]);
+    }
+    free(table->log);
+    free(table->marks);
+    memset(table, 0, sizeof(SymbolTable_t));
+}
+
+void enter_scope(SymbolTable_t *const table, DataScope_t *const scope) {
+    if (table->depth == table->marks_capacity) {
+        table->marks_capacity = table->marks_capacity ? 2 * table->marks_capacity : 16;
+        table->marks = realloc(table->marks, table->marks_capacity * sizeof(SymbolTableMark_t));
+    }
+    table->marks[table->depth].scope = scope;
+    table->marks[table->depth].log_size = table->log_size;
+    ++table->depth;
+    scope->symbols = table;
+}
+
+void leave_scope(SymbolTable_t *const table) {
+    assert(table->depth);
+    const uint32_t log_size = table->marks[--table->depth].log_size;
+    while (table->log_size > log_size) {
+        const SymbolBinding_t *binding = &table->log[--table->log_size];
+        SymbolBindingMap_t *map = &table->innermost[binding->ns];
+        if (binding->shadowed == NO_SYMBOL_BINDING) {
+            SymbolBindingMap_remove(map, binding->name);
+        }
+        else {
+            SymbolBindingMap_get(map, binding->name)->value = binding->shadowed;
+        }
+    }
+}
+
+DataScope_t *current_scope(const SymbolTable_t *const table) {
+    return table->depth ? table->marks[table->depth - 1].scope : NULL;
+}
+
+const SymbolBinding_t *lookup_symbol(const SymbolTable_t *const table, const Symbol_t *const name, const SymbolNamespace_t ns) {
+    const SymbolBindingMapSlot_t *slot = SymbolBindingMap_find(&table->innermost[ns], name);
+    return slot ? &table->log[slot->value] : NULL;
+}
+
+/**
+ * Append a binding that shadows the current innermost one for its name
+ */
+static SymbolBinding_t *push_binding(SymbolTable_t *const table, const Symbol_t *const name, const SymbolNamespace_t ns) {
+    if (table->log_size == table->log_capacity) {
+        table->log_capacity = table->log_capacity ? 2 * table->log_capacity : 64;
+        table->log = realloc(table->log, table->log_capacity * sizeof(SymbolBinding_t));
+    }
+    const uint32_t index = table->log_size++;
+    SymbolBinding_t *binding = &table->log[index];
+    binding->name = name;
+    binding->ns = ns;
+    binding->scope = current_scope(table);
+    binding->is_definition = false;
+    SymbolBindingMapSlot_t *slot = SymbolBindingMap_get(&table->innermost[ns], name);
+    if (slot) {
+        binding->shadowed = slot->value;
+        slot->value = index;
+    }
+    else {
+        binding->shadowed = NO_SYMBOL_BINDING;
+        SymbolBindingMap_insert(&table->innermost[ns], name, index);
+    }
+    return binding;
+}
+
+static bool declare_in_namespace(SymbolTable_t *const table, const SymbolNamespace_t ns, TypeNameMap_t *const map, const Symbol_t *const name, const DerivedType_t *const type, const bool is_definition) {
+    DataScope_t *scope = current_scope(table);
+    SymbolBinding_t *binding = (SymbolBinding_t *)lookup_symbol(table, name, ns);
+    if (binding && binding->scope == scope) {
+        if (binding->is_definition && is_definition) {
+            return false;
+        }
+        // A definition completes an earlier declaration in the same scope
+        if (is_definition) {
+            binding->type = type;
+            binding->is_definition = true;
+            TypeNameMap_get(map, name)->value.type = type;
+            TypeNameMap_get(map, name)->value.is_definition = true;
+        }
         return true;
     }
-    else if (scope->location.parent_scope) {
-        return is_declared_in_scope(type_name, scope->location.parent_scope);
+    binding = push_binding(table, name, ns);
+    binding->type = type;
+    binding->is_definition = is_definition;
+    TypeName_t type_name;
+    type_name.type = type;
+    type_name.is_definition = is_definition;
+    TypeNameMap_insert(map, name, type_name);
+    return true;
+}
+
+bool declare_type(SymbolTable_t *const table, const Symbol_t *const name, const DerivedType_t *const type, const bool is_definition) {
+    return declare_in_namespace(table, SYMBOL_NAMESPACE_TYPE, &current_scope(table)->types, name, type, is_definition);
+}
+
+bool declare_tag(SymbolTable_t *const table, const Symbol_t *const name, const DerivedType_t *const type, const bool is_definition) {
+    return declare_in_namespace(table, SYMBOL_NAMESPACE_TAG, &current_scope(table)->tags, name, type, is_definition);
+}
+
+bool declare_variable(SymbolTable_t *const table, const Symbol_t *const name, DataVariable_t *const variable) {
+    DataScope_t *scope = current_scope(table);
+    const SymbolBinding_t *existing = lookup_symbol(table, name, SYMBOL_NAMESPACE_VARIABLE);
+    if (existing && existing->scope == scope) {
+        return false;
+    }
+    SymbolBinding_t *binding = push_binding(table, name, SYMBOL_NAMESPACE_VARIABLE);
+    binding->variable = variable;
+    binding->is_definition = true;
+    variable->scope = scope;
+    DataVariableMap_insert(&scope->variables, name, variable);
+    return true;
+}
+
+/**
+ * The typedef name `name` as seen from `scope`; false if it is not visible
+ */
+static bool find_type_name(const Symbol_t *const name, const DataScope_t *const scope, TypeName_t *const output) {
+    if (scope->symbols && current_scope(scope->symbols) == scope) {
+        const SymbolBinding_t *binding = lookup_symbol(scope->symbols, name, SYMBOL_NAMESPACE_TYPE);
+        if (binding) {
+            output->type = binding->type;
+            output->is_definition = binding->is_definition;
+        }
+        return binding;
+    }
+    for (const DataScope_t *it = scope; it; it = it->location.parent_scope) {
+        const TypeNameMapSlot_t *slot = TypeNameMap_find(&it->types, name);
+        if (slot) {
+            *output = slot->value;
+            return true;
+        }
     }
     return false;
-}
\ No newline at end of file
+}
+
+bool is_type_declared_in_scope(const Symbol_t *const type_name, const DataScope_t *const scope) {
+    TypeName_t found;
+    return find_type_name(type_name, scope, &found);
+}
+
+bool is_defined_in_scope(const Symbol_t *const type_name, const DataScope_t *const scope) {
+    TypeName_t found;
+    return find_type_name(type_name, scope, &found) && found.is_definition;
+}
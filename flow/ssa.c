@@ -0,0 +1,632 @@
+#include "flow.h"
+
+#include <assert.h>
+
+#define NO_BLOCK UINT32_MAX
+#define NO_INDEX UINT32_MAX
+
+uint32_t block_successors(const BasicBlock_t *const block, BasicBlock_t *output[2]) {
+    uint32_t n = 0;
+    if (block->returns) {
+        return 0;
+    }
+    if (block->branch) {
+        output[n++] = block->branch;
+    }
+    if (block->next && block->next != block->branch) {
+        output[n++] = block->next;
+    }
+    return n;
+}
+
+/**
+ * Number the reachable blocks in reverse postorder with an explicit stack
+ */
+static void compute_rpo(FlowProgram_t *const program, FlowFunction_t *const function) {
+    typedef struct {
+        BasicBlock_t *block;
+        uint32_t n_visited;
+    } DfsFrame_t;
+    DfsFrame_t *stack = malloc(function->n_blocks * sizeof(DfsFrame_t));
+    BasicBlock_t **postorder = malloc(function->n_blocks * sizeof(BasicBlock_t *));
+    bool *visited = calloc(function->n_blocks, sizeof(bool));
+    uint32_t size = 0;
+    uint32_t n_postorder = 0;
+    for (uint32_t i = 0; i < function->n_blocks; ++i) {
+        function->blocks[i]->rpo_index = NO_BLOCK;
+    }
+
+    stack[size].block = function->head_block;
+    stack[size++].n_visited = 0;
+    visited[function->head_block->id] = true;
+    while (size) {
+        DfsFrame_t *top = &stack[size - 1];
+        BasicBlock_t *succs[2];
+        const uint32_t n_succs = block_successors(top->block, succs);
+        if (top->n_visited < n_succs) {
+            BasicBlock_t *succ = succs[top->n_visited++];
+            if (!visited[succ->id]) {
+                visited[succ->id] = true;
+                stack[size].block = succ;
+                stack[size++].n_visited = 0;
+            }
+        }
+        else {
+            postorder[n_postorder++] = top->block;
+            --size;
+        }
+    }
+
+    function->n_rpo = n_postorder;
+    function->rpo = flow_alloc(program, n_postorder * sizeof(BasicBlock_t *));
+    for (uint32_t i = 0; i < n_postorder; ++i) {
+        function->rpo[i] = postorder[n_postorder - 1 - i];
+        function->rpo[i]->rpo_index = i;
+    }
+    free(stack);
+    free(postorder);
+    free(visited);
+}
+
+static void compute_predecessors(FlowProgram_t *const program, FlowFunction_t *const function) {
+    for (uint32_t i = 0; i < function->n_blocks; ++i) {
+        function->blocks[i]->n_preds = 0;
+        function->blocks[i]->preds = NULL;
+    }
+    BasicBlock_t *succs[2];
+    for (uint32_t i = 0; i < function->n_rpo; ++i) {
+        const uint32_t n_succs = block_successors(function->rpo[i], succs);
+        for (uint32_t j = 0; j < n_succs; ++j) {
+            ++succs[j]->n_preds;
+        }
+    }
+    for (uint32_t i = 0; i < function->n_rpo; ++i) {
+        BasicBlock_t *block = function->rpo[i];
+        block->preds = flow_alloc(program, block->n_preds * sizeof(BasicBlock_t *));
+        block->n_preds = 0;
+    }
+    for (uint32_t i = 0; i < function->n_rpo; ++i) {
+        const uint32_t n_succs = block_successors(function->rpo[i], succs);
+        for (uint32_t j = 0; j < n_succs; ++j) {
+            succs[j]->preds[succs[j]->n_preds++] = function->rpo[i];
+        }
+    }
+}
+
+/**
+ * Children of each block in the dominator tree as linked lists over block ids
+ */
+static void dominator_children(const FlowFunction_t *const function, uint32_t *const first_child, uint32_t *const next_sibling) {
+    for (uint32_t i = 0; i < function->n_blocks; ++i) {
+        first_child[i] = NO_BLOCK;
+        next_sibling[i] = NO_BLOCK;
+    }
+    // Backwards, so that children end up in reverse postorder
+    for (uint32_t i = function->n_rpo; i-- > 1;) {
+        const BasicBlock_t *block = function->rpo[i];
+        next_sibling[block->id] = first_child[block->idom->id];
+        first_child[block->idom->id] = block->id;
+    }
+}
+
+static BasicBlock_t *intersect(BasicBlock_t *a, BasicBlock_t *b) {
+    while (a != b) {
+        while (a->rpo_index > b->rpo_index) {
+            a = a->idom;
+        }
+        while (b->rpo_index > a->rpo_index) {
+            b = b->idom;
+        }
+    }
+    return a;
+}
+
+void compute_dominators(FlowProgram_t *const program, FlowFunction_t *const function) {
+    compute_rpo(program, function);
+    compute_predecessors(program, function);
+    for (uint32_t i = 0; i < function->n_blocks; ++i) {
+        function->blocks[i]->idom = NULL;
+    }
+    BasicBlock_t *head = function->head_block;
+    head->idom = head;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = 1; i < function->n_rpo; ++i) {
+            BasicBlock_t *block = function->rpo[i];
+            BasicBlock_t *idom = NULL;
+            for (uint32_t j = 0; j < block->n_preds; ++j) {
+                BasicBlock_t *pred = block->preds[j];
+                if (pred->idom) {
+                    idom = idom ? intersect(pred, idom) : pred;
+                }
+            }
+            if (idom != block->idom) {
+                block->idom = idom;
+                changed = true;
+            }
+        }
+    }
+    head->idom = NULL;
+
+    // Preorder and postorder numbers answer dominance queries in O(1)
+    uint32_t *first_child = malloc(function->n_blocks * sizeof(uint32_t));
+    uint32_t *next_sibling = malloc(function->n_blocks * sizeof(uint32_t));
+    uint32_t *stack = malloc(function->n_blocks * sizeof(uint32_t));
+    uint32_t *child = malloc(function->n_blocks * sizeof(uint32_t));
+    dominator_children(function, first_child, next_sibling);
+    uint32_t size = 0;
+    uint32_t pre = 0;
+    uint32_t post = 0;
+    stack[size++] = head->id;
+    head->dom_pre = pre++;
+    child[head->id] = first_child[head->id];
+    while (size) {
+        const uint32_t top = stack[size - 1];
+        if (child[top] != NO_BLOCK) {
+            const uint32_t next = child[top];
+            child[top] = next_sibling[next];
+            function->blocks[next]->dom_pre = pre++;
+            child[next] = first_child[next];
+            stack[size++] = next;
+        }
+        else {
+            function->blocks[top]->dom_post = post++;
+            --size;
+        }
+    }
+    free(first_child);
+    free(next_sibling);
+    free(stack);
+    free(child);
+}
+
+bool dominates(const BasicBlock_t *const dominator, const BasicBlock_t *const block) {
+    if (dominator->rpo_index == NO_BLOCK || block->rpo_index == NO_BLOCK) {
+        return false;
+    }
+    return dominator->dom_pre <= block->dom_pre && block->dom_post <= dominator->dom_post;
+}
+
+/**
+ * Walking up from each predecessor of a join block to the join block's
+ * immediate dominator passes exactly the blocks it is in the frontier of
+ */
+void compute_dominance_frontiers(FlowProgram_t *const program, FlowFunction_t *const function) {
+    uint32_t *last_added = malloc(function->n_blocks * sizeof(uint32_t));
+    for (int pass = 0; pass < 2; ++pass) {
+        for (uint32_t i = 0; i < function->n_blocks; ++i) {
+            last_added[i] = NO_BLOCK;
+        }
+        for (uint32_t i = 0; i < function->n_rpo; ++i) {
+            BasicBlock_t *block = function->rpo[i];
+            if (pass) {
+                block->frontier = flow_alloc(program, block->n_frontier * sizeof(BasicBlock_t *));
+            }
+            block->n_frontier = 0;
+        }
+        // The first pass counts, the second fills
+        for (uint32_t i = 0; i < function->n_rpo; ++i) {
+            BasicBlock_t *block = function->rpo[i];
+            if (block->n_preds < 2) {
+                continue;
+            }
+            for (uint32_t j = 0; j < block->n_preds; ++j) {
+                for (BasicBlock_t *runner = block->preds[j]; runner != block->idom; runner = runner->idom) {
+                    if (last_added[runner->id] == block->id) {
+                        break;
+                    }
+                    last_added[runner->id] = block->id;
+                    if (pass) {
+                        runner->frontier[runner->n_frontier] = block;
+                    }
+                    ++runner->n_frontier;
+                }
+            }
+        }
+    }
+    free(last_added);
+}
+
+/**
+ * USES AND DEFINITIONS
+ */
+static void visit_operand_uses(DataOperand_t *const operand, const UseVisitor_t visit, void *const user) {
+    if (!operand) {
+        return;
+    }
+    switch (operand->variant) {
+        case OPERAND_VARIABLE:
+            if (operand->data->is_ssa) {
+                visit(user, operand);
+            }
+            break;
+        case OPERAND_INDIRECT:
+        case OPERAND_MEMBER:
+            visit_operand_uses(operand->base, visit, user);
+            break;
+        default:
+            break;
+    }
+}
+
+void visit_operation_uses(DataOperation_t *const operation, const UseVisitor_t visit, void *const user) {
+    visit_operand_uses(operation->in1, visit, user);
+    visit_operand_uses(operation->in2, visit, user);
+    for (uint32_t i = 0; i < operation->n_args; ++i) {
+        visit_operand_uses(operation->args[i], visit, user);
+    }
+    if (operation->out && operation->out->variant != OPERAND_VARIABLE) {
+        visit_operand_uses(operation->out, visit, user);
+    }
+}
+
+DataOperand_t *operation_definition(const DataOperation_t *const operation) {
+    DataOperand_t *out = operation->out;
+    return out && out->variant == OPERAND_VARIABLE && out->data->is_ssa ? out : NULL;
+}
+
+void visit_terminator_uses(BasicBlock_t *const block, const UseVisitor_t visit, void *const user) {
+    if (block->returns) {
+        visit_operand_uses(block->return_value, visit, user);
+    }
+    else if (block->branch) {
+        visit_operand_uses(block->predicate, visit, user);
+    }
+}
+
+/**
+ * OCCURRENCES
+ * One pass over the operations lists, for each variable, the blocks that
+ * define it and the blocks that use it before any definition in the block,
+ * each block once. Only variables with such a use can be live across blocks,
+ * and most temporaries have none
+ */
+typedef struct {
+    uint32_t variable;
+    uint32_t block;
+} Occurrence_t;
+
+typedef struct {
+    Occurrence_t *items;
+    uint32_t size;
+    uint32_t capacity;
+} OccurrenceList_t;
+
+/**
+ * Blocks of each variable as ranges of `blocks`, indexed by variable id
+ */
+typedef struct {
+    uint32_t *begin;
+    uint32_t *blocks;
+} BlockSets_t;
+
+typedef struct {
+    OccurrenceList_t defs;
+    OccurrenceList_t exposed;
+    uint32_t *defined_in; // Last block each variable was defined in
+    uint32_t *exposed_in; // Last block each variable was noted exposed in
+    uint32_t block;
+} OccurrenceVisit_t;
+
+static void append_occurrence(OccurrenceList_t *const list, const uint32_t variable, const uint32_t block) {
+    if (list->size == list->capacity) {
+        list->capacity = list->capacity ? 2 * list->capacity : 64;
+        list->items = realloc(list->items, list->capacity * sizeof(Occurrence_t));
+    }
+    list->items[list->size].variable = variable;
+    list->items[list->size++].block = block;
+}
+
+static void note_use(void *const user, DataOperand_t *const operand) {
+    OccurrenceVisit_t *visit = user;
+    const uint32_t id = operand->data->id;
+    if (visit->defined_in[id] != visit->block && visit->exposed_in[id] != visit->block) {
+        visit->exposed_in[id] = visit->block;
+        append_occurrence(&visit->exposed, id, visit->block);
+    }
+}
+
+/**
+ * Counting sort by variable, which keeps the blocks of each in rpo
+ */
+static BlockSets_t group_by_variable(const OccurrenceList_t *const list, const uint32_t n_variables) {
+    BlockSets_t sets;
+    sets.begin = calloc(n_variables + 1, sizeof(uint32_t));
+    sets.blocks = malloc(list->size * sizeof(uint32_t));
+    for (uint32_t i = 0; i < list->size; ++i) {
+        ++sets.begin[list->items[i].variable + 1];
+    }
+    for (uint32_t v = 0; v < n_variables; ++v) {
+        sets.begin[v + 1] += sets.begin[v];
+    }
+    for (uint32_t i = 0; i < list->size; ++i) {
+        sets.blocks[sets.begin[list->items[i].variable]++] = list->items[i].block;
+    }
+    for (uint32_t v = n_variables; v > 0; --v) {
+        sets.begin[v] = sets.begin[v - 1];
+    }
+    sets.begin[0] = 0;
+    return sets;
+}
+
+static void free_block_sets(BlockSets_t *const sets) {
+    free(sets->begin);
+    free(sets->blocks);
+}
+
+static void collect_occurrences(const FlowFunction_t *const function, BlockSets_t *const defs, BlockSets_t *const exposed) {
+    OccurrenceVisit_t visit;
+    memset(&visit, 0, sizeof(OccurrenceVisit_t));
+    visit.defined_in = malloc(function->n_variables * sizeof(uint32_t));
+    visit.exposed_in = malloc(function->n_variables * sizeof(uint32_t));
+    for (uint32_t v = 0; v < function->n_variables; ++v) {
+        visit.defined_in[v] = NO_BLOCK;
+        visit.exposed_in[v] = NO_BLOCK;
+    }
+    for (uint32_t i = 0; i < function->n_rpo; ++i) {
+        BasicBlock_t *block = function->rpo[i];
+        visit.block = block->id;
+        for (DataOperationLinkedListNode_t *it = block->ops; it; it = it->next) {
+            visit_operation_uses(it->value, note_use, &visit);
+            const DataOperand_t *def = operation_definition(it->value);
+            if (def && visit.defined_in[def->data->id] != block->id) {
+                visit.defined_in[def->data->id] = block->id;
+                append_occurrence(&visit.defs, def->data->id, block->id);
+            }
+        }
+        visit_terminator_uses(block, note_use, &visit);
+    }
+    *defs = group_by_variable(&visit.defs, function->n_variables);
+    *exposed = group_by_variable(&visit.exposed, function->n_variables);
+    free(visit.defs.items);
+    free(visit.exposed.items);
+    free(visit.defined_in);
+    free(visit.exposed_in);
+}
+
+/**
+ * PHI PLACEMENT
+ */
+static void add_phi(FlowProgram_t *const program, BasicBlock_t *const block, DataVariable_t *const variable) {
+    DataPhi_t *phi = flow_alloc(program, sizeof(DataPhi_t));
+    phi->variable = variable;
+    phi->out = flow_alloc(program, sizeof(DataOperand_t));
+    phi->out->variant = OPERAND_VARIABLE;
+    phi->out->data = variable;
+    phi->out->type = variable->type;
+    phi->args = flow_alloc(program, block->n_preds * sizeof(DataOperand_t *));
+    DataPhiLinkedListNode_t *node = flow_alloc(program, sizeof(DataPhiLinkedListNode_t));
+    node->value = phi;
+    node->next = block->phis;
+    block->phis = node;
+}
+
+/**
+ * Per-block marks, stamped with the variable they are for so that they never
+ * need clearing
+ */
+typedef struct {
+    uint32_t *defines;
+    uint32_t *live_in;
+    uint32_t *has_phi;
+    uint32_t *queued;
+    BasicBlock_t **worklist;
+} PhiPlacement_t;
+
+/**
+ * A variable is live into the blocks that use it before defining it, and into
+ * each predecessor of a block it is live into unless that predecessor defines
+ * it. Walking backwards from its uses only visits where it is live
+ */
+static void mark_live_in(const FlowFunction_t *const function, PhiPlacement_t *const placement, const BlockSets_t *const exposed, const uint32_t v) {
+    uint32_t size = 0;
+    for (uint32_t i = exposed->begin[v]; i < exposed->begin[v + 1]; ++i) {
+        placement->live_in[exposed->blocks[i]] = v;
+        placement->worklist[size++] = function->blocks[exposed->blocks[i]];
+    }
+    while (size) {
+        const BasicBlock_t *block = placement->worklist[--size];
+        for (uint32_t j = 0; j < block->n_preds; ++j) {
+            BasicBlock_t *pred = block->preds[j];
+            if (placement->live_in[pred->id] != v && placement->defines[pred->id] != v) {
+                placement->live_in[pred->id] = v;
+                placement->worklist[size++] = pred;
+            }
+        }
+    }
+}
+
+/**
+ * Phis go on the iterated dominance frontier of the defining blocks, where
+ * the variable is live; the work for each variable is bounded by the blocks
+ * it is live in or defined in, and their frontiers
+ */
+static void place_phis(FlowProgram_t *const program, FlowFunction_t *const function, const BlockSets_t *const defs, const BlockSets_t *const exposed) {
+    PhiPlacement_t placement;
+    placement.defines = malloc(function->n_blocks * sizeof(uint32_t));
+    placement.live_in = malloc(function->n_blocks * sizeof(uint32_t));
+    placement.has_phi = malloc(function->n_blocks * sizeof(uint32_t));
+    placement.queued = malloc(function->n_blocks * sizeof(uint32_t));
+    placement.worklist = malloc(function->n_blocks * sizeof(BasicBlock_t *));
+    for (uint32_t i = 0; i < function->n_blocks; ++i) {
+        placement.defines[i] = NO_INDEX;
+        placement.live_in[i] = NO_INDEX;
+        placement.has_phi[i] = NO_INDEX;
+        placement.queued[i] = NO_INDEX;
+    }
+    for (uint32_t v = 0; v < function->n_variables; ++v) {
+        // A variable that is never live across blocks needs no phis
+        if (exposed->begin[v] == exposed->begin[v + 1] || defs->begin[v] == defs->begin[v + 1]) {
+            continue;
+        }
+        for (uint32_t i = defs->begin[v]; i < defs->begin[v + 1]; ++i) {
+            placement.defines[defs->blocks[i]] = v;
+        }
+        mark_live_in(function, &placement, exposed, v);
+        uint32_t size = 0;
+        for (uint32_t i = defs->begin[v]; i < defs->begin[v + 1]; ++i) {
+            placement.queued[defs->blocks[i]] = v;
+            placement.worklist[size++] = function->blocks[defs->blocks[i]];
+        }
+        while (size) {
+            const BasicBlock_t *block = placement.worklist[--size];
+            for (uint32_t i = 0; i < block->n_frontier; ++i) {
+                BasicBlock_t *frontier = block->frontier[i];
+                if (placement.has_phi[frontier->id] == v || placement.live_in[frontier->id] != v) {
+                    continue;
+                }
+                placement.has_phi[frontier->id] = v;
+                add_phi(program, frontier, function->variables[v]);
+                if (placement.queued[frontier->id] != v) {
+                    placement.queued[frontier->id] = v;
+                    placement.worklist[size++] = frontier;
+                }
+            }
+        }
+    }
+    free(placement.defines);
+    free(placement.live_in);
+    free(placement.has_phi);
+    free(placement.queued);
+    free(placement.worklist);
+}
+
+/**
+ * RENAMING
+ * Each variable's current version, with an undo log to restore them when the
+ * walk leaves a subtree of the dominator tree
+ */
+typedef struct {
+    uint32_t variable;
+    uint32_t version;
+} VersionLogEntry_t;
+
+typedef struct {
+    uint32_t *current;
+    uint32_t *n_versions;
+    VersionLogEntry_t *log;
+    uint32_t log_size;
+    uint32_t log_capacity;
+} Renamer_t;
+
+static void rename_use(void *const user, DataOperand_t *const operand) {
+    Renamer_t *renamer = user;
+    operand->version = renamer->current[operand->data->id];
+}
+
+static void rename_definition(Renamer_t *const renamer, DataOperand_t *const operand) {
+    const uint32_t id = operand->data->id;
+    if (renamer->log_size == renamer->log_capacity) {
+        renamer->log_capacity = renamer->log_capacity ? 2 * renamer->log_capacity : 64;
+        renamer->log = realloc(renamer->log, renamer->log_capacity * sizeof(VersionLogEntry_t));
+    }
+    renamer->log[renamer->log_size].variable = id;
+    renamer->log[renamer->log_size++].version = renamer->current[id];
+    operand->version = ++renamer->n_versions[id];
+    renamer->current[id] = operand->version;
+}
+
+static void rename_block(FlowProgram_t *const program, Renamer_t *const renamer, BasicBlock_t *const block) {
+    for (DataPhiLinkedListNode_t *it = block->phis; it; it = it->next) {
+        rename_definition(renamer, it->value->out);
+    }
+    for (DataOperationLinkedListNode_t *it = block->ops; it; it = it->next) {
+        visit_operation_uses(it->value, rename_use, renamer);
+        DataOperand_t *def = operation_definition(it->value);
+        if (def) {
+            rename_definition(renamer, def);
+        }
+    }
+    visit_terminator_uses(block, rename_use, renamer);
+
+    BasicBlock_t *succs[2];
+    const uint32_t n_succs = block_successors(block, succs);
+    for (uint32_t i = 0; i < n_succs; ++i) {
+        BasicBlock_t *succ = succs[i];
+        for (uint32_t j = 0; j < succ->n_preds; ++j) {
+            if (succ->preds[j] != block) {
+                continue;
+            }
+            for (DataPhiLinkedListNode_t *it = succ->phis; it; it = it->next) {
+                DataOperand_t *arg = flow_alloc(program, sizeof(DataOperand_t));
+                *arg = *it->value->out;
+                arg->version = renamer->current[it->value->variable->id];
+                it->value->args[j] = arg;
+            }
+        }
+    }
+}
+
+static void rename_variables(FlowProgram_t *const program, FlowFunction_t *const function) {
+    typedef struct {
+        uint32_t block;
+        uint32_t child;
+        uint32_t log_size;
+    } RenameFrame_t;
+    Renamer_t renamer;
+    renamer.current = calloc(function->n_variables, sizeof(uint32_t));
+    renamer.n_versions = calloc(function->n_variables, sizeof(uint32_t));
+    renamer.log = NULL;
+    renamer.log_size = 0;
+    renamer.log_capacity = 0;
+    uint32_t *first_child = malloc(function->n_blocks * sizeof(uint32_t));
+    uint32_t *next_sibling = malloc(function->n_blocks * sizeof(uint32_t));
+    RenameFrame_t *stack = malloc(function->n_blocks * sizeof(RenameFrame_t));
+    dominator_children(function, first_child, next_sibling);
+
+    uint32_t size = 0;
+    rename_block(program, &renamer, function->head_block);
+    stack[size].block = function->head_block->id;
+    stack[size].child = first_child[function->head_block->id];
+    stack[size++].log_size = 0;
+    while (size) {
+        RenameFrame_t *top = &stack[size - 1];
+        if (top->child != NO_BLOCK) {
+            const uint32_t child = top->child;
+            top->child = next_sibling[child];
+            stack[size].block = child;
+            stack[size].child = first_child[child];
+            stack[size++].log_size = renamer.log_size;
+            rename_block(program, &renamer, function->blocks[child]);
+        }
+        else {
+            while (renamer.log_size > top->log_size) {
+                const VersionLogEntry_t *entry = &renamer.log[--renamer.log_size];
+                renamer.current[entry->variable] = entry->version;
+            }
+            --size;
+        }
+    }
+    free(renamer.current);
+    free(renamer.n_versions);
+    free(renamer.log);
+    free(first_child);
+    free(next_sibling);
+    free(stack);
+}
+
+void build_ssa(FlowProgram_t *const program, FlowFunction_t *const function) {
+    assert(!function->is_ssa);
+    for (uint32_t i = 0; i < function->n_variables; ++i) {
+        DataVariable_t *variable = function->variables[i];
+        // Top-level variables are globals that functions share
+        variable->is_ssa = !variable->address_taken && (function->name || variable->scope != function->scope);
+    }
+    compute_dominators(program, function);
+    compute_dominance_frontiers(program, function);
+    BlockSets_t defs, exposed;
+    collect_occurrences(function, &defs, &exposed);
+    place_phis(program, function, &defs, &exposed);
+    free_block_sets(&defs);
+    free_block_sets(&exposed);
+    rename_variables(program, function);
+    function->is_ssa = true;
+}
+
+void build_program_ssa(FlowProgram_t *const program) {
+    build_ssa(program, program->top_level);
+    for (FlowFunction_t *it = program->functions; it; it = it->next) {
+        build_ssa(program, it);
+    }
+}
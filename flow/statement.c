@@ -2,76 +2,340 @@
 
 #include <assert.h>
 
-static bool try_declare_type(const Type_t *const type, DataScope_t *const scope, FlowError_t ***errors) {
-    const Type_t *current = type;
-    if (type->variant == TYPE_NAMED) {
-        return TypeNameMap_find(scope->types, type->named);
-    }
-    else if (type->variant == TYPE_ENUM) {
-        if (type->compound.has_name) {
-            bool type_already_registered = is_declared_in_scope(type->compound.name, scope);
-            if (type->compound.is_definition) {
-                if (type_already_registered) {
-                    append_error(errors,
-                        FLOW_ERROR,
-                        type->compound.name,
-                        "Type is already defined");
-                    return false;
-                }
-                DerivedType_t *der = malloc(sizeof(DerivedType_t));
-                der->variant = DERIVED_TYPE_TERMINAL;
-                der->terminal.qualifier = QUALIFIER_NONE;
-                der->terminal.type = *type;
-                TypeNameMap_insert(&scope->types, type->compound.name, der);
-            }
-            else {
-                if (!type_already_registered) {
-                    append_error(errors,
-                        FLOW_ERROR,
-                        type->compound.name,
-                        "Type is not defined");
-                    return false;
-                }
-                return true;
+static DataScope_t *new_data_scope(FlowProgram_t *const program) {
+    DataScope_t *scope = flow_alloc(program, sizeof(DataScope_t));
+    DataScope_t *parent = current_scope(&program->symbols);
+    scope->location.parent_scope = parent;
+    if (parent) {
+        DataScopeLinkedListNode_t *node = flow_alloc(program, sizeof(DataScopeLinkedListNode_t));
+        node->value = scope;
+        node->next = parent->scopes;
+        parent->scopes = node;
+    }
+    return scope;
+}
+
+/**
+ * Register struct, union and enum tags; a tag that is only mentioned is
+ * declared unless an outer one is visible, and a definition must be the only
+ * one in its scope
+ */
+static void declare_tagged_type(FlowBuilder_t *const builder, const Type_t *const type) {
+    if (type->variant != TYPE_STRUCT && type->variant != TYPE_UNION && type->variant != TYPE_ENUM) {
+        return;
+    }
+    if (type->compound.has_name) {
+        SymbolTable_t *symbols = &builder->program->symbols;
+        DerivedType_t der;
+        memset(&der, 0, sizeof(DerivedType_t));
+        der.variant = DERIVED_TYPE_TERMINAL;
+        der.terminal.qualifier = QUALIFIER_NONE;
+        der.terminal.type = *type;
+        if (type->compound.is_definition) {
+            const DerivedType_t *definition = canonical_derived_type(&der);
+            if (!declare_tag(symbols, type->compound.name, definition, true)) {
+                flow_error(builder, "Type is already defined");
             }
+            // Names used by the fields resolve here
+            derived_type_layout(builder->program, definition);
         }
-        if (type->compound.is_definition) {
-            
+        else if (!lookup_symbol(symbols, type->compound.name, SYMBOL_NAMESPACE_TAG)) {
+            declare_tag(symbols, type->compound.name, canonical_derived_type(&der), false);
+        }
+    }
+    if (type->compound.is_definition && type->variant != TYPE_ENUM) {
+        for (uint32_t i = 0; i < type->compound.su_fields.size; ++i) {
+            const DerivedType_t *field = type->compound.su_fields.items[i].type;
+            while (field->variant != DERIVED_TYPE_TERMINAL) {
+                field = field->variant == DERIVED_TYPE_POINTER ? field->pointer.inner_type :
+                    field->variant == DERIVED_TYPE_ARRAY ? field->array.inner_type :
+                    field->function.return_type;
+            }
+            declare_tagged_type(builder, &field->terminal.type);
         }
     }
-    return true;
 }
 
-static bool try_declare_derived_type(const DerivedType_t *const der, DataScope_t *const scope, FlowError_t ***errors) {
-    bool all_params_succeeded = true;
-    const DerivedType_t *current = der;
-    while (current) {
-        if (current->variant == DERIVED_TYPE_POINTER) {
-            current = current->pointer.inner_type;
+static void declare_derived_type(FlowBuilder_t *const builder, const DerivedType_t *der) {
+    // Parameter types of function types belong to their own prototype scope
+    while (der->variant != DERIVED_TYPE_TERMINAL) {
+        der = der->variant == DERIVED_TYPE_POINTER ? der->pointer.inner_type :
+            der->variant == DERIVED_TYPE_ARRAY ? der->array.inner_type :
+            der->function.return_type;
+    }
+    declare_tagged_type(builder, &der->terminal.type);
+}
+
+static void flowify_scope_statement(FlowBuilder_t *const builder, const Scope_t *const scope) {
+    SymbolTable_t *symbols = &builder->program->symbols;
+    enter_scope(symbols, new_data_scope(builder->program));
+    for (uint32_t i = 0; i < scope->statements.size; ++i) {
+        flowify_statement(builder, &scope->statements.items[i]);
+    }
+    leave_scope(symbols);
+}
+
+/**
+ * Lower a loop body with its own break and continue targets
+ */
+static void flowify_loop_body(FlowBuilder_t *const builder, const Statement_t *const body, BasicBlock_t *const break_target, BasicBlock_t *const continue_target) {
+    BasicBlock_t *prev_break = builder->break_target;
+    BasicBlock_t *prev_continue = builder->continue_target;
+    builder->break_target = break_target;
+    builder->continue_target = continue_target;
+    flowify_statement(builder, body);
+    builder->break_target = prev_break;
+    builder->continue_target = prev_continue;
+}
+
+/**
+ * Expressions are folded before they are lowered, into copies that the
+ * program owns; the AST is left as it is
+ */
+static DataOperand_t *flowify_folded(FlowBuilder_t *const builder, const Expression_t *const expr) {
+    return flowify_expression(builder, fold_expression(builder->program, expr));
+}
+
+static void flowify_control(FlowBuilder_t *const builder, const Control_t *const control) {
+    BasicBlock_t *body, *header, *step, *exit;
+    switch (control->variant) {
+        case CONTROL_IF: {
+            DataOperand_t *predicate = flowify_folded(builder, &control->condition);
+            BasicBlock_t *then_block = new_basic_block(builder);
+            BasicBlock_t *else_block = control->ctrl_if.continuation ? new_basic_block(builder) : NULL;
+            exit = new_basic_block(builder);
+            branch_to(builder, predicate, then_block, else_block ? else_block : exit);
+            builder->block = then_block;
+            flowify_statement(builder, &control->exec);
+            jump_to(builder, exit);
+            if (else_block) {
+                builder->block = else_block;
+                flowify_statement(builder, control->ctrl_if.continuation);
+                jump_to(builder, exit);
+            }
+            builder->block = exit;
+            break;
         }
-        else if (current->variant == DERIVED_TYPE_ARRAY) {
-            current = current->array.inner_type;
+        case CONTROL_WHILE:
+            header = new_basic_block(builder);
+            jump_to(builder, header);
+            builder->block = header;
+            body = new_basic_block(builder);
+            exit = new_basic_block(builder);
+            branch_to(builder, flowify_folded(builder, &control->condition), body, exit);
+            builder->block = body;
+            flowify_loop_body(builder, &control->exec, exit, header);
+            jump_to(builder, header);
+            builder->block = exit;
+            break;
+        case CONTROL_DO:
+            body = new_basic_block(builder);
+            jump_to(builder, body);
+            builder->block = body;
+            step = new_basic_block(builder);
+            exit = new_basic_block(builder);
+            flowify_loop_body(builder, &control->exec, exit, step);
+            jump_to(builder, step);
+            builder->block = step;
+            branch_to(builder, flowify_folded(builder, &control->condition), body, exit);
+            builder->block = exit;
+            break;
+        case CONTROL_FOR: {
+            // Declarations in the header are scoped to the loop
+            SymbolTable_t *symbols = &builder->program->symbols;
+            enter_scope(symbols, new_data_scope(builder->program));
+            flowify_folded(builder, control->ctrl_for.init);
+            header = new_basic_block(builder);
+            jump_to(builder, header);
+            builder->block = header;
+            body = new_basic_block(builder);
+            step = new_basic_block(builder);
+            exit = new_basic_block(builder);
+            branch_to(builder, flowify_folded(builder, &control->condition), body, exit);
+            builder->block = body;
+            flowify_loop_body(builder, &control->exec, exit, step);
+            jump_to(builder, step);
+            builder->block = step;
+            flowify_folded(builder, control->ctrl_for.increment);
+            jump_to(builder, header);
+            builder->block = exit;
+            leave_scope(symbols);
+            break;
         }
-        else if (current->variant == DERIVED_TYPE_FUNCTION) {
-            const VariableLinkedListNode_t *var = current->function.params;
-            while (var) {
-                all_params_succeeded = all_params_succeeded && try_declare_derived_type(var->value.type, scope, errors);
-                var = var->next;
+        case CONTROL_BREAK:
+            if (!builder->break_target) {
+                flow_error(builder, "break outside of a loop");
+            }
+            jump_to(builder, builder->break_target);
+            break;
+        case CONTROL_CONTINUE:
+            if (!builder->continue_target) {
+                flow_error(builder, "continue outside of a loop");
             }
-            current = current->function.return_type;
+            jump_to(builder, builder->continue_target);
+            break;
+        case CONTROL_RETURN: {
+            DataOperand_t *value = flowify_folded(builder, &control->ret);
+            BasicBlock_t *block = current_block(builder);
+            block->returns = true;
+            block->return_value = value;
+            builder->block = NULL;
+            break;
         }
-        else {
-            return all_params_succeeded && try_declare_type(&current->terminal.type, scope, errors);
+    }
+}
+
+static FlowFunction_t *new_flow_function(FlowProgram_t *const program, const Symbol_t *const name) {
+    FlowFunction_t *function = flow_alloc(program, sizeof(FlowFunction_t));
+    function->name = name;
+    return function;
+}
+
+/**
+ * Falling off the end of a function returns
+ */
+static void finish_function(FlowBuilder_t *const builder) {
+    if (builder->block) {
+        builder->block->returns = true;
+        builder->block = NULL;
+    }
+}
+
+static void flowify_function(FlowBuilder_t *const outer, const Function_t *const function) {
+    FlowProgram_t *program = outer->program;
+    FlowFunction_t *flow = new_flow_function(program, function->signature.name);
+    FlowFunction_t **tail = &program->functions;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = flow;
+
+    FlowBuilder_t builder;
+    memset(&builder, 0, sizeof(FlowBuilder_t));
+    builder.program = program;
+    builder.function = flow;
+    builder.statement = outer->statement;
+    flow->scope = new_data_scope(program);
+    enter_scope(&program->symbols, flow->scope);
+    flow->head_block = current_block(&builder);
+
+    // Canonical function types drop parameter names; the signature's own
+    // parameters come first among the ones it declares
+    const uint32_t n_params = function->signature.type->function.params.size;
+    const Variable_t *params = function->signature.params.items;
+    flow->params = flow_alloc(program, n_params * sizeof(DataVariable_t *));
+    for (uint32_t i = 0; i < n_params; ++i) {
+        if (params[i].has_name) {
+            DataVariable_t *param = new_data_variable(&builder, params[i].name, params[i].type);
+            if (!declare_variable(&program->symbols, param->name, param)) {
+                flow_error(&builder, "Parameter is already defined");
+            }
+            flow->params[flow->n_params++] = param;
         }
     }
+    for (uint32_t i = 0; i < function->scope.statements.size; ++i) {
+        flowify_statement(&builder, &function->scope.statements.items[i]);
+    }
+    finish_function(&builder);
+    leave_scope(&program->symbols);
 }
 
-void flowify_statement(const Statement_t *statement, BasicBlock_t *block, DataScope_t *scope, FlowError_t ***errors) {
+void flowify_statement(FlowBuilder_t *const builder, const Statement_t *const statement) {
+    const Statement_t *prev_statement = builder->statement;
+    builder->statement = statement;
+    Expression_t expr;
     switch (statement->variant) {
+        case STATEMENT_SCOPE:
+            flowify_scope_statement(builder, statement->scope);
+            break;
+        case STATEMENT_CONTROL:
+            flowify_control(builder, statement->control);
+            break;
+        case STATEMENT_OPERATOR:
+            expr.variant = EXPRESSION_OPERATOR;
+            expr.operator = statement->operator;
+            flowify_folded(builder, &expr);
+            break;
         case STATEMENT_DECLARATION:
-            DataVariableMap_insert(&scope->variables, statement->declaration->name, statement->declaration->type);
+            declare_derived_type(builder, statement->declaration->type);
+            // Function prototypes name something outside the program
+            if (statement->declaration->has_name && statement->declaration->type->variant != DERIVED_TYPE_FUNCTION) {
+                expr.variant = EXPRESSION_DECLARATION;
+                expr.decl = statement->declaration;
+                flowify_folded(builder, &expr);
+            }
+            break;
+        case STATEMENT_TYPEDEF:
+            declare_derived_type(builder, statement->tdef->type);
+            if (!declare_type(&builder->program->symbols, statement->tdef->name, statement->tdef->type, true)) {
+                flow_error(builder, "Type is already defined");
+            }
             break;
         case STATEMENT_FUNCTION:
-            statement->function->signature;
+            flowify_function(builder, statement->function);
+            break;
+    }
+    builder->statement = prev_statement;
+}
+
+FlowProgram_t *flowify_scope(const Scope_t *const scope, ParseContext_t *const context) {
+    FlowProgram_t *program = malloc(sizeof(FlowProgram_t));
+    memset(program, 0, sizeof(FlowProgram_t));
+    program->arena = new_arena();
+    program->context = context;
+    program->symbols = new_scoped_symbol_table();
+    program->errors_tail = &program->errors;
+    ParseContext_t *prev_context = attach_parse_context(context);
+
+    program->scope = new_data_scope(program);
+    enter_scope(&program->symbols, program->scope);
+    program->top_level = new_flow_function(program, NULL);
+    program->top_level->scope = program->scope;
+    FlowBuilder_t builder;
+    memset(&builder, 0, sizeof(FlowBuilder_t));
+    builder.program = program;
+    builder.function = program->top_level;
+    program->top_level->head_block = current_block(&builder);
+    for (uint32_t i = 0; i < scope->statements.size; ++i) {
+        flowify_statement(&builder, &scope->statements.items[i]);
+    }
+    finish_function(&builder);
+    leave_scope(&program->symbols);
+    layout_frames(program);
+
+    attach_parse_context(prev_context);
+    return program;
+}
+
+static void free_data_scope(DataScope_t *const scope) {
+    DataVariableMap_free(&scope->variables);
+    TypeNameMap_free(&scope->types);
+    TypeNameMap_free(&scope->tags);
+    for (DataScopeLinkedListNode_t *it = scope->scopes; it; it = it->next) {
+        free_data_scope(it->value);
+    }
+}
+
+static void free_flow_function(FlowFunction_t *const function) {
+    free(function->blocks);
+    free(function->variables);
+}
+
+void free_flow_program(FlowProgram_t *const program) {
+    free_flow_function(program->top_level);
+    for (FlowFunction_t *it = program->functions; it; it = it->next) {
+        free_flow_function(it);
     }
-}
\ No newline at end of file
+    free_data_scope(program->scope);
+    FlowError_t *error = program->errors;
+    while (error) {
+        FlowError_t *next = error->next;
+        free_alloc_const_string(&error->cause);
+        free(error);
+        error = next;
+    }
+    free_scoped_symbol_table(&program->symbols);
+    TypeLayoutMap_free(&program->layouts);
+    free_arena(&program->arena);
+    free(program);
+}
@@ -0,0 +1,10 @@
+#include "tests.h"
+
+FlowProgram_t *flowify_str(const ConstString_t str, ParseContext_t *const context) {
+    ErrorLinkedListNode_t *errors = NULL;
+    ErrorLinkedListNode_t **errors_head = &errors;
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryScope_t scope = parse_scope(str, &errors_head);
+    attach_parse_context(prev_context);
+    return scope.status == TRY_SUCCESS ? flowify_scope(&scope.value, context) : NULL;
+}
@@ -0,0 +1,101 @@
+#include "tests.h"
+#include "../../grammar/tests/tests.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const static Case_t cases[] = {
+    {true,  "int x = (1 << 4) * 16;",
+        "top level:\nb0:\n    x = 256\n    return"},
+    {true,  "int f(int a) { if (1 << 2 > 3) { a = -(3 - 5); } return g(1 + 1, 2 * 3, a); }",
+        "top level:\nb0:\n    return\nf(a):\nb0:\n    if 1 goto b1 else b2\nb1:\n    a = 2\n    goto b2\nb2:\n    t1 = g(2, 6, a)\n    return t1"},
+    {true,  "int f(int a) { return a * (2 + 3) + (0 && a) + (a && 0); }",
+        "top level:\nb0:\n    return\nf(a):\nb0:\n    t1 = a * 5\n    t2 = t1 + 0\n    t3 = a != 0\n    if t3 goto b1 else b2\nb1:\n    t3 = 0 != 0\n    goto b2\nb2:\n    t4 = t2 + t3\n    return t4"},
+    {true,  "int b = 'a' + 1; int d = (unsigned char)-1; char c = (char)300 + 0; int m = -2147483647 - 1;",
+        "top level:\nb0:\n    b = 98\n    d = 255\n    c = 44\n    t4 = -2147483648\n    t5 = (int)t4\n    m = t5\n    return"},
+    {true,  "unsigned int u = (unsigned int)1 - 2; int h = -7 / 2; int g = 7 % -3;",
+        "top level:\nb0:\n    u = 4294967295\n    t2 = -3\n    h = t2\n    g = 1\n    return"},
+    {true,  "int z = 2147483647 + 1; int a = 1 / 0; int o = 1 << 31;",
+        "top level:\nb0:\n    t1 = 2147483647 + 1\n    z = t1\n    t3 = 1 / 0\n    a = t3\n    t5 = 1 << 31\n    o = t5\n    return"},
+    {true,  "long s = sizeof(int) * 3; int t = sizeof(long) > 4 ? 10 : 20;",
+        "top level:\nb0:\n    s = 12\n    t = 10\n    return"},
+    {true,  "struct Fwd *p; long n = sizeof(*p); long k = sizeof(p);",
+        "top level:\nb0:\n    t2 = sizeof(struct Fwd)\n    n = t2\n    k = 8\n    return"},
+    {true,  "int f(int a) { typedef char C; return sizeof(C) + sizeof(a) + (1 ? 2 : 3); }",
+        "top level:\nb0:\n    return\nf(a):\nb0:\n    return 7"},
+    {true,  "unsigned int x = 0xffffffff + 1; int y = 0x7fffffff + 1; unsigned int s = 010 + 0X1f + 07u; long l = 1L << 40;",
+        "top level:\nb0:\n    x = 0\n    t2 = 2147483647 + 1\n    y = t2\n    s = 46\n    l = 1099511627776\n    return"},
+    {true,  "unsigned long m = 18446744073709551615u / 0x10; long n = 9223372036854775807 + 0ll;",
+        "top level:\nb0:\n    m = 1152921504606846975\n    n = 9223372036854775807\n    return"},
+    {false, "long d = 9223372036854775808;", NULL},
+    {false, NULL, NULL}
+};
+
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    ErrorLinkedListNode_t *errors = NULL;
+    ErrorLinkedListNode_t **errors_head = &errors;
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryScope_t op = parse_scope(str, &errors_head);
+    attach_parse_context(prev_context);
+
+    if (op.status == TRY_SUCCESS) {
+        FlowProgram_t *program = flowify_scope(&op.value, context);
+        if (program->errors) {
+            output.status = TRY_ERROR;
+            output.error.desc = program->errors->desc;
+            output.error.location = str;
+        }
+        else {
+            Sink_t sink = new_buffer_sink();
+            print_flow_program(&sink, program);
+            snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+            free_sink(&sink);
+            buffer[strlen(buffer) - 1] = 0;
+            output.status = TRY_SUCCESS;
+            output.value = buffer;
+        }
+        free_flow_program(program);
+    }
+    else if (op.status == TRY_ERROR) {
+        output.status = TRY_ERROR;
+        output.error = op.error;
+    }
+    else {
+        output.status = TRY_NONE;
+    }
+    free_parse_context(context);
+    return output;
+}
+
+/**
+ * Lowering folds into copies, so the scope prints the same afterwards
+ */
+static int test_ast_unchanged() {
+    ErrorLinkedListNode_t *errors = NULL;
+    ErrorLinkedListNode_t **errors_head = &errors;
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryScope_t scope = parse_scope(const_string_from_cstr(
+        "int f(int a) { if (1 << 2 > 3) { a = -(3 - 5); } return a * (2 + 3) + (1 << 4) * 16 + sizeof(int); }"), &errors_head);
+    Sink_t before = new_buffer_sink();
+    print_scope(&before, &scope.value, 0);
+    attach_parse_context(prev_context);
+    FlowProgram_t *program = flowify_scope(&scope.value, context);
+    Sink_t after = new_buffer_sink();
+    print_scope(&after, &scope.value, 0);
+    const bool passed = check("(fold) the AST is left unchanged", !strcmp(sink_str(&before), sink_str(&after)));
+    free_sink(&before);
+    free_sink(&after);
+    free_flow_program(program);
+    free_parse_context(context);
+    return !passed;
+}
+
+int test_flow_fold() {
+    printf("Running test_flow_fold() ...\n");
+    return test_fixture(cases, case_func, TEST_INPUT_STRING) + test_ast_unchanged();
+}
@@ -0,0 +1,66 @@
+#include "tests.h"
+#include "../../grammar/tests/tests.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const static Case_t cases[] = {
+    {true,  "void f(int n) { { int a; long b; } { char c; double d; } }",
+        "top level: 0 bytes, 0 unpacked\nf: 16 bytes, 32 unpacked\n    n: 0 (4)\n    a: 4 (4)\n    b: 8 (8)\n    c: 4 (1)\n    d: 8 (8)"},
+    {true,  "void f() { { int a[4]; } int b; }",
+        "top level: 0 bytes, 0 unpacked\nf: 16 bytes, 20 unpacked\n    a: 0 (16)\n    b: 0 (4)"},
+    {true,  "void f() { int x; { int y; { int z; } { long w; } } { char c; } }",
+        "top level: 0 bytes, 0 unpacked\nf: 16 bytes, 32 unpacked\n    x: 0 (4)\n    y: 4 (4)\n    z: 8 (4)\n    w: 8 (8)\n    c: 4 (1)"},
+    {true,  "int f(int a, int b) { if (a) { struct { char c; int i; } s; } else { char buf[3]; } return a + b; }",
+        "top level: 0 bytes, 0 unpacked\nf: 16 bytes, 24 unpacked\n    a: 0 (4)\n    b: 4 (4)\n    s: 8 (8)\n    buf: 8 (3)\n    t4: 8 (4)"},
+    {true,  "int g; { int a; } { int b; }",
+        "top level: 4 bytes, 8 unpacked\n    a: 0 (4)\n    b: 0 (4)"},
+    {false, NULL, NULL}
+};
+
+const static Case_t file_cases[] = {
+    {true,  "tests/grammar/scope/nested1-recursion.in", "tests/flow/frame/nested1-recursion.out"},
+    {false, NULL, NULL}
+};
+
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    ErrorLinkedListNode_t *errors = NULL;
+    ErrorLinkedListNode_t **errors_head = &errors;
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryScope_t op = parse_scope(str, &errors_head);
+    attach_parse_context(prev_context);
+
+    if (op.status == TRY_SUCCESS) {
+        FlowProgram_t *program = flowify_scope(&op.value, context);
+        Sink_t sink = new_buffer_sink();
+        print_frame_layout(&sink, program->top_level);
+        for (const FlowFunction_t *it = program->functions; it; it = it->next) {
+            print_frame_layout(&sink, it);
+        }
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+        free_sink(&sink);
+        buffer[strlen(buffer) - 1] = 0;
+        output.status = TRY_SUCCESS;
+        output.value = buffer;
+        free_flow_program(program);
+    }
+    else if (op.status == TRY_ERROR) {
+        output.status = TRY_ERROR;
+        output.error = op.error;
+    }
+    else {
+        output.status = TRY_NONE;
+    }
+    free_parse_context(context);
+    return output;
+}
+
+int test_flow_frame() {
+    printf("Running test_flow_frame() ...\n");
+    return test_fixture(cases, case_func, TEST_INPUT_STRING) +
+        test_fixture(file_cases, case_func, TEST_INPUT_FILE);
+}
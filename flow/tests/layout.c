@@ -0,0 +1,144 @@
+#include "tests.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+
+typedef struct {
+    const char *input;
+    const char *name;
+    uint64_t size;
+    uint64_t alignment;
+} LayoutCase_t;
+
+const static LayoutCase_t cases[] = {
+    {"char c;", "c", 1, 1},
+    {"unsigned short s;", "s", 2, 2},
+    {"int i;", "i", 4, 4},
+    {"long l;", "l", 8, 8},
+    {"double d;", "d", 8, 8},
+    {"const char *p;", "p", 8, 8},
+    {"int a[10];", "a", 40, 4},
+    {"char s[0x10];", "s", 16, 1},
+    {"int m[2][3];", "m", 24, 4},
+    {"enum E { A, B } e;", "e", 4, 4},
+    {"struct { char c; int i; char d; } s;", "s", 12, 4},
+    {"struct { char c; double d; } s;", "s", 16, 8},
+    {"union { char c[5]; int i; } u;", "u", 8, 4},
+    {"struct P { char c; struct Q { short s; char t; } q; long l; } p;", "p", 16, 8},
+    {"struct N { int v; struct N *next; } n;", "n", 16, 8},
+    {"struct F { int n; char data[]; } f;", "f", 4, 4},
+    {"typedef struct { int x; int y; } Point_t; Point_t pts[3];", "pts", 24, 4},
+    {"struct S { long l; } first; typedef struct S S_t; S_t s;", "s", 8, 8},
+    {"typedef char T; T a[4]; { typedef long T; T b[4]; }", "b", 32, 8},
+    {"char b[(1 << 4) * 16];", "b", 256, 1},
+    {"typedef long L; char c[sizeof(L) * 2 + 1];", "c", 17, 1},
+    {"typedef long L; { typedef char L; char c[sizeof(L)]; }", "c", 1, 1},
+    {"int n; int a[n];", "a", 0, 4},
+    {"int a[1 - 2];", "a", 0, 4},
+    {"struct Fwd *p; struct Fwd f;", "f", 0, 1},
+    {"typedef int T; int f() { struct T { char c; } t; T u; return sizeof(u); }", "u", 4, 4},
+    {"typedef int T; int f() { struct T { char c; } t; T u; char s[sizeof(u)]; }", "s", 4, 1},
+    {"struct S { long a; } x; { typedef char S; struct S y; }", "y", 8, 8},
+    {NULL, NULL, 0, 0}
+};
+
+static const DataVariable_t *find_variable(const FlowFunction_t *const function, const char *const name) {
+    const Symbol_t *symbol = intern_cstr(name);
+    for (uint32_t i = 0; i < function->n_variables; ++i) {
+        if (function->variables[i]->name == symbol) {
+            return function->variables[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * At the top level first, then in each function
+ */
+static const DataVariable_t *find_program_variable(const FlowProgram_t *const program, const char *const name) {
+    const DataVariable_t *variable = find_variable(program->top_level, name);
+    for (const FlowFunction_t *it = program->functions; !variable && it; it = it->next) {
+        variable = find_variable(it, name);
+    }
+    return variable;
+}
+
+static int test_variables() {
+    char message[256];
+    int n_failed_tests = 0;
+    for (const LayoutCase_t *c = cases; c->input; ++c) {
+        ParseContext_t *context = new_parse_context();
+        FlowProgram_t *program = flowify_str(const_string_from_cstr(c->input), context);
+        const DataVariable_t *variable = program ? find_program_variable(program, c->name) : NULL;
+        const bool passed = variable &&
+            variable->location->size == c->size &&
+            variable->location->alignment == c->alignment;
+        snprintf(message, sizeof(message), "(size %llu, alignment %llu) %s",
+            (unsigned long long)c->size, (unsigned long long)c->alignment, c->input);
+        n_failed_tests += !check(message, passed);
+        if (program) {
+            free_flow_program(program);
+        }
+        free_parse_context(context);
+    }
+    return n_failed_tests;
+}
+
+/**
+ * Field offsets, and repeated queries answered from the memo
+ */
+static int test_offsets() {
+    int n_failed_tests = 0;
+    ParseContext_t *context = new_parse_context();
+    FlowProgram_t *program = flowify_str(const_string_from_cstr(
+        "struct { char c; short s; double d; char e; int a[3]; } x; union { char c; long l; } u;"), context);
+    const DataVariable_t *x = find_variable(program->top_level, "x");
+    const DataVariable_t *u = find_variable(program->top_level, "u");
+    const TypeLayout_t *layout = derived_type_layout(program, x->type);
+    const uint64_t expected[] = { 0, 2, 8, 16, 20 };
+    bool offsets = layout->n_fields == 5 && layout->size == 32;
+    for (uint32_t i = 0; offsets && i < 5; ++i) {
+        offsets = layout->offsets[i] == expected[i];
+    }
+    const TypeLayout_t *union_layout = derived_type_layout(program, u->type);
+    const bool union_offsets = union_layout->n_fields == 2 && !union_layout->offsets[0] && !union_layout->offsets[1];
+    const bool memoized = derived_type_layout(program, x->type) == layout &&
+        derived_type_layout(program, x->type->terminal.type.compound.su_fields.items[4].type) ==
+        derived_type_layout(program, x->type->terminal.type.compound.su_fields.items[4].type);
+    n_failed_tests += !check("(offsets) struct fields at their alignment", offsets);
+    n_failed_tests += !check("(offsets) union fields at 0", union_offsets);
+    n_failed_tests += !check("(offsets) repeated queries are memoized", memoized);
+    free_flow_program(program);
+    free_parse_context(context);
+    return n_failed_tests;
+}
+
+/**
+ * Variables' types record what their names stood for, so their layouts can
+ * still be queried once every scope has been left, and are memoized
+ */
+static int test_after_flowify() {
+    ParseContext_t *context = new_parse_context();
+    FlowProgram_t *program = flowify_str(const_string_from_cstr(
+        "typedef struct S {long a; long b;} T; void f(){ T x; struct S y; T z[2]; { typedef char T; T w[2]; } }"), context);
+    const char *names[] = { "x", "y", "z", "w" };
+    const uint64_t sizes[] = { 16, 16, 32, 2 };
+    bool passed = program && program->functions;
+    for (size_t i = 0; passed && i < sizeof(names) / sizeof(names[0]); ++i) {
+        const DataVariable_t *variable = find_variable(program->functions, names[i]);
+        const TypeLayout_t *layout = variable ? derived_type_layout(program, variable->type) : NULL;
+        passed = layout && layout->is_complete && layout->size == sizes[i] &&
+            variable->location->size == sizes[i] &&
+            TypeLayoutMap_find(&program->layouts, variable->type);
+    }
+    if (program) {
+        free_flow_program(program);
+    }
+    free_parse_context(context);
+    return !check("(after flowify) typedef and tag layouts are bound and memoized", passed);
+}
+
+int test_flow_layout() {
+    printf("Running test_flow_layout() ...\n");
+    return test_variables() + test_offsets() + test_after_flowify();
+}
@@ -0,0 +1,89 @@
+#include "tests.h"
+#include "../../grammar/tests/tests.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LONG_CHAIN 3000
+
+const static Case_t cases[] = {
+    {true,  "int f(int a) { int x = 1; if (x) { x = 2; } else { x = 3; } return x; }",
+        "f(a):\nb0:\n    x.1 = 1\n    goto b1\nb1:\n    x.3 = 2\n    goto b3\nb2:\n    unreachable\nb3:\n    return 2"},
+    {true,  "int f(int a) { int x = 1; if (a) { x = 1; } return x + 1; }",
+        "f(a):\nb0:\n    x.1 = 1\n    if a.0 goto b1 else b2\nb1:\n    x.2 = 1\n    goto b2\nb2:\n    t2.1 = 2\n    return 2"},
+    {true,  "int f(int n) { int s = 0; for (int i = 0; i < n; i += 1) { s += i; } return s; }",
+        "f(n):\nb0:\n    s.1 = 0\n    i.1 = 0\n    goto b1\nb1:\n    i.2 = phi(b0: 0, b3: i.3)\n    s.2 = phi(b0: 0, b3: s.3)\n    t3.1 = i.2 < n.0\n    if t3.1 goto b2 else b4\nb2:\n    s.3 = s.2 + i.2\n    goto b3\nb3:\n    i.3 = i.2 + 1\n    goto b1\nb4:\n    return s.2"},
+    {true,  "int f(int n) { int i = 0; while (1) { if (i > n) { break; } i += 1; } return i; }",
+        "f(n):\nb0:\n    i.1 = 0\n    goto b1\nb1:\n    i.2 = phi(b0: 0, b5: i.3)\n    goto b2\nb2:\n    t2.1 = i.2 > n.0\n    if t2.1 goto b4 else b5\nb3:\n    return i.2\nb4:\n    goto b3\nb5:\n    i.3 = i.2 + 1\n    goto b1"},
+    {true,  "int f() { int x = 3; int y = x - 5; return y * 2; }",
+        "f():\nb0:\n    x.1 = 3\n    t2.1 = -2\n    y.1 = -2\n    t3.1 = -4\n    return -4"},
+    {true,  "int f(int a) { int x = 0; int y = 0; while (x < 10) { if (y) { x = a; } x += 1; } return y; }",
+        "f(a):\nb0:\n    x.1 = 0\n    y.1 = 0\n    goto b1\nb1:\n    x.2 = phi(b0: 0, b5: x.5)\n    t3.1 = x.2 < 10\n    if t3.1 goto b2 else b3\nb2:\n    goto b5\nb3:\n    return 0\nb4:\n    unreachable\nb5:\n    x.4 = phi(b2: x.2)\n    x.5 = x.4 + 1\n    goto b1"},
+    {true,  "int f() { unsigned char c = 255; c += 1; int d = 7 / c; return d; }",
+        "f():\nb0:\n    c.1 = 255\n    c.2 = 0\n    t2.1 = 7 / 0\n    d.1 = t2.1\n    return d.1"},
+    {false, NULL, NULL}
+};
+
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    ParseContext_t *context = new_parse_context();
+    FlowProgram_t *program = flowify_str(str, context);
+    if (program) {
+        build_program_ssa(program);
+        propagate_program_constants(program);
+        Sink_t sink = new_buffer_sink();
+        for (const FlowFunction_t *it = program->functions; it; it = it->next) {
+            print_flow_function(&sink, it);
+        }
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+        free_sink(&sink);
+        buffer[strlen(buffer) - 1] = 0;
+        output.status = TRY_SUCCESS;
+        output.value = buffer;
+        free_flow_program(program);
+    }
+    else {
+        output.status = TRY_NONE;
+    }
+    free_parse_context(context);
+    return output;
+}
+
+/**
+ * Thousands of branches, each on the constant the previous join produced, so
+ * every branch is only resolved after the ones before it
+ */
+static int test_long_chain() {
+    const char *const step = "if (x) { x += 1; } else { x = 0; } ";
+    const size_t step_len = strlen(step);
+    char *source = malloc(64 + LONG_CHAIN * step_len);
+    size_t len = sprintf(source, "int f(int a) { int x = 1; ");
+    for (int i = 0; i < LONG_CHAIN; ++i) {
+        memcpy(source + len, step, step_len);
+        len += step_len;
+    }
+    strcpy(source + len, "return x; }");
+    ParseContext_t *context = new_parse_context();
+    FlowProgram_t *program = flowify_str(const_string_from_cstr(source), context);
+    FlowFunction_t *f = program->functions;
+    build_ssa(program, f);
+    propagate_constants(program, f);
+    const BasicBlock_t *last = f->rpo[f->n_rpo - 1];
+    const bool returns = last->returns && last->return_value->variant == OPERAND_CONSTANT &&
+        last->return_value->constant == LONG_CHAIN + 1;
+    char message[128];
+    snprintf(message, sizeof(message), "(sccp) %d branches resolved in turn", LONG_CHAIN);
+    const bool passed = check(message, returns && f->n_rpo == 2 * LONG_CHAIN + 1);
+    free_flow_program(program);
+    free_parse_context(context);
+    free(source);
+    return !passed;
+}
+
+int test_flow_sccp() {
+    printf("Running test_flow_sccp() ...\n");
+    return test_fixture(cases, case_func, TEST_INPUT_STRING) + test_long_chain();
+}
@@ -0,0 +1,199 @@
+#include "tests.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+
+#define DEEP_NESTING 10000
+
+static DerivedType_t *int_type() {
+    DerivedType_t der;
+    memset(&der, 0, sizeof(DerivedType_t));
+    der.variant = DERIVED_TYPE_TERMINAL;
+    der.terminal.qualifier = QUALIFIER_NONE;
+    der.terminal.type.variant = TYPE_PRIMITIVE;
+    der.terminal.type.primitive = PRIMITIVE_INT;
+    return canonical_derived_type(&der);
+}
+
+static void free_scope_maps(DataScope_t *const scope) {
+    DataVariableMap_free(&scope->variables);
+    TypeNameMap_free(&scope->types);
+    TypeNameMap_free(&scope->tags);
+}
+
+/**
+ * Shadowing, restoring on leave, and namespaces kept apart
+ */
+static int test_shadowing() {
+    int n_failed_tests = 0;
+    SymbolTable_t table = new_scoped_symbol_table();
+    DataScope_t outer, inner;
+    memset(&outer, 0, sizeof(DataScope_t));
+    memset(&inner, 0, sizeof(DataScope_t));
+    DataVariable_t outer_x, inner_x, y;
+    memset(&outer_x, 0, sizeof(DataVariable_t));
+    memset(&inner_x, 0, sizeof(DataVariable_t));
+    memset(&y, 0, sizeof(DataVariable_t));
+    const Symbol_t *x_name = intern_cstr("x");
+    const Symbol_t *y_name = intern_cstr("y");
+
+    enter_scope(&table, &outer);
+    declare_variable(&table, x_name, &outer_x);
+    const bool redeclared = declare_variable(&table, x_name, &inner_x);
+    enter_scope(&table, &inner);
+    declare_variable(&table, x_name, &inner_x);
+    declare_variable(&table, y_name, &y);
+    const SymbolBinding_t *x_inner = lookup_symbol(&table, x_name, SYMBOL_NAMESPACE_VARIABLE);
+    const bool shadowed = x_inner && x_inner->variable == &inner_x && inner_x.scope == &inner;
+    const bool separate = !lookup_symbol(&table, x_name, SYMBOL_NAMESPACE_TYPE);
+    leave_scope(&table);
+    const SymbolBinding_t *x_outer = lookup_symbol(&table, x_name, SYMBOL_NAMESPACE_VARIABLE);
+    const bool restored = x_outer && x_outer->variable == &outer_x && !lookup_symbol(&table, y_name, SYMBOL_NAMESPACE_VARIABLE);
+    const bool own = DataVariableMap_find(&inner.variables, y_name) && !DataVariableMap_find(&outer.variables, y_name);
+    leave_scope(&table);
+    const bool empty = !lookup_symbol(&table, x_name, SYMBOL_NAMESPACE_VARIABLE) && !current_scope(&table);
+
+    n_failed_tests += !check("(variables) redeclaration in the same scope fails", !redeclared);
+    n_failed_tests += !check("(variables) inner binding shadows outer", shadowed && separate);
+    n_failed_tests += !check("(variables) leaving restores outer binding", restored && own);
+    n_failed_tests += !check("(variables) leaving every scope empties the table", empty);
+    free_scope_maps(&outer);
+    free_scope_maps(&inner);
+    free_scoped_symbol_table(&table);
+    return n_failed_tests;
+}
+
+/**
+ * A type may be declared repeatedly but defined once per scope, and an inner
+ * scope may define its own
+ */
+static int test_types() {
+    int n_failed_tests = 0;
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    SymbolTable_t table = new_scoped_symbol_table();
+    DataScope_t outer, inner;
+    memset(&outer, 0, sizeof(DataScope_t));
+    memset(&inner, 0, sizeof(DataScope_t));
+    inner.location.parent_scope = &outer;
+    const Symbol_t *name = intern_cstr("Pair_t");
+    const Symbol_t *inner_name = intern_cstr("Inner_t");
+    const DerivedType_t *type = int_type();
+
+    enter_scope(&table, &outer);
+    const bool undeclared = !is_type_declared_in_scope(name, &outer);
+    declare_type(&table, name, type, false);
+    const bool declared = is_type_declared_in_scope(name, &outer) && !is_defined_in_scope(name, &outer);
+    const bool defined = declare_type(&table, name, type, true) && is_defined_in_scope(name, &outer);
+    const bool redefined = declare_type(&table, name, type, true);
+    enter_scope(&table, &inner);
+    const bool visible = is_defined_in_scope(name, &inner);
+    const bool inner_defined = declare_type(&table, name, type, true);
+    declare_type(&table, inner_name, type, false);
+    const bool enclosing_open = is_defined_in_scope(name, &outer) && !is_type_declared_in_scope(inner_name, &outer);
+    leave_scope(&table);
+    leave_scope(&table);
+    const bool after_walk =
+        is_defined_in_scope(name, &inner) && is_defined_in_scope(name, &outer) &&
+        is_type_declared_in_scope(inner_name, &inner) && !is_defined_in_scope(inner_name, &inner) &&
+        !is_type_declared_in_scope(inner_name, &outer);
+
+    n_failed_tests += !check("(types) declare then define", undeclared && declared && defined);
+    n_failed_tests += !check("(types) redefinition in the same scope fails", !redefined);
+    n_failed_tests += !check("(types) inner scope sees and may redefine", visible && inner_defined);
+    n_failed_tests += !check("(types) queries on an enclosing open scope", enclosing_open);
+    n_failed_tests += !check("(types) queries on scopes that were left", after_walk);
+    free_scope_maps(&outer);
+    free_scope_maps(&inner);
+    free_scoped_symbol_table(&table);
+    attach_parse_context(prev_context);
+    free_parse_context(context);
+    return n_failed_tests;
+}
+
+/**
+ * A tag and a typedef name may be the same name, and a typedef name in an
+ * inner scope does not hide a tag
+ */
+static int test_tags() {
+    int n_failed_tests = 0;
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    SymbolTable_t table = new_scoped_symbol_table();
+    DataScope_t outer, inner;
+    memset(&outer, 0, sizeof(DataScope_t));
+    memset(&inner, 0, sizeof(DataScope_t));
+    const Symbol_t *name = intern_cstr("S");
+    const DerivedType_t *tag = int_type();
+    const DerivedType_t *tdef = pointer_derived_type(tag);
+
+    enter_scope(&table, &outer);
+    const bool both = declare_tag(&table, name, tag, true) && declare_type(&table, name, tdef, true);
+    enter_scope(&table, &inner);
+    declare_type(&table, name, tag, true);
+    const SymbolBinding_t *inner_tag = lookup_symbol(&table, name, SYMBOL_NAMESPACE_TAG);
+    const bool not_hidden = inner_tag && inner_tag->type == tag && inner_tag->scope == &outer;
+    leave_scope(&table);
+    const SymbolBinding_t *outer_type = lookup_symbol(&table, name, SYMBOL_NAMESPACE_TYPE);
+    const bool restored = outer_type && outer_type->type == tdef;
+    leave_scope(&table);
+
+    n_failed_tests += !check("(tags) tag and typedef name of the same name", both && restored);
+    n_failed_tests += !check("(tags) inner typedef name does not hide a tag", not_hidden);
+    free_scope_maps(&outer);
+    free_scope_maps(&inner);
+    free_scoped_symbol_table(&table);
+    attach_parse_context(prev_context);
+    free_parse_context(context);
+    return n_failed_tests;
+}
+
+/**
+ * Lookups from deep inside still find the outermost binding directly
+ */
+static int test_deep_nesting() {
+    static DataScope_t scopes[DEEP_NESTING];
+    SymbolTable_t table = new_scoped_symbol_table();
+    DataVariable_t global;
+    memset(&global, 0, sizeof(DataVariable_t));
+    memset(scopes, 0, sizeof(scopes));
+    const Symbol_t *name = intern_cstr("global");
+    enter_scope(&table, &scopes[0]);
+    declare_variable(&table, name, &global);
+    for (int i = 1; i < DEEP_NESTING; ++i) {
+        enter_scope(&table, &scopes[i]);
+    }
+    const SymbolBinding_t *binding = lookup_symbol(&table, name, SYMBOL_NAMESPACE_VARIABLE);
+    const bool found = binding && binding->variable == &global && binding->scope == &scopes[0];
+    for (int i = 0; i < DEEP_NESTING; ++i) {
+        leave_scope(&table);
+    }
+    free_scope_maps(&scopes[0]);
+    free_scoped_symbol_table(&table);
+    return !check("(nesting) outer binding found 10000 scopes deep", found);
+}
+
+/**
+ * Typedef names are still visible from every scope once flowify is done
+ */
+static int test_after_flowify() {
+    ParseContext_t *context = new_parse_context();
+    FlowProgram_t *program = flowify_str(const_string_from_cstr(
+        "typedef int T; void f() { typedef long U; U u; }"), context);
+    const Symbol_t *t = intern_cstr("T");
+    const Symbol_t *u = intern_cstr("U");
+    const DataScope_t *body = program && program->scope->scopes ? program->scope->scopes->value : NULL;
+    const bool passed = body &&
+        is_defined_in_scope(t, program->scope) && !is_type_declared_in_scope(u, program->scope) &&
+        is_defined_in_scope(t, body) && is_defined_in_scope(u, body);
+    if (program) {
+        free_flow_program(program);
+    }
+    free_parse_context(context);
+    return !check("(types) queries after flowify", passed);
+}
+
+int test_flow_scope() {
+    printf("Running test_flow_scope() ...\n");
+    return test_shadowing() + test_types() + test_tags() + test_deep_nesting() + test_after_flowify();
+}
@@ -0,0 +1,120 @@
+#include "tests.h"
+#include "../../grammar/tests/tests.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LONG_CHAIN 3000
+
+const static Case_t cases[] = {
+    {true,  "int f(int a) { int x = 1; if (a) { x = 2; } return x; }",
+        "f(a):\nb0:\n    x.1 = 1\n    if a.0 goto b1 else b2\nb1:\n    x.2 = 2\n    goto b2\nb2:\n    x.3 = phi(b0: x.1, b1: x.2)\n    return x.3"},
+    {true,  "int f(int a) { int x = 1; if (a) { x = 2; } else { x = 3; } return x; }",
+        "f(a):\nb0:\n    x.1 = 1\n    if a.0 goto b1 else b2\nb1:\n    x.3 = 2\n    goto b3\nb2:\n    x.2 = 3\n    goto b3\nb3:\n    x.4 = phi(b2: x.2, b1: x.3)\n    return x.4"},
+    {true,  "int f(int n) { int s = 0; for (int i = 0; i < n; i += 1) { s += i; } return s; }",
+        "f(n):\nb0:\n    s.1 = 0\n    i.1 = 0\n    goto b1\nb1:\n    i.2 = phi(b0: i.1, b3: i.3)\n    s.2 = phi(b0: s.1, b3: s.3)\n    t3.1 = i.2 < n.0\n    if t3.1 goto b2 else b4\nb2:\n    s.3 = s.2 + i.2\n    goto b3\nb3:\n    i.3 = i.2 + 1\n    goto b1\nb4:\n    return s.2"},
+    {true,  "int f(int a) { int x = a; if (a) { int y = x; return y; } return 0; }",
+        "f(a):\nb0:\n    x.1 = a.0\n    if a.0 goto b1 else b2\nb1:\n    y.1 = x.1\n    return y.1\nb2:\n    return 0"},
+    {true,  "int f(int a, int b) { return a && b; }",
+        "f(a, b):\nb0:\n    t2.1 = a.0 != 0\n    if t2.1 goto b1 else b2\nb1:\n    t2.2 = b.0 != 0\n    goto b2\nb2:\n    t2.3 = phi(b0: t2.1, b1: t2.2)\n    return t2.3"},
+    {true,  "int f(int a) { int x = 1; int *p = &x; if (a) { x = 2; } return *p; }",
+        "f(a):\nb0:\n    x = 1\n    t3.1 = &x\n    p.1 = t3.1\n    if a.0 goto b1 else b2\nb1:\n    x = 2\n    goto b2\nb2:\n    return *p.1"},
+    {true,  "int f(int n) { int i = 0; while (1) { if (i > n) { break; } i += 1; } return i; }",
+        "f(n):\nb0:\n    i.1 = 0\n    goto b1\nb1:\n    i.2 = phi(b0: i.1, b5: i.3)\n    if 1 goto b2 else b3\nb2:\n    t2.1 = i.2 > n.0\n    if t2.1 goto b4 else b5\nb3:\n    return i.2\nb4:\n    goto b3\nb5:\n    i.3 = i.2 + 1\n    goto b1"},
+    {false, NULL, NULL}
+};
+
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    ParseContext_t *context = new_parse_context();
+    FlowProgram_t *program = flowify_str(str, context);
+    if (program) {
+        build_program_ssa(program);
+        Sink_t sink = new_buffer_sink();
+        for (const FlowFunction_t *it = program->functions; it; it = it->next) {
+            print_flow_function(&sink, it);
+        }
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+        free_sink(&sink);
+        buffer[strlen(buffer) - 1] = 0;
+        output.status = TRY_SUCCESS;
+        output.value = buffer;
+        free_flow_program(program);
+    }
+    else {
+        output.status = TRY_NONE;
+    }
+    free_parse_context(context);
+    return output;
+}
+
+/**
+ * Immediate dominators, frontiers and dominance of a loop inside a diamond
+ */
+static int test_dominators() {
+    int n_failed_tests = 0;
+    ParseContext_t *context = new_parse_context();
+    FlowProgram_t *program = flowify_str(const_string_from_cstr(
+        "void f(int a) { if (a) { while (a) { a -= 1; } } else { a = 2; } g(a); }"), context);
+    FlowFunction_t *f = program->functions;
+    build_ssa(program, f);
+    // b0 branches to b1 and b2, which join at b3; b1 loops through b4 to b5
+    BasicBlock_t **b = f->blocks;
+    const bool idoms = !b[0]->idom && b[1]->idom == b[0] && b[2]->idom == b[0] && b[3]->idom == b[0] &&
+        b[4]->idom == b[1] && b[5]->idom == b[4] && b[6]->idom == b[4];
+    const bool frontiers = b[0]->n_frontier == 0 &&
+        b[1]->n_frontier == 1 && b[1]->frontier[0] == b[3] &&
+        b[2]->n_frontier == 1 && b[2]->frontier[0] == b[3] &&
+        b[5]->n_frontier == 1 && b[5]->frontier[0] == b[4];
+    const bool dominance = dominates(b[0], b[5]) && dominates(b[4], b[6]) && dominates(b[4], b[4]) &&
+        !dominates(b[1], b[3]) && !dominates(b[5], b[4]);
+    n_failed_tests += !check("(dominators) immediate dominators", idoms);
+    n_failed_tests += !check("(dominators) dominance frontiers", frontiers);
+    n_failed_tests += !check("(dominators) dominance queries", dominance);
+    free_flow_program(program);
+    free_parse_context(context);
+    return n_failed_tests;
+}
+
+/**
+ * Thousands of blocks, each join needing a phi for one variable and none for
+ * the variables that are dead there
+ */
+static int test_long_chain() {
+    const char *const step = "if (a) { x += 1; } ";
+    const size_t step_len = strlen(step);
+    char *source = malloc(64 + LONG_CHAIN * step_len);
+    size_t len = sprintf(source, "int f(int a) { int x = 0; int d = 0; ");
+    for (int i = 0; i < LONG_CHAIN; ++i) {
+        memcpy(source + len, step, step_len);
+        len += step_len;
+    }
+    strcpy(source + len, "return x; }");
+    ParseContext_t *context = new_parse_context();
+    FlowProgram_t *program = flowify_str(const_string_from_cstr(source), context);
+    FlowFunction_t *f = program->functions;
+    build_ssa(program, f);
+    uint32_t n_phis = 0;
+    bool only_x = true;
+    for (uint32_t i = 0; i < f->n_blocks; ++i) {
+        for (const DataPhiLinkedListNode_t *it = f->blocks[i]->phis; it; it = it->next) {
+            ++n_phis;
+            only_x = only_x && it->value->variable->name == intern_cstr("x");
+        }
+    }
+    char message[128];
+    snprintf(message, sizeof(message), "(ssa) %d joins get one phi each", LONG_CHAIN);
+    const bool passed = check(message, n_phis == LONG_CHAIN && only_x);
+    free_flow_program(program);
+    free_parse_context(context);
+    free(source);
+    return !passed;
+}
+
+int test_flow_ssa() {
+    printf("Running test_flow_ssa() ...\n");
+    return test_fixture(cases, case_func, TEST_INPUT_STRING) + test_dominators() + test_long_chain();
+}
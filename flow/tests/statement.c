@@ -0,0 +1,78 @@
+#include "tests.h"
+#include "../../grammar/tests/tests.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const static Case_t cases[] = {
+    {true,  "int x = 1; x += 2;",
+        "top level:\nb0:\n    x = 1\n    x = x + 2\n    return"},
+    {true,  "int f(int a, int b) { if (a < b) { return a; } else { return b; } }",
+        "top level:\nb0:\n    return\nf(a, b):\nb0:\n    t2 = a < b\n    if t2 goto b1 else b2\nb1:\n    return a\nb2:\n    return b\nb3:\n    return"},
+    {true,  "int f(int n) { int s = 0; while (n) { if (n == 3) { continue; } s += n; n -= 1; } return s; }",
+        "top level:\nb0:\n    return\nf(n):\nb0:\n    s = 0\n    goto b1\nb1:\n    if n goto b2 else b3\nb2:\n    t2 = n == 3\n    if t2 goto b4 else b5\nb3:\n    return s\nb4:\n    goto b1\nb5:\n    s = s + n\n    n = n - 1\n    goto b1"},
+    {true,  "int f(int n) { int s = 0; for (int i = 0; i < n; i += 1) { if (i > 5) break; s += i; } return s; }",
+        "top level:\nb0:\n    return\nf(n):\nb0:\n    s = 0\n    i = 0\n    goto b1\nb1:\n    t3 = i < n\n    if t3 goto b2 else b4\nb2:\n    t4 = i > 5\n    if t4 goto b5 else b6\nb3:\n    i = i + 1\n    goto b1\nb4:\n    return s\nb5:\n    goto b4\nb6:\n    s = s + i\n    goto b3"},
+    {true,  "void f(int n) { do { n -= 1; } while (n); }",
+        "top level:\nb0:\n    return\nf(n):\nb0:\n    goto b1\nb1:\n    n = n - 1\n    goto b2\nb2:\n    if n goto b1 else b3\nb3:\n    return"},
+    {true,  "int f(int a, int b) { return a && b || !a; }",
+        "top level:\nb0:\n    return\nf(a, b):\nb0:\n    t3 = a != 0\n    if t3 goto b1 else b2\nb1:\n    t3 = b != 0\n    goto b2\nb2:\n    t2 = t3 != 0\n    if t2 goto b4 else b3\nb3:\n    t4 = !a\n    t2 = t4 != 0\n    goto b4\nb4:\n    return t2"},
+    {true,  "int f(int a) { return a ? 1 : 2; }",
+        "top level:\nb0:\n    return\nf(a):\nb0:\n    if a goto b1 else b2\nb1:\n    t1 = 1\n    goto b3\nb2:\n    t1 = 2\n    goto b3\nb3:\n    return t1"},
+    {true,  "struct P { int x; int *y; }; int f(struct P *p, int a[4]) { p->x = a[2]; *p->y = sizeof(*p); return g(p->x, (char)a[1]); }",
+        "top level:\nb0:\n    return\nf(p, a):\nb0:\n    t2 = a + 2\n    p->x = *t2\n    t3 = sizeof(struct P)\n    *p->y = t3\n    t4 = a + 1\n    t5 = (char)*t4\n    t6 = g(p->x, t5)\n    return t6"},
+    {true,  "int f(int n) { int x; { int x = n; x += 1; } return x; }",
+        "top level:\nb0:\n    return\nf(n):\nb0:\n    x = n\n    x = x + 1\n    return x"},
+    {true,  "typedef struct S { int x; } S; S s; s.x = 1;",
+        "top level:\nb0:\n    s.x = 1\n    return"},
+    {false, "int x; int x;", NULL},
+    {false, "break;", NULL},
+    {false, "int f(); f() = 2;", NULL},
+    {false, "struct A { int x; } a; struct A { int y; } b;", NULL},
+    {false, NULL, NULL}
+};
+
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    ErrorLinkedListNode_t *errors = NULL;
+    ErrorLinkedListNode_t **errors_head = &errors;
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryScope_t op = parse_scope(str, &errors_head);
+    attach_parse_context(prev_context);
+
+    if (op.status == TRY_SUCCESS) {
+        FlowProgram_t *program = flowify_scope(&op.value, context);
+        if (program->errors) {
+            output.status = TRY_ERROR;
+            output.error.desc = program->errors->desc;
+            output.error.location = str;
+        }
+        else {
+            Sink_t sink = new_buffer_sink();
+            print_flow_program(&sink, program);
+            snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+            free_sink(&sink);
+            buffer[strlen(buffer) - 1] = 0;
+            output.status = TRY_SUCCESS;
+            output.value = buffer;
+        }
+        free_flow_program(program);
+    }
+    else if (op.status == TRY_ERROR) {
+        output.status = TRY_ERROR;
+        output.error = op.error;
+    }
+    else {
+        output.status = TRY_NONE;
+    }
+    free_parse_context(context);
+    return output;
+}
+
+int test_flow_statement() {
+    printf("Running test_flow_statement() ...\n");
+    return test_fixture(cases, case_func, TEST_INPUT_STRING);
+}
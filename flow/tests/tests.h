@@ -0,0 +1,20 @@
+#ifndef _FLOW_TESTS_TESTS_H_
+#define _FLOW_TESTS_TESTS_H_
+
+#include "../flow.h"
+
+/**
+ * Parse `str` as a scope in `context` and flowify it; NULL if it does not
+ * parse
+ */
+FlowProgram_t *flowify_str(const ConstString_t str, ParseContext_t *const context);
+
+int test_flow_scope();
+int test_flow_layout();
+int test_flow_fold();
+int test_flow_statement();
+int test_flow_frame();
+int test_flow_ssa();
+int test_flow_sccp();
+
+#endif
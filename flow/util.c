@@ -1,12 +1,150 @@
 #include "flow.h"
 
+#include <assert.h>
+
 void append_error(FlowError_t ***errors, const FlowErrorVariant_t variant, const AConstString_t cause, const char *const desc) {
     FlowError_t *new_error = malloc(sizeof(FlowError_t));
     new_error->next = NULL;
-    new_error->variant = FLOW_ERROR;
+    new_error->variant = variant;
     new_error->cause = new_alloc_const_string_from_alloc_const_str(cause);
     new_error->desc = desc;
     assert(!**errors);
-    (**errors)->next = new_error;
+    **errors = new_error;
     *errors = &new_error->next;
-}
\ No newline at end of file
+}
+
+void *flow_alloc(FlowProgram_t *const program, const size_t size) {
+    void *output = arena_alloc(&program->arena, size);
+    memset(output, 0, size);
+    return output;
+}
+
+/**
+ * Grow a malloc'd array of pointers owned by a function
+ */
+static void push_pointer(void ***items, uint32_t *const size, uint32_t *const capacity, void *const item) {
+    if (*size == *capacity) {
+        *capacity = *capacity ? 2 * *capacity : 16;
+        *items = realloc(*items, *capacity * sizeof(void *));
+    }
+    (*items)[(*size)++] = item;
+}
+
+BasicBlock_t *new_basic_block(FlowBuilder_t *const builder) {
+    FlowFunction_t *function = builder->function;
+    BasicBlock_t *block = flow_alloc(builder->program, sizeof(BasicBlock_t));
+    block->id = function->n_blocks;
+    block->scope = current_scope(&builder->program->symbols);
+    push_pointer((void ***)&function->blocks, &function->n_blocks, &function->blocks_capacity, block);
+    return block;
+}
+
+BasicBlock_t *current_block(FlowBuilder_t *const builder) {
+    if (!builder->block) {
+        // Code after a jump is unreachable, but still gets a block of its own
+        builder->block = new_basic_block(builder);
+    }
+    return builder->block;
+}
+
+void jump_to(FlowBuilder_t *const builder, BasicBlock_t *const target) {
+    if (builder->block) {
+        builder->block->next = target;
+        builder->block = NULL;
+    }
+}
+
+void branch_to(FlowBuilder_t *const builder, DataOperand_t *const predicate, BasicBlock_t *const if_true, BasicBlock_t *const if_false) {
+    BasicBlock_t *block = current_block(builder);
+    block->predicate = predicate;
+    block->branch = if_true;
+    block->next = if_false;
+    builder->block = NULL;
+}
+
+DataVariable_t *new_data_variable(FlowBuilder_t *const builder, const Symbol_t *const name, const DerivedType_t *const type) {
+    FlowFunction_t *function = builder->function;
+    DataVariable_t *variable = flow_alloc(builder->program, sizeof(DataVariable_t));
+    variable->name = name;
+    variable->type = bind_derived_type(builder->program, type);
+    variable->location = flow_alloc(builder->program, sizeof(DataLocation_t));
+    variable->location->parent_scope = current_scope(&builder->program->symbols);
+    layout_data_location(builder->program, variable->location, variable->type);
+    variable->scope = variable->location->parent_scope;
+    variable->function = function;
+    variable->id = function->n_variables;
+    variable->address_taken = type && type->variant != DERIVED_TYPE_POINTER && (
+        type->variant != DERIVED_TYPE_TERMINAL ||
+        type->terminal.type.variant == TYPE_STRUCT ||
+        type->terminal.type.variant == TYPE_UNION);
+    push_pointer((void ***)&function->variables, &function->n_variables, &function->variables_capacity, variable);
+    return variable;
+}
+
+DataOperand_t *new_variable_operand(FlowBuilder_t *const builder, DataVariable_t *const variable) {
+    DataOperand_t *operand = flow_alloc(builder->program, sizeof(DataOperand_t));
+    operand->variant = OPERAND_VARIABLE;
+    operand->data = variable;
+    operand->type = variable->type;
+    return operand;
+}
+
+DataOperand_t *copy_operand(FlowBuilder_t *const builder, const DataOperand_t *const operand) {
+    if (!operand) {
+        return NULL;
+    }
+    DataOperand_t *output = flow_alloc(builder->program, sizeof(DataOperand_t));
+    *output = *operand;
+    if (operand->variant == OPERAND_INDIRECT || operand->variant == OPERAND_MEMBER) {
+        output->base = copy_operand(builder, operand->base);
+    }
+    return output;
+}
+
+DataOperation_t *emit_operation(FlowBuilder_t *const builder, const OperatorVariant_t op, DataOperand_t *const out, DataOperand_t *const in1, DataOperand_t *const in2) {
+    BasicBlock_t *block = current_block(builder);
+    DataOperation_t *operation = flow_alloc(builder->program, sizeof(DataOperation_t));
+    operation->op = op;
+    operation->out = out;
+    operation->in1 = in1;
+    operation->in2 = in2;
+    DataOperationLinkedListNode_t *node = flow_alloc(builder->program, sizeof(DataOperationLinkedListNode_t));
+    node->value = operation;
+    if (block->last_op) {
+        block->last_op->next = node;
+    }
+    else {
+        block->ops = node;
+    }
+    block->last_op = node;
+    return operation;
+}
+
+void flow_error(FlowBuilder_t *const builder, const char *const desc) {
+    AConstString_t cause;
+    cause.begin = (char *)builder->statement->str.begin;
+    cause.end = (char *)builder->statement->str.end;
+    append_error(&builder->program->errors_tail, FLOW_ERROR, cause, desc);
+}
+
+const DerivedType_t *primitive_derived_type(const PrimitiveVariant_t primitive) {
+    DerivedType_t der;
+    memset(&der, 0, sizeof(DerivedType_t));
+    der.variant = DERIVED_TYPE_TERMINAL;
+    der.terminal.qualifier = QUALIFIER_NONE;
+    der.terminal.type.variant = TYPE_PRIMITIVE;
+    der.terminal.type.primitive = primitive;
+    return canonical_derived_type(&der);
+}
+
+const DerivedType_t *pointer_derived_type(const DerivedType_t *const inner) {
+    if (!inner) {
+        return NULL;
+    }
+    DerivedType_t der;
+    memset(&der, 0, sizeof(DerivedType_t));
+    der.variant = DERIVED_TYPE_POINTER;
+    der.pointer.qualifier = QUALIFIER_NONE;
+    der.pointer.inner_type = (DerivedType_t *)inner;
+    return canonical_derived_type(&der);
+}
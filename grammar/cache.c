@@ -0,0 +1,162 @@
+#include "grammar.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Part of every key, so results from an older parser are never loaded; bump
+ * it whenever the parser's output for some input changes
+ */
+#define PARSER_VERSION 7
+
+typedef struct {
+    char *name;
+    uint64_t size;
+    struct timespec used;
+} CacheEntry_t;
+
+static bool is_cache_file(const char *const name) {
+    const size_t len = strlen(name);
+    return name[0] != '.' && len > 4 && !strcmp(name + len - 4, ".ast");
+}
+
+/**
+ * The cache files in the directory, with their total size
+ */
+static CacheEntry_t *list_entries(const char *const dir_path, size_t *const n_entries, uint64_t *const total) {
+    *n_entries = 0;
+    *total = 0;
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        return NULL;
+    }
+    CacheEntry_t *entries = NULL;
+    size_t capacity = 0;
+    char path[PATH_MAX];
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir_path, ent->d_name);
+        if (!is_cache_file(ent->d_name) || stat(path, &st) < 0) {
+            continue;
+        }
+        if (*n_entries == capacity) {
+            capacity = capacity ? 2 * capacity : 64;
+            entries = realloc(entries, capacity * sizeof(CacheEntry_t));
+        }
+        entries[*n_entries].name = strdup(ent->d_name);
+        entries[*n_entries].size = st.st_size;
+        entries[*n_entries].used = st.st_mtim;
+        ++*n_entries;
+        *total += st.st_size;
+    }
+    closedir(dir);
+    return entries;
+}
+
+static void free_entries(CacheEntry_t *const entries, const size_t n_entries) {
+    for (size_t i = 0; i < n_entries; ++i) {
+        free(entries[i].name);
+    }
+    free(entries);
+}
+
+ParseCache_t new_parse_cache(const char *const dir, const uint64_t max_bytes) {
+    ParseCache_t output;
+    output.dir = strdup(dir);
+    output.max_bytes = max_bytes;
+    output.hits = 0;
+    output.misses = 0;
+    mkdir(dir, 0777);
+    size_t n_entries;
+    CacheEntry_t *entries = list_entries(dir, &n_entries, &output.total_bytes);
+    free_entries(entries, n_entries);
+    return output;
+}
+
+void free_parse_cache(ParseCache_t *const cache) {
+    free(cache->dir);
+    cache->dir = NULL;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const CacheEntry_t *ea = a;
+    const CacheEntry_t *eb = b;
+    if (ea->used.tv_sec != eb->used.tv_sec) {
+        return ea->used.tv_sec < eb->used.tv_sec ? -1 : 1;
+    }
+    return (ea->used.tv_nsec > eb->used.tv_nsec) - (ea->used.tv_nsec < eb->used.tv_nsec);
+}
+
+/**
+ * Remove the least recently used files until the directory fits; another
+ * process may be evicting too, so files that are already gone are skipped
+ */
+static void evict(ParseCache_t *const cache) {
+    size_t n_entries;
+    uint64_t total;
+    CacheEntry_t *entries = list_entries(cache->dir, &n_entries, &total);
+    qsort(entries, n_entries, sizeof(CacheEntry_t), compare_entries);
+    char path[PATH_MAX];
+    for (size_t i = 0; i < n_entries && total > cache->max_bytes; ++i) {
+        snprintf(path, sizeof(path), "%s/%s", cache->dir, entries[i].name);
+        if (!unlink(path) || errno == ENOENT) {
+            total -= entries[i].size;
+        }
+    }
+    free_entries(entries, n_entries);
+    cache->total_bytes = total;
+}
+
+/**
+ * Write to a name unique to this process and call, and rename it into place,
+ * so readers only ever see complete files; the directory is only listed when
+ * the running total says it no longer fits
+ */
+static void store(ParseCache_t *const cache, const char *const path, const TryScope_t *const result, const ErrorLinkedListNode_t *const errors, const ConstString_t str) {
+    static atomic_uint_fast64_t n_stored = 0;
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s/.tmp-%d-%llu.ast", cache->dir, (int)getpid(),
+        (unsigned long long)atomic_fetch_add(&n_stored, 1));
+    // The key already names the source, so it is not copied into the file
+    TrySize_t saved = save_parse_result(tmp_path, result, errors, str, false);
+    if (saved.status != TRY_SUCCESS || rename(tmp_path, path) < 0) {
+        unlink(tmp_path);
+        return;
+    }
+    cache->total_bytes += saved.value;
+    if (cache->total_bytes > cache->max_bytes) {
+        evict(cache);
+    }
+}
+
+TryScope_t parse_scope_cached(ParseCache_t *const cache, const ConstString_t str, ParseContext_t *const context, ErrorLinkedListNode_t ***const errors) {
+    TryScope_t output;
+    char path[PATH_MAX];
+    // A collision only costs a miss, since loading also checks the source's
+    // length and a second hash of it
+    snprintf(path, sizeof(path), "%s/%016llx.ast", cache->dir, (unsigned long long)hash_bytes(str, PARSER_VERSION));
+
+    if (!load_parse_result(path, context, str, &output, errors)) {
+        // The modification time doubles as the last use for eviction
+        utimensat(AT_FDCWD, path, NULL, 0);
+        ++cache->hits;
+        return output;
+    }
+
+    ++cache->misses;
+    ErrorLinkedListNode_t **first_error = *errors;
+    ParseContext_t *prev_context = attach_parse_context(context);
+    output = parse_scope(str, errors);
+    attach_parse_context(prev_context);
+    store(cache, path, &output, *first_error, str);
+    return output;
+}
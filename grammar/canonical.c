@@ -0,0 +1,258 @@
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Open-addressed table of canonical types, plus a log of insertions in order.
+ * Growing reinserts in log order, so a type's probe sequence only ever passes
+ * over types inserted before it and the newest type can be removed by simply
+ * clearing its slot; rollbacks always remove the newest types first.
+ */
+typedef struct {
+    DerivedType_t *type;
+    size_t allocated; // Arena position just after the type was allocated
+} TypeLogEntry_t;
+
+typedef struct TypeTable {
+    DerivedType_t **slots;
+    size_t capacity; // Always a power of 2
+    TypeLogEntry_t *log;
+    size_t size;
+    size_t log_capacity;
+} TypeTable_t;
+
+static uint32_t hash_combine(const uint32_t hash, const uint64_t value) {
+    // FNV-1a over the bytes of the value
+    uint32_t output = hash;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        output ^= (uint8_t)(value >> (8 * i));
+        output *= 16777619u;
+    }
+    return output;
+}
+
+static uint32_t hash_type(uint32_t hash, const Type_t *const type) {
+    hash = hash_combine(hash, type->variant);
+    switch (type->variant) {
+        case TYPE_PRIMITIVE:
+            return hash_combine(hash, type->primitive);
+        case TYPE_NAMED:
+            return hash_combine(hash, type->named->hash);
+        default:
+            hash = hash_combine(hash, type->compound.has_name ? type->compound.name->hash : 0);
+            hash = hash_combine(hash, type->compound.is_definition);
+            if (type->compound.is_definition) {
+                hash = hash_combine(hash, (uintptr_t)type->compound.su_fields.items);
+            }
+            return hash;
+    }
+}
+
+static uint32_t hash_derived_type(const DerivedType_t *const der) {
+    uint32_t hash = hash_combine(2166136261u, der->variant);
+    switch (der->variant) {
+        case DERIVED_TYPE_TERMINAL:
+            hash = hash_combine(hash, der->terminal.qualifier);
+            hash = hash_combine(hash, (uintptr_t)der->terminal.resolved);
+            return hash_type(hash, &der->terminal.type);
+        case DERIVED_TYPE_POINTER:
+            hash = hash_combine(hash, der->pointer.qualifier);
+            return hash_combine(hash, der->pointer.inner_type->hash);
+        case DERIVED_TYPE_ARRAY:
+            hash = hash_combine(hash, der->array.inner_type->hash);
+            if (der->array.has_size) {
+                ConstString_t size;
+                size.begin = der->array.size.begin;
+                size.end = der->array.size.end;
+                hash = hash_combine(hash, hash_const_str(size));
+                hash = hash_combine(hash, der->array.is_size_constant ? der->array.size_value : 0);
+            }
+            return hash;
+        case DERIVED_TYPE_FUNCTION:
+            hash = hash_combine(hash, der->function.return_type->hash);
+            for (uint32_t i = 0; i < der->function.params.size; ++i) {
+                const Variable_t *param = &der->function.params.items[i];
+                hash = hash_combine(hash, param->type->hash);
+            }
+            return hash;
+    }
+    return hash;
+}
+
+static bool type_equal(const Type_t *const a, const Type_t *const b) {
+    if (a->variant != b->variant) {
+        return false;
+    }
+    switch (a->variant) {
+        case TYPE_PRIMITIVE:
+            return a->primitive == b->primitive;
+        case TYPE_NAMED:
+            return a->named == b->named;
+        default:
+            if (    a->compound.has_name != b->compound.has_name ||
+                    a->compound.is_definition != b->compound.is_definition ||
+                    (a->compound.has_name && a->compound.name != b->compound.name)) {
+                return false;
+            }
+            // A definition is its own type, even if another one is identical
+            return !a->compound.is_definition || a->compound.su_fields.items == b->compound.su_fields.items;
+    }
+}
+
+/**
+ * Children are canonical, so they are compared by pointer
+ */
+static bool derived_type_equal(const DerivedType_t *const a, const DerivedType_t *const b) {
+    if (a->hash != b->hash || a->variant != b->variant) {
+        return false;
+    }
+    switch (a->variant) {
+        case DERIVED_TYPE_TERMINAL:
+            return
+                a->terminal.qualifier == b->terminal.qualifier &&
+                a->terminal.resolved == b->terminal.resolved &&
+                type_equal(&a->terminal.type, &b->terminal.type);
+        case DERIVED_TYPE_POINTER:
+            return a->pointer.qualifier == b->pointer.qualifier && a->pointer.inner_type == b->pointer.inner_type;
+        case DERIVED_TYPE_ARRAY:
+            if (a->array.inner_type != b->array.inner_type || a->array.has_size != b->array.has_size) {
+                return false;
+            }
+            if (!a->array.has_size) {
+                return true;
+            }
+            // The same text may have been evaluated in different scopes
+            if (    a->array.is_size_constant != b->array.is_size_constant ||
+                    (a->array.is_size_constant && a->array.size_value != b->array.size_value) ||
+                    (!a->array.is_size_constant && !a->array.size_expr != !b->array.size_expr)) {
+                return false;
+            }
+            return
+                a->array.size.end - a->array.size.begin == b->array.size.end - b->array.size.begin &&
+                !memcmp(a->array.size.begin, b->array.size.begin, a->array.size.end - a->array.size.begin);
+        case DERIVED_TYPE_FUNCTION:
+            if (a->function.return_type != b->function.return_type || a->function.params.size != b->function.params.size) {
+                return false;
+            }
+            for (uint32_t i = 0; i < a->function.params.size; ++i) {
+                if (a->function.params.items[i].type != b->function.params.items[i].type) {
+                    return false;
+                }
+            }
+            return true;
+    }
+    return false;
+}
+
+static DerivedType_t **find_slot(DerivedType_t **const slots, const size_t capacity, const DerivedType_t *const der) {
+    const size_t mask = capacity - 1;
+    size_t i = der->hash & mask;
+    while (slots[i] && !derived_type_equal(slots[i], der)) {
+        i = (i + 1) & mask;
+    }
+    return &slots[i];
+}
+
+static void grow_table(TypeTable_t *const table) {
+    const size_t capacity = table->capacity ? 2 * table->capacity : 256;
+    DerivedType_t **slots = calloc(capacity, sizeof(DerivedType_t *));
+    for (size_t i = 0; i < table->size; ++i) {
+        *find_slot(slots, capacity, table->log[i].type) = table->log[i].type;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+}
+
+/**
+ * The parameters of a new canonical function type, without their names
+ */
+static VariableSpan_t unnamed_params(const VariableSpan_t params) {
+    VariableSpan_t output;
+    output.items = NULL;
+    output.size = params.size;
+    if (params.size) {
+        output.items = parse_alloc(params.size * sizeof(Variable_t));
+        for (uint32_t i = 0; i < params.size; ++i) {
+            output.items[i].name = NULL;
+            output.items[i].has_name = false;
+            output.items[i].type = params.items[i].type;
+            output.items[i].params.items = NULL;
+            output.items[i].params.size = 0;
+        }
+    }
+    return output;
+}
+
+DerivedType_t *canonical_derived_type(const DerivedType_t *const proto) {
+    ParseContext_t *context = get_attached_parse_context();
+    DerivedType_t der = *proto;
+    der.hash = hash_derived_type(proto);
+    if (!context) {
+        DerivedType_t *output = new_derived_type();
+        der.id = NO_NODE_ID;
+        *output = der;
+        if (der.variant == DERIVED_TYPE_FUNCTION) {
+            output->function.params = unnamed_params(der.function.params);
+        }
+        return output;
+    }
+
+    if (!context->types) {
+        context->types = calloc(1, sizeof(TypeTable_t));
+    }
+    TypeTable_t *table = context->types;
+    if (2 * (table->size + 1) > table->capacity) {
+        grow_table(table);
+    }
+    DerivedType_t **slot = find_slot(table->slots, table->capacity, &der);
+    if (!*slot) {
+        *slot = new_derived_type();
+        der.id = context->derived_types.size;
+        **slot = der;
+        if (der.variant == DERIVED_TYPE_FUNCTION) {
+            (*slot)->function.params = unnamed_params(der.function.params);
+        }
+        if (table->size == table->log_capacity) {
+            table->log_capacity = table->log_capacity ? 2 * table->log_capacity : 256;
+            table->log = realloc(table->log, table->log_capacity * sizeof(TypeLogEntry_t));
+        }
+        table->log[table->size].type = *slot;
+        table->log[table->size].allocated = context->arena.allocated;
+        ++table->size;
+    }
+    return *slot;
+}
+
+int cmp_canonical_type(const DerivedType_t *const first, const DerivedType_t *const second) {
+    return first < second ? -1 : first > second;
+}
+
+uint32_t hash_canonical_type(const DerivedType_t *const type) {
+    return type->hash;
+}
+
+size_t n_canonical_types() {
+    ParseContext_t *context = get_attached_parse_context();
+    return context && context->types ? context->types->size : 0;
+}
+
+void invalidate_canonical_types(const size_t allocated) {
+    ParseContext_t *context = get_attached_parse_context();
+    if (!context || !context->types) {
+        return;
+    }
+    TypeTable_t *table = context->types;
+    while (table->size && table->log[table->size - 1].allocated > allocated) {
+        *find_slot(table->slots, table->capacity, table->log[--table->size].type) = NULL;
+    }
+}
+
+void free_type_table(TypeTable_t *const table) {
+    if (table) {
+        free(table->slots);
+        free(table->log);
+        free(table);
+    }
+}
@@ -0,0 +1,306 @@
+#include "util.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ARENA_CHUNK_SIZE 0x10000
+
+static ParseContext_t *attached_context = NULL;
+
+Arena_t new_arena() {
+    Arena_t output;
+    output.head = NULL;
+    output.allocated = 0;
+    return output;
+}
+
+void *arena_alloc(Arena_t *const arena, const size_t size) {
+    const size_t aligned = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    ArenaChunk_t *chunk = arena->head;
+    if (!chunk || chunk->used + aligned > chunk->size) {
+        // Oversized requests get a chunk of their own
+        const size_t chunk_size = aligned > ARENA_CHUNK_SIZE ? aligned : ARENA_CHUNK_SIZE;
+        chunk = malloc(sizeof(ArenaChunk_t) + chunk_size);
+        chunk->prev = arena->head;
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        arena->head = chunk;
+    }
+    void *output = chunk->data + chunk->used;
+    chunk->used += aligned;
+    arena->allocated += aligned;
+    return output;
+}
+
+ArenaCheckpoint_t arena_checkpoint(const Arena_t *const arena) {
+    ArenaCheckpoint_t output;
+    output.head = arena->head;
+    output.used = arena->head ? arena->head->used : 0;
+    output.allocated = arena->allocated;
+    return output;
+}
+
+void arena_rollback(Arena_t *const arena, const ArenaCheckpoint_t checkpoint) {
+    while (arena->head != checkpoint.head) {
+        ArenaChunk_t *prev = arena->head->prev;
+        free(arena->head);
+        arena->head = prev;
+    }
+    if (arena->head) {
+        arena->head->used = checkpoint.used;
+    }
+    arena->allocated = checkpoint.allocated;
+}
+
+void free_arena(Arena_t *const arena) {
+    ArenaCheckpoint_t empty;
+    empty.head = NULL;
+    empty.used = 0;
+    empty.allocated = 0;
+    arena_rollback(arena, empty);
+}
+
+static NodePool_t new_node_pool(const size_t node_size) {
+    NodePool_t output;
+    output.chunks = NULL;
+    output.n_chunks = 0;
+    output.size = 0;
+    output.node_size = node_size;
+    return output;
+}
+
+static void free_node_pool(NodePool_t *const pool) {
+    for (uint32_t i = 0; i < pool->n_chunks; ++i) {
+        free(pool->chunks[i]);
+    }
+    free(pool->chunks);
+}
+
+/**
+ * Chunks left over from a rollback are reused. Each node also counts towards
+ * the arena's allocated bytes, which order allocations for rollbacks
+ */
+static void *pool_alloc(ParseContext_t *const context, NodePool_t *const pool) {
+    const uint32_t chunk = pool->size >> NODE_POOL_CHUNK_BITS;
+    if (chunk == pool->n_chunks) {
+        pool->chunks = realloc(pool->chunks, (pool->n_chunks + 1) * sizeof(char *));
+        pool->chunks[pool->n_chunks++] = malloc(pool->node_size << NODE_POOL_CHUNK_BITS);
+    }
+    void *output = pool->chunks[chunk] + (pool->size & ((1u << NODE_POOL_CHUNK_BITS) - 1)) * pool->node_size;
+    ++pool->size;
+    context->arena.allocated += pool->node_size;
+    return output;
+}
+
+static void *pool_at(const NodePool_t *const pool, const NodeId_t id) {
+    if (id == NO_NODE_ID || id > pool->size) {
+        return NULL;
+    }
+    const uint32_t index = id - 1;
+    return pool->chunks[index >> NODE_POOL_CHUNK_BITS] + (index & ((1u << NODE_POOL_CHUNK_BITS) - 1)) * pool->node_size;
+}
+
+ParseContext_t *new_parse_context() {
+    ParseContext_t *context = malloc(sizeof(ParseContext_t));
+    context->arena = new_arena();
+    context->sources = NULL;
+    context->zero_copy = false;
+    context->types = NULL;
+    context->expressions = new_node_pool(sizeof(Expression_t));
+    context->operators = new_node_pool(sizeof(Operator_t));
+    context->derived_types = new_node_pool(sizeof(DerivedType_t));
+    return context;
+}
+
+void free_parse_context(ParseContext_t *const context) {
+    free_type_table(context->types);
+    free_node_pool(&context->expressions);
+    free_node_pool(&context->operators);
+    free_node_pool(&context->derived_types);
+    free_arena(&context->arena);
+    while (context->sources) {
+        MappedSource_t *next = context->sources->next;
+        munmap(context->sources->addr, context->sources->size);
+        free(context->sources);
+        context->sources = next;
+    }
+    free(context);
+}
+
+void add_mapped_source(ParseContext_t *const context, void *const addr, const size_t size) {
+    MappedSource_t *source = malloc(sizeof(MappedSource_t));
+    source->next = context->sources;
+    source->addr = addr;
+    source->size = size;
+    context->sources = source;
+}
+
+TryConstString_t map_source_file(ParseContext_t *const context, const char *const path) {
+    TryConstString_t output;
+    output.error.location.begin = path;
+    output.error.location.end = path + strlen(path);
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        output.status = TRY_ERROR;
+        output.error.desc = "Could not open file";
+        return output;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        output.status = TRY_ERROR;
+        output.error.desc = "Could not stat file";
+        return output;
+    }
+    output.status = TRY_SUCCESS;
+    if (st.st_size == 0) {
+        // Empty files cannot be mapped
+        close(fd);
+        output.value.begin = "";
+        output.value.end = output.value.begin;
+        return output;
+    }
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        output.status = TRY_ERROR;
+        output.error.desc = "Could not map file";
+        return output;
+    }
+    add_mapped_source(context, addr, st.st_size);
+    output.value.begin = addr;
+    output.value.end = output.value.begin + st.st_size;
+    return output;
+}
+
+ParseContext_t *attach_parse_context(ParseContext_t *const context) {
+    ParseContext_t *prev = attached_context;
+    attached_context = context;
+    return prev;
+}
+
+ParseContext_t *get_attached_parse_context() {
+    return attached_context;
+}
+
+void *parse_alloc(const size_t size) {
+    if (attached_context) {
+        return arena_alloc(&attached_context->arena, size);
+    }
+    return malloc(size);
+}
+
+Expression_t *new_expression() {
+    return attached_context ? pool_alloc(attached_context, &attached_context->expressions) : malloc(sizeof(Expression_t));
+}
+
+Operator_t *new_operator() {
+    return attached_context ? pool_alloc(attached_context, &attached_context->operators) : malloc(sizeof(Operator_t));
+}
+
+DerivedType_t *new_derived_type() {
+    return attached_context ? pool_alloc(attached_context, &attached_context->derived_types) : malloc(sizeof(DerivedType_t));
+}
+
+Expression_t *expression_at(const ParseContext_t *const context, const NodeId_t id) {
+    return pool_at(&context->expressions, id);
+}
+
+Operator_t *operator_at(const ParseContext_t *const context, const NodeId_t id) {
+    return pool_at(&context->operators, id);
+}
+
+DerivedType_t *derived_type_at(const ParseContext_t *const context, const NodeId_t id) {
+    return pool_at(&context->derived_types, id);
+}
+
+void parse_free(void *const ptr) {
+    if (!attached_context) {
+        free(ptr);
+    }
+}
+
+AConstString_t parse_alloc_const_string(const ConstString_t str) {
+    if (attached_context && attached_context->zero_copy) {
+        // Source buffers are never written through the AST
+        AConstString_t output;
+        output.begin = (char *)str.begin;
+        output.end = (char *)str.end;
+        return output;
+    }
+    const size_t len = str.end - str.begin;
+    char *buffer = parse_alloc(len + 1);
+    memcpy(buffer, str.begin, len);
+    buffer[len] = 0;
+
+    AConstString_t output;
+    output.begin = buffer;
+    output.end = buffer + len;
+    return output;
+}
+
+SpanBuilder_t new_span_builder(const size_t item_size) {
+    SpanBuilder_t output;
+    output.items = NULL;
+    output.size = 0;
+    output.capacity = 0;
+    output.item_size = item_size;
+    return output;
+}
+
+void *span_builder_push(SpanBuilder_t *const builder) {
+    if (builder->size == builder->capacity) {
+        builder->capacity = builder->capacity ? 2 * builder->capacity : 8;
+        builder->items = realloc(builder->items, builder->capacity * builder->item_size);
+    }
+    return (char *)builder->items + builder->item_size * builder->size++;
+}
+
+void *finish_span(SpanBuilder_t *const builder) {
+    void *output = NULL;
+    if (builder->size) {
+        output = parse_alloc(builder->size * builder->item_size);
+        memcpy(output, builder->items, builder->size * builder->item_size);
+    }
+    free_span_builder(builder);
+    return output;
+}
+
+void free_span_builder(SpanBuilder_t *const builder) {
+    free(builder->items);
+    builder->items = NULL;
+    builder->capacity = 0;
+}
+
+ParseCheckpoint_t parse_checkpoint() {
+    ParseCheckpoint_t output;
+    if (attached_context) {
+        output.arena = arena_checkpoint(&attached_context->arena);
+        output.n_expressions = attached_context->expressions.size;
+        output.n_operators = attached_context->operators.size;
+        output.n_derived_types = attached_context->derived_types.size;
+        return output;
+    }
+    output.arena.head = NULL;
+    output.arena.used = 0;
+    output.arena.allocated = 0;
+    output.n_expressions = 0;
+    output.n_operators = 0;
+    output.n_derived_types = 0;
+    return output;
+}
+
+void parse_rollback(const ParseCheckpoint_t checkpoint) {
+    if (attached_context && checkpoint.arena.allocated < attached_context->arena.allocated) {
+        invalidate_parse_memo(checkpoint.arena.allocated);
+        invalidate_canonical_types(checkpoint.arena.allocated);
+        arena_rollback(&attached_context->arena, checkpoint.arena);
+        attached_context->expressions.size = checkpoint.n_expressions;
+        attached_context->operators.size = checkpoint.n_operators;
+        attached_context->derived_types.size = checkpoint.n_derived_types;
+    }
+}
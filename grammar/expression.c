@@ -28,26 +28,28 @@ ConstString_t strip_wrapping_parens(const ConstString_t str) {
     return working;
 }
 
-TryExpression_t parse_left_expression(const ConstString_t str) {
+static TryExpression_t parse_left_expression_uncached(const ConstString_t str) {
     TryExpression_t output;
     ConstString_t working = strip_wrapping_parens(strip_whitespace(str));
     if (working.begin == working.end) {
         output.status = TRY_NONE;
         return output;
     }
+    ParseCheckpoint_t checkpoint = parse_checkpoint();
     TryVariable_t var = parse_variable(str);
     if (var.status == TRY_SUCCESS && var.value.has_name) {
         output.status = TRY_SUCCESS;
         output.value.variant = EXPRESSION_DECLARATION;
-        output.value.decl = malloc(sizeof(Variable_t));
+        output.value.decl = parse_alloc(sizeof(Variable_t));
         *output.value.decl = var.value;
         return output;
     }
+    parse_rollback(checkpoint);
     TryOperator_t op = parse_operator(working);
     if (op.status == TRY_SUCCESS) {
         output.status = TRY_SUCCESS;
         output.value.variant = EXPRESSION_OPERATOR;
-        output.value.operator = malloc(sizeof(Operator_t));
+        output.value.operator = new_operator();
         *output.value.operator = op.value;
         return output;
     }
@@ -60,7 +62,7 @@ TryExpression_t parse_left_expression(const ConstString_t str) {
         }
         output.status = TRY_SUCCESS;
         output.value.variant = EXPRESSION_IDENTIFIER;
-        output.value.identifier = new_alloc_const_string_from_const_str(identifier.value);
+        output.value.identifier = intern(identifier.value);
         return output;
     }
     output.status = TRY_ERROR;
@@ -69,7 +71,12 @@ TryExpression_t parse_left_expression(const ConstString_t str) {
     return output;
 }
 
-TryExpression_t parse_right_expression(const ConstString_t str) {
+TryExpression_t parse_left_expression(const ConstString_t str) {
+    TryExpression_t output;
+    WithParseMemo(MEMO_LEFT_EXPRESSION, expression, str, output, parse_left_expression_uncached(str));
+}
+
+static TryExpression_t parse_right_expression_uncached(const ConstString_t str) {
     TryExpression_t output;
     ConstString_t working = strip_wrapping_parens(strip_whitespace(str));
     if (working.begin == working.end) {
@@ -80,7 +87,7 @@ TryExpression_t parse_right_expression(const ConstString_t str) {
     if (op.status == TRY_SUCCESS) {
         output.status = TRY_SUCCESS;
         output.value.variant = EXPRESSION_OPERATOR;
-        output.value.operator = malloc(sizeof(Operator_t));
+        output.value.operator = new_operator();
         *output.value.operator = op.value;
         return output;
     }
@@ -94,6 +101,8 @@ TryExpression_t parse_right_expression(const ConstString_t str) {
         output.status = TRY_SUCCESS;
         output.value.variant = EXPRESSION_UINT_LIT;
         output.value.uint_lit = integer.value.integer;
+        output.value.uint_lit_base = integer.value.base;
+        output.value.uint_lit_suffix = integer.value.suffix;
         return output;
     }
     TryConstString_t str_lit = find_string_lit(working, '"', '\\');
@@ -109,7 +118,7 @@ TryExpression_t parse_right_expression(const ConstString_t str) {
         contents.end = str_lit.value.end - 1;
         output.status = TRY_SUCCESS;
         output.value.variant = EXPRESSION_STR_LIT;
-        output.value.str_lit = new_alloc_const_string_from_const_str(contents);
+        output.value.str_lit = intern(contents);
         return output;
     }
     TryConstString_t char_lit = find_string_lit(working, '\'', '\\');
@@ -127,7 +136,7 @@ TryExpression_t parse_right_expression(const ConstString_t str) {
         if ((len == 1 && contents.begin[0] != '\\') || (len == 2 && contents.begin[0] == '\\')) {
             output.status = TRY_SUCCESS;
             output.value.variant = EXPRESSION_CHAR_LIT;
-            output.value.char_lit = new_alloc_const_string_from_const_str(contents);
+            output.value.char_lit = intern(contents);
             return output;
         }
         else {
@@ -147,7 +156,7 @@ TryExpression_t parse_right_expression(const ConstString_t str) {
         }
         output.status = TRY_SUCCESS;
         output.value.variant = EXPRESSION_IDENTIFIER;
-        output.value.identifier = new_alloc_const_string_from_const_str(identifier.value);
+        output.value.identifier = intern(identifier.value);
         return output;
     }
     output.status = TRY_ERROR;
@@ -156,61 +165,220 @@ TryExpression_t parse_right_expression(const ConstString_t str) {
     return output;
 }
 
-TryExpression_t parse_type_expression(const ConstString_t str) {
+TryExpression_t parse_right_expression(const ConstString_t str) {
+    TryExpression_t output;
+    WithParseMemo(MEMO_RIGHT_EXPRESSION, expression, str, output, parse_right_expression_uncached(str));
+}
+
+/**
+ * Same alternatives as `parse_right_expression_uncached`, taken from the
+ * tokens: a literal or an identifier must be the only token
+ */
+static TryExpression_t parse_right_expression_token_span_uncached(const TokenSpan_t span) {
+    TryExpression_t output;
+    TokenSpan_t working = span;
+    while (working.begin < working.end && is_punctuator(&span.tokens[working.begin], "(") && span.match[working.begin] == working.end - 1) {
+        ++working.begin;
+        --working.end;
+    }
+    if (working.begin == working.end) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    TryOperator_t op = parse_operator_token_span(working);
+    if (op.status == TRY_SUCCESS) {
+        output.status = TRY_SUCCESS;
+        output.value.variant = EXPRESSION_OPERATOR;
+        output.value.operator = new_operator();
+        *output.value.operator = op.value;
+        return output;
+    }
+    const Token_t *token = &span.tokens[working.begin];
+    const bool single = working.end - working.begin == 1;
+    ConstString_t contents;
+    contents.begin = token->str.begin + 1;
+    contents.end = token->str.end - 1;
+    switch (token->variant) {
+        case TOKEN_INTEGER: {
+            TryIntegerLiteral_t integer = find_integer(token->str);
+            if (!single || integer.status != TRY_SUCCESS || integer.value.str.end != token->str.end) {
+                output.status = TRY_NONE;
+                return output;
+            }
+            output.status = TRY_SUCCESS;
+            output.value.variant = EXPRESSION_UINT_LIT;
+            output.value.uint_lit = integer.value.integer;
+            output.value.uint_lit_base = integer.value.base;
+            output.value.uint_lit_suffix = integer.value.suffix;
+            return output;
+        }
+        case TOKEN_STR_LIT:
+            if (!single) {
+                output.status = TRY_NONE;
+                return output;
+            }
+            output.status = TRY_SUCCESS;
+            output.value.variant = EXPRESSION_STR_LIT;
+            output.value.str_lit = intern(contents);
+            return output;
+        case TOKEN_CHAR_LIT: {
+            if (!single) {
+                output.status = TRY_NONE;
+                return output;
+            }
+            size_t len = contents.end - contents.begin;
+            if ((len == 1 && contents.begin[0] != '\\') || (len == 2 && contents.begin[0] == '\\')) {
+                output.status = TRY_SUCCESS;
+                output.value.variant = EXPRESSION_CHAR_LIT;
+                output.value.char_lit = intern(contents);
+                return output;
+            }
+            output.status = TRY_ERROR;
+            output.error.location = contents;
+            output.error.desc = "Character literal must contain 1 character";
+            return output;
+        }
+        case TOKEN_IDENTIFIER:
+            if (!single) {
+                output.status = TRY_NONE;
+                return output;
+            }
+            output.status = TRY_SUCCESS;
+            output.value.variant = EXPRESSION_IDENTIFIER;
+            output.value.identifier = token->symbol;
+            return output;
+        default:
+            break;
+    }
+    output.status = TRY_ERROR;
+    output.error.location = token_span_str(span, span.begin, span.end);
+    output.error.desc = token->variant == TOKEN_KEYWORD ? "Identifier cannot be a keyword" : "Expected a right expression";
+    return output;
+}
+
+TryExpression_t parse_right_expression_token_span(const TokenSpan_t span) {
+    TryExpression_t output;
+    if (span.begin == span.end) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    WithParseMemo(MEMO_RIGHT_EXPRESSION, expression, token_span_str(span, span.begin, span.end), output, parse_right_expression_token_span_uncached(span));
+}
+
+static TryExpression_t parse_type_expression_uncached(const ConstString_t str) {
     TryExpression_t output;
     ConstString_t working = strip_wrapping_parens(strip_whitespace(str));
     if (working.begin == working.end) {
         output.status = TRY_NONE;
         return output;
     }
+    ParseCheckpoint_t checkpoint = parse_checkpoint();
     TryVariable_t var = parse_variable(working);
     if (var.status == TRY_SUCCESS && !var.value.has_name) {
         output.status = TRY_SUCCESS;
         output.value.variant = EXPRESSION_TYPE;
-        output.value.type = malloc(sizeof(DerivedType_t));
-        memcpy(output.value.type, var.value.type, sizeof(DerivedType_t));
+        output.value.type = var.value.type;
         return output;
     }
+    parse_rollback(checkpoint);
     output.status = TRY_NONE;
     return output;
 }
 
-size_t print_expression(char *buffer, const Expression_t *const expr, const Operator_t *const parent_op) {
+TryExpression_t parse_type_expression(const ConstString_t str) {
+    TryExpression_t output;
+    WithParseMemo(MEMO_TYPE_EXPRESSION, expression, str, output, parse_type_expression_uncached(str));
+}
+
+static TryExpression_t parse_type_expression_token_span_uncached(const TokenSpan_t span) {
+    TryExpression_t output;
+    TokenSpan_t working = span;
+    while (working.begin < working.end && is_punctuator(&span.tokens[working.begin], "(") && span.match[working.begin] == working.end - 1) {
+        ++working.begin;
+        --working.end;
+    }
+    if (working.begin == working.end) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    ParseCheckpoint_t checkpoint = parse_checkpoint();
+    TryVariable_t var = parse_variable_token_span(working);
+    if (var.status == TRY_SUCCESS && !var.value.has_name) {
+        output.status = TRY_SUCCESS;
+        output.value.variant = EXPRESSION_TYPE;
+        output.value.type = var.value.type;
+        return output;
+    }
+    parse_rollback(checkpoint);
+    output.status = TRY_NONE;
+    return output;
+}
+
+TryExpression_t parse_type_expression_token_span(const TokenSpan_t span) {
+    TryExpression_t output;
+    if (span.begin == span.end) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    WithParseMemo(MEMO_TYPE_EXPRESSION, expression, token_span_str(span, span.begin, span.end), output, parse_type_expression_token_span_uncached(span));
+}
+
+size_t print_expression(Sink_t *const sink, const Expression_t *const expr, const Operator_t *const parent_op) {
     if (!expr) {
         return 0;
     }
-    buffer[0] = 0;
     Variable_t var;
-    size_t num_chars = 0;
+    const size_t begin = sink->written;
     switch (expr->variant) {
         case EXPRESSION_OPERATOR:
             if (parent_op && operator_precedence(parent_op->variant) < operator_precedence(expr->operator->variant)) {
-                num_chars += sprintf(buffer, "(");
-                num_chars += print_operator(buffer + num_chars, expr->operator);
-                num_chars += sprintf(buffer + num_chars, ")");
-                return num_chars;
+                sink_puts(sink, "(");
+                print_operator(sink, expr->operator);
+                sink_puts(sink, ")");
+                return sink->written - begin;
             }
             else {
-                return print_operator(buffer, expr->operator);
+                return print_operator(sink, expr->operator);
             }
         case EXPRESSION_IDENTIFIER:
-            return sprintf(buffer, "%.*s",
-                (int)(expr->identifier.end - expr->identifier.begin), expr->identifier.begin);
+            sink_write(sink, expr->identifier->str.begin, expr->identifier->str.end - expr->identifier->str.begin);
+            break;
         case EXPRESSION_TYPE:
             var.type = expr->type;
             var.has_name = false;
-            return print_variable(buffer, &var);
+            var.params.size = 0;
+            return print_variable(sink, &var);
         case EXPRESSION_DECLARATION:
-            return print_variable(buffer, expr->decl);
+            return print_variable(sink, expr->decl);
         case EXPRESSION_STR_LIT:
-            return sprintf(buffer, "\"%.*s\"",
-                (int)(expr->str_lit.end - expr->str_lit.begin), expr->str_lit.begin);
+            sink_puts(sink, "\"");
+            sink_write(sink, expr->str_lit->str.begin, expr->str_lit->str.end - expr->str_lit->str.begin);
+            sink_puts(sink, "\"");
+            break;
         case EXPRESSION_CHAR_LIT:
-            return sprintf(buffer, "'%.*s'",
-                (int)(expr->char_lit.end - expr->char_lit.begin), expr->char_lit.begin);
-        case EXPRESSION_UINT_LIT:
-            return sprintf(buffer, "%lu", expr->uint_lit);
+            sink_puts(sink, "'");
+            sink_write(sink, expr->char_lit->str.begin, expr->char_lit->str.end - expr->char_lit->str.begin);
+            sink_puts(sink, "'");
+            break;
+        case EXPRESSION_UINT_LIT: {
+            static const char *const suffix_strs[] = { "", "u", "l", "ul", "ll", "ull" };
+            switch (expr->uint_lit_base) {
+                case INTEGER_OCTAL:
+                    sink_printf(sink, expr->uint_lit ? "0%lo" : "0", expr->uint_lit);
+                    break;
+                case INTEGER_HEX:
+                    sink_printf(sink, "0x%lx", expr->uint_lit);
+                    break;
+                default:
+                    sink_printf(sink, "%lu", expr->uint_lit);
+                    break;
+            }
+            sink_puts(sink, suffix_strs[expr->uint_lit_suffix]);
+            break;
+        }
         case EXPRESSION_VOID:
-            return sprintf(buffer, "void");
+            sink_puts(sink, "void");
+            break;
     }
-}
\ No newline at end of file
+    return sink->written - begin;
+}
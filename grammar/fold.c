@@ -0,0 +1,504 @@
+#include "grammar.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const FoldEnv_t *env;
+    bool replace; // Or only evaluate
+    bool uses_env;
+} Folder_t;
+
+static bool fold(Folder_t *const folder, const Expression_t *const expr, IntegerConstant_t *const value, const Expression_t **const folded);
+
+IntegerConstant_t new_integer_constant(const uint64_t bits, const uint8_t size, const bool is_signed) {
+    IntegerConstant_t output;
+    output.size = size;
+    output.is_signed = is_signed;
+    if (size >= 8) {
+        output.bits = bits;
+    }
+    else if (is_signed) {
+        const uint64_t sign = 1ull << (8 * size - 1);
+        const uint64_t low = bits & ((sign << 1) - 1);
+        output.bits = (low ^ sign) - sign;
+    }
+    else {
+        output.bits = bits & ((1ull << (8 * size)) - 1);
+    }
+    return output;
+}
+
+static IntegerConstant_t int_constant(const int64_t value) {
+    return new_integer_constant((uint64_t)value, 4, true);
+}
+
+static bool is_negative(const IntegerConstant_t value) {
+    return value.is_signed && (int64_t)value.bits < 0;
+}
+
+bool integer_primitive(const PrimitiveVariant_t primitive, uint8_t *const size, bool *const is_signed) {
+    switch (primitive) {
+        case PRIMITIVE_CHAR: *size = 1; *is_signed = true; return true;
+        case PRIMITIVE_UNSIGNED_CHAR: *size = 1; *is_signed = false; return true;
+        case PRIMITIVE_SHORT: *size = 2; *is_signed = true; return true;
+        case PRIMITIVE_UNSIGNED_SHORT: *size = 2; *is_signed = false; return true;
+        case PRIMITIVE_INT: *size = 4; *is_signed = true; return true;
+        case PRIMITIVE_UNSIGNED_INT: *size = 4; *is_signed = false; return true;
+        case PRIMITIVE_LONG:
+        case PRIMITIVE_LONG_LONG: *size = 8; *is_signed = true; return true;
+        case PRIMITIVE_UNSIGNED_LONG:
+        case PRIMITIVE_UNSIGNED_LONG_LONG: *size = 8; *is_signed = false; return true;
+        default: return false;
+    }
+}
+
+PrimitiveVariant_t integer_constant_primitive(const IntegerConstant_t value) {
+    switch (value.size) {
+        case 1: return value.is_signed ? PRIMITIVE_CHAR : PRIMITIVE_UNSIGNED_CHAR;
+        case 2: return value.is_signed ? PRIMITIVE_SHORT : PRIMITIVE_UNSIGNED_SHORT;
+        case 4: return value.is_signed ? PRIMITIVE_INT : PRIMITIVE_UNSIGNED_INT;
+        default: return value.is_signed ? PRIMITIVE_LONG : PRIMITIVE_UNSIGNED_LONG;
+    }
+}
+
+/**
+ * An integer literal in the type its value, base and suffix give it; false
+ * if no type holds it
+ */
+static bool literal_constant(const uint64_t value, const IntegerBase_t base, const IntegerSuffix_t suffix, IntegerConstant_t *const constant) {
+    PrimitiveVariant_t primitive;
+    uint8_t size;
+    bool is_signed;
+    if (!integer_literal_type(value, base, suffix, &primitive) || !integer_primitive(primitive, &size, &is_signed)) {
+        return false;
+    }
+    *constant = new_integer_constant(value, size, is_signed);
+    return true;
+}
+
+IntegerConstant_t promote_integer(const IntegerConstant_t value) {
+    return value.size < 4 ? new_integer_constant(value.bits, 4, true) : value;
+}
+
+/**
+ * An unsigned type wins unless the signed one is wider, since a long holds
+ * every unsigned int
+ */
+void convert_integers(IntegerConstant_t *const left, IntegerConstant_t *const right) {
+    *left = promote_integer(*left);
+    *right = promote_integer(*right);
+    uint8_t size = left->size > right->size ? left->size : right->size;
+    bool is_signed = left->is_signed && right->is_signed;
+    if (left->is_signed != right->is_signed) {
+        const IntegerConstant_t *unsigned_operand = left->is_signed ? right : left;
+        is_signed = unsigned_operand->size < size;
+    }
+    *left = new_integer_constant(left->bits, size, is_signed);
+    *right = new_integer_constant(right->bits, size, is_signed);
+}
+
+/**
+ * The result of a signed operation done in 64 bits, if the type holds it
+ */
+static bool signed_result(const int64_t result, const uint8_t size, IntegerConstant_t *const value) {
+    *value = new_integer_constant((uint64_t)result, size, true);
+    return (int64_t)value->bits == result;
+}
+
+static bool fold_unary(const OperatorVariant_t variant, IntegerConstant_t operand, IntegerConstant_t *const value) {
+    operand = promote_integer(operand);
+    switch (variant) {
+        case OP_POS:
+            *value = operand;
+            return true;
+        case OP_NEG:
+            if (operand.is_signed) {
+                return (int64_t)operand.bits != INT64_MIN && signed_result(-(int64_t)operand.bits, operand.size, value);
+            }
+            *value = new_integer_constant(-operand.bits, operand.size, false);
+            return true;
+        case OP_BITWISE_NOT:
+            *value = new_integer_constant(~operand.bits, operand.size, operand.is_signed);
+            return true;
+        case OP_LOGICAL_NOT:
+            *value = int_constant(!operand.bits);
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool fold_shift(const OperatorVariant_t variant, IntegerConstant_t left, IntegerConstant_t right, IntegerConstant_t *const value) {
+    left = promote_integer(left);
+    right = promote_integer(right);
+    const uint64_t width = 8 * left.size;
+    if (is_negative(right) || right.bits >= width) {
+        return false;
+    }
+    if (variant == OP_SR) {
+        const uint64_t bits = left.is_signed ? (uint64_t)((int64_t)left.bits >> right.bits) : left.bits >> right.bits;
+        *value = new_integer_constant(bits, left.size, left.is_signed);
+        return true;
+    }
+    if (!left.is_signed) {
+        *value = new_integer_constant(left.bits << right.bits, left.size, false);
+        return true;
+    }
+    // Shifting a negative value, or a bit into the sign, is undefined
+    return !is_negative(left) && !(left.bits >> (width - 1 - right.bits)) &&
+        signed_result((int64_t)(left.bits << right.bits), left.size, value);
+}
+
+static bool fold_arithmetic(const OperatorVariant_t variant, IntegerConstant_t left, IntegerConstant_t right, IntegerConstant_t *const value) {
+    convert_integers(&left, &right);
+    const uint8_t size = left.size;
+    if (!left.is_signed) {
+        const uint64_t l = left.bits;
+        const uint64_t r = right.bits;
+        switch (variant) {
+            case OP_ADD: *value = new_integer_constant(l + r, size, false); return true;
+            case OP_SUB: *value = new_integer_constant(l - r, size, false); return true;
+            case OP_MUL: *value = new_integer_constant(l * r, size, false); return true;
+            case OP_DIV: *value = new_integer_constant(r ? l / r : 0, size, false); return r;
+            case OP_MOD: *value = new_integer_constant(r ? l % r : 0, size, false); return r;
+            case OP_BITWISE_AND: *value = new_integer_constant(l & r, size, false); return true;
+            case OP_BITWISE_OR: *value = new_integer_constant(l | r, size, false); return true;
+            case OP_BITWISE_XOR: *value = new_integer_constant(l ^ r, size, false); return true;
+            case OP_EQ: *value = int_constant(l == r); return true;
+            case OP_NE: *value = int_constant(l != r); return true;
+            case OP_GT: *value = int_constant(l > r); return true;
+            case OP_LT: *value = int_constant(l < r); return true;
+            case OP_GE: *value = int_constant(l >= r); return true;
+            case OP_LE: *value = int_constant(l <= r); return true;
+            default: return false;
+        }
+    }
+    const int64_t l = (int64_t)left.bits;
+    const int64_t r = (int64_t)right.bits;
+    int64_t result;
+    switch (variant) {
+        case OP_ADD: return !__builtin_add_overflow(l, r, &result) && signed_result(result, size, value);
+        case OP_SUB: return !__builtin_sub_overflow(l, r, &result) && signed_result(result, size, value);
+        case OP_MUL: return !__builtin_mul_overflow(l, r, &result) && signed_result(result, size, value);
+        case OP_DIV: return r && !(l == INT64_MIN && r == -1) && signed_result(l / r, size, value);
+        case OP_MOD: return r && !(l == INT64_MIN && r == -1) && signed_result(l % r, size, value);
+        case OP_BITWISE_AND: return signed_result(l & r, size, value);
+        case OP_BITWISE_OR: return signed_result(l | r, size, value);
+        case OP_BITWISE_XOR: return signed_result(l ^ r, size, value);
+        case OP_EQ: *value = int_constant(l == r); return true;
+        case OP_NE: *value = int_constant(l != r); return true;
+        case OP_GT: *value = int_constant(l > r); return true;
+        case OP_LT: *value = int_constant(l < r); return true;
+        case OP_GE: *value = int_constant(l >= r); return true;
+        case OP_LE: *value = int_constant(l <= r); return true;
+        default: return false;
+    }
+}
+
+bool evaluate_integer_operation(const OperatorVariant_t op, const IntegerConstant_t in1, const IntegerConstant_t in2, IntegerConstant_t *const value) {
+    switch (op) {
+        case OP_POS:
+        case OP_NEG:
+        case OP_BITWISE_NOT:
+        case OP_LOGICAL_NOT:
+            return fold_unary(op, in1, value);
+        case OP_SL:
+        case OP_SR:
+            return fold_shift(op, in1, in2, value);
+        default:
+            return fold_arithmetic(op, in1, in2, value);
+    }
+}
+
+uint64_t char_literal_value(const AConstString_t str) {
+    if (str.end - str.begin < 2 || str.begin[0] != '\\') {
+        return str.begin < str.end ? (uint8_t)str.begin[0] : 0;
+    }
+    switch (str.begin[1]) {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        case 'v': return '\v';
+        case 'f': return '\f';
+        case 'b': return '\b';
+        case 'a': return '\a';
+        case 'x': return strtoull(str.begin + 2, NULL, 16) & 0xff;
+        default:
+            if ('0' <= str.begin[1] && str.begin[1] <= '7') {
+                return strtoull(str.begin + 1, NULL, 8) & 0xff;
+            }
+            return (uint8_t)str.begin[1];
+    }
+}
+
+/**
+ * The integer type a cast converts to; only typedef names need `env`
+ */
+static bool cast_type(Folder_t *const folder, const DerivedType_t *const type, uint8_t *const size, bool *const is_signed) {
+    if (type->variant != DERIVED_TYPE_TERMINAL) {
+        return false;
+    }
+    switch (type->terminal.type.variant) {
+        case TYPE_PRIMITIVE:
+            return integer_primitive(type->terminal.type.primitive, size, is_signed);
+        case TYPE_ENUM:
+            *size = 4;
+            *is_signed = true;
+            return true;
+        case TYPE_NAMED:
+            folder->uses_env = true;
+            return folder->env && folder->env->integer_type && folder->env->integer_type(folder->env->data, type, size, is_signed);
+        default:
+            return false;
+    }
+}
+
+static bool fold_sizeof(Folder_t *const folder, const Expression_t *const operand, IntegerConstant_t *const value) {
+    if (!folder->env || !folder->env->size_of) {
+        return false;
+    }
+    folder->uses_env = true;
+    uint64_t size;
+    if (!folder->env->size_of(folder->env->data, operand, &size)) {
+        return false;
+    }
+    *value = new_integer_constant(size, 8, false);
+    return true;
+}
+
+static Expression_t *new_operator_expression(const Operator_t *const op) {
+    Expression_t *expr = new_expression();
+    memset(expr, 0, sizeof(Expression_t));
+    expr->variant = EXPRESSION_OPERATOR;
+    expr->operator = new_operator();
+    *expr->operator = *op;
+    return expr;
+}
+
+/**
+ * The literal form of a promoted constant: a decimal literal of the value's
+ * magnitude, suffixed for the value's type, which negation keeps. Only the
+ * magnitude of a negative value can be too large for the type, and then the
+ * literal is an unsigned long
+ */
+static Expression_t *new_literal(const IntegerConstant_t value, IntegerConstant_t *const literal_type) {
+    const bool negative = is_negative(value);
+    const uint64_t magnitude = negative ? -value.bits : value.bits;
+    Expression_t *literal = new_expression();
+    memset(literal, 0, sizeof(Expression_t));
+    literal->variant = EXPRESSION_UINT_LIT;
+    literal->uint_lit = magnitude;
+    literal->uint_lit_base = INTEGER_DECIMAL;
+    literal->uint_lit_suffix = value.size < 8 ?
+        (value.is_signed ? INTEGER_SUFFIX_NONE : INTEGER_SUFFIX_U) :
+        (value.is_signed ? INTEGER_SUFFIX_L : INTEGER_SUFFIX_UL);
+    if (!literal_constant(magnitude, INTEGER_DECIMAL, literal->uint_lit_suffix, literal_type)) {
+        literal->uint_lit_suffix = INTEGER_SUFFIX_UL;
+        literal_constant(magnitude, INTEGER_DECIMAL, INTEGER_SUFFIX_UL, literal_type);
+    }
+    if (!negative) {
+        return literal;
+    }
+    Operator_t negation;
+    memset(&negation, 0, sizeof(Operator_t));
+    negation.variant = OP_NEG;
+    negation.n_operands = 1;
+    negation.uop = literal;
+    return new_operator_expression(&negation);
+}
+
+/**
+ * A literal, or a negated one, has its value and type already
+ */
+static bool is_literal_form(const Expression_t *const expr) {
+    if (expr->variant == EXPRESSION_UINT_LIT || expr->variant == EXPRESSION_CHAR_LIT) {
+        return true;
+    }
+    return expr->variant == EXPRESSION_OPERATOR && expr->operator->variant == OP_NEG &&
+        expr->operator->uop->variant == EXPRESSION_UINT_LIT;
+}
+
+/**
+ * The expression that stands for a constant in place of `expr`
+ */
+static const Expression_t *constant_expression(const Expression_t *const expr, IntegerConstant_t value) {
+    if (is_literal_form(expr)) {
+        return expr;
+    }
+    // A char or short value is used as an int
+    value = promote_integer(value);
+    IntegerConstant_t literal_type;
+    Expression_t *literal = new_literal(value, &literal_type);
+    if (literal_type.size == value.size && literal_type.is_signed == value.is_signed) {
+        return literal;
+    }
+    DerivedType_t der;
+    memset(&der, 0, sizeof(DerivedType_t));
+    der.variant = DERIVED_TYPE_TERMINAL;
+    der.terminal.qualifier = QUALIFIER_NONE;
+    der.terminal.type.variant = TYPE_PRIMITIVE;
+    der.terminal.type.primitive = integer_constant_primitive(value);
+    Expression_t *type = new_expression();
+    memset(type, 0, sizeof(Expression_t));
+    type->variant = EXPRESSION_TYPE;
+    type->type = canonical_derived_type(&der);
+    Operator_t cast;
+    memset(&cast, 0, sizeof(Operator_t));
+    cast.variant = OP_CAST;
+    cast.n_operands = 2;
+    cast.lop = type;
+    cast.rop = literal;
+    return new_operator_expression(&cast);
+}
+
+/**
+ * The value of an operator whose operands have been folded, `is_constant`
+ * telling which of them are constant
+ */
+static bool evaluate_operator(Folder_t *const folder, const Operator_t *const op, const IntegerConstant_t *const operands, const bool *const is_constant, IntegerConstant_t *const value) {
+    uint8_t size;
+    bool is_signed;
+    switch (op->variant) {
+        case OP_POS:
+        case OP_NEG:
+        case OP_BITWISE_NOT:
+        case OP_LOGICAL_NOT:
+            return is_constant[0] && evaluate_integer_operation(op->variant, operands[0], operands[0], value);
+        case OP_SL:
+        case OP_SR:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_BITWISE_AND:
+        case OP_BITWISE_OR:
+        case OP_BITWISE_XOR:
+        case OP_EQ:
+        case OP_NE:
+        case OP_GT:
+        case OP_LT:
+        case OP_GE:
+        case OP_LE:
+            return is_constant[0] && is_constant[1] && evaluate_integer_operation(op->variant, operands[0], operands[1], value);
+        case OP_LOGICAL_AND:
+        case OP_LOGICAL_OR: {
+            // Constant when the left operand decides it, however the right one goes
+            if (!is_constant[0]) {
+                return false;
+            }
+            const bool decides = op->variant == OP_LOGICAL_AND ? !operands[0].bits : !!operands[0].bits;
+            if (!decides && !is_constant[1]) {
+                return false;
+            }
+            *value = int_constant(decides ? !!operands[0].bits : !!operands[1].bits);
+            return true;
+        }
+        case OP_COND: {
+            if (!is_constant[0] || !is_constant[1] || !is_constant[2]) {
+                return false;
+            }
+            // The result has the common type of both branches
+            IntegerConstant_t if_true = operands[1];
+            IntegerConstant_t if_false = operands[2];
+            convert_integers(&if_true, &if_false);
+            *value = operands[0].bits ? if_true : if_false;
+            return true;
+        }
+        case OP_CAST:
+            if (!cast_type(folder, op->lop->type, &size, &is_signed) || !is_constant[1]) {
+                return false;
+            }
+            *value = new_integer_constant(operands[1].bits, size, is_signed);
+            return true;
+        case OP_SIZEOF:
+            return fold_sizeof(folder, op->uop, value);
+        default:
+            return false;
+    }
+}
+
+/**
+ * Constant operands are replaced only when their operator is not constant,
+ * so the largest constant subexpressions are the ones replaced. An operator
+ * with any operand replaced is copied, and the copy gets the new operands
+ */
+static bool fold_operator(Folder_t *const folder, const Expression_t *const expr, IntegerConstant_t *const value, const Expression_t **const folded) {
+    const Operator_t *op = expr->operator;
+    Expression_t *const operand_exprs[3] = { op->pop, op->top, op->fop };
+    const Expression_t *folded_operands[3] = { op->pop, op->top, op->fop };
+    IntegerConstant_t operands[3];
+    bool is_constant[3] = { false, false, false };
+    for (uint8_t i = 0; i < op->n_operands; ++i) {
+        is_constant[i] = operand_exprs[i] && fold(folder, operand_exprs[i], &operands[i], &folded_operands[i]);
+    }
+    if (evaluate_operator(folder, op, operands, is_constant, value)) {
+        return true;
+    }
+    *folded = expr;
+    if (!folder->replace) {
+        return false;
+    }
+    bool changed = false;
+    for (uint8_t i = 0; i < op->n_operands; ++i) {
+        if (is_constant[i]) {
+            folded_operands[i] = constant_expression(operand_exprs[i], operands[i]);
+        }
+        changed = changed || folded_operands[i] != operand_exprs[i];
+    }
+    if (changed) {
+        Expression_t *copy = new_operator_expression(op);
+        Expression_t **const copy_operands[3] = { &copy->operator->pop, &copy->operator->top, &copy->operator->fop };
+        for (uint8_t i = 0; i < op->n_operands; ++i) {
+            // Only nodes of the copy are ever written
+            *copy_operands[i] = (Expression_t *)folded_operands[i];
+        }
+        *folded = copy;
+    }
+    return false;
+}
+
+/**
+ * Fold the constant parts of an expression; when all of it is constant it is
+ * left for the caller to replace, and otherwise `folded` is the expression
+ * with its constant parts replaced
+ */
+static bool fold(Folder_t *const folder, const Expression_t *const expr, IntegerConstant_t *const value, const Expression_t **const folded) {
+    *folded = expr;
+    switch (expr->variant) {
+        case EXPRESSION_UINT_LIT:
+            return literal_constant(expr->uint_lit, expr->uint_lit_base, expr->uint_lit_suffix, value);
+        case EXPRESSION_CHAR_LIT:
+            // char is signed, and a character constant is an int
+            *value = promote_integer(new_integer_constant(char_literal_value(expr->char_lit->str), 1, true));
+            return true;
+        case EXPRESSION_OPERATOR:
+            return fold_operator(folder, expr, value, folded);
+        default:
+            return false;
+    }
+}
+
+bool evaluate_constant(const Expression_t *const expr, const FoldEnv_t *const env, IntegerConstant_t *const value, bool *const uses_env) {
+    Folder_t folder = { env, false, false };
+    const Expression_t *folded;
+    const bool is_constant = fold(&folder, expr, value, &folded);
+    if (uses_env && folder.uses_env) {
+        *uses_env = true;
+    }
+    return is_constant;
+}
+
+const Expression_t *fold_constant_expression(const Expression_t *const expr, const FoldEnv_t *const env) {
+    if (!expr) {
+        return NULL;
+    }
+    Folder_t folder = { env, true, false };
+    IntegerConstant_t value;
+    const Expression_t *folded;
+    if (fold(&folder, expr, &value, &folded)) {
+        folded = constant_expression(expr, value);
+    }
+    return folded;
+}
@@ -1,6 +1,7 @@
 #ifndef _GRAMMAR_GRAMMAR_H_
 #define _GRAMMAR_GRAMMAR_H_
 
+#include "lexer.h"
 #include "util.h"
 
 #include <stddef.h>
@@ -20,22 +21,198 @@ TryVariable_t parse_typedef(const ConstString_t str);
 TryOperator_t parse_operator(const ConstString_t str);
 
 /**
- * Parse a scope into a linked list of statements; the first and last
- * characters must be braces
+ * Parse a scope into a contiguous span of statements. The text is lexed once,
+ * statements are split on the tokens at each ';' or '}' found through the
+ * matched brackets, and every statement is parsed from its tokens
  *  SUCCESS: a scope was parsed
- *  ERROR: there was a syntactic problem with the scope itself (i.e. contained
- *         scopes/controls have syntactic problem, expressions not terminated
- *         in semicolons)
+ *  ERROR: there was a syntactic problem with the scope itself (i.e. the text
+ *         does not lex, brackets do not balance, contained scopes/controls
+ *         have syntactic problem, expressions not terminated in semicolons)
  */
 TryScope_t parse_scope(const ConstString_t str, ErrorLinkedListNode_t ***const errors);
 
-size_t print_type(char *buffer, const Type_t *const type);
-size_t print_variable(char *buffer, const Variable_t *const var);
-size_t print_expression(char *buffer, const Expression_t *const expr, const Operator_t *const parent_op);
-size_t print_operator(char *buffer, const Operator_t *const op);
-size_t print_scope(char *buffer, const Scope_t *scope, const int32_t depth);
-size_t print_statement(char *buffer, const Statement_t *stmt, const int32_t depth);
+/**
+ * Map a file read-only into the context and parse it as a scope; the AST
+ * references the mapped text instead of copying it, so it is valid until the
+ * context is freed
+ *  SUCCESS: the file was parsed
+ *  ERROR: the file could not be read, or `parse_scope` failed
+ */
+TryScope_t parse_file(const char *const path, ParseContext_t *const context, ErrorLinkedListNode_t ***const errors);
+
+/**
+ * Write a scope to a binary file: the nodes reachable from the scope are laid
+ * out in sections, and each pointer is stored in place as a 32-bit offset into
+ * the section it points to, so there is no relocation table. Symbols are
+ * indices into a table of their spellings. Source locations inside `source`
+ * are kept as offsets into it; the source itself is only copied into the file
+ * when `copy_source` is set, and is otherwise recognized by its length and
+ * hash. The format is native-endian and tied to this build's struct layout.
+ *  SUCCESS: the number of bytes written
+ *  ERROR: the file could not be written, or is too large for 32-bit offsets
+ */
+TrySize_t save_scope(const char *const path, const Scope_t *const scope, const ConstString_t source, const bool copy_source);
+
+/**
+ * Map a file written by `save_scope` into the context, re-intern its symbols
+ * and derived types, the latter through `canonical_derived_type`, and turn
+ * its offsets into pointers in place while walking the tree once;
+ * the scope lives until the context is freed. Locations refer to the copy of
+ * the source if the file has one, and are empty otherwise
+ *  SUCCESS: the scope was loaded
+ *  ERROR: the file could not be read or is not a valid AST file
+ */
+TryScope_t load_scope(const char *const path, ParseContext_t *const context);
+
+/**
+ * Store or load a whole `parse_scope` result, including an ERROR or NONE
+ * status and the errors it appended. `load_parse_result` returns NULL on
+ * success or why the file could not be used; when `source` is given it must
+ * have the stored length and hash, and match the copy if there is one, and
+ * all locations refer to it
+ */
+TrySize_t save_parse_result(const char *const path, const TryScope_t *const result, const ErrorLinkedListNode_t *const errors, const ConstString_t source, const bool copy_source);
+const char *load_parse_result(const char *const path, ParseContext_t *const context, const ConstString_t source, TryScope_t *const result, ErrorLinkedListNode_t ***const errors);
+
+/**
+ * On-disk cache of parse results, one AST file per distinct input named by a
+ * hash of its bytes and the parser version. Files are written under a
+ * temporary name and renamed into place, so several processes can share a
+ * directory. The size of the directory is counted once when the cache is
+ * opened and then kept up to date by each store; once it passes `max_bytes`,
+ * the directory is listed again and the least recently used files are removed
+ * until it fits
+ */
+typedef struct {
+    char *dir;
+    uint64_t max_bytes;
+    uint64_t total_bytes; // Includes files stored by other processes as of the last listing
+
+    uint64_t hits;
+    uint64_t misses;
+} ParseCache_t;
+
+ParseCache_t new_parse_cache(const char *const dir, const uint64_t max_bytes);
+void free_parse_cache(ParseCache_t *const cache);
+
+/**
+ * Same as `parse_scope` under `context`, including the errors appended, but
+ * a cache hit loads the stored result instead of parsing. The AST lives until
+ * the context is freed and its locations refer to `str`
+ */
+TryScope_t parse_scope_cached(ParseCache_t *const cache, const ConstString_t str, ParseContext_t *const context, ErrorLinkedListNode_t ***const errors);
+
+/**
+ * Token range entry points; the range must come from a token array produced
+ * by `lex`, and the result is the same as parsing the source text the range
+ * covers
+ */
+TryType_t parse_type_tokens(const TokenRange_t tokens);
+TryVariable_t parse_variable_tokens(const TokenRange_t tokens);
+TryOperator_t parse_operator_tokens(const TokenRange_t tokens);
+TryScope_t parse_scope_tokens(const TokenRange_t tokens, ErrorLinkedListNode_t ***const errors);
+
+/**
+ * The same over a span with matched brackets, so that productions nested in
+ * a span are parsed without matching its brackets again
+ */
+TryType_t parse_type_token_span(const TokenSpan_t span);
+TryVariable_t parse_variable_token_span(const TokenSpan_t span);
+TryExpression_t parse_right_expression_token_span(const TokenSpan_t span);
+TryExpression_t parse_type_expression_token_span(const TokenSpan_t span);
+TryOperator_t parse_operator_token_span(const TokenSpan_t span);
+TryScope_t parse_scope_token_span(const TokenSpan_t span, ErrorLinkedListNode_t ***const errors);
+
+size_t print_type(Sink_t *const sink, const Type_t *const type);
+size_t print_variable(Sink_t *const sink, const Variable_t *const var);
+size_t print_expression(Sink_t *const sink, const Expression_t *const expr, const Operator_t *const parent_op);
+size_t print_operator(Sink_t *const sink, const Operator_t *const op);
+size_t print_scope(Sink_t *const sink, const Scope_t *scope, const int32_t depth);
+size_t print_statement(Sink_t *const sink, const Statement_t *stmt, const int32_t depth);
+
+/**
+ * CONSTANT FOLDING
+ *
+ * Integer constant expressions are evaluated as C does on x86-64: literals
+ * and operands take the type the integer promotions and the usual arithmetic
+ * conversions give them, unsigned arithmetic wraps, and char is signed. An
+ * expression whose value is undefined, such as one dividing by zero or
+ * overflowing a signed type, is not constant. Operands of sizeof are not
+ * evaluated, so sizeof of a complete type is constant whatever its operand.
+ */
+
+/**
+ * An integer value of a type of `size` bytes, with its bits sign- or
+ * zero-extended to 64
+ */
+typedef struct IntegerConstant {
+    uint64_t bits;
+    uint8_t size;
+    bool is_signed;
+} IntegerConstant_t;
+
+/**
+ * The value of `bits` converted to the type, as a cast would
+ */
+IntegerConstant_t new_integer_constant(const uint64_t bits, const uint8_t size, const bool is_signed);
+
+/**
+ * Size and signedness of an integer primitive
+ *  false: the primitive is not an integer
+ */
+bool integer_primitive(const PrimitiveVariant_t primitive, uint8_t *const size, bool *const is_signed);
+PrimitiveVariant_t integer_constant_primitive(const IntegerConstant_t value);
+
+/**
+ * The integer promotions, and the usual arithmetic conversions that bring
+ * both operands of a binary operator to their common type
+ */
+IntegerConstant_t promote_integer(const IntegerConstant_t value);
+void convert_integers(IntegerConstant_t *const left, IntegerConstant_t *const right);
+
+/**
+ * An arithmetic, bitwise, shift, comparison or unary operator applied to
+ * constants, `in2` being ignored by unary ones
+ *  false: the operator is not one of those, or the result is undefined
+ */
+bool evaluate_integer_operation(const OperatorVariant_t op, const IntegerConstant_t in1, const IntegerConstant_t in2, IntegerConstant_t *const value);
+
+/**
+ * The value of the characters between the quotes of a character literal
+ */
+uint64_t char_literal_value(const AConstString_t str);
+
+/**
+ * What folding needs to know beyond the expression: the integer type a
+ * typedef name stands for and the size of an operand of sizeof. Without it,
+ * casts to typedef names and sizeof are not constant
+ */
+typedef struct FoldEnv {
+    void *data;
+    bool (*integer_type)(void *data, const DerivedType_t *type, uint8_t *size, bool *is_signed);
+    bool (*size_of)(void *data, const Expression_t *operand, uint64_t *size);
+} FoldEnv_t;
+
+/**
+ * The value of an integer constant expression, without changing it
+ *  true: the expression is constant; `uses_env`, if given, is set when the
+ *        value relied on `env`, which may be NULL
+ */
+bool evaluate_constant(const Expression_t *const expr, const FoldEnv_t *const env, IntegerConstant_t *const value, bool *const uses_env);
+
+/**
+ * The expression with its largest constant subexpressions replaced by
+ * literals of the same value and type: a literal, the negation of one, or
+ * either cast to the type when a literal of that value would have another
+ * type. Nothing else changes, so comma operators, including those separating
+ * arguments, are kept, and so is sizeof without `env`. The expression
+ * itself is never changed: operators on the way to a replaced subexpression
+ * are copied with `parse_alloc`, and unchanged subexpressions are shared, so
+ * an expression without constants is returned as is
+ */
+const Expression_t *fold_constant_expression(const Expression_t *const expr, const FoldEnv_t *const env);
 
 uint32_t operator_precedence(const OperatorVariant_t variant);
+const char *operator_token(const OperatorVariant_t variant);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const SourceIndex_t *attached_index = NULL;
+
+static char closing_bracket(const char c) {
+    switch (c) {
+        case '(': return ')';
+        case '[': return ']';
+        case '{': return '}';
+        default: return 0;
+    }
+}
+
+static void fill_depth(uint32_t *const depth, const size_t begin, const size_t end, const size_t value) {
+    for (size_t i = begin; i < end; ++i) {
+        depth[i] = value;
+    }
+}
+
+SourceIndex_t build_source_index(const ConstString_t str) {
+    SourceIndex_t output;
+    const size_t len = str.end - str.begin;
+    output.source = str;
+    output.bitmaps = scan_structure(str);
+    output.match = malloc((len + 1) * sizeof(uint32_t));
+    output.depth = malloc((len + 1) * sizeof(uint32_t));
+    output.valid = true;
+    output.memo = is_parse_memo_enabled() ? new_parse_memo() : NULL;
+    memset(output.match, 0xff, (len + 1) * sizeof(uint32_t));
+
+    // Only brackets and quotes change the nesting, so jump between them using
+    // the structural bitmaps and fill the depth of the runs in between
+    const uint32_t structural = SCAN_CLASS(SCAN_OPEN_BRACKET) | SCAN_CLASS(SCAN_CLOSE_BRACKET) | SCAN_CLASS(SCAN_QUOTE);
+    const uint32_t literal = SCAN_CLASS(SCAN_QUOTE) | SCAN_CLASS(SCAN_ESCAPE);
+    uint32_t *stack = malloc((len + 1) * sizeof(uint32_t));
+    size_t stack_size = 0;
+    size_t i = 0;
+    while (i < len) {
+        const size_t next = scan_next(&output.bitmaps, structural, str.begin + i, str.end) - str.begin;
+        fill_depth(output.depth, i, next, stack_size);
+        i = next;
+        if (i == len) {
+            break;
+        }
+        const char c = str.begin[i];
+        output.depth[i] = stack_size;
+        if (c == '"' || c == '\'') {
+            size_t j = i + 1;
+            while (1) {
+                j = scan_next(&output.bitmaps, literal, str.begin + j, str.end) - str.begin;
+                if (j >= len || str.begin[j] == c) {
+                    break;
+                }
+                j += str.begin[j] == '\\' ? 2 : 1;
+            }
+            if (j >= len) {
+                output.valid = false;
+                break;
+            }
+            fill_depth(output.depth, i + 1, j, stack_size + 1);
+            for (size_t k = i + 1; k < j; ++k) {
+                output.match[k] = SOURCE_INDEX_LITERAL;
+            }
+            output.depth[j] = stack_size;
+            output.match[i] = j;
+            output.match[j] = i;
+            i = j + 1;
+            continue;
+        }
+        else if (closing_bracket(c)) {
+            stack[stack_size++] = i;
+        }
+        else {
+            if (!stack_size || closing_bracket(str.begin[stack[stack_size - 1]]) != c) {
+                output.valid = false;
+                break;
+            }
+            const uint32_t opening = stack[--stack_size];
+            output.depth[i] = stack_size;
+            output.match[i] = opening;
+            output.match[opening] = i;
+        }
+        ++i;
+    }
+    if (stack_size) {
+        output.valid = false;
+    }
+    free(stack);
+    return output;
+}
+
+void free_source_index(SourceIndex_t *const index) {
+    free(index->match);
+    free(index->depth);
+    free_structural_bitmaps(&index->bitmaps);
+    free_parse_memo(index->memo);
+    index->match = NULL;
+    index->depth = NULL;
+    index->memo = NULL;
+    index->valid = false;
+}
+
+const SourceIndex_t *attach_source_index(const SourceIndex_t *const index) {
+    const SourceIndex_t *prev = attached_index;
+    attached_index = index;
+    return prev;
+}
+
+const SourceIndex_t *get_attached_source_index() {
+    return attached_index;
+}
+
+const SourceIndex_t *find_source_index(const ConstString_t str) {
+    if (    attached_index &&
+            attached_index->source.begin <= str.begin &&
+            str.end <= attached_index->source.end) {
+        return attached_index;
+    }
+    return NULL;
+}
+
+uint32_t source_index_depth(const SourceIndex_t *const index, const char *const pos) {
+    return index->depth[pos - index->source.begin];
+}
@@ -0,0 +1,190 @@
+#include "lexer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Punctuators ordered so that longer spellings are tried first (maximal
+ * munch); the grammar has no increment/decrement, so "--" lexes as two "-"
+ */
+const static char *punctuators[] = {
+    "<<=", ">>=",
+    "->", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+    "+=", "-=", "*=", "/=", "%=", "&=", "^=", "|=",
+    "(", ")", "[", "]", "{", "}", ";", ",", ".", "?", ":",
+    "=", "+", "-", "*", "/", "%", "<", ">", "!", "~", "&", "|", "^",
+    NULL
+};
+
+static bool is_identifier_start(const char c) {
+    return c == '_' || ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z');
+}
+
+static bool is_identifier_char(const char c) {
+    return is_identifier_start(c) || ('0' <= c && c <= '9');
+}
+
+static Token_t *append_token(TokenArray_t *const tokens, const TokenVariant_t variant, const char *const begin, const char *const end) {
+    if (tokens->n_tokens == tokens->capacity) {
+        tokens->capacity = tokens->capacity ? 2 * tokens->capacity : 64;
+        tokens->tokens = realloc(tokens->tokens, tokens->capacity * sizeof(Token_t));
+    }
+    Token_t *token = &tokens->tokens[tokens->n_tokens++];
+    token->variant = variant;
+    token->offset = begin - tokens->source.begin;
+    token->length = end - begin;
+    token->str.begin = begin;
+    token->str.end = end;
+    token->keyword = KEYWORD_NONE;
+    token->symbol = NULL;
+    return token;
+}
+
+TryTokenArray_t lex(const ConstString_t str) {
+    TryTokenArray_t output;
+    output.value.source = str;
+    output.value.tokens = NULL;
+    output.value.n_tokens = 0;
+    output.value.capacity = 0;
+
+    const char *it = str.begin;
+    while (it < str.end) {
+        const char c = *it;
+        if (c == ' ' || c == '\t' || c == '\n') {
+            ++it;
+        }
+        else if (is_identifier_start(c)) {
+            const char *begin = it++;
+            while (it < str.end && is_identifier_char(*it)) {
+                ++it;
+            }
+            ConstString_t word;
+            word.begin = begin;
+            word.end = it;
+            const KeywordVariant_t keyword = find_keyword(word);
+            if (keyword != KEYWORD_NONE) {
+                append_token(&output.value, TOKEN_KEYWORD, begin, it)->keyword = keyword;
+            }
+            else {
+                append_token(&output.value, TOKEN_IDENTIFIER, begin, it)->symbol = intern(word);
+            }
+        }
+        else if ('0' <= c && c <= '9') {
+            // Numbers keep their suffix/radix characters (e.g. "0xda") as one token
+            const char *begin = it++;
+            while (it < str.end && is_identifier_char(*it)) {
+                ++it;
+            }
+            append_token(&output.value, TOKEN_INTEGER, begin, it);
+        }
+        else if (c == '"' || c == '\'') {
+            ConstString_t working;
+            working.begin = it;
+            working.end = str.end;
+            TryConstString_t lit = find_string_lit(working, c, '\\');
+            if (lit.status != TRY_SUCCESS) {
+                free_token_array(&output.value);
+                output.status = TRY_ERROR;
+                output.error.location = working;
+                output.error.desc = c == '"' ? "Unterminated string literal" : "Unterminated character literal";
+                return output;
+            }
+            append_token(&output.value, c == '"' ? TOKEN_STR_LIT : TOKEN_CHAR_LIT, lit.value.begin, lit.value.end);
+            it = lit.value.end;
+        }
+        else {
+            const char **punct = punctuators;
+            size_t len = 0;
+            while (*punct) {
+                len = strlen(*punct);
+                if (len <= (size_t)(str.end - it) && !strncmp(it, *punct, len)) {
+                    break;
+                }
+                ++punct;
+            }
+            if (!*punct) {
+                free_token_array(&output.value);
+                output.status = TRY_ERROR;
+                output.error.location.begin = it;
+                output.error.location.end = it + 1;
+                output.error.desc = "Unexpected character";
+                return output;
+            }
+            append_token(&output.value, TOKEN_PUNCTUATOR, it, it + len);
+            it += len;
+        }
+    }
+
+    output.status = TRY_SUCCESS;
+    return output;
+}
+
+void free_token_array(TokenArray_t *const tokens) {
+    free(tokens->tokens);
+    tokens->tokens = NULL;
+    tokens->n_tokens = 0;
+    tokens->capacity = 0;
+}
+
+TokenRange_t token_range_from_array(const TokenArray_t *const tokens) {
+    TokenRange_t output;
+    output.begin = tokens->tokens;
+    output.end = tokens->tokens + tokens->n_tokens;
+    return output;
+}
+
+ConstString_t token_range_str(const TokenRange_t range) {
+    ConstString_t output;
+    if (range.begin == range.end) {
+        output.begin = NULL;
+        output.end = NULL;
+        return output;
+    }
+    output.begin = range.begin->str.begin;
+    output.end = (range.end - 1)->str.end;
+    return output;
+}
+
+bool match_token_brackets(const TokenRange_t range, uint32_t *const match) {
+    const size_t n_tokens = range.end - range.begin;
+    uint32_t *stack = malloc(n_tokens * sizeof(uint32_t));
+    size_t stack_size = 0;
+    bool balanced = true;
+    for (size_t i = 0; i < n_tokens && balanced; ++i) {
+        match[i] = NO_TOKEN_MATCH;
+        const Token_t *token = &range.begin[i];
+        if (is_punctuator(token, "(") || is_punctuator(token, "[") || is_punctuator(token, "{")) {
+            stack[stack_size++] = i;
+        }
+        else if (is_punctuator(token, ")") || is_punctuator(token, "]") || is_punctuator(token, "}")) {
+            const char opening = *token->str.begin == ')' ? '(' : *token->str.begin == ']' ? '[' : '{';
+            if (!stack_size || *range.begin[stack[stack_size - 1]].str.begin != opening) {
+                balanced = false;
+                break;
+            }
+            const uint32_t j = stack[--stack_size];
+            match[i] = j;
+            match[j] = i;
+        }
+    }
+    free(stack);
+    return balanced && !stack_size;
+}
+
+ConstString_t token_span_str(const TokenSpan_t span, const size_t begin, const size_t end) {
+    ConstString_t output;
+    if (begin == end) {
+        output.begin = NULL;
+        output.end = NULL;
+        return output;
+    }
+    output.begin = span.tokens[begin].str.begin;
+    output.end = span.tokens[end - 1].str.end;
+    return output;
+}
+
+bool is_punctuator(const Token_t *const token, const char *const punct) {
+    return token->variant == TOKEN_PUNCTUATOR &&
+        token->length == strlen(punct) &&
+        !strncmp(token->str.begin, punct, token->length);
+}
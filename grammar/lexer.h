@@ -0,0 +1,94 @@
+#ifndef _GRAMMAR_LEXER_H_
+#define _GRAMMAR_LEXER_H_
+
+#include "util.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * TOKENS
+ */
+typedef enum {
+    TOKEN_IDENTIFIER,
+    TOKEN_KEYWORD,
+    TOKEN_INTEGER,
+    TOKEN_STR_LIT,
+    TOKEN_CHAR_LIT,
+    TOKEN_PUNCTUATOR
+} TokenVariant_t;
+typedef struct Token {
+    TokenVariant_t variant;
+    uint32_t offset; // Offset of the first character from the beginning of the source
+    uint32_t length;
+    ConstString_t str; // View of the token text in the source buffer
+    KeywordVariant_t keyword; // KEYWORD_NONE unless a TOKEN_KEYWORD
+    const Symbol_t *symbol; // Interned text of a TOKEN_IDENTIFIER, otherwise NULL
+} Token_t;
+
+/**
+ * A contiguous array of tokens covering one source buffer
+ */
+typedef struct TokenArray {
+    ConstString_t source;
+    Token_t *tokens;
+    size_t n_tokens;
+    size_t capacity;
+} TokenArray_t;
+typedef GrammarTryType(TokenArray_t) TryTokenArray_t;
+
+/**
+ * A half-open range of tokens within a token array
+ */
+typedef struct TokenRange {
+    const Token_t *begin;
+    const Token_t *end;
+} TokenRange_t;
+
+#define NO_TOKEN_MATCH ((uint32_t)-1)
+
+/**
+ * The tokens [begin, end) of an array whose brackets are paired up: `match`
+ * holds the index of the bracket matching each bracket token, and
+ * NO_TOKEN_MATCH for every other token
+ */
+typedef struct TokenSpan {
+    const Token_t *tokens;
+    const uint32_t *match;
+    size_t begin;
+    size_t end;
+} TokenSpan_t;
+
+/**
+ * Split a source buffer into tokens in a single pass
+ *  SUCCESS: the whole buffer was tokenized
+ *  ERROR: there was an unterminated literal or an unexpected character
+ */
+TryTokenArray_t lex(const ConstString_t str);
+void free_token_array(TokenArray_t *const tokens);
+
+TokenRange_t token_range_from_array(const TokenArray_t *const tokens);
+
+/**
+ * Get the source text covered by a token range, from the beginning of the
+ * first token to the end of the last token
+ */
+ConstString_t token_range_str(const TokenRange_t range);
+
+/**
+ * Fill `match` (one entry per token) for the tokens of a range
+ *  returns whether the brackets of the range balance
+ */
+bool match_token_brackets(const TokenRange_t range, uint32_t *const match);
+
+/**
+ * Get the source text covered by tokens [begin, end) of a span
+ */
+ConstString_t token_span_str(const TokenSpan_t span, const size_t begin, const size_t end);
+
+/**
+ * Check whether the token is a punctuator with the given spelling
+ */
+bool is_punctuator(const Token_t *const token, const char *const punct);
+
+#endif
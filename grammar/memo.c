@@ -0,0 +1,163 @@
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t begin; // Offsets into the indexed source
+    uint32_t end;
+    MemoProductionVariant_t production;
+    size_t allocated; // Parse context arena position when the result was stored
+    MemoResult_t result;
+} ParseMemoEntry_t;
+
+/**
+ * Entries are kept in the order they were stored, and the open-addressed
+ * slots refer to them by position. As for canonical types, growing reinserts
+ * in that order, so the newest entry can be removed by clearing its slot, and
+ * a rollback removes entries newest first.
+ */
+typedef struct ParseMemo {
+    uint32_t *slots; // Entry index + 1, or 0 for an empty slot
+    size_t capacity; // Always a power of 2
+    ParseMemoEntry_t *entries;
+    size_t size;
+    size_t entries_capacity;
+} ParseMemo_t;
+
+static bool memo_enabled = false;
+static ParseMemoStats_t memo_stats;
+
+const static char *memo_production_strs[] = {
+    "type",
+    "variable",
+    "left expression",
+    "right expression",
+    "type expression"
+};
+
+static size_t memo_hash(const uint32_t begin, const uint32_t end, const MemoProductionVariant_t production) {
+    uint64_t h = ((uint64_t)begin << 32 | end) * 0x9e3779b97f4a7c15ull;
+    h ^= (uint64_t)production * 0xc2b2ae3d27d4eb4full;
+    return h ^ (h >> 29);
+}
+
+static uint32_t *find_slot(const ParseMemo_t *const memo, uint32_t *const slots, const size_t capacity, const uint32_t begin, const uint32_t end, const MemoProductionVariant_t production) {
+    const size_t mask = capacity - 1;
+    size_t i = memo_hash(begin, end, production) & mask;
+    while (slots[i]) {
+        const ParseMemoEntry_t *entry = &memo->entries[slots[i] - 1];
+        if (entry->begin == begin && entry->end == end && entry->production == production) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return &slots[i];
+}
+
+static void grow_memo(ParseMemo_t *const memo) {
+    const size_t capacity = 2 * memo->capacity;
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    for (size_t i = 0; i < memo->size; ++i) {
+        const ParseMemoEntry_t *entry = &memo->entries[i];
+        *find_slot(memo, slots, capacity, entry->begin, entry->end, entry->production) = i + 1;
+    }
+    free(memo->slots);
+    memo->slots = slots;
+    memo->capacity = capacity;
+}
+
+struct ParseMemo *new_parse_memo() {
+    ParseMemo_t *memo = malloc(sizeof(ParseMemo_t));
+    memo->capacity = 64;
+    memo->slots = calloc(memo->capacity, sizeof(uint32_t));
+    memo->entries = NULL;
+    memo->size = 0;
+    memo->entries_capacity = 0;
+    return memo;
+}
+
+void free_parse_memo(struct ParseMemo *const memo) {
+    if (memo) {
+        free(memo->slots);
+        free(memo->entries);
+        free(memo);
+    }
+}
+
+void set_parse_memo_enabled(const bool enabled) {
+    memo_enabled = enabled;
+}
+
+bool is_parse_memo_enabled() {
+    return memo_enabled;
+}
+
+const MemoResult_t *lookup_parse_memo(const MemoProductionVariant_t production, const ConstString_t str) {
+    const SourceIndex_t *index = find_source_index(str);
+    if (!index || !index->memo) {
+        return NULL;
+    }
+    ParseMemo_t *memo = index->memo;
+    const uint32_t slot = *find_slot(memo, memo->slots, memo->capacity,
+        str.begin - index->source.begin, str.end - index->source.begin, production);
+    if (slot) {
+        ++memo_stats.hits[production];
+        return &memo->entries[slot - 1].result;
+    }
+    ++memo_stats.misses[production];
+    return NULL;
+}
+
+void store_parse_memo(const MemoProductionVariant_t production, const ConstString_t str, const MemoResult_t *const result) {
+    const SourceIndex_t *index = find_source_index(str);
+    if (!index || !index->memo) {
+        return;
+    }
+    ParseMemo_t *memo = index->memo;
+    if (2 * (memo->size + 1) > memo->capacity) {
+        grow_memo(memo);
+    }
+    const uint32_t begin = str.begin - index->source.begin;
+    const uint32_t end = str.end - index->source.begin;
+    uint32_t *slot = find_slot(memo, memo->slots, memo->capacity, begin, end, production);
+    if (*slot) {
+        // An equal result is already stored, and it is the older one
+        return;
+    }
+    if (memo->size == memo->entries_capacity) {
+        memo->entries_capacity = memo->entries_capacity ? 2 * memo->entries_capacity : 64;
+        memo->entries = realloc(memo->entries, memo->entries_capacity * sizeof(ParseMemoEntry_t));
+    }
+    ParseMemoEntry_t *entry = &memo->entries[memo->size];
+    entry->begin = begin;
+    entry->end = end;
+    entry->production = production;
+    entry->allocated = parse_checkpoint().arena.allocated;
+    entry->result = *result;
+    *slot = ++memo->size;
+}
+
+void invalidate_parse_memo(const size_t allocated) {
+    const SourceIndex_t *index = get_attached_source_index();
+    if (!index || !index->memo) {
+        return;
+    }
+    ParseMemo_t *memo = index->memo;
+    while (memo->size && memo->entries[memo->size - 1].allocated > allocated) {
+        const ParseMemoEntry_t *entry = &memo->entries[--memo->size];
+        *find_slot(memo, memo->slots, memo->capacity, entry->begin, entry->end, entry->production) = 0;
+    }
+}
+
+ParseMemoStats_t get_parse_memo_stats() {
+    return memo_stats;
+}
+
+void reset_parse_memo_stats() {
+    memset(&memo_stats, 0, sizeof(ParseMemoStats_t));
+}
+
+const char *memo_production_str(const MemoProductionVariant_t production) {
+    return memo_production_strs[production];
+}
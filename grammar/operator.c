@@ -5,8 +5,7 @@
 #include <stdio.h>
 #include <string.h>
 
-typedef TryOperator_t (*ParseOperatorFunc_t)(const ConstString_t str, const void *args);
-typedef size_t (*PrintOperatorFunc_t)(char *buffer, const Operator_t *const op, const void *args);
+typedef size_t (*PrintOperatorFunc_t)(Sink_t *const sink, const Operator_t *const op, const void *args);
 typedef enum {
     NO_EXPR,
     LEFT_EXPR,
@@ -14,353 +13,716 @@ typedef enum {
     TYPE_EXPR
 } ExpressionTypeVariant_t;
 
+/**
+ * Syntactic shape of an operator, used by the expression parser to decide
+ * how the operator token(s) and operands are laid out
+ */
+typedef enum {
+    FORM_BINARY,
+    FORM_PREFIX,
+    FORM_CAST,
+    FORM_SIZEOF,
+    FORM_COND,
+    FORM_POSTFIX_CLOSURE,
+    FORM_MEMBER
+} OperatorFormVariant_t;
+
 typedef struct {
     OperatorVariant_t variant;
     uint32_t n_operands;
     uint32_t precedence;
     void *parse_args;
     void *print_args;
-    ExpressionVariant_t op1_type;
-    ExpressionVariant_t op2_type;
-    ExpressionVariant_t op3_type;
-    ParseOperatorFunc_t parse_func;
+    ExpressionTypeVariant_t op1_type;
+    ExpressionTypeVariant_t op2_type;
+    ExpressionTypeVariant_t op3_type;
+    OperatorFormVariant_t form;
     PrintOperatorFunc_t print_func;
 } OperatorSpec_t;
 
-static TryOperator_t parse_unary_prefix_operator(const ConstString_t str, const void *args) {
-    TryOperator_t output;
+static bool is_right_associative(const OperatorSpec_t *const spec);
+
+static size_t print_unary_prefix_operator(Sink_t *const sink, const Operator_t *const op, const void *args) {
+    const size_t begin = sink->written;
     const OperatorSpec_t *spec = args;
-    TryConstString_t prefix = find_string(str, const_string_from_cstr((const char *)spec->parse_args));
-    if (prefix.status == TRY_SUCCESS) {
-        ConstString_t unary_str;
-        unary_str.begin = prefix.value.end;
-        unary_str.end = str.end;
-        TryExpression_t unary_expr = parse_right_expression(unary_str);
-        GrammarPropagateError(unary_expr, output);
-        if (unary_expr.status == TRY_SUCCESS) {
-            output.status = TRY_SUCCESS;
-            output.value.n_operands = 1;
-            output.value.uop = malloc(sizeof(Expression_t));
-            *output.value.uop = unary_expr.value;
-            return output;
-        }
+    sink_puts(sink, (const char *)spec->print_args);
+    print_expression(sink, op->uop, op);
+    return sink->written - begin;
+}
+
+static size_t print_binary_operator(Sink_t *const sink, const Operator_t *const op, const void *args) {
+    const size_t begin = sink->written;
+    const OperatorSpec_t *spec = args;
+    print_expression(sink, op->lop, op);
+    sink_puts(sink, (const char *)spec->print_args);
+    if (    !is_right_associative(spec) &&
+            op->rop->variant == EXPRESSION_OPERATOR &&
+            operator_precedence(op->rop->operator->variant) == spec->precedence) {
+        // Left-associative, so an equal precedence right operand needs parentheses
+        sink_puts(sink, "(");
+        print_operator(sink, op->rop->operator);
+        sink_puts(sink, ")");
     }
-    output.status = TRY_NONE;
-    return output;
+    else {
+        print_expression(sink, op->rop, op);
+    }
+    return sink->written - begin;
 }
 
-static TryOperator_t parse_binary_operator(const ConstString_t str, const void *args) {
-    TryOperator_t output;
+static size_t print_cast_operator(Sink_t *const sink, const Operator_t *const op, const void *args) {
+    (void)args;
+    const size_t begin = sink->written;
+    sink_puts(sink, "(");
+    print_expression(sink, op->lop, op);
+    sink_puts(sink, ")");
+    print_expression(sink, op->rop, op);
+    return sink->written - begin;
+}
+
+static size_t print_cond_operator(Sink_t *const sink, const Operator_t *const op, const void *args) {
+    const size_t begin = sink->written;
     const OperatorSpec_t *spec = args;
-    TryConstString_t split = find_string_nesting_sensitive(str, const_string_from_cstr((const char *)spec->parse_args));
-    if (split.status == TRY_SUCCESS) {
-        ConstString_t left_str, right_str;
-        left_str.begin = str.begin;
-        left_str.end = split.value.begin;
-        right_str.begin = split.value.end;
-        right_str.end = str.end;
-        TryExpression_t left_expr = spec->op1_type == LEFT_EXPR ?
-            parse_left_expression(left_str) :
-            parse_right_expression(left_str);
-        if (left_expr.status == TRY_SUCCESS) {
-            TryExpression_t right_expr = spec->op2_type == LEFT_EXPR ?
-                parse_left_expression(right_str) :
-                parse_right_expression(right_str);
-            if (right_expr.status == TRY_SUCCESS) {
-                output.value.lop = malloc(sizeof(Expression_t));
-                *output.value.lop = left_expr.value;
-                output.value.rop = malloc(sizeof(Expression_t));
-                *output.value.rop = right_expr.value;
-                output.status = TRY_SUCCESS;
-                output.value.n_operands = 2;
-                return output;
-            }
-        }
+    if (    op->pop->variant == EXPRESSION_OPERATOR &&
+            operator_precedence(op->pop->operator->variant) >= spec->precedence) {
+        // Right-associative, so an equal precedence condition needs parentheses
+        sink_puts(sink, "(");
+        print_operator(sink, op->pop->operator);
+        sink_puts(sink, ")");
     }
-    output.status = TRY_NONE;
+    else {
+        print_expression(sink, op->pop, op);
+    }
+    sink_puts(sink, " ? ");
+    print_expression(sink, op->top, op);
+    sink_puts(sink, " : ");
+    print_expression(sink, op->fop, op);
+    return sink->written - begin;
+}
+
+static size_t print_sizeof_operator(Sink_t *const sink, const Operator_t *const op, const void *args) {
+    (void)args;
+    const size_t begin = sink->written;
+    sink_puts(sink, "sizeof(");
+    if (op->uop && op->uop->variant == EXPRESSION_OPERATOR) {
+        print_operator(sink, op->uop->operator);
+    }
+    else {
+        print_expression(sink, op->uop, op);
+    }
+    sink_puts(sink, ")");
+    return sink->written - begin;
+}
+
+static size_t print_postfix_closure_operator(Sink_t *const sink, const Operator_t *const op, const void *args) {
+    const size_t begin = sink->written;
+    const OperatorSpec_t *spec = args;
+    const char *pair = spec->print_args;
+    print_expression(sink, op->lop, op);
+    sink_write(sink, &pair[0], 1);
+    if (op->rop && op->rop->variant == EXPRESSION_OPERATOR) {
+        print_operator(sink, op->rop->operator);
+    }
+    else {
+        print_expression(sink, op->rop, op);
+    }
+    sink_write(sink, &pair[1], 1);
+    return sink->written - begin;
+}
+
+
+static OperatorSpec_t operators[] = {
+    {OP_COMMA,       2, 15,   ",",    ", ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_ASSIGN,      2, 14,   "=",   " = ",  LEFT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_ADD_ASSIGN,  2, 14,  "+=",  " += ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_SUB_ASSIGN,  2, 14,  "-=",  " -= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_MUL_ASSIGN,  2, 14,  "*=",  " *= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_DIV_ASSIGN,  2, 14,  "/=",  " /= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_MOD_ASSIGN,  2, 14,  "%=",  " %= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_SL_ASSIGN,   2, 14, "<<=", " <<= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_SR_ASSIGN,   2, 14, ">>=", " >>= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_AND_ASSIGN,  2, 14,  "&=",  " &= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_XOR_ASSIGN,  2, 14,  "^=",  " ^= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_OR_ASSIGN,   2, 14,  "|=",  " |= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_COND,        3, 13,   "?",    NULL, RIGHT_EXPR, RIGHT_EXPR, RIGHT_EXPR, FORM_COND, print_cond_operator},
+    {OP_LOGICAL_OR,  2, 12,  "||",  " || ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_LOGICAL_AND, 2, 11,  "&&",  " && ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_BITWISE_OR,  2, 10,   "|",   " | ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_BITWISE_XOR, 2,  9,   "^",   " ^ ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_BITWISE_AND, 2,  8,   "&",   " & ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_EQ,          2,  7,  "==",  " == ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_NE,          2,  7,  "!=",  " != ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_GT,          2,  6,   ">",   " > ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_LT,          2,  6,   "<",   " < ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_GE,          2,  6,  ">=",  " >= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_LE,          2,  6,  "<=",  " <= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_SL,          2,  5,  "<<",  " << ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_SR,          2,  5,  ">>",  " >> ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_ADD,         2,  4,   "+",   " + ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_SUB,         2,  4,   "-",   " - ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_MUL,         2,  3,   "*",   " * ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_DIV,         2,  3,   "/",   " / ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_MOD,         2,  3,   "%",   " % ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_BINARY, print_binary_operator},
+    {OP_POS,         1,  2,   "+",     "+", RIGHT_EXPR,    NO_EXPR,    NO_EXPR, FORM_PREFIX, print_unary_prefix_operator},
+    {OP_NEG,         1,  2,   "-",     "-", RIGHT_EXPR,    NO_EXPR,    NO_EXPR, FORM_PREFIX, print_unary_prefix_operator},
+    {OP_LOGICAL_NOT, 1,  2,   "!",     "!", RIGHT_EXPR,    NO_EXPR,    NO_EXPR, FORM_PREFIX, print_unary_prefix_operator},
+    {OP_BITWISE_NOT, 1,  2,   "~",     "~", RIGHT_EXPR,    NO_EXPR,    NO_EXPR, FORM_PREFIX, print_unary_prefix_operator},
+    {OP_CAST,        1,  2,   "(",    NULL,  TYPE_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_CAST, print_cast_operator},
+    {OP_DEREFERENCE, 1,  1,   "*",     "*", RIGHT_EXPR,    NO_EXPR,    NO_EXPR, FORM_PREFIX, print_unary_prefix_operator},
+    {OP_ADDRESS,     1,  1,   "&",     "&", RIGHT_EXPR,    NO_EXPR,    NO_EXPR, FORM_PREFIX, print_unary_prefix_operator},
+    {OP_SIZEOF,      1,  1, "sizeof",  NULL, RIGHT_EXPR,    NO_EXPR,    NO_EXPR, FORM_SIZEOF, print_sizeof_operator},
+    {OP_CALL,        2,  0,  "()",    "()", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_POSTFIX_CLOSURE, print_postfix_closure_operator},
+    {OP_SUBSCRIPT,   2,  0,  "[]",    "[]", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_POSTFIX_CLOSURE, print_postfix_closure_operator},
+    {OP_MEM_ACCESS,  2,  0,   ".",     ".", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_MEMBER, print_binary_operator},
+    {OP_PTR_ACCESS,  2,  0,  "->",    "->", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, FORM_MEMBER, print_binary_operator}
+};
+#define N_OPERATORS (sizeof(operators) / sizeof(OperatorSpec_t))
+
+/**
+ * Precedence climbing over a lexed token span; `match` holds the index of the
+ * bracket token matching each bracket token, so that bracketed sub-expressions
+ * are parsed as sub-ranges without scanning for their ends
+ */
+typedef struct {
+    const Token_t *tokens;
+    const uint32_t *match;
+    size_t pos;
+    size_t end;
+} ExpressionParser_t;
+
+#define MAX_PRECEDENCE 15
+
+static TryExpression_t parse_pratt_expression(ExpressionParser_t *const parser, const uint32_t max_precedence);
+static TryExpression_t parse_pratt_unary(ExpressionParser_t *const parser);
+
+static TokenSpan_t parser_span(const ExpressionParser_t *const parser, const size_t begin, const size_t end) {
+    TokenSpan_t output;
+    output.tokens = parser->tokens;
+    output.match = parser->match;
+    output.begin = begin;
+    output.end = end;
     return output;
 }
 
-static TryOperator_t parse_cast_operator(const ConstString_t str, const void *args) {
-    TryOperator_t output;
-    TryConstString_t parens = find_closing(str, '(', ')');
-    if (parens.status == TRY_SUCCESS) {
-        ConstString_t type_str, right_str;
-        type_str.begin = parens.value.begin + 1;
-        type_str.end = parens.value.end - 1;
-        right_str.begin = parens.value.end;
-        right_str.end = str.end;
-        TryExpression_t type_expr = parse_type_expression(type_str);
-        if (type_expr.status == TRY_SUCCESS) {
-            TryExpression_t right_expr = parse_right_expression(right_str);
-            if (right_expr.status == TRY_SUCCESS) {
-                output.value.lop = malloc(sizeof(Expression_t));
-                *output.value.lop = type_expr.value;
-                output.value.rop = malloc(sizeof(Expression_t));
-                *output.value.rop = right_expr.value;
-                output.status = TRY_SUCCESS;
-                output.value.n_operands = 2;
-                return output;
-            }
+static bool at_punctuator(const ExpressionParser_t *const parser, const char *const punct) {
+    return parser->pos < parser->end && is_punctuator(&parser->tokens[parser->pos], punct);
+}
+
+/**
+ * Whether an expression can be used where an operand of the given type is
+ * expected; left expressions are the ones accepted by `parse_left_expression`
+ */
+static bool expression_fits(const Expression_t *const expr, const ExpressionTypeVariant_t type) {
+    switch (type) {
+        case LEFT_EXPR:
+            return expr->variant == EXPRESSION_OPERATOR ||
+                expr->variant == EXPRESSION_IDENTIFIER ||
+                expr->variant == EXPRESSION_DECLARATION;
+        case RIGHT_EXPR:
+            return expr->variant != EXPRESSION_DECLARATION &&
+                expr->variant != EXPRESSION_TYPE;
+        case TYPE_EXPR:
+            return expr->variant == EXPRESSION_TYPE;
+        default:
+            return false;
+    }
+}
+
+static const OperatorSpec_t *find_operator_spec(const Token_t *const token, const OperatorFormVariant_t form) {
+    if (token->variant != TOKEN_PUNCTUATOR) {
+        return NULL;
+    }
+    for (size_t i = 0; i < N_OPERATORS; ++i) {
+        if (operators[i].form == form && is_punctuator(token, operators[i].parse_args)) {
+            return &operators[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Assignments and the conditional operator group right to left, everything
+ * else groups left to right
+ */
+static bool is_right_associative(const OperatorSpec_t *const spec) {
+    return spec->form == FORM_COND || spec->precedence == operators[OP_ASSIGN].precedence;
+}
+
+static Expression_t new_operator_expression(const OperatorVariant_t variant, const uint8_t n_operands, Expression_t *const operands) {
+    Expression_t output;
+    output.variant = EXPRESSION_OPERATOR;
+    output.operator = new_operator();
+    output.operator->variant = variant;
+    output.operator->n_operands = n_operands;
+    output.operator->pop = NULL;
+    output.operator->top = NULL;
+    output.operator->fop = NULL;
+    for (uint8_t i = 0; i < n_operands; ++i) {
+        Expression_t *operand = NULL;
+        if (operands[i].variant != EXPRESSION_VOID) {
+            operand = new_expression();
+            *operand = operands[i];
+        }
+        switch (i) {
+            case 0: output.operator->pop = operand; break;
+            case 1: output.operator->top = operand; break;
+            case 2: output.operator->fop = operand; break;
         }
     }
-    output.status = TRY_NONE;
     return output;
 }
 
-static TryOperator_t parse_cond_operator(const ConstString_t str, const void *args) {
-    TryOperator_t output;
-    TryConstString_t question = find_string_nesting_sensitive(str, const_string_from_cstr("?"));
-    if (question.status == TRY_SUCCESS) {
-        ConstString_t pred_str, working;
-        pred_str.begin = str.begin;
-        pred_str.end = question.value.begin;
-        working.begin = question.value.end;
-        working.end = str.end;
-        TryConstString_t colon = find_last_string_nesting_sensitive(working, const_string_from_cstr(":"));
-        if (colon.status == TRY_SUCCESS) {
-            ConstString_t true_str, false_str;
-            true_str.begin = working.begin;
-            true_str.end = colon.value.begin;
-            false_str.begin = colon.value.end;
-            false_str.end = working.end;
-            TryExpression_t pred_expr = parse_right_expression(pred_str);
-            if (pred_expr.status == TRY_SUCCESS) {
-                TryExpression_t true_expr = parse_right_expression(true_str);
-                if (true_expr.status == TRY_SUCCESS) {
-                    TryExpression_t false_expr = parse_right_expression(false_str);
-                    if (false_expr.status == TRY_SUCCESS) {
-                        output.value.pop = malloc(sizeof(Expression_t));
-                        *output.value.pop = pred_expr.value;
-                        output.value.top = malloc(sizeof(Expression_t));
-                        *output.value.top = true_expr.value;
-                        output.value.fop = malloc(sizeof(Expression_t));
-                        *output.value.fop = false_expr.value;
-                        output.status = TRY_SUCCESS;
-                        output.value.n_operands = 3;
-                        return output;
-                    }
-                }
-            }
+/**
+ * Parse the tokens in [begin, end) as one whole expression
+ */
+static TryExpression_t parse_pratt_range(const ExpressionParser_t *const parser, const size_t begin, const size_t end, const uint32_t max_precedence) {
+    TryExpression_t output;
+    ExpressionParser_t sub = *parser;
+    sub.pos = begin;
+    sub.end = end;
+    if (begin == end) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    output = parse_pratt_expression(&sub, max_precedence);
+    if (output.status == TRY_SUCCESS && sub.pos != end) {
+        output.status = TRY_NONE;
+    }
+    return output;
+}
+
+static bool can_start_unary(const Token_t *const token) {
+    switch (token->variant) {
+        case TOKEN_IDENTIFIER:
+        case TOKEN_INTEGER:
+        case TOKEN_STR_LIT:
+        case TOKEN_CHAR_LIT:
+            return true;
+        case TOKEN_KEYWORD:
+            return token->keyword == KEYWORD_SIZEOF;
+        case TOKEN_PUNCTUATOR:
+            return is_punctuator(token, "(") || find_operator_spec(token, FORM_PREFIX);
+        default:
+            return false;
+    }
+}
+
+static bool can_start_declaration(const ExpressionParser_t *const parser) {
+    const Token_t *token = &parser->tokens[parser->pos];
+    if (token->variant == TOKEN_KEYWORD) {
+        switch (token->keyword) {
+            case KEYWORD_CHAR:
+            case KEYWORD_CONST:
+            case KEYWORD_DOUBLE:
+            case KEYWORD_ENUM:
+            case KEYWORD_FLOAT:
+            case KEYWORD_INT:
+            case KEYWORD_LONG:
+            case KEYWORD_SHORT:
+            case KEYWORD_SIGNED:
+            case KEYWORD_STRUCT:
+            case KEYWORD_UNION:
+            case KEYWORD_UNSIGNED:
+            case KEYWORD_VOID:
+            case KEYWORD_VOLATILE:
+                return true;
+            default:
+                return false;
         }
     }
+    if (token->variant == TOKEN_IDENTIFIER && parser->pos + 1 < parser->end) {
+        const Token_t *next = token + 1;
+        return next->variant == TOKEN_IDENTIFIER || is_punctuator(next, "*");
+    }
+    return false;
+}
+
+/**
+ * A declaration is only an expression as the left operand of an assignment,
+ * so look for the "=" at this nesting level and parse what comes before it
+ */
+static TryExpression_t parse_pratt_declaration(ExpressionParser_t *const parser) {
+    TryExpression_t output;
     output.status = TRY_NONE;
+    size_t it = parser->pos;
+    while (it < parser->end) {
+        const Token_t *token = &parser->tokens[it];
+        if (parser->match[it] != NO_TOKEN_MATCH) {
+            it = parser->match[it] + 1;
+            continue;
+        }
+        if (is_punctuator(token, "=")) {
+            break;
+        }
+        if (is_punctuator(token, ",") || is_punctuator(token, ";") || is_punctuator(token, "?") || is_punctuator(token, ":")) {
+            return output;
+        }
+        ++it;
+    }
+    if (it == parser->end || it == parser->pos) {
+        return output;
+    }
+    ParseCheckpoint_t checkpoint = parse_checkpoint();
+    TryVariable_t var = parse_variable_token_span(parser_span(parser, parser->pos, it));
+    if (var.status == TRY_SUCCESS && var.value.has_name) {
+        output.status = TRY_SUCCESS;
+        output.value.variant = EXPRESSION_DECLARATION;
+        output.value.decl = parse_alloc(sizeof(Variable_t));
+        *output.value.decl = var.value;
+        parser->pos = it;
+    }
+    else {
+        parse_rollback(checkpoint);
+    }
     return output;
 }
 
-static TryOperator_t parse_sizeof_operator(const ConstString_t str, const void *args) {
-    TryOperator_t output;
-    TryConstString_t keyword = find_string(str, const_string_from_cstr("sizeof"));
-    if (keyword.status == TRY_SUCCESS) {
-        ConstString_t working = strip_whitespace(strip(str, keyword.value).value);
-        TryConstString_t parens = find_closing(working, '(', ')');
-        if (parens.status == TRY_SUCCESS) {
-            ConstString_t contents;
-            contents.begin = parens.value.begin + 1;
-            contents.end = parens.value.end - 1;
-            TryExpression_t inner_expr = parse_right_expression(contents);
-            if (inner_expr.status != TRY_SUCCESS) {
-                inner_expr = parse_type_expression(contents);  
+static TryExpression_t parse_pratt_primary(ExpressionParser_t *const parser) {
+    TryExpression_t output;
+    output.status = TRY_NONE;
+    const Token_t *token = &parser->tokens[parser->pos];
+    ConstString_t contents;
+    switch (token->variant) {
+        case TOKEN_IDENTIFIER:
+            output.value.variant = EXPRESSION_IDENTIFIER;
+            output.value.identifier = token->symbol;
+            break;
+        case TOKEN_INTEGER: {
+            TryIntegerLiteral_t integer = find_integer(token->str);
+            if (integer.status != TRY_SUCCESS || integer.value.str.end != token->str.end) {
+                return output;
             }
-            if (inner_expr.status == TRY_SUCCESS) {
-                output.value.uop = malloc(sizeof(Expression_t));
-                *output.value.uop = inner_expr.value;
-                output.status = TRY_SUCCESS;
-                output.value.n_operands = 1;
+            output.value.variant = EXPRESSION_UINT_LIT;
+            output.value.uint_lit = integer.value.integer;
+            output.value.uint_lit_base = integer.value.base;
+            output.value.uint_lit_suffix = integer.value.suffix;
+            break;
+        }
+        case TOKEN_STR_LIT:
+            contents.begin = token->str.begin + 1;
+            contents.end = token->str.end - 1;
+            output.value.variant = EXPRESSION_STR_LIT;
+            output.value.str_lit = intern(contents);
+            break;
+        case TOKEN_CHAR_LIT: {
+            contents.begin = token->str.begin + 1;
+            contents.end = token->str.end - 1;
+            const size_t len = contents.end - contents.begin;
+            if (!((len == 1 && contents.begin[0] != '\\') || (len == 2 && contents.begin[0] == '\\'))) {
                 return output;
             }
+            output.value.variant = EXPRESSION_CHAR_LIT;
+            output.value.char_lit = intern(contents);
+            break;
         }
+        default:
+            return output;
     }
-    output.status = TRY_NONE;
+    ++parser->pos;
+    output.status = TRY_SUCCESS;
     return output;
 }
 
-static TryOperator_t parse_postfix_closure_operator(const ConstString_t str, const void *args) {
-    TryOperator_t output;
-    const OperatorSpec_t *spec = args;
-    const char *pair = spec->parse_args;
-    TryConstString_t closure = find_last_closure_nesting_sensitive(str, pair[0], pair[1]);
-    if (closure.status == TRY_SUCCESS) {
-        ConstString_t ws;
-        ws.begin = closure.value.end;
-        ws.end = str.end;
-        ws = strip_whitespace(ws);
-        if (ws.begin == ws.end) {
-            ConstString_t left_str, right_str;
-            left_str.begin = str.begin;
-            left_str.end = closure.value.begin;
-            right_str.begin = closure.value.begin + 1;
-            right_str.end = closure.value.end - 1;
-            TryExpression_t left_expr = parse_right_expression(left_str);
-            if (left_expr.status == TRY_SUCCESS) {
-                TryExpression_t right_expr = parse_right_expression(right_str);
-                if (right_expr.status == TRY_SUCCESS || right_str.begin == right_str.end) {
-                    output.value.lop = malloc(sizeof(Expression_t));
-                    *output.value.lop = left_expr.value;
-                    if (right_expr.status == TRY_SUCCESS) {
-                        output.value.rop = malloc(sizeof(Expression_t));
-                        *output.value.rop = right_expr.value;
-                    }
-                    else {
-                        output.value.rop = NULL;
-                    }
-                    output.status = TRY_SUCCESS;
-                    output.value.n_operands = 2;
+static TryExpression_t parse_pratt_postfix(ExpressionParser_t *const parser, Expression_t expr) {
+    TryExpression_t output;
+    output.status = TRY_NONE;
+    while (parser->pos < parser->end) {
+        const Token_t *token = &parser->tokens[parser->pos];
+        Expression_t operands[2];
+        operands[0] = expr;
+        if (is_punctuator(token, "(") || is_punctuator(token, "[")) {
+            const size_t closing = parser->match[parser->pos];
+            operands[1].variant = EXPRESSION_VOID;
+            if (closing > parser->pos + 1) {
+                TryExpression_t inner = parse_pratt_range(parser, parser->pos + 1, closing, MAX_PRECEDENCE);
+                if (inner.status != TRY_SUCCESS || !expression_fits(&inner.value, RIGHT_EXPR)) {
                     return output;
                 }
+                operands[1] = inner.value;
             }
+            expr = new_operator_expression(is_punctuator(token, "(") ? OP_CALL : OP_SUBSCRIPT, 2, operands);
+            parser->pos = closing + 1;
+        }
+        else if (is_punctuator(token, ".") || is_punctuator(token, "->")) {
+            if (parser->pos + 1 >= parser->end || token[1].variant != TOKEN_IDENTIFIER) {
+                return output;
+            }
+            operands[1].variant = EXPRESSION_IDENTIFIER;
+            operands[1].identifier = token[1].symbol;
+            expr = new_operator_expression(is_punctuator(token, ".") ? OP_MEM_ACCESS : OP_PTR_ACCESS, 2, operands);
+            parser->pos += 2;
+        }
+        else {
+            break;
         }
     }
-    output.status = TRY_NONE;
+    output.status = TRY_SUCCESS;
+    output.value = expr;
     return output;
 }
 
-static size_t print_unary_prefix_operator(char *buffer, const Operator_t *const op, const void *args) {
-    size_t num_chars = 0;
-    const OperatorSpec_t *spec = args;
-    num_chars += sprintf(buffer, "%s", (const char *)spec->print_args);
-    num_chars += print_expression(buffer + num_chars, op->uop, op);
-    return num_chars;
+static TryExpression_t parse_pratt_sizeof(ExpressionParser_t *const parser) {
+    TryExpression_t output;
+    output.status = TRY_NONE;
+    ++parser->pos;
+    if (!at_punctuator(parser, "(")) {
+        return output;
+    }
+    const size_t opening = parser->pos;
+    const size_t closing = parser->match[opening];
+    if (closing == opening + 1) {
+        return output;
+    }
+    ParseCheckpoint_t checkpoint = parse_checkpoint();
+    TryExpression_t inner = parse_pratt_range(parser, opening + 1, closing, MAX_PRECEDENCE);
+    if (inner.status != TRY_SUCCESS || !expression_fits(&inner.value, RIGHT_EXPR)) {
+        parse_rollback(checkpoint);
+        inner = parse_type_expression_token_span(parser_span(parser, opening + 1, closing));
+        if (inner.status != TRY_SUCCESS) {
+            output.status = TRY_NONE;
+            return output;
+        }
+    }
+    parser->pos = closing + 1;
+    output.status = TRY_SUCCESS;
+    output.value = new_operator_expression(OP_SIZEOF, 1, &inner.value);
+    return output;
 }
 
-static size_t print_binary_operator(char *buffer, const Operator_t *const op, const void *args) {
-    size_t num_chars = 0;
-    const OperatorSpec_t *spec = args;
-    num_chars += print_expression(buffer + num_chars, op->lop, op);
-    num_chars += sprintf(buffer + num_chars, "%s", (const char *)spec->print_args);
-    num_chars += print_expression(buffer + num_chars, op->rop, op);
-    return num_chars;
+/**
+ * A parenthesized type followed by something that can start an operand is a
+ * cast; "(x) - y" and friends are ambiguous, and are read as arithmetic when
+ * the parenthesized tokens are also a valid expression
+ */
+static TryExpression_t parse_pratt_parens(ExpressionParser_t *const parser) {
+    TryExpression_t output;
+    output.status = TRY_NONE;
+    const size_t opening = parser->pos;
+    const size_t closing = parser->match[opening];
+    if (closing == opening + 1) {
+        return output;
+    }
+    const size_t next = closing + 1;
+    ParseCheckpoint_t checkpoint = parse_checkpoint();
+    TryExpression_t inner;
+    inner.status = TRY_NONE;
+    bool parsed_inner = false;
+    if (next < parser->end && can_start_unary(&parser->tokens[next])) {
+        const Token_t *token = &parser->tokens[next];
+        const bool ambiguous = is_punctuator(token, "+") || is_punctuator(token, "-") ||
+            is_punctuator(token, "*") || is_punctuator(token, "&");
+        if (ambiguous) {
+            inner = parse_pratt_range(parser, opening + 1, closing, MAX_PRECEDENCE);
+            parsed_inner = true;
+            if (inner.status == TRY_SUCCESS && expression_fits(&inner.value, RIGHT_EXPR)) {
+                parser->pos = next;
+                return parse_pratt_postfix(parser, inner.value);
+            }
+            parse_rollback(checkpoint);
+        }
+        TryExpression_t type_expr = parse_type_expression_token_span(parser_span(parser, opening + 1, closing));
+        if (type_expr.status == TRY_SUCCESS) {
+            parser->pos = next;
+            TryExpression_t right_expr = parse_pratt_unary(parser);
+            if (right_expr.status != TRY_SUCCESS || !expression_fits(&right_expr.value, RIGHT_EXPR)) {
+                parse_rollback(checkpoint);
+                return output;
+            }
+            Expression_t operands[2];
+            operands[0] = type_expr.value;
+            operands[1] = right_expr.value;
+            output.status = TRY_SUCCESS;
+            output.value = new_operator_expression(OP_CAST, 2, operands);
+            return output;
+        }
+        parse_rollback(checkpoint);
+        if (parsed_inner) {
+            return output;
+        }
+    }
+    inner = parse_pratt_range(parser, opening + 1, closing, MAX_PRECEDENCE);
+    if (inner.status != TRY_SUCCESS || !expression_fits(&inner.value, RIGHT_EXPR)) {
+        parse_rollback(checkpoint);
+        return output;
+    }
+    parser->pos = next;
+    return parse_pratt_postfix(parser, inner.value);
 }
 
-static size_t print_cast_operator(char *buffer, const Operator_t *const op, const void *args) {
-    size_t num_chars = 0;
-    num_chars += sprintf(buffer, "(");
-    num_chars += print_expression(buffer + num_chars, op->lop, op);
-    num_chars += sprintf(buffer + num_chars, ")");
-    num_chars += print_expression(buffer + num_chars, op->rop, op);
-    return num_chars;
+static TryExpression_t parse_pratt_unary(ExpressionParser_t *const parser) {
+    TryExpression_t output;
+    output.status = TRY_NONE;
+    if (parser->pos >= parser->end) {
+        return output;
+    }
+    const Token_t *token = &parser->tokens[parser->pos];
+    const OperatorSpec_t *prefix = find_operator_spec(token, FORM_PREFIX);
+    if (prefix) {
+        ++parser->pos;
+        TryExpression_t operand = parse_pratt_unary(parser);
+        if (operand.status != TRY_SUCCESS || !expression_fits(&operand.value, prefix->op1_type)) {
+            return output;
+        }
+        output.status = TRY_SUCCESS;
+        output.value = new_operator_expression(prefix->variant, 1, &operand.value);
+        return output;
+    }
+    if (token->variant == TOKEN_KEYWORD && token->keyword == KEYWORD_SIZEOF) {
+        return parse_pratt_sizeof(parser);
+    }
+    if (is_punctuator(token, "(")) {
+        return parse_pratt_parens(parser);
+    }
+    TryExpression_t primary = parse_pratt_primary(parser);
+    if (primary.status != TRY_SUCCESS) {
+        return primary;
+    }
+    return parse_pratt_postfix(parser, primary.value);
 }
 
-static size_t print_cond_operator(char *buffer, const Operator_t *const op, const void *args) {
-    size_t num_chars = 0;
-    num_chars += print_expression(buffer, op->pop, op);
-    num_chars += sprintf(buffer + num_chars, " ? ");
-    num_chars += print_expression(buffer + num_chars, op->top, op);
-    num_chars += sprintf(buffer + num_chars, " : ");
-    num_chars += print_expression(buffer + num_chars, op->fop, op);
-    return num_chars;
+static TryExpression_t parse_pratt_expression(ExpressionParser_t *const parser, const uint32_t max_precedence) {
+    TryExpression_t output;
+    output.status = TRY_NONE;
+    if (parser->pos >= parser->end) {
+        return output;
+    }
+    TryExpression_t left_expr;
+    left_expr.status = TRY_NONE;
+    if (max_precedence >= operators[OP_ASSIGN].precedence && can_start_declaration(parser)) {
+        left_expr = parse_pratt_declaration(parser);
+    }
+    if (left_expr.status != TRY_SUCCESS) {
+        left_expr = parse_pratt_unary(parser);
+        if (left_expr.status != TRY_SUCCESS) {
+            return output;
+        }
+    }
+
+    while (parser->pos < parser->end) {
+        const Token_t *token = &parser->tokens[parser->pos];
+        const OperatorSpec_t *spec = find_operator_spec(token, FORM_BINARY);
+        if (!spec) {
+            spec = find_operator_spec(token, FORM_COND);
+        }
+        if (!spec || spec->precedence > max_precedence) {
+            break;
+        }
+        ++parser->pos;
+        Expression_t operands[3];
+        operands[0] = left_expr.value;
+        if (!expression_fits(&operands[0], spec->op1_type)) {
+            return output;
+        }
+        if (spec->form == FORM_COND) {
+            TryExpression_t true_expr = parse_pratt_expression(parser, MAX_PRECEDENCE);
+            if (true_expr.status != TRY_SUCCESS || !expression_fits(&true_expr.value, spec->op2_type) || !at_punctuator(parser, ":")) {
+                return output;
+            }
+            ++parser->pos;
+            operands[1] = true_expr.value;
+        }
+        const uint32_t right_precedence = is_right_associative(spec) ? spec->precedence : spec->precedence - 1;
+        TryExpression_t right_expr = parse_pratt_expression(parser, right_precedence);
+        const ExpressionTypeVariant_t right_type = spec->form == FORM_COND ? spec->op3_type : spec->op2_type;
+        if (right_expr.status != TRY_SUCCESS || !expression_fits(&right_expr.value, right_type)) {
+            return output;
+        }
+        operands[spec->n_operands - 1] = right_expr.value;
+        left_expr.value = new_operator_expression(spec->variant, spec->n_operands, operands);
+    }
+    return left_expr;
 }
 
-static size_t print_sizeof_operator(char *buffer, const Operator_t *const op, const void *args) {
-    size_t num_chars = 0;
-    num_chars += sprintf(buffer, "sizeof(");
-    if (op->uop && op->uop->variant == EXPRESSION_OPERATOR) {
-        num_chars += print_operator(buffer + num_chars, op->uop->operator);
+TryOperator_t parse_operator_token_span(const TokenSpan_t span) {
+    TryOperator_t output;
+    output.status = TRY_NONE;
+    if (span.begin == span.end) {
+        return output;
+    }
+    ParseCheckpoint_t checkpoint = parse_checkpoint();
+    ExpressionParser_t parser;
+    parser.tokens = span.tokens;
+    parser.match = span.match;
+    parser.pos = span.begin;
+    parser.end = span.end;
+    TryExpression_t expr = parse_pratt_expression(&parser, MAX_PRECEDENCE);
+    if (expr.status == TRY_SUCCESS && parser.pos == span.end && expr.value.variant == EXPRESSION_OPERATOR) {
+        output.status = TRY_SUCCESS;
+        output.value = *expr.value.operator;
+        parse_free(expr.value.operator);
     }
     else {
-        num_chars += print_expression(buffer + num_chars, op->uop, op);
+        parse_rollback(checkpoint);
     }
-    num_chars += sprintf(buffer + num_chars, ")");
-    return num_chars;
+    return output;
 }
 
-static size_t print_postfix_closure_operator(char *buffer, const Operator_t *const op, const void *args) {
-    size_t num_chars = 0;
-    const OperatorSpec_t *spec = args;
-    const char *pair = spec->print_args;
-    num_chars += print_expression(buffer + num_chars, op->lop, op);
-    num_chars += sprintf(buffer + num_chars, "%c", pair[0]);
-    if (op->rop && op->rop->variant == EXPRESSION_OPERATOR) {
-        num_chars += print_operator(buffer + num_chars, op->rop->operator);
+/**
+ * Parse a whole token range as one operator expression; brackets must balance
+ */
+static TryOperator_t parse_operator_token_range(const TokenRange_t range) {
+    TryOperator_t output;
+    output.status = TRY_NONE;
+    const size_t n_tokens = range.end - range.begin;
+    if (!n_tokens) {
+        return output;
     }
-    else {
-        num_chars += print_expression(buffer + num_chars, op->rop, op);
+    uint32_t *match = malloc(n_tokens * sizeof(uint32_t));
+    if (match_token_brackets(range, match)) {
+        TokenSpan_t span;
+        span.tokens = range.begin;
+        span.match = match;
+        span.begin = 0;
+        span.end = n_tokens;
+        output = parse_operator_token_span(span);
     }
-    num_chars += sprintf(buffer + num_chars, "%c", pair[1]);
-    return num_chars;
+    free(match);
+    return output;
 }
 
-static OperatorSpec_t operators[] = {
-    {OP_COMMA,       2, 15,   ",",    ", ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_ASSIGN,      2, 14,   "=",   " = ",  LEFT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_ADD_ASSIGN,  2, 14,  "+=",  " += ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_SUB_ASSIGN,  2, 14,  "-=",  " -= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_MUL_ASSIGN,  2, 14,  "*=",  " *= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_DIV_ASSIGN,  2, 14,  "/=",  " /= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_MOD_ASSIGN,  2, 14,  "%=",  " %= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_SL_ASSIGN,   2, 14, "<<=", " <<= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_SR_ASSIGN,   2, 14, ">>=", " >>= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_AND_ASSIGN,  2, 14,  "&=",  " &= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_XOR_ASSIGN,  2, 14,  "^=",  " ^= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_OR_ASSIGN,   2, 14,  "|=",  " |= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_COND,        3, 13,  NULL,    NULL, RIGHT_EXPR, RIGHT_EXPR, RIGHT_EXPR, parse_cond_operator, print_cond_operator},
-    {OP_LOGICAL_OR,  2, 12,  "||",  " || ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_LOGICAL_AND, 2, 11,  "&&",  " && ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_BITWISE_OR,  2, 10,   "|",   " | ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_BITWISE_XOR, 2,  9,   "^",   " ^ ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_BITWISE_AND, 2,  8,   "&",   " & ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_EQ,          2,  7,  "==",  " == ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_NE,          2,  7,  "!=",  " != ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_GT,          2,  6,   ">",   " > ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_LT,          2,  6,   "<",   " < ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_GE,          2,  6,  ">=",  " >= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_LE,          2,  6,  "<=",  " <= ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_SL,          2,  5,  "<<",  " << ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_SR,          2,  5,  ">>",  " >> ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_ADD,         2,  4,   "+",   " + ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_SUB,         2,  4,   "-",   " - ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_MUL,         2,  3,   "*",   " * ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_DIV,         2,  3,   "/",   " / ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_MOD,         2,  3,   "%",   " % ", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_POS,         1,  2,   "+",     "+", RIGHT_EXPR,    NO_EXPR,    NO_EXPR, parse_unary_prefix_operator, print_unary_prefix_operator},
-    {OP_NEG,         1,  2,   "-",     "-", RIGHT_EXPR,    NO_EXPR,    NO_EXPR, parse_unary_prefix_operator, print_unary_prefix_operator},
-    {OP_LOGICAL_NOT, 1,  2,   "!",     "!", RIGHT_EXPR,    NO_EXPR,    NO_EXPR, parse_unary_prefix_operator, print_unary_prefix_operator},
-    {OP_BITWISE_NOT, 1,  2,   "~",     "~", RIGHT_EXPR,    NO_EXPR,    NO_EXPR, parse_unary_prefix_operator, print_unary_prefix_operator},
-    {OP_CAST,        1,  2,  NULL,    NULL,  TYPE_EXPR, RIGHT_EXPR,    NO_EXPR, parse_cast_operator, print_cast_operator},
-    {OP_DEREFERENCE, 1,  1,   "*",     "*", RIGHT_EXPR,    NO_EXPR,    NO_EXPR, parse_unary_prefix_operator, print_unary_prefix_operator},
-    {OP_ADDRESS,     1,  1,   "&",     "&", RIGHT_EXPR,    NO_EXPR,    NO_EXPR, parse_unary_prefix_operator, print_unary_prefix_operator},
-    {OP_SIZEOF,      1,  1,  NULL,    NULL, RIGHT_EXPR,    NO_EXPR,    NO_EXPR, parse_sizeof_operator, print_sizeof_operator},
-    {OP_CALL,        2,  0,  "()",    "()", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_postfix_closure_operator, print_postfix_closure_operator},
-    {OP_SUBSCRIPT,   2,  0,  "[]",    "[]", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_postfix_closure_operator, print_postfix_closure_operator},
-    {OP_MEM_ACCESS,  2,  0,   ".",     ".", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator},
-    {OP_PTR_ACCESS,  2,  0,  "->",    "->", RIGHT_EXPR, RIGHT_EXPR,    NO_EXPR, parse_binary_operator, print_binary_operator}
-};
-
 TryOperator_t parse_operator(const ConstString_t str) {
     TryOperator_t output;
+    WithSourceIndex(str, output, parse_operator(str));
     ConstString_t working = strip_whitespace(str);
     if (working.begin == working.end) {
         output.status = TRY_NONE;
         return output;
     }
-    for (int i = 0; i < 43; ++i) {
-        OperatorSpec_t *spec = &operators[i];
-        if (!spec->parse_func) {
-            continue;
-        }
-        TryOperator_t op = spec->parse_func(working, spec);
-        if (op.status == TRY_SUCCESS) {
-            output.status = TRY_SUCCESS;
-            output.value = op.value;
-            output.value.variant = i;
-            return output;
-        }
+    TryTokenArray_t tokens = lex(working);
+    if (tokens.status != TRY_SUCCESS) {
+        output.status = TRY_NONE;
+        return output;
     }
-    output.status = TRY_NONE;
+    output = parse_operator_token_range(token_range_from_array(&tokens.value));
+    free_token_array(&tokens.value);
     return output;
 }
 
-size_t print_operator(char *buffer, const Operator_t *const op) {
-    buffer[0] = 0;
+TryOperator_t parse_operator_tokens(const TokenRange_t tokens) {
+    TryOperator_t output;
+    if (tokens.begin == tokens.end) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    WithSourceIndex(token_range_str(tokens), output, parse_operator_tokens(tokens));
+    return parse_operator_token_range(tokens);
+}
+
+size_t print_operator(Sink_t *const sink, const Operator_t *const op) {
     OperatorSpec_t *spec = &operators[op->variant];
     if (!spec->print_func) {
         return 0;
     }
-    return spec->print_func(buffer, op, spec);
+    return spec->print_func(sink, op, spec);
 }
 
 uint32_t operator_precedence(const OperatorVariant_t variant) {
     const OperatorSpec_t *spec = &operators[variant];
     assert(spec->variant == variant);
     return spec->precedence;
-}
\ No newline at end of file
+}
+
+const char *operator_token(const OperatorVariant_t variant) {
+    const OperatorSpec_t *spec = &operators[variant];
+    assert(spec->variant == variant);
+    return (const char *)spec->parse_args;
+}
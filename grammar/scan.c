@@ -0,0 +1,238 @@
+#include "util.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCAN_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Each classifier fills one 64-bit mask per class for a 64-byte block
+ */
+typedef void (*ClassifyBlockFunc_t)(const uint8_t *const block, uint64_t *const masks);
+
+static void classify_block_scalar(const uint8_t *const block, uint64_t *const masks) {
+    memset(masks, 0, N_SCAN_CLASSES * sizeof(uint64_t));
+    for (int i = 0; i < 64; ++i) {
+        const uint8_t c = block[i];
+        const uint64_t bit = (uint64_t)1 << i;
+        if (c == ' ' || c == '\t' || c == '\n') masks[SCAN_WHITESPACE] |= bit;
+        else if (c == '(' || c == '[' || c == '{') masks[SCAN_OPEN_BRACKET] |= bit;
+        else if (c == ')' || c == ']' || c == '}') masks[SCAN_CLOSE_BRACKET] |= bit;
+        else if (c == '"' || c == '\'') masks[SCAN_QUOTE] |= bit;
+        else if (c == '\\') masks[SCAN_ESCAPE] |= bit;
+        else if (c == ';') masks[SCAN_SEMICOLON] |= bit;
+        else if (c == ',') masks[SCAN_COMMA] |= bit;
+        else if (c == '_' || ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9')) {
+            masks[SCAN_IDENTIFIER] |= bit;
+        }
+    }
+}
+
+#ifdef SCAN_X86
+static void classify_block_sse2(const uint8_t *const block, uint64_t *const masks) {
+    memset(masks, 0, N_SCAN_CLASSES * sizeof(uint64_t));
+    for (int k = 0; k < 4; ++k) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(block + 16 * k));
+        const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        const __m128i classes[N_SCAN_CLASSES] = {
+            _mm_or_si128(_mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+            _mm_or_si128(_mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('(')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('['))),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('{'))),
+            _mm_or_si128(_mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8(')')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8(']'))),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('}'))),
+            _mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\''))),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8(';')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8(',')),
+            _mm_or_si128(_mm_or_si128(
+                _mm_and_si128(
+                    _mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                    _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1))),
+                _mm_and_si128(
+                    _mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                    _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)))),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('_')))
+        };
+        for (int c = 0; c < N_SCAN_CLASSES; ++c) {
+            masks[c] |= (uint64_t)(uint16_t)_mm_movemask_epi8(classes[c]) << (16 * k);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void classify_block_avx2(const uint8_t *const block, uint64_t *const masks) {
+    memset(masks, 0, N_SCAN_CLASSES * sizeof(uint64_t));
+    for (int k = 0; k < 2; ++k) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *)(block + 32 * k));
+        const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        const __m256i classes[N_SCAN_CLASSES] = {
+            _mm256_or_si256(_mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+            _mm256_or_si256(_mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('(')),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('['))),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('{'))),
+            _mm256_or_si256(_mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(')')),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(']'))),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\''))),
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')),
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(';')),
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')),
+            _mm256_or_si256(_mm256_or_si256(
+                _mm256_and_si256(
+                    _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                    _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower)),
+                _mm256_and_si256(
+                    _mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                    _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v))),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')))
+        };
+        for (int c = 0; c < N_SCAN_CLASSES; ++c) {
+            masks[c] |= (uint64_t)(uint32_t)_mm256_movemask_epi8(classes[c]) << (32 * k);
+        }
+    }
+}
+#endif
+
+/**
+ * Pick the widest classifier the CPU supports; SSE2 is part of the x86-64
+ * baseline, AVX2 is detected at runtime
+ */
+static ClassifyBlockFunc_t select_classifier() {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return classify_block_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return classify_block_sse2;
+    }
+#endif
+    return classify_block_scalar;
+}
+
+static ClassifyBlockFunc_t find_classifier(const ScanClassifierVariant_t variant) {
+    switch (variant) {
+        case SCAN_CLASSIFIER_SCALAR:
+            return classify_block_scalar;
+#ifdef SCAN_X86
+        case SCAN_CLASSIFIER_SSE2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2") ? classify_block_sse2 : NULL;
+        case SCAN_CLASSIFIER_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? classify_block_avx2 : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+static StructuralBitmaps_t scan_structure_by(const ConstString_t str, const ClassifyBlockFunc_t classify) {
+    StructuralBitmaps_t output;
+    const size_t len = str.end - str.begin;
+    output.source = str;
+    output.n_words = (len + 63) / 64;
+    output.words = malloc((output.n_words ? output.n_words : 1) * N_SCAN_CLASSES * sizeof(uint64_t));
+
+    uint64_t masks[N_SCAN_CLASSES];
+    size_t word = 0;
+    for (; 64 * (word + 1) <= len; ++word) {
+        classify((const uint8_t *)str.begin + 64 * word, masks);
+        for (int c = 0; c < N_SCAN_CLASSES; ++c) {
+            output.words[c * output.n_words + word] = masks[c];
+        }
+    }
+    if (word < output.n_words) {
+        // Zero padding does not belong to any class
+        uint8_t tail[64] = { 0 };
+        memcpy(tail, str.begin + 64 * word, len - 64 * word);
+        classify(tail, masks);
+        for (int c = 0; c < N_SCAN_CLASSES; ++c) {
+            output.words[c * output.n_words + word] = masks[c];
+        }
+    }
+    return output;
+}
+
+StructuralBitmaps_t scan_structure(const ConstString_t str) {
+    static ClassifyBlockFunc_t classify = NULL;
+    if (!classify) {
+        classify = select_classifier();
+    }
+    return scan_structure_by(str, classify);
+}
+
+bool has_scan_classifier(const ScanClassifierVariant_t variant) {
+    return find_classifier(variant) != NULL;
+}
+
+StructuralBitmaps_t scan_structure_with(const ConstString_t str, const ScanClassifierVariant_t variant) {
+    const ClassifyBlockFunc_t classify = find_classifier(variant);
+    assert(classify);
+    return scan_structure_by(str, classify);
+}
+
+void free_structural_bitmaps(StructuralBitmaps_t *const bitmaps) {
+    free(bitmaps->words);
+    bitmaps->words = NULL;
+    bitmaps->n_words = 0;
+}
+
+static const char *scan_next_impl(const StructuralBitmaps_t *const bitmaps, const uint32_t classes, const char *const from, const char *const limit, const bool invert) {
+    if (from >= limit) {
+        return limit;
+    }
+    size_t offset = from - bitmaps->source.begin;
+    size_t word = offset / 64;
+    uint64_t mask = ~(uint64_t)0 << (offset % 64);
+    while (word < bitmaps->n_words) {
+        uint64_t bits = 0;
+        for (int c = 0; c < N_SCAN_CLASSES; ++c) {
+            if (classes & (1 << c)) {
+                bits |= bitmaps->words[c * bitmaps->n_words + word];
+            }
+        }
+        if (invert) {
+            bits = ~bits;
+        }
+        bits &= mask;
+        if (bits) {
+            const char *found = bitmaps->source.begin + 64 * word + __builtin_ctzll(bits);
+            return found < limit ? found : limit;
+        }
+        if (bitmaps->source.begin + 64 * (word + 1) >= limit) {
+            break;
+        }
+        mask = ~(uint64_t)0;
+        ++word;
+    }
+    return limit;
+}
+
+const char *scan_next(const StructuralBitmaps_t *const bitmaps, const uint32_t classes, const char *const from, const char *const limit) {
+    return scan_next_impl(bitmaps, classes, from, limit, false);
+}
+
+const char *scan_next_not(const StructuralBitmaps_t *const bitmaps, const uint32_t classes, const char *const from, const char *const limit) {
+    return scan_next_impl(bitmaps, classes, from, limit, true);
+}
@@ -24,322 +24,371 @@ TryVariable_t parse_typedef(const ConstString_t str) {
 }
 
 /**
- * Parse a statement
- *  SUCCESS: a statement was parsed
- *  NONE: a statement was not found
- *  ERROR: there was an error with statement syntax
+ * Tokens [begin, end) of the same array as `span`
  */
-TryStatement_t parse_statement(const ConstString_t str, ErrorLinkedListNode_t ***const errors, ConstString_t *const stmt_str) {
-    TryStatement_t output;
-    output.value.variant = STATEMENT_DECLARATION;
-    ConstString_t working = strip_whitespace(str);
-    stmt_str->begin = str.begin;
+static TokenSpan_t sub_span(const TokenSpan_t span, const size_t begin, const size_t end) {
+    TokenSpan_t output = span;
+    output.begin = begin;
+    output.end = end;
+    return output;
+}
+
+/**
+ * Index of the first punctuator `punct` in [begin, span.end) that is at the
+ * nesting level of `begin`, or span.end if there is none; bracketed tokens
+ * are stepped over through `match`
+ */
+static size_t find_token(const TokenSpan_t span, size_t begin, const char *const punct) {
+    while (begin < span.end && !is_punctuator(&span.tokens[begin], punct)) {
+        begin = span.match[begin] != NO_TOKEN_MATCH ? span.match[begin] + 1 : begin + 1;
+    }
+    return begin;
+}
 
-    if (*working.begin == '{') {
-        TryConstString_t braces = find_closing(working, '{', '}');
-        GrammarPropagateError(braces, output);
-        if (braces.status == TRY_SUCCESS) {
-            stmt_str->end = braces.value.end;
-            ConstString_t contents;
-            contents.begin = braces.value.begin + 1;
-            contents.end = braces.value.end - 1;
-            TryScope_t scope = parse_scope(contents, errors);
-            GrammarPropagateError(scope, output);
-            if (scope.status == TRY_SUCCESS) {
-                output.status = TRY_SUCCESS;
-                output.value.str = working;
-                output.value.variant = STATEMENT_SCOPE;
-                output.value.scope = malloc(sizeof(Scope_t));
-                *output.value.scope = scope.value;
+static TryVariable_t parse_typedef_token_span(const TokenSpan_t span) {
+    TryVariable_t output;
+    if (span.begin == span.end || span.tokens[span.begin].keyword != KEYWORD_TYPEDEF) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    return parse_variable_token_span(sub_span(span, span.begin + 1, span.end));
+}
+
+static TryStatement_t parse_statement_token_span(const TokenSpan_t span, ErrorLinkedListNode_t ***const errors, size_t *const stmt_end);
+
+/**
+ * Parse a break, continue or return statement, up to its ';'
+ */
+static TryStatement_t parse_jump_token_span(const TokenSpan_t span, size_t *const stmt_end) {
+    TryStatement_t output;
+    const Token_t *keyword = &span.tokens[span.begin];
+    Control_t control;
+    control.variant = keyword->keyword == KEYWORD_BREAK ? CONTROL_BREAK :
+        keyword->keyword == KEYWORD_CONTINUE ? CONTROL_CONTINUE : CONTROL_RETURN;
+    const size_t semicolon = find_token(span, span.begin + 1, ";");
+    if (semicolon == span.end) {
+        output.status = TRY_ERROR;
+        output.error.location = keyword->str;
+        output.error.desc = "Control statement should be ended by a ';'";
+        return output;
+    }
+    const TokenSpan_t following = sub_span(span, span.begin + 1, semicolon);
+    if (following.begin != following.end) {
+        if (control.variant == CONTROL_RETURN) {
+            TryExpression_t expr = parse_right_expression_token_span(following);
+            GrammarPropagateError(expr, output);
+            if (expr.status == TRY_NONE) {
+                output.status = TRY_ERROR;
+                output.error.location = token_span_str(span, following.begin, following.end);
+                output.error.desc = "return accepts only right expressions";
                 return output;
             }
+            control.ret = expr.value;
         }
+        else {
+            output.status = TRY_ERROR;
+            output.error.location = token_span_str(span, following.begin, following.end);
+            output.error.desc = "break/continue does not accept data";
+            return output;
+        }
+    }
+    else if (control.variant == CONTROL_RETURN) {
+        control.ret.variant = EXPRESSION_VOID;
+    }
+    output.status = TRY_SUCCESS;
+    output.value.variant = STATEMENT_CONTROL;
+    output.value.control = parse_alloc(sizeof(Control_t));
+    *output.value.control = control;
+    output.value.str = token_span_str(span, span.begin, semicolon + 1);
+    *stmt_end = semicolon + 1;
+    return output;
+}
+
+/**
+ * Parse the condition in the parentheses that open at token `pos`, and give
+ * the index of the closing parenthesis
+ */
+static TryExpression_t parse_condition_token_span(const TokenSpan_t span, const size_t pos, size_t *const closing) {
+    TryExpression_t output;
+    if (pos == span.end || !is_punctuator(&span.tokens[pos], "(")) {
+        output.status = TRY_ERROR;
+        output.error.location = pos < span.end ? token_span_str(span, pos, span.end) : span.tokens[pos - 1].str;
+        output.error.desc = "Control statement needs condition in ()";
+        return output;
     }
+    *closing = span.match[pos];
+    output = parse_right_expression_token_span(sub_span(span, pos + 1, *closing));
+    if (output.status == TRY_NONE) {
+        output.status = TRY_ERROR;
+        output.error.location = token_span_str(span, pos, *closing + 1);
+        output.error.desc = "Control statement needs a condition in ()";
+    }
+    return output;
+}
 
-    TryConstString_t keyword;
+/**
+ * Parse the three clauses between the parentheses of a for statement
+ */
+static TryStatement_t parse_for_clauses_token_span(const TokenSpan_t clauses, Control_t *const control) {
+    TryStatement_t output;
+    const size_t semicolon1 = find_token(clauses, clauses.begin, ";");
+    const size_t semicolon2 = semicolon1 < clauses.end ? find_token(clauses, semicolon1 + 1, ";") : clauses.end;
+    if (semicolon2 == clauses.end) {
+        output.status = TRY_ERROR;
+        output.error.location = token_span_str(clauses, clauses.begin - 1, clauses.end + 1);
+        output.error.desc = semicolon1 == clauses.end ? "For statement needs a first ';'" : "For statement needs a second ';'";
+        return output;
+    }
+    TryExpression_t init_expr = parse_right_expression_token_span(sub_span(clauses, clauses.begin, semicolon1));
+    GrammarPropagateError(init_expr, output);
+    if (init_expr.status == TRY_NONE) {
+        control->ctrl_for.init = NULL;
+    }
+    else {
+        control->ctrl_for.init = new_expression();
+        *control->ctrl_for.init = init_expr.value;
+    }
+    TryExpression_t cond_expr = parse_right_expression_token_span(sub_span(clauses, semicolon1 + 1, semicolon2));
+    GrammarPropagateError(cond_expr, output);
+    if (cond_expr.status == TRY_NONE) {
+        control->condition.variant = EXPRESSION_UINT_LIT;
+        control->condition.uint_lit = 1;
+        control->condition.uint_lit_base = INTEGER_DECIMAL;
+        control->condition.uint_lit_suffix = INTEGER_SUFFIX_NONE;
+    }
+    else {
+        control->condition = cond_expr.value;
+    }
+    TryExpression_t inc_expr = parse_right_expression_token_span(sub_span(clauses, semicolon2 + 1, clauses.end));
+    GrammarPropagateError(inc_expr, output);
+    if (inc_expr.status == TRY_NONE) {
+        control->ctrl_for.increment = NULL;
+    }
+    else {
+        control->ctrl_for.increment = new_expression();
+        *control->ctrl_for.increment = inc_expr.value;
+    }
+    output.status = TRY_SUCCESS;
+    return output;
+}
+
+/**
+ * Parse an if, for, while or do statement, including an else branch or the
+ * while condition of a do
+ */
+static TryStatement_t parse_control_token_span(const TokenSpan_t span, ErrorLinkedListNode_t ***const errors, size_t *const stmt_end) {
+    TryStatement_t output;
+    const Token_t *tokens = span.tokens;
     Control_t control;
-    if ((keyword = find_string(working, const_string_from_cstr("break"))).status == TRY_SUCCESS) {
-        output.value.variant = STATEMENT_CONTROL;
-        control.variant = CONTROL_BREAK;
-    }
-    else if ((keyword = find_string(working, const_string_from_cstr("continue"))).status == TRY_SUCCESS) {
-        output.value.variant = STATEMENT_CONTROL;
-        control.variant = CONTROL_CONTINUE;
-    }
-    else if ((keyword = find_string(working, const_string_from_cstr("return"))).status == TRY_SUCCESS) {
-        output.value.variant = STATEMENT_CONTROL;
-        control.variant = CONTROL_RETURN;
-    }
-    if (output.value.variant == STATEMENT_CONTROL) {
-        TryConstString_t semicolon = find_string_nesting_sensitive(working, const_string_from_cstr(";"));
-        GrammarPropagateError(semicolon, output);
-        if (semicolon.status == TRY_NONE) {
+    switch (tokens[span.begin].keyword) {
+        case KEYWORD_IF: control.variant = CONTROL_IF; break;
+        case KEYWORD_FOR: control.variant = CONTROL_FOR; break;
+        case KEYWORD_WHILE: control.variant = CONTROL_WHILE; break;
+        default: control.variant = CONTROL_DO; break;
+    }
+    size_t pos = span.begin + 1;
+    size_t closing;
+    if (control.variant == CONTROL_IF || control.variant == CONTROL_WHILE) {
+        TryExpression_t cond = parse_condition_token_span(span, pos, &closing);
+        GrammarPropagateError(cond, output);
+        control.condition = cond.value;
+        pos = closing + 1;
+    }
+    else if (control.variant == CONTROL_FOR) {
+        if (pos == span.end || !is_punctuator(&tokens[pos], "(")) {
             output.status = TRY_ERROR;
-            output.error.location = keyword.value;
-            output.error.desc = "Control statement should be ended by a ';'";
+            output.error.location = pos < span.end ? token_span_str(span, pos, span.end) : tokens[pos - 1].str;
+            output.error.desc = "Control statement needs condition in ()";
             return output;
         }
-        ConstString_t following;
-        following.begin = keyword.value.end;
-        following.end = semicolon.value.begin;
-        TryConstString_t ws = find_whitespace(following);
-        following = strip_whitespace(following);
-        if (following.begin != following.end) {
-            if (control.variant == CONTROL_RETURN) {
-                TryExpression_t expr = parse_right_expression(following);
-                GrammarPropagateError(expr, output);
-                if (expr.status == TRY_NONE) {
-                    output.status = TRY_ERROR;
-                    output.error.location = following;
-                    output.error.desc = "return accepts only right expressions";
-                    return output;
-                }
-                control.ret = expr.value;
-            }
-            else {
-                output.status = TRY_ERROR;
-                output.error.location = following;
-                output.error.desc = "break/continue does not accept data";
-                return output;
-            }
-        }
-        else if (control.variant == CONTROL_RETURN) {
-            control.ret.variant = EXPRESSION_VOID;
-        }
-        output.status = TRY_SUCCESS;
-        output.value.control = malloc(sizeof(Control_t));
-        *output.value.control = control;
-        output.value.str.begin = working.begin;
-        output.value.str.end = semicolon.value.end;
-        stmt_str->end = semicolon.value.end;
+        closing = span.match[pos];
+        TryStatement_t clauses = parse_for_clauses_token_span(sub_span(span, pos + 1, closing), &control);
+        GrammarPropagateError(clauses, output);
+        pos = closing + 1;
+    }
+
+    size_t exec_end;
+    TryStatement_t exec = parse_statement_token_span(sub_span(span, pos, span.end), errors, &exec_end);
+    GrammarPropagateError(exec, output);
+    if (exec.status == TRY_NONE) {
+        output.status = TRY_ERROR;
+        output.error.location = token_span_str(span, span.begin, pos < span.end ? exec_end : pos);
+        output.error.desc = "Control needs a scope";
         return output;
     }
+    control.exec = exec.value;
+    pos = exec_end;
 
-    if ((keyword = find_string(working, const_string_from_cstr("if"))).status == TRY_SUCCESS) {
-        output.value.variant = STATEMENT_CONTROL;
-        control.variant = CONTROL_IF;
-    }
-    else if ((keyword = find_string(working, const_string_from_cstr("for"))).status == TRY_SUCCESS) {
-        output.value.variant = STATEMENT_CONTROL;
-        control.variant = CONTROL_FOR;
-    }
-    else if ((keyword = find_string(working, const_string_from_cstr("while"))).status == TRY_SUCCESS) {
-        output.value.variant = STATEMENT_CONTROL;
-        control.variant = CONTROL_WHILE;
-    }
-    else if ((keyword = find_string(working, const_string_from_cstr("do"))).status == TRY_SUCCESS) {
-        output.value.variant = STATEMENT_CONTROL;
-        control.variant = CONTROL_DO;
-    }
-    if (output.value.variant == STATEMENT_CONTROL) {
-        ConstString_t cont_working = strip_whitespace(strip(working, keyword.value).value);
-        if (control.variant == CONTROL_IF || control.variant == CONTROL_WHILE || control.variant == CONTROL_FOR) {
-            TryConstString_t cond_str = find_closing(cont_working, '(', ')');
-            GrammarPropagateError(cond_str, output);
-            if (cond_str.status == TRY_NONE) {
-                output.status = TRY_ERROR;
-                output.error.location = cont_working;
-                output.error.desc = "Control statement needs condition in ()";
-                return output;
-            }
-            cont_working = strip_whitespace(strip(cont_working, cond_str.value).value);
-            cond_str.value.begin += 1;
-            cond_str.value.end -= 1;
-            if (control.variant == CONTROL_IF || control.variant == CONTROL_WHILE) {
-                TryExpression_t cond = parse_right_expression(cond_str.value);
-                GrammarPropagateError(cond_str, output);
-                if (cond.status == TRY_NONE) {
-                    output.status = TRY_ERROR;
-                    output.error.location = cond_str.value;
-                    output.error.desc = "Control statement needs a condition in ()";
-                    return output;
-                }
-                control.condition = cond.value;
-            }
-            else {
-                ConstString_t init_str, check_str, inc_str;
-                TryConstString_t semicolon1_str = find_string_nesting_sensitive(cond_str.value, const_string_from_cstr(";"));
-                GrammarPropagateError(semicolon1_str, output);
-                if (semicolon1_str.status == TRY_NONE) {
-                    output.status = TRY_ERROR;
-                    output.error.location = cond_str.value;
-                    output.error.desc = "For statement needs a first ';'";
-                    return output;
-                }
-                init_str.begin = cond_str.value.begin;
-                init_str.end = semicolon1_str.value.begin;
-                cond_str.value.begin = semicolon1_str.value.end;
-                TryConstString_t semicolon2_str = find_string_nesting_sensitive(cond_str.value, const_string_from_cstr(";"));
-                GrammarPropagateError(semicolon2_str, output);
-                if (semicolon2_str.status == TRY_NONE) {
-                    output.status = TRY_ERROR;
-                    output.error.location = cond_str.value;
-                    output.error.desc = "For statement needs a second ';'";
-                    return output;
-                }
-                check_str.begin = semicolon1_str.value.end;
-                check_str.end = semicolon2_str.value.begin;
-                inc_str.begin = semicolon2_str.value.end;
-                inc_str.end = cond_str.value.end;
-                TryExpression_t init_expr = parse_right_expression(init_str);
-                GrammarPropagateError(init_expr, output);
-                if (init_expr.status == TRY_NONE) {
-                    control.ctrl_for.init = NULL;
-                }
-                else {
-                    control.ctrl_for.init = malloc(sizeof(Expression_t));
-                    *control.ctrl_for.init = init_expr.value;
-                }
-                TryExpression_t cond_expr = parse_right_expression(check_str);
-                GrammarPropagateError(cond_expr, output);
-                if (cond_expr.status == TRY_NONE) {
-                    control.condition.variant = EXPRESSION_UINT_LIT;
-                    control.condition.uint_lit = 1;
-                }
-                else {
-                    control.condition = cond_expr.value;
-                }
-                TryExpression_t inc_expr = parse_right_expression(inc_str);
-                GrammarPropagateError(inc_expr, output);
-                if (inc_expr.status == TRY_NONE) {
-                    control.ctrl_for.increment = NULL;
-                }
-                else {
-                    control.ctrl_for.increment = malloc(sizeof(Expression_t));
-                    *control.ctrl_for.increment = inc_expr.value;
-                }
-            }
+    if (control.variant == CONTROL_DO) {
+        if (pos == span.end || tokens[pos].keyword != KEYWORD_WHILE) {
+            output.status = TRY_ERROR;
+            output.error.location = token_span_str(span, span.begin, pos);
+            output.error.desc = "Do statement needs a while condition";
+            return output;
         }
-        ConstString_t exec_str;
-        TryStatement_t exec = parse_statement(cont_working, errors, &exec_str);
-        GrammarPropagateError(exec, output);
-        if (exec.status == TRY_NONE) {
+        TryExpression_t cond = parse_condition_token_span(span, pos + 1, &closing);
+        GrammarPropagateError(cond, output);
+        pos = closing + 1;
+        if (pos == span.end || !is_punctuator(&tokens[pos], ";")) {
             output.status = TRY_ERROR;
-            output.error.location = cont_working;
-            output.error.desc = "Control needs a scope";
+            output.error.location = token_span_str(span, span.begin, pos);
+            output.error.desc = "Control statement should be ended by a ';'";
             return output;
         }
-        control.exec = exec.value;
-        output.value.str.begin = working.begin;
-        output.value.str.end = exec_str.end;
-        if (control.variant == CONTROL_IF) {
-            control.ctrl_if.continuation = NULL;
-            ConstString_t continuation_str;
-            continuation_str.begin = exec_str.end;
-            continuation_str.end = working.end;
-            continuation_str = strip_whitespace(continuation_str);
-            TryConstString_t else_str = find_string(continuation_str, const_string_from_cstr("else"));
-            if (else_str.status == TRY_SUCCESS) {
-                continuation_str = strip(continuation_str, else_str.value).value;
-                TryConstString_t id_str = find_identifier(continuation_str);
-                if (id_str.status == TRY_NONE) {
-                    ConstString_t scope_str;
-                    TryStatement_t else_stmt = parse_statement(continuation_str, errors, &scope_str);
-                    GrammarPropagateError(else_stmt, output);
-                    if (else_stmt.status == TRY_NONE) {
-                        output.status = TRY_ERROR;
-                        output.error.location = cont_working;
-                        output.error.desc = "Else needs a scope";
-                        return output;
-                    }
-                    control.ctrl_if.continuation = malloc(sizeof(Statement_t));
-                    *control.ctrl_if.continuation = else_stmt.value;
-                    output.value.str.end = scope_str.end;
-                }
+        control.condition = cond.value;
+        ++pos;
+    }
+    if (control.variant == CONTROL_IF) {
+        control.ctrl_if.continuation = NULL;
+        if (pos < span.end && tokens[pos].keyword == KEYWORD_ELSE) {
+            size_t else_end;
+            TryStatement_t else_stmt = parse_statement_token_span(sub_span(span, pos + 1, span.end), errors, &else_end);
+            GrammarPropagateError(else_stmt, output);
+            if (else_stmt.status == TRY_NONE) {
+                output.status = TRY_ERROR;
+                output.error.location = tokens[pos].str;
+                output.error.desc = "Else needs a scope";
+                return output;
             }
+            control.ctrl_if.continuation = parse_alloc(sizeof(Statement_t));
+            *control.ctrl_if.continuation = else_stmt.value;
+            pos = else_end;
         }
+    }
+    output.status = TRY_SUCCESS;
+    output.value.variant = STATEMENT_CONTROL;
+    output.value.control = parse_alloc(sizeof(Control_t));
+    *output.value.control = control;
+    output.value.str = token_span_str(span, span.begin, pos);
+    *stmt_end = pos;
+    return output;
+}
+
+/**
+ * Parse a function definition whose body opens at token `brace`
+ *  NONE: the tokens before the brace do not declare a named function
+ */
+static TryStatement_t parse_function_token_span(const TokenSpan_t span, const size_t brace, ErrorLinkedListNode_t ***const errors, size_t *const stmt_end) {
+    TryStatement_t output;
+    ParseCheckpoint_t checkpoint = parse_checkpoint();
+    TryVariable_t signature = parse_variable_token_span(sub_span(span, span.begin, brace));
+    if (    signature.status != TRY_SUCCESS ||
+            !signature.value.has_name ||
+            signature.value.type->variant != DERIVED_TYPE_FUNCTION) {
+        parse_rollback(checkpoint);
+        output.status = TRY_NONE;
+        return output;
+    }
+    const size_t closing = span.match[brace];
+    TryScope_t scope = parse_scope_token_span(sub_span(span, brace + 1, closing), errors);
+    GrammarPropagateError(scope, output);
+    Function_t *function = parse_alloc(sizeof(Function_t));
+    function->signature = signature.value;
+    function->scope = scope.value;
+    output.status = TRY_SUCCESS;
+    output.value.variant = STATEMENT_FUNCTION;
+    output.value.function = function;
+    output.value.str = token_span_str(span, span.begin, closing + 1);
+    *stmt_end = closing + 1;
+    return output;
+}
+
+/**
+ * Parse the statement at the beginning of a span, and give the index of the
+ * token after it
+ *  SUCCESS: a statement was parsed
+ *  NONE: a statement was not found; an error was appended and `stmt_end` is
+ *        past its ';', so that parsing can go on with the next statement
+ *  ERROR: there was an error with statement syntax
+ */
+static TryStatement_t parse_statement_token_span(const TokenSpan_t span, ErrorLinkedListNode_t ***const errors, size_t *const stmt_end) {
+    TryStatement_t output;
+    const Token_t *tokens = span.tokens;
+    const size_t pos = span.begin;
+    if (pos == span.end) {
+        output.status = TRY_NONE;
+        return output;
+    }
+
+    if (is_punctuator(&tokens[pos], "{")) {
+        const size_t closing = span.match[pos];
+        TryScope_t scope = parse_scope_token_span(sub_span(span, pos + 1, closing), errors);
+        GrammarPropagateError(scope, output);
         output.status = TRY_SUCCESS;
-        output.value.control = malloc(sizeof(Control_t));
-        *output.value.control = control;
-        stmt_str->end = output.value.str.end;
+        output.value.variant = STATEMENT_SCOPE;
+        output.value.scope = parse_alloc(sizeof(Scope_t));
+        *output.value.scope = scope.value;
+        output.value.str = token_span_str(span, pos, closing + 1);
+        *stmt_end = closing + 1;
         return output;
     }
 
-    TryConstString_t parens = find_string_nesting_sensitive(working, const_string_from_cstr("("));
-    GrammarPropagateError(parens, output);
-    if (parens.status == TRY_SUCCESS) {
-        ConstString_t func_str;
-        func_str.begin = parens.value.begin;
-        func_str.end = working.end;
-        parens = find_closing(func_str, '(', ')');
-        if (parens.status == TRY_SUCCESS) {
-            func_str = strip(func_str, parens.value).value;
-            TryConstString_t braces = find_string_nesting_sensitive(working, const_string_from_cstr("{"));
-            if (braces.status == TRY_SUCCESS) {
-                func_str.begin = braces.value.begin;
-                braces = find_closing(func_str, '{', '}');
-                if (braces.status == TRY_SUCCESS) {
-                    ConstString_t func_sig;
-                    func_sig.begin = working.begin;
-                    func_sig.end = braces.value.begin;
-                    ConstString_t scope_str;
-                    scope_str.begin = braces.value.begin + 1;
-                    scope_str.end = braces.value.end - 1;
+    switch (tokens[pos].keyword) {
+        case KEYWORD_BREAK:
+        case KEYWORD_CONTINUE:
+        case KEYWORD_RETURN:
+            return parse_jump_token_span(span, stmt_end);
+        case KEYWORD_IF:
+        case KEYWORD_FOR:
+        case KEYWORD_WHILE:
+        case KEYWORD_DO:
+            return parse_control_token_span(span, errors, stmt_end);
+        default:
+            break;
+    }
 
-                    TryVariable_t signature = parse_variable(func_sig);
-                    if (    signature.status == TRY_SUCCESS &&
-                            signature.value.has_name &&
-                            signature.value.type->variant == DERIVED_TYPE_FUNCTION) {
-                        TryScope_t scope = parse_scope(scope_str, errors);
-                        if (scope.status == TRY_SUCCESS) {
-                            Function_t *function = malloc(sizeof(Function_t));
-                            function->signature = signature.value;
-                            function->scope = scope.value;
-                            output.status = TRY_SUCCESS;
-                            output.value.variant = STATEMENT_FUNCTION;
-                            output.value.function = function;
-                            stmt_str->end = braces.value.end;
-                            output.value.str.begin = working.begin;
-                            output.value.str.end = braces.value.end;
-                            return output;
-                        }
-                    }
-                }
-            }
+    // A '{' before the ';' either opens a function body or belongs to the
+    // statement, such as the fields of a struct
+    size_t brace = pos;
+    while (brace < span.end && !is_punctuator(&tokens[brace], ";") && !is_punctuator(&tokens[brace], "{")) {
+        brace = span.match[brace] != NO_TOKEN_MATCH ? span.match[brace] + 1 : brace + 1;
+    }
+    if (brace < span.end && is_punctuator(&tokens[brace], "{") && find_token(sub_span(span, pos, brace), pos, "(") < brace) {
+        output = parse_function_token_span(span, brace, errors, stmt_end);
+        if (output.status != TRY_NONE) {
+            return output;
         }
     }
+    const size_t semicolon = find_token(span, brace, ";");
 
-    TryConstString_t semicolon = find_string_nesting_sensitive(working, const_string_from_cstr(";"));
-    GrammarPropagateError(semicolon, output);
-    if (semicolon.status == TRY_NONE) {
+    if (semicolon == span.end) {
         output.status = TRY_ERROR;
-        output.error.location = str;
+        output.error.location = token_span_str(span, pos, span.end);
         output.error.desc = "Expected a semicolon";
         return output;
     }
-    stmt_str->end = semicolon.value.end;
-    ConstString_t op_str;
-    op_str.begin = working.begin;
-    op_str.end = semicolon.value.begin;
-    TryOperator_t op = parse_operator(op_str);
+    *stmt_end = semicolon + 1;
+    const TokenSpan_t op_span = sub_span(span, pos, semicolon);
+    TryOperator_t op = parse_operator_token_span(op_span);
     if (op.status == TRY_SUCCESS) {
         output.status = TRY_SUCCESS;
-        output.value.str.begin = op_str.begin;
-        output.value.str.end = semicolon.value.end;
+        output.value.str = token_span_str(span, pos, semicolon + 1);
         output.value.variant = STATEMENT_OPERATOR;
-        output.value.operator = malloc(sizeof(Operator_t));
+        output.value.operator = new_operator();
         *output.value.operator = op.value;
         return output;
     }
     else {
-        TryVariable_t var = parse_variable(op_str);
+        ParseCheckpoint_t checkpoint = parse_checkpoint();
+        TryVariable_t var = parse_variable_token_span(op_span);
         output.value.variant = STATEMENT_DECLARATION;
         if (var.status != TRY_SUCCESS) {
-            var = parse_typedef(op_str);
+            parse_rollback(checkpoint);
+            var = parse_typedef_token_span(op_span);
             output.value.variant = STATEMENT_TYPEDEF;
         }
         if (var.status == TRY_SUCCESS && var.value.has_name) {
             output.status = TRY_SUCCESS;
-            output.value.str.begin = op_str.begin;
-            output.value.str.end = semicolon.value.end;
-            output.value.declaration = malloc(sizeof(Variable_t));
+            output.value.str = token_span_str(span, pos, semicolon + 1);
+            output.value.declaration = parse_alloc(sizeof(Variable_t));
             *output.value.declaration = var.value;
             return output;
         }
         else {
-            **errors = malloc(sizeof(ErrorLinkedListNode_t));
+            parse_rollback(checkpoint);
+            **errors = parse_alloc(sizeof(ErrorLinkedListNode_t));
             (**errors)->next = NULL;
-            (**errors)->value.location = op_str;
+            (**errors)->value.location = token_span_str(span, pos, semicolon + 1);
             if (var.status == TRY_ERROR) {
                 (**errors)->value.desc = var.error.desc;
             }
@@ -356,130 +405,188 @@ TryStatement_t parse_statement(const ConstString_t str, ErrorLinkedListNode_t **
     return output;
 }
 
+TryScope_t parse_scope_token_span(const TokenSpan_t span, ErrorLinkedListNode_t ***const errors) {
+    TryScope_t output;
+    SpanBuilder_t statements = new_span_builder(sizeof(Statement_t));
+    size_t pos = span.begin;
+    while (pos < span.end) {
+        size_t stmt_end;
+        TryStatement_t stmt = parse_statement_token_span(sub_span(span, pos, span.end), errors, &stmt_end);
+        if (stmt.status == TRY_ERROR) {
+            free_span_builder(&statements);
+            GrammarPropagateError(stmt, output);
+        }
+        pos = stmt_end;
+        if (stmt.status == TRY_SUCCESS) {
+            *(Statement_t *)span_builder_push(&statements) = stmt.value;
+        }
+    }
+    output.value.statements.items = finish_span(&statements);
+    output.value.statements.size = statements.size;
+    output.status = TRY_SUCCESS;
+    return output;
+}
+
+/**
+ * Match the brackets of a whole token range and parse it as a scope
+ */
+static TryScope_t parse_scope_token_range(const TokenRange_t tokens, ErrorLinkedListNode_t ***const errors) {
+    TryScope_t output;
+    uint32_t *match = malloc((tokens.end - tokens.begin) * sizeof(uint32_t));
+    if (tokens.begin != tokens.end && !match_token_brackets(tokens, match)) {
+        free(match);
+        output.status = TRY_ERROR;
+        output.error.location = token_range_str(tokens);
+        output.error.desc = "Unbalanced brackets";
+        return output;
+    }
+    TokenSpan_t span;
+    span.tokens = tokens.begin;
+    span.match = match;
+    span.begin = 0;
+    span.end = tokens.end - tokens.begin;
+    output = parse_scope_token_span(span, errors);
+    free(match);
+    return output;
+}
+
 TryScope_t parse_scope(const ConstString_t str, ErrorLinkedListNode_t ***const errors) {
     TryScope_t output;
+    WithSourceIndex(str, output, parse_scope(str, errors));
     if (str.begin == str.end) {
         output.status = TRY_NONE;
         return output;
     }
-    output.status = TRY_SUCCESS;
-    output.value.statements = NULL;
-    StatementLinkedListNode_t **stmt_head = &output.value.statements;
-    ConstString_t working = str;
-    working = strip_whitespace(working);
-    while (working.begin < working.end) {
-        ConstString_t stmt_str;
-        TryStatement_t stmt = parse_statement(working, errors, &stmt_str);
-        GrammarPropagateError(stmt, output);
-        working = strip_whitespace(strip(working, stmt_str).value);
-        if (stmt.status == TRY_SUCCESS) {
-            *stmt_head = malloc(sizeof(StatementLinkedListNode_t));
-            (*stmt_head)->next = NULL;
-            (*stmt_head)->value = stmt.value;
-            stmt_head = &(*stmt_head)->next;
-        }
-    }
-    output.status = TRY_SUCCESS;
+    TryTokenArray_t tokens = lex(str);
+    GrammarPropagateError(tokens, output);
+    output = parse_scope_token_range(token_range_from_array(&tokens.value), errors);
+    free_token_array(&tokens.value);
     return output;
 }
 
-size_t print_scope(char *buffer, const Scope_t *const scope, const int32_t depth) {
-    buffer[0] = 0;
-    size_t num_chars = 0;
-    const StatementLinkedListNode_t *statement = scope->statements;
-    if (statement) {
+TryScope_t parse_file(const char *const path, ParseContext_t *const context, ErrorLinkedListNode_t ***const errors) {
+    TryScope_t output;
+    TryConstString_t source = map_source_file(context, path);
+    GrammarPropagateError(source, output);
+    ParseContext_t *prev_context = attach_parse_context(context);
+    const bool prev_zero_copy = context->zero_copy;
+    context->zero_copy = true;
+    output = parse_scope(source.value, errors);
+    context->zero_copy = prev_zero_copy;
+    attach_parse_context(prev_context);
+    return output;
+}
+
+TryScope_t parse_scope_tokens(const TokenRange_t tokens, ErrorLinkedListNode_t ***const errors) {
+    TryScope_t output;
+    if (tokens.begin == tokens.end) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    WithSourceIndex(token_range_str(tokens), output, parse_scope_tokens(tokens, errors));
+    return parse_scope_token_range(tokens, errors);
+}
+
+size_t print_scope(Sink_t *const sink, const Scope_t *const scope, const int32_t depth) {
+    const size_t begin = sink->written;
+    if (scope->statements.size) {
         if (depth >= 0) {
-            num_chars += sprintf(buffer, "{\n");
+            sink_puts(sink, "{\n");
         }
-        while (statement) {
-            num_chars += sprintf(buffer + num_chars, "%*s", (depth + 1) * 4, "");
-            num_chars += print_statement(buffer + num_chars, &statement->value, depth + 1);
-            num_chars += sprintf(buffer + num_chars, "\n");
-            statement = statement->next;
+        for (uint32_t i = 0; i < scope->statements.size; ++i) {
+            sink_printf(sink, "%*s", (depth + 1) * 4, "");
+            print_statement(sink, &scope->statements.items[i], depth + 1);
+            sink_puts(sink, "\n");
         }
         if (depth >= 0) {
-            num_chars += sprintf(buffer + num_chars, "%*s}", 4 * depth, "");
+            sink_printf(sink, "%*s}", 4 * depth, "");
         }
     }
     else {
         if (depth >= 0) {
-            num_chars += sprintf(buffer, "{ }");
+            sink_puts(sink, "{ }");
         }
     }
-    return num_chars;
+    return sink->written - begin;
 }
 
-size_t print_statement(char *buffer, const Statement_t *const stmt, const int32_t depth) {
-    buffer[0] = 0;
-    size_t num_chars = 0;
+size_t print_statement(Sink_t *const sink, const Statement_t *const stmt, const int32_t depth) {
+    const size_t begin = sink->written;
     switch (stmt->variant) {
         case STATEMENT_OPERATOR:
-            num_chars += print_operator(buffer + num_chars, stmt->operator);
-            num_chars += sprintf(buffer + num_chars, ";");
+            print_operator(sink, stmt->operator);
+            sink_puts(sink, ";");
             break;
         case STATEMENT_SCOPE:
-            num_chars += print_scope(buffer + num_chars, stmt->scope, depth);
+            print_scope(sink, stmt->scope, depth);
             break;
         case STATEMENT_DECLARATION:
-            num_chars += print_variable(buffer + num_chars, stmt->declaration);
-            num_chars += sprintf(buffer + num_chars, ";");
+            print_variable(sink, stmt->declaration);
+            sink_puts(sink, ";");
             break;
         case STATEMENT_CONTROL:
             switch (stmt->control->variant) {
                 case CONTROL_IF:
-                    num_chars += sprintf(buffer + num_chars, "if (");
-                    num_chars += print_expression(buffer + num_chars, &stmt->control->condition, NULL);
-                    num_chars += sprintf(buffer + num_chars, ") ");
-                    num_chars += print_statement(buffer + num_chars, &stmt->control->exec, depth);
+                    sink_puts(sink, "if (");
+                    print_expression(sink, &stmt->control->condition, NULL);
+                    sink_puts(sink, ") ");
+                    print_statement(sink, &stmt->control->exec, depth);
                     if (stmt->control->ctrl_if.continuation) {
-                        num_chars += sprintf(buffer + num_chars, "\n%*selse ", depth * 4, "");
-                        num_chars += print_statement(buffer + num_chars, stmt->control->ctrl_if.continuation, depth);
+                        sink_printf(sink, "\n%*selse ", depth * 4, "");
+                        print_statement(sink, stmt->control->ctrl_if.continuation, depth);
                     }
                     break;
                 case CONTROL_WHILE:
-                    num_chars += sprintf(buffer + num_chars, "while (");
-                    num_chars += print_expression(buffer + num_chars, &stmt->control->condition, NULL);
-                    num_chars += sprintf(buffer + num_chars, ") ");
-                    num_chars += print_statement(buffer + num_chars, &stmt->control->exec, depth);
+                    sink_puts(sink, "while (");
+                    print_expression(sink, &stmt->control->condition, NULL);
+                    sink_puts(sink, ") ");
+                    print_statement(sink, &stmt->control->exec, depth);
+                    break;
+                case CONTROL_DO:
+                    sink_puts(sink, "do ");
+                    print_statement(sink, &stmt->control->exec, depth);
+                    sink_puts(sink, " while (");
+                    print_expression(sink, &stmt->control->condition, NULL);
+                    sink_puts(sink, ");");
                     break;
                 case CONTROL_FOR:
-                    num_chars += sprintf(buffer + num_chars, "for (");
-                    num_chars += print_expression(buffer + num_chars, stmt->control->ctrl_for.init, NULL);
-                    num_chars += sprintf(buffer + num_chars, "; ");
-                    num_chars += print_expression(buffer + num_chars, &stmt->control->condition, NULL);
-                    num_chars += sprintf(buffer + num_chars, "; ");
-                    num_chars += print_expression(buffer + num_chars, stmt->control->ctrl_for.increment, NULL);
-                    num_chars += sprintf(buffer + num_chars, ") ");
-                    num_chars += print_statement(buffer + num_chars, &stmt->control->exec, depth);
+                    sink_puts(sink, "for (");
+                    print_expression(sink, stmt->control->ctrl_for.init, NULL);
+                    sink_puts(sink, "; ");
+                    print_expression(sink, &stmt->control->condition, NULL);
+                    sink_puts(sink, "; ");
+                    print_expression(sink, stmt->control->ctrl_for.increment, NULL);
+                    sink_puts(sink, ") ");
+                    print_statement(sink, &stmt->control->exec, depth);
                     break;
                 case CONTROL_BREAK:
-                    num_chars += sprintf(buffer + num_chars, "break;");
+                    sink_puts(sink, "break;");
                     break;
                 case CONTROL_CONTINUE:
-                    num_chars += sprintf(buffer + num_chars, "continue;");
+                    sink_puts(sink, "continue;");
                     break;
                 case CONTROL_RETURN:
                     if (stmt->control->ret.variant == EXPRESSION_VOID) {
-                        num_chars += sprintf(buffer + num_chars, "return;");
+                        sink_puts(sink, "return;");
                     }
                     else {
-                        num_chars += sprintf(buffer + num_chars, "return ");
-                        num_chars += print_expression(buffer + num_chars, &stmt->control->ret, NULL);
-                        num_chars += sprintf(buffer + num_chars, ";");
+                        sink_puts(sink, "return ");
+                        print_expression(sink, &stmt->control->ret, NULL);
+                        sink_puts(sink, ";");
                     }
                     break;
             }
             break;
         case STATEMENT_TYPEDEF:
-            num_chars += sprintf(buffer + num_chars, "typedef ");
-            num_chars += print_variable(buffer + num_chars, stmt->tdef);
-            num_chars += sprintf(buffer + num_chars, ";");
+            sink_puts(sink, "typedef ");
+            print_variable(sink, stmt->tdef);
+            sink_puts(sink, ";");
             break;
         case STATEMENT_FUNCTION:
-            num_chars += print_variable(buffer + num_chars, &stmt->function->signature);
-            num_chars += sprintf(buffer + num_chars, " ");
-            num_chars += print_scope(buffer + num_chars, &stmt->function->scope, depth);
+            print_variable(sink, &stmt->function->signature);
+            sink_puts(sink, " ");
+            print_scope(sink, &stmt->function->scope, depth);
             break;
     }
-    return num_chars;
+    return sink->written - begin;
 }
\ No newline at end of file
@@ -0,0 +1,1046 @@
+#include "grammar.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define AST_FILE_MAGIC "METACAST"
+#define AST_FILE_VERSION 8
+#define AST_FILE_NO_LOCATION UINT32_MAX
+
+/**
+ * Sections are 8-byte aligned and placed by their offset from the start of
+ * the file; every offset inside a section is 32-bit and relative to the
+ * section it points into
+ */
+typedef struct {
+    uint64_t offset;
+    uint64_t size; // In bytes
+} AstFileSection_t;
+
+/**
+ * Locations are offsets into the source, or AST_FILE_NO_LOCATION
+ */
+typedef struct {
+    uint32_t desc; // NUL-terminated, in the text section
+    uint32_t begin;
+    uint32_t end;
+} AstFileDiagnostic_t;
+
+typedef struct {
+    uint32_t offset; // In the text section
+    uint32_t len;
+} AstFileSymbol_t;
+
+/**
+ * Nodes are stored as images of their structs, and each pointer field holds
+ * in place what it points to:
+ *  - nodes and spans of nodes: their offset in `nodes`, where 0 is NULL
+ *  - derived types: their index + 1 in `types`, a DerivedType_t array, so
+ *    that shared (canonical) types are stored once
+ *  - symbols: their index + 1 in `symbols`
+ *  - text, like array sizes: offsets of its ends in `text`
+ *  - locations: offsets of their ends in the source, which is only copied
+ *    into the file if asked to, and otherwise identified by its length and
+ *    hash
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t status; // GrammarTryStatusVariant_t of the stored result
+    uint64_t size;
+    uint64_t source_len;
+    uint64_t source_hash;
+    AstFileSection_t source; // Empty when the source was not copied
+    AstFileSection_t nodes;
+    AstFileSection_t types;
+    AstFileSection_t text;
+    AstFileSection_t symbols; // AstFileSymbol_t per symbol
+    AstFileSection_t diagnostics; // AstFileDiagnostic_t per appended error
+    uint64_t root; // Scope_t in `nodes` for a TRY_SUCCESS result
+    AstFileDiagnostic_t error; // For a TRY_ERROR result
+} AstFileHeader_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} Section_t;
+
+/**
+ * Open-addressed map from derived types to their index + 1, so that shared
+ * types are written once and stay shared when loaded
+ */
+typedef struct {
+    const DerivedType_t **keys;
+    uint64_t *values;
+    size_t capacity; // Always a power of 2
+    size_t size;
+} TypeIndexMap_t;
+
+typedef struct {
+    Section_t nodes;
+    Section_t types;
+    Section_t text;
+    Section_t diagnostics;
+    uint32_t *symbol_index; // By symbol id, index + 1 or 0 if not yet written
+    const Symbol_t **symbols;
+    uint32_t n_symbols;
+    uint32_t symbols_capacity;
+    TypeIndexMap_t type_index;
+    ConstString_t source;
+} AstWriter_t;
+
+static uint64_t append(Section_t *const section, const void *const bytes, const size_t size, const size_t alignment) {
+    const size_t offset = (section->size + alignment - 1) & ~(alignment - 1);
+    if (offset + size > section->capacity) {
+        size_t capacity = section->capacity ? section->capacity : 0x1000;
+        while (offset + size > capacity) {
+            capacity *= 2;
+        }
+        section->data = realloc(section->data, capacity);
+        section->capacity = capacity;
+    }
+    memset(section->data + section->size, 0, offset - section->size);
+    if (bytes) {
+        memcpy(section->data + offset, bytes, size);
+    }
+    else {
+        memset(section->data + offset, 0, size);
+    }
+    section->size = offset + size;
+    return offset;
+}
+
+static uint64_t write_node(AstWriter_t *const w, const void *const node, const size_t size) {
+    return append(&w->nodes, node, size, 8);
+}
+
+/**
+ * Overwrite the pointer field at `field` with what it stands for in the file
+ */
+static void set_field(Section_t *const section, const uint64_t field, const uint64_t value) {
+    memcpy(section->data + field, &value, sizeof(uint64_t));
+}
+
+static void set_symbol(AstWriter_t *const w, Section_t *const section, const uint64_t field, const Symbol_t *const symbol) {
+    uint64_t value = 0;
+    if (symbol) {
+        if (!w->symbol_index[symbol->id]) {
+            if (w->n_symbols == w->symbols_capacity) {
+                w->symbols_capacity = w->symbols_capacity ? 2 * w->symbols_capacity : 256;
+                w->symbols = realloc(w->symbols, w->symbols_capacity * sizeof(Symbol_t *));
+            }
+            w->symbols[w->n_symbols++] = symbol;
+            w->symbol_index[symbol->id] = w->n_symbols;
+        }
+        value = w->symbol_index[symbol->id];
+    }
+    set_field(section, field, value);
+}
+
+/**
+ * Locations are views into the source; those outside of it cannot be kept
+ */
+static void set_location(AstWriter_t *const w, Section_t *const section, const uint64_t field, const ConstString_t str) {
+    const bool inside =
+        w->source.begin && str.begin &&
+        w->source.begin <= str.begin && str.end <= w->source.end;
+    set_field(section, field + offsetof(ConstString_t, begin), inside ? (uint64_t)(str.begin - w->source.begin) : AST_FILE_NO_LOCATION);
+    set_field(section, field + offsetof(ConstString_t, end), inside ? (uint64_t)(str.end - w->source.begin) : AST_FILE_NO_LOCATION);
+}
+
+static uint64_t write_text(AstWriter_t *const w, const char *const begin, const size_t len) {
+    const uint64_t text = append(&w->text, NULL, len + 1, 1);
+    memcpy(w->text.data + text, begin, len);
+    return text;
+}
+
+static void set_text(AstWriter_t *const w, Section_t *const section, const uint64_t field, const AConstString_t str) {
+    const size_t len = str.end - str.begin;
+    const uint64_t text = write_text(w, str.begin, len);
+    set_field(section, field + offsetof(AConstString_t, begin), text);
+    set_field(section, field + offsetof(AConstString_t, end), text + len);
+}
+
+static uint64_t *find_type_index(TypeIndexMap_t *const map, const DerivedType_t *const der) {
+    const size_t mask = map->capacity - 1;
+    size_t i = ((uintptr_t)der >> 4) & mask;
+    while (map->keys[i] && map->keys[i] != der) {
+        i = (i + 1) & mask;
+    }
+    map->keys[i] = der;
+    return &map->values[i];
+}
+
+static void grow_type_index(TypeIndexMap_t *const map) {
+    TypeIndexMap_t grown;
+    grown.capacity = map->capacity ? 2 * map->capacity : 256;
+    grown.size = map->size;
+    grown.keys = calloc(grown.capacity, sizeof(DerivedType_t *));
+    grown.values = calloc(grown.capacity, sizeof(uint64_t));
+    for (size_t i = 0; i < map->capacity; ++i) {
+        if (map->keys[i]) {
+            *find_type_index(&grown, map->keys[i]) = map->values[i];
+        }
+    }
+    free(map->keys);
+    free(map->values);
+    *map = grown;
+}
+
+static void write_statement_fields(AstWriter_t *const w, const uint64_t off, const Statement_t *const stmt);
+static void write_expression_fields(AstWriter_t *const w, const uint64_t off, const Expression_t *const expr);
+static uint64_t write_derived_type(AstWriter_t *const w, const DerivedType_t *const der);
+static uint64_t write_optional_expression(AstWriter_t *const w, const Expression_t *const expr);
+static uint64_t write_variable_span(AstWriter_t *const w, const VariableSpan_t span);
+
+static void write_variable_fields(AstWriter_t *const w, const uint64_t off, const Variable_t *const var) {
+    set_symbol(w, &w->nodes, off + offsetof(Variable_t, name), var->has_name ? var->name : NULL);
+    set_field(&w->nodes, off + offsetof(Variable_t, type), write_derived_type(w, var->type));
+    set_field(&w->nodes, off + offsetof(Variable_t, params.items), write_variable_span(w, var->params));
+}
+
+static uint64_t write_variable(AstWriter_t *const w, const Variable_t *const var) {
+    const uint64_t off = write_node(w, var, sizeof(Variable_t));
+    write_variable_fields(w, off, var);
+    return off;
+}
+
+static uint64_t write_variable_span(AstWriter_t *const w, const VariableSpan_t span) {
+    if (!span.size) {
+        return 0;
+    }
+    const uint64_t items = write_node(w, span.items, span.size * sizeof(Variable_t));
+    for (uint32_t i = 0; i < span.size; ++i) {
+        write_variable_fields(w, items + i * sizeof(Variable_t), &span.items[i]);
+    }
+    return items;
+}
+
+static void write_type_fields(AstWriter_t *const w, const uint64_t off, const Type_t *const type) {
+    set_location(w, &w->types, off + offsetof(Type_t, str), type->str);
+    switch (type->variant) {
+        case TYPE_PRIMITIVE:
+            break;
+        case TYPE_NAMED:
+            set_symbol(w, &w->types, off + offsetof(Type_t, named), type->named);
+            break;
+        default:
+            set_symbol(w, &w->types, off + offsetof(Type_t, compound.name), type->compound.has_name ? type->compound.name : NULL);
+            if (!type->compound.is_definition) {
+                set_field(&w->types, off + offsetof(Type_t, compound.su_fields.items), 0);
+            }
+            else if (type->variant == TYPE_ENUM) {
+                const EnumFieldSpan_t span = type->compound.e_fields;
+                uint64_t items = 0;
+                if (span.size) {
+                    items = write_node(w, span.items, span.size * sizeof(EnumField_t));
+                    for (uint32_t i = 0; i < span.size; ++i) {
+                        set_symbol(w, &w->nodes, items + i * sizeof(EnumField_t) + offsetof(EnumField_t, name), span.items[i].name);
+                    }
+                }
+                set_field(&w->types, off + offsetof(Type_t, compound.e_fields.items), items);
+            }
+            else {
+                const uint64_t items = write_variable_span(w, type->compound.su_fields);
+                set_field(&w->types, off + offsetof(Type_t, compound.su_fields.items), items);
+            }
+            break;
+    }
+}
+
+/**
+ * Types are written before their children, so a type's index is known when
+ * its children refer back to it through a struct's fields
+ */
+static uint64_t write_derived_type(AstWriter_t *const w, const DerivedType_t *const der) {
+    if (!der) {
+        return 0;
+    }
+    if (2 * (w->type_index.size + 1) > w->type_index.capacity) {
+        grow_type_index(&w->type_index);
+    }
+    uint64_t *slot = find_type_index(&w->type_index, der);
+    if (*slot) {
+        return *slot;
+    }
+    const uint64_t off = append(&w->types, der, sizeof(DerivedType_t), 8);
+    // IDs are given again when the type is interned on load
+    memset(w->types.data + off + offsetof(DerivedType_t, id), 0, sizeof(uint32_t));
+    const uint64_t index = off / sizeof(DerivedType_t) + 1;
+    // Set before the children are written, since they may grow the map
+    *slot = index;
+    ++w->type_index.size;
+    switch (der->variant) {
+        case DERIVED_TYPE_TERMINAL:
+            write_type_fields(w, off + offsetof(DerivedType_t, terminal.type), &der->terminal.type);
+            // Resolved names belong to flow, not to the AST
+            set_field(&w->types, off + offsetof(DerivedType_t, terminal.resolved), 0);
+            break;
+        case DERIVED_TYPE_POINTER:
+            set_field(&w->types, off + offsetof(DerivedType_t, pointer.inner_type), write_derived_type(w, der->pointer.inner_type));
+            break;
+        case DERIVED_TYPE_ARRAY:
+            set_field(&w->types, off + offsetof(DerivedType_t, array.inner_type), write_derived_type(w, der->array.inner_type));
+            if (der->array.has_size) {
+                set_text(w, &w->types, off + offsetof(DerivedType_t, array.size), der->array.size);
+            }
+            if (der->array.has_size && !der->array.is_size_constant) {
+                set_field(&w->types, off + offsetof(DerivedType_t, array.size_expr), write_optional_expression(w, der->array.size_expr));
+            }
+            break;
+        case DERIVED_TYPE_FUNCTION:
+            set_field(&w->types, off + offsetof(DerivedType_t, function.return_type), write_derived_type(w, der->function.return_type));
+            set_field(&w->types, off + offsetof(DerivedType_t, function.params.items), write_variable_span(w, der->function.params));
+            break;
+    }
+    return index;
+}
+
+static uint64_t write_operator(AstWriter_t *const w, const Operator_t *const op) {
+    const uint64_t off = write_node(w, op, sizeof(Operator_t));
+    // Operands alias pop/top/fop in order
+    struct Expression *const *operands = &op->pop;
+    for (uint8_t i = 0; i < op->n_operands; ++i) {
+        set_field(&w->nodes, off + offsetof(Operator_t, pop) + i * sizeof(struct Expression *), write_optional_expression(w, operands[i]));
+    }
+    return off;
+}
+
+static void write_expression_fields(AstWriter_t *const w, const uint64_t off, const Expression_t *const expr) {
+    switch (expr->variant) {
+        case EXPRESSION_OPERATOR:
+            set_field(&w->nodes, off + offsetof(Expression_t, operator), write_operator(w, expr->operator));
+            break;
+        case EXPRESSION_IDENTIFIER:
+        case EXPRESSION_STR_LIT:
+        case EXPRESSION_CHAR_LIT:
+            set_symbol(w, &w->nodes, off + offsetof(Expression_t, identifier), expr->identifier);
+            break;
+        case EXPRESSION_TYPE:
+            set_field(&w->nodes, off + offsetof(Expression_t, type), write_derived_type(w, expr->type));
+            break;
+        case EXPRESSION_DECLARATION:
+            set_field(&w->nodes, off + offsetof(Expression_t, decl), write_variable(w, expr->decl));
+            break;
+        case EXPRESSION_UINT_LIT:
+        case EXPRESSION_VOID:
+            break;
+    }
+}
+
+static uint64_t write_optional_expression(AstWriter_t *const w, const Expression_t *const expr) {
+    if (!expr) {
+        return 0;
+    }
+    const uint64_t off = write_node(w, expr, sizeof(Expression_t));
+    write_expression_fields(w, off, expr);
+    return off;
+}
+
+static void write_scope_fields(AstWriter_t *const w, const uint64_t off, const Scope_t *const scope) {
+    const StatementSpan_t span = scope->statements;
+    uint64_t items = 0;
+    if (span.size) {
+        items = write_node(w, span.items, span.size * sizeof(Statement_t));
+        for (uint32_t i = 0; i < span.size; ++i) {
+            write_statement_fields(w, items + i * sizeof(Statement_t), &span.items[i]);
+        }
+    }
+    set_field(&w->nodes, off + offsetof(Scope_t, statements.items), items);
+}
+
+static uint64_t write_scope(AstWriter_t *const w, const Scope_t *const scope) {
+    const uint64_t off = write_node(w, scope, sizeof(Scope_t));
+    write_scope_fields(w, off, scope);
+    return off;
+}
+
+static void write_control_fields(AstWriter_t *const w, const uint64_t off, const Control_t *const control) {
+    switch (control->variant) {
+        case CONTROL_IF:
+        case CONTROL_WHILE:
+        case CONTROL_DO:
+        case CONTROL_FOR:
+            write_expression_fields(w, off + offsetof(Control_t, condition), &control->condition);
+            write_statement_fields(w, off + offsetof(Control_t, exec), &control->exec);
+            if (control->variant == CONTROL_IF) {
+                uint64_t continuation = 0;
+                if (control->ctrl_if.continuation) {
+                    continuation = write_node(w, control->ctrl_if.continuation, sizeof(Statement_t));
+                    write_statement_fields(w, continuation, control->ctrl_if.continuation);
+                }
+                set_field(&w->nodes, off + offsetof(Control_t, ctrl_if.continuation), continuation);
+            }
+            else if (control->variant == CONTROL_FOR) {
+                set_field(&w->nodes, off + offsetof(Control_t, ctrl_for.init), write_optional_expression(w, control->ctrl_for.init));
+                set_field(&w->nodes, off + offsetof(Control_t, ctrl_for.increment), write_optional_expression(w, control->ctrl_for.increment));
+            }
+            break;
+        case CONTROL_RETURN:
+            write_expression_fields(w, off + offsetof(Control_t, ret), &control->ret);
+            break;
+        case CONTROL_BREAK:
+        case CONTROL_CONTINUE:
+            break;
+    }
+}
+
+static void write_statement_fields(AstWriter_t *const w, const uint64_t off, const Statement_t *const stmt) {
+    set_location(w, &w->nodes, off + offsetof(Statement_t, str), stmt->str);
+    uint64_t child = 0;
+    switch (stmt->variant) {
+        case STATEMENT_SCOPE:
+            child = write_scope(w, stmt->scope);
+            break;
+        case STATEMENT_CONTROL:
+            child = write_node(w, stmt->control, sizeof(Control_t));
+            write_control_fields(w, child, stmt->control);
+            break;
+        case STATEMENT_OPERATOR:
+            child = write_operator(w, stmt->operator);
+            break;
+        case STATEMENT_DECLARATION:
+        case STATEMENT_TYPEDEF:
+            child = write_variable(w, stmt->declaration);
+            break;
+        case STATEMENT_FUNCTION:
+            child = write_node(w, stmt->function, sizeof(Function_t));
+            write_variable_fields(w, child + offsetof(Function_t, signature), &stmt->function->signature);
+            write_scope_fields(w, child + offsetof(Function_t, scope), &stmt->function->scope);
+            break;
+    }
+    set_field(&w->nodes, off + offsetof(Statement_t, scope), child);
+}
+
+static void free_writer(AstWriter_t *const w) {
+    free(w->nodes.data);
+    free(w->types.data);
+    free(w->text.data);
+    free(w->diagnostics.data);
+    free(w->symbol_index);
+    free(w->symbols);
+    free(w->type_index.keys);
+    free(w->type_index.values);
+}
+
+static AstFileDiagnostic_t make_diagnostic(AstWriter_t *const w, const Error_t *const error) {
+    AstFileDiagnostic_t output;
+    const char *desc = error->desc ? error->desc : "";
+    output.desc = write_text(w, desc, strlen(desc));
+    const ConstString_t loc = error->location;
+    if (w->source.begin && loc.begin && w->source.begin <= loc.begin && loc.end <= w->source.end) {
+        output.begin = loc.begin - w->source.begin;
+        output.end = loc.end - w->source.begin;
+    }
+    else {
+        output.begin = AST_FILE_NO_LOCATION;
+        output.end = AST_FILE_NO_LOCATION;
+    }
+    return output;
+}
+
+/**
+ * Place a section after those before it
+ */
+static AstFileSection_t place_section(uint64_t *const end, const size_t size) {
+    AstFileSection_t section;
+    section.offset = (*end + 7) & ~(uint64_t)7;
+    section.size = size;
+    *end = section.offset + size;
+    return section;
+}
+
+static bool write_section(FILE *const fp, uint64_t *const written, const AstFileSection_t section, const void *const data) {
+    static const uint8_t padding[8] = { 0 };
+    return
+        fwrite(padding, 1, section.offset - *written, fp) == section.offset - *written &&
+        fwrite(data, 1, section.size, fp) == section.size &&
+        (*written = section.offset + section.size, true);
+}
+
+TrySize_t save_parse_result(const char *const path, const TryScope_t *const result, const ErrorLinkedListNode_t *const errors, const ConstString_t source, const bool copy_source) {
+    TrySize_t output;
+    output.error.location = const_string_from_cstr(path);
+    AstWriter_t w;
+    memset(&w, 0, sizeof(AstWriter_t));
+    w.symbol_index = calloc(n_symbols() + 1, sizeof(uint32_t));
+    w.source = source;
+
+    AstFileHeader_t h;
+    memset(&h, 0, sizeof(AstFileHeader_t));
+    // Offset 0 of the nodes stands for NULL
+    write_node(&w, NULL, sizeof(uint64_t));
+    h.root = result->status == TRY_SUCCESS ? write_scope(&w, &result->value) : 0;
+    if (result->status == TRY_ERROR) {
+        h.error = make_diagnostic(&w, &result->error);
+    }
+    for (const ErrorLinkedListNode_t *it = errors; it; it = it->next) {
+        const AstFileDiagnostic_t diagnostic = make_diagnostic(&w, &it->value);
+        append(&w.diagnostics, &diagnostic, sizeof(AstFileDiagnostic_t), 4);
+    }
+    // Symbol spellings go after the nodes since they are only known now
+    AstFileSymbol_t *symbols = malloc((w.n_symbols + 1) * sizeof(AstFileSymbol_t));
+    for (uint32_t i = 0; i < w.n_symbols; ++i) {
+        symbols[i].len = w.symbols[i]->str.end - w.symbols[i]->str.begin;
+        symbols[i].offset = write_text(&w, w.symbols[i]->str.begin, symbols[i].len);
+    }
+
+    const size_t source_len = source.begin ? source.end - source.begin : 0;
+    if (    source_len > UINT32_MAX - 1 || w.nodes.size > UINT32_MAX ||
+            w.types.size / sizeof(DerivedType_t) > UINT32_MAX || w.text.size > UINT32_MAX) {
+        free(symbols);
+        free_writer(&w);
+        output.status = TRY_ERROR;
+        output.error.desc = "AST is too large for 32-bit offsets";
+        return output;
+    }
+    memcpy(h.magic, AST_FILE_MAGIC, sizeof(h.magic));
+    h.version = AST_FILE_VERSION;
+    h.status = result->status;
+    h.source_len = source_len;
+    h.source_hash = hash_bytes(source, 0);
+    uint64_t end = sizeof(AstFileHeader_t);
+    h.source = place_section(&end, copy_source ? source_len : 0);
+    h.nodes = place_section(&end, w.nodes.size);
+    h.types = place_section(&end, w.types.size);
+    h.text = place_section(&end, w.text.size);
+    h.symbols = place_section(&end, w.n_symbols * sizeof(AstFileSymbol_t));
+    h.diagnostics = place_section(&end, w.diagnostics.size);
+    h.size = end;
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        free(symbols);
+        free_writer(&w);
+        output.status = TRY_ERROR;
+        output.error.desc = "Could not open file for writing";
+        return output;
+    }
+    uint64_t written = sizeof(AstFileHeader_t);
+    const bool complete =
+        fwrite(&h, 1, sizeof(AstFileHeader_t), fp) == sizeof(AstFileHeader_t) &&
+        write_section(fp, &written, h.source, source.begin) &&
+        write_section(fp, &written, h.nodes, w.nodes.data) &&
+        write_section(fp, &written, h.types, w.types.data) &&
+        write_section(fp, &written, h.text, w.text.data) &&
+        write_section(fp, &written, h.symbols, symbols) &&
+        write_section(fp, &written, h.diagnostics, w.diagnostics.data);
+    const bool closed = !fclose(fp);
+    free(symbols);
+    free_writer(&w);
+    if (!complete || !closed) {
+        output.status = TRY_ERROR;
+        output.error.desc = "Could not write file";
+        return output;
+    }
+    output.status = TRY_SUCCESS;
+    output.value = h.size;
+    return output;
+}
+
+TrySize_t save_scope(const char *const path, const Scope_t *const scope, const ConstString_t source, const bool copy_source) {
+    TryScope_t result;
+    result.status = TRY_SUCCESS;
+    result.value = *scope;
+    return save_parse_result(path, &result, NULL, source, copy_source);
+}
+
+/**
+ * The loader walks the tree once, turning each stored offset into a pointer
+ * in place as it reaches the field, and stops at the first one that is out
+ * of bounds
+ */
+typedef struct {
+    uint8_t *nodes;
+    uint64_t nodes_size;
+    DerivedType_t *types;
+    uint64_t n_types;
+    DerivedType_t **loaded_types; // By index, NULL until loaded
+    bool *loading_types; // To reject cycles
+    const char *text;
+    uint64_t text_size;
+    const Symbol_t **symbols;
+    uint64_t n_symbols;
+    ConstString_t source; // Where locations point, if anywhere
+    uint64_t source_len;
+    bool valid;
+} AstLoader_t;
+
+static uint64_t read_field(const void *const field) {
+    uint64_t value;
+    memcpy(&value, field, sizeof(uint64_t));
+    return value;
+}
+
+static void store_pointer(void *const field, const void *const ptr) {
+    memcpy(field, &ptr, sizeof ptr);
+}
+
+/**
+ * `count` nodes of `size` bytes, or NULL for offset 0
+ */
+static void *load_nodes(AstLoader_t *const l, void *const field, const uint64_t count, const size_t size) {
+    const uint64_t offset = read_field(field);
+    void *ptr = NULL;
+    if (offset) {
+        l->valid = l->valid && offset % 8 == 0 && offset <= l->nodes_size && count <= (l->nodes_size - offset) / size;
+        ptr = l->valid ? l->nodes + offset : NULL;
+    }
+    store_pointer(field, ptr);
+    return ptr;
+}
+
+static void *load_required_node(AstLoader_t *const l, void *const field, const size_t size) {
+    void *ptr = load_nodes(l, field, 1, size);
+    l->valid = l->valid && ptr;
+    return ptr;
+}
+
+static void load_symbol(AstLoader_t *const l, void *const field) {
+    const uint64_t value = read_field(field);
+    l->valid = l->valid && value <= l->n_symbols;
+    store_pointer(field, l->valid && value ? l->symbols[value - 1] : NULL);
+}
+
+static void load_location(AstLoader_t *const l, ConstString_t *const field) {
+    const uint64_t begin = read_field(&field->begin);
+    const uint64_t end = read_field(&field->end);
+    ConstString_t location;
+    location.begin = NULL;
+    location.end = NULL;
+    if (begin != AST_FILE_NO_LOCATION) {
+        l->valid = l->valid && begin <= end && end <= l->source_len;
+        if (l->valid && l->source.begin) {
+            location.begin = l->source.begin + begin;
+            location.end = l->source.begin + end;
+        }
+    }
+    *field = location;
+}
+
+static void load_text(AstLoader_t *const l, AConstString_t *const field) {
+    const uint64_t begin = read_field(&field->begin);
+    const uint64_t end = read_field(&field->end);
+    l->valid = l->valid && begin <= end && end < l->text_size;
+    field->begin = l->valid ? (char *)l->text + begin : NULL;
+    field->end = l->valid ? (char *)l->text + end : NULL;
+}
+
+static DerivedType_t *load_derived_type(AstLoader_t *const l, const uint64_t value);
+static void load_statement_fields(AstLoader_t *const l, Statement_t *const stmt);
+static void load_expression_fields(AstLoader_t *const l, Expression_t *const expr);
+static void load_variable_span(AstLoader_t *const l, VariableSpan_t *const span);
+
+static void load_type_field(AstLoader_t *const l, void *const field, const bool required) {
+    const uint64_t value = read_field(field);
+    l->valid = l->valid && (value || !required);
+    store_pointer(field, value ? load_derived_type(l, value) : NULL);
+}
+
+static void load_variable_fields(AstLoader_t *const l, Variable_t *const var) {
+    load_symbol(l, &var->name);
+    l->valid = l->valid && (var->name != NULL) == var->has_name;
+    load_type_field(l, &var->type, true);
+    load_variable_span(l, &var->params);
+}
+
+static void load_variable_span(AstLoader_t *const l, VariableSpan_t *const span) {
+    Variable_t *items = load_nodes(l, &span->items, span->size, sizeof(Variable_t));
+    l->valid = l->valid && (items || !span->size);
+    for (uint32_t i = 0; i < span->size && l->valid; ++i) {
+        load_variable_fields(l, &items[i]);
+    }
+}
+
+static void load_type_fields(AstLoader_t *const l, Type_t *const type) {
+    load_location(l, &type->str);
+    switch (type->variant) {
+        case TYPE_PRIMITIVE:
+            break;
+        case TYPE_NAMED:
+            load_symbol(l, &type->named);
+            break;
+        case TYPE_STRUCT:
+        case TYPE_UNION:
+        case TYPE_ENUM:
+            load_symbol(l, &type->compound.name);
+            if (!type->compound.is_definition) {
+                store_pointer(&type->compound.su_fields.items, NULL);
+            }
+            else if (type->variant == TYPE_ENUM) {
+                EnumFieldSpan_t *span = &type->compound.e_fields;
+                EnumField_t *items = load_nodes(l, &span->items, span->size, sizeof(EnumField_t));
+                l->valid = l->valid && (items || !span->size);
+                for (uint32_t i = 0; i < span->size && l->valid; ++i) {
+                    load_symbol(l, &items[i].name);
+                }
+            }
+            else {
+                load_variable_span(l, &type->compound.su_fields);
+            }
+            break;
+        default:
+            l->valid = false;
+    }
+}
+
+/**
+ * Types are loaded on first use and interned in the attached context; each
+ * is stored once however many nodes share it
+ */
+static DerivedType_t *load_derived_type(AstLoader_t *const l, const uint64_t value) {
+    l->valid = l->valid && value <= l->n_types;
+    if (!l->valid) {
+        return NULL;
+    }
+    const uint64_t index = value - 1;
+    if (l->loaded_types[index]) {
+        return l->loaded_types[index];
+    }
+    l->valid = !l->loading_types[index];
+    if (!l->valid) {
+        return NULL;
+    }
+    l->loading_types[index] = true;
+    DerivedType_t *der = &l->types[index];
+    switch (der->variant) {
+        case DERIVED_TYPE_TERMINAL:
+            load_type_fields(l, &der->terminal.type);
+            l->valid = l->valid && !read_field(&der->terminal.resolved);
+            break;
+        case DERIVED_TYPE_POINTER:
+            load_type_field(l, &der->pointer.inner_type, true);
+            break;
+        case DERIVED_TYPE_ARRAY:
+            load_type_field(l, &der->array.inner_type, true);
+            if (der->array.has_size) {
+                load_text(l, &der->array.size);
+            }
+            if (der->array.has_size && !der->array.is_size_constant) {
+                Expression_t *size_expr = load_nodes(l, &der->array.size_expr, 1, sizeof(Expression_t));
+                if (size_expr) {
+                    load_expression_fields(l, size_expr);
+                }
+            }
+            break;
+        case DERIVED_TYPE_FUNCTION:
+            load_type_field(l, &der->function.return_type, true);
+            load_variable_span(l, &der->function.params);
+            break;
+        default:
+            l->valid = false;
+    }
+    // Children are canonical by now, so the stored type is the prototype of
+    // its canonical node and the AST shares types with the rest of the context
+    l->loaded_types[index] = l->valid ? canonical_derived_type(der) : NULL;
+    return l->loaded_types[index];
+}
+
+static void load_operator(AstLoader_t *const l, Operator_t *const op) {
+    struct Expression **operands = &op->pop;
+    l->valid = l->valid && op->n_operands <= 3;
+    for (uint8_t i = 0; i < op->n_operands && l->valid; ++i) {
+        Expression_t *operand = load_nodes(l, &operands[i], 1, sizeof(Expression_t));
+        if (operand) {
+            load_expression_fields(l, operand);
+        }
+    }
+}
+
+static void load_expression_fields(AstLoader_t *const l, Expression_t *const expr) {
+    switch (expr->variant) {
+        case EXPRESSION_OPERATOR: {
+            Operator_t *op = load_required_node(l, &expr->operator, sizeof(Operator_t));
+            if (op) {
+                load_operator(l, op);
+            }
+            break;
+        }
+        case EXPRESSION_IDENTIFIER:
+        case EXPRESSION_STR_LIT:
+        case EXPRESSION_CHAR_LIT:
+            load_symbol(l, &expr->identifier);
+            break;
+        case EXPRESSION_TYPE:
+            load_type_field(l, &expr->type, true);
+            break;
+        case EXPRESSION_DECLARATION: {
+            Variable_t *decl = load_required_node(l, &expr->decl, sizeof(Variable_t));
+            if (decl) {
+                load_variable_fields(l, decl);
+            }
+            break;
+        }
+        case EXPRESSION_UINT_LIT:
+        case EXPRESSION_VOID:
+            break;
+        default:
+            l->valid = false;
+    }
+}
+
+static void load_scope_fields(AstLoader_t *const l, Scope_t *const scope) {
+    StatementSpan_t *span = &scope->statements;
+    Statement_t *items = load_nodes(l, &span->items, span->size, sizeof(Statement_t));
+    l->valid = l->valid && (items || !span->size);
+    for (uint32_t i = 0; i < span->size && l->valid; ++i) {
+        load_statement_fields(l, &items[i]);
+    }
+}
+
+static void load_control_fields(AstLoader_t *const l, Control_t *const control) {
+    switch (control->variant) {
+        case CONTROL_IF:
+        case CONTROL_WHILE:
+        case CONTROL_DO:
+        case CONTROL_FOR:
+            load_expression_fields(l, &control->condition);
+            load_statement_fields(l, &control->exec);
+            if (control->variant == CONTROL_IF) {
+                Statement_t *continuation = load_nodes(l, &control->ctrl_if.continuation, 1, sizeof(Statement_t));
+                if (continuation) {
+                    load_statement_fields(l, continuation);
+                }
+            }
+            else if (control->variant == CONTROL_FOR) {
+                Expression_t *init = load_nodes(l, &control->ctrl_for.init, 1, sizeof(Expression_t));
+                if (init) {
+                    load_expression_fields(l, init);
+                }
+                Expression_t *increment = load_nodes(l, &control->ctrl_for.increment, 1, sizeof(Expression_t));
+                if (increment) {
+                    load_expression_fields(l, increment);
+                }
+            }
+            break;
+        case CONTROL_RETURN:
+            load_expression_fields(l, &control->ret);
+            break;
+        case CONTROL_BREAK:
+        case CONTROL_CONTINUE:
+            break;
+        default:
+            l->valid = false;
+    }
+}
+
+static void load_statement_fields(AstLoader_t *const l, Statement_t *const stmt) {
+    if (!l->valid) {
+        return;
+    }
+    load_location(l, &stmt->str);
+    switch (stmt->variant) {
+        case STATEMENT_SCOPE: {
+            Scope_t *scope = load_required_node(l, &stmt->scope, sizeof(Scope_t));
+            if (scope) {
+                load_scope_fields(l, scope);
+            }
+            break;
+        }
+        case STATEMENT_CONTROL: {
+            Control_t *control = load_required_node(l, &stmt->control, sizeof(Control_t));
+            if (control) {
+                load_control_fields(l, control);
+            }
+            break;
+        }
+        case STATEMENT_OPERATOR: {
+            Operator_t *op = load_required_node(l, &stmt->operator, sizeof(Operator_t));
+            if (op) {
+                load_operator(l, op);
+            }
+            break;
+        }
+        case STATEMENT_DECLARATION:
+        case STATEMENT_TYPEDEF: {
+            Variable_t *decl = load_required_node(l, &stmt->declaration, sizeof(Variable_t));
+            if (decl) {
+                load_variable_fields(l, decl);
+            }
+            break;
+        }
+        case STATEMENT_FUNCTION: {
+            Function_t *function = load_required_node(l, &stmt->function, sizeof(Function_t));
+            if (function) {
+                load_variable_fields(l, &function->signature);
+                load_scope_fields(l, &function->scope);
+            }
+            break;
+        }
+        default:
+            l->valid = false;
+    }
+}
+
+static bool is_valid_section(const AstFileHeader_t *const h, const AstFileSection_t section, const size_t size) {
+    return section.offset % 8 == 0 && section.offset <= h->size && section.size <= h->size - section.offset && section.size % size == 0;
+}
+
+static bool is_valid_diagnostic(const AstLoader_t *const l, const AstFileDiagnostic_t *const diagnostic) {
+    const bool has_location = diagnostic->begin != AST_FILE_NO_LOCATION;
+    return
+        diagnostic->desc < l->text_size &&
+        memchr(l->text + diagnostic->desc, 0, l->text_size - diagnostic->desc) &&
+        (!has_location || (diagnostic->begin <= diagnostic->end && diagnostic->end <= l->source_len));
+}
+
+static Error_t load_diagnostic(const AstLoader_t *const l, const AstFileDiagnostic_t *const diagnostic) {
+    Error_t output;
+    output.desc = l->text + diagnostic->desc;
+    output.location.begin = NULL;
+    output.location.end = NULL;
+    if (diagnostic->begin != AST_FILE_NO_LOCATION && l->source.begin) {
+        output.location.begin = l->source.begin + diagnostic->begin;
+        output.location.end = l->source.begin + diagnostic->end;
+    }
+    return output;
+}
+
+/**
+ * Intern the symbols and load the tree from the root into the context; types
+ * interned for a file that turns out to be corrupt are rolled back
+ */
+static const char *load_tree(AstLoader_t *const l, ParseContext_t *const context, uint8_t *const base, const AstFileHeader_t *const h) {
+    ParseContext_t *prev_context = attach_parse_context(context);
+    const ParseCheckpoint_t checkpoint = parse_checkpoint();
+    const AstFileSymbol_t *entries = (const AstFileSymbol_t *)(base + h->symbols.offset);
+    l->symbols = malloc((l->n_symbols + 1) * sizeof(Symbol_t *));
+    for (uint64_t i = 0; i < l->n_symbols && l->valid; ++i) {
+        l->valid = entries[i].offset <= l->text_size && entries[i].len < l->text_size - entries[i].offset;
+        if (l->valid) {
+            ConstString_t str;
+            str.begin = l->text + entries[i].offset;
+            str.end = str.begin + entries[i].len;
+            l->symbols[i] = intern(str);
+        }
+    }
+    l->loaded_types = calloc(l->n_types + 1, sizeof(DerivedType_t *));
+    l->loading_types = calloc(l->n_types + 1, sizeof(bool));
+    if (h->status == TRY_SUCCESS) {
+        l->valid = l->valid && h->root && h->root % 8 == 0 && h->root <= l->nodes_size && sizeof(Scope_t) <= l->nodes_size - h->root;
+        if (l->valid) {
+            load_scope_fields(l, (Scope_t *)(l->nodes + h->root));
+        }
+    }
+    if (!l->valid) {
+        parse_rollback(checkpoint);
+    }
+    attach_parse_context(prev_context);
+    free(l->symbols);
+    free(l->loaded_types);
+    free(l->loading_types);
+    return l->valid ? NULL : "Corrupt AST file";
+}
+
+const char *load_parse_result(const char *const path, ParseContext_t *const context, const ConstString_t source, TryScope_t *const result, ErrorLinkedListNode_t ***const errors) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return "Could not open file";
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(AstFileHeader_t)) {
+        close(fd);
+        return "Not an AST file";
+    }
+    // Private and writable, so the loader only dirties the pages it touches
+    uint8_t *base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return "Could not map file";
+    }
+
+    const AstFileHeader_t *h = (const AstFileHeader_t *)base;
+    const bool valid_header =
+        !memcmp(h->magic, AST_FILE_MAGIC, sizeof(h->magic)) &&
+        h->version == AST_FILE_VERSION &&
+        h->size == (uint64_t)st.st_size &&
+        h->status <= TRY_NONE &&
+        (!h->source.size || h->source.size == h->source_len) &&
+        is_valid_section(h, h->source, 1) &&
+        is_valid_section(h, h->nodes, 1) &&
+        h->nodes.size >= sizeof(uint64_t) &&
+        is_valid_section(h, h->types, sizeof(DerivedType_t)) &&
+        is_valid_section(h, h->text, 1) &&
+        is_valid_section(h, h->symbols, sizeof(AstFileSymbol_t)) &&
+        is_valid_section(h, h->diagnostics, sizeof(AstFileDiagnostic_t));
+    if (!valid_header) {
+        munmap(base, st.st_size);
+        return "Not an AST file";
+    }
+    if (    source.begin &&
+            ((uint64_t)(source.end - source.begin) != h->source_len ||
+             hash_bytes(source, 0) != h->source_hash ||
+             (h->source.size && memcmp(base + h->source.offset, source.begin, h->source_len)))) {
+        munmap(base, st.st_size);
+        return "Source does not match";
+    }
+
+    AstLoader_t l;
+    memset(&l, 0, sizeof(AstLoader_t));
+    l.nodes = base + h->nodes.offset;
+    l.nodes_size = h->nodes.size;
+    l.types = (DerivedType_t *)(base + h->types.offset);
+    l.n_types = h->types.size / sizeof(DerivedType_t);
+    l.text = (const char *)base + h->text.offset;
+    l.text_size = h->text.size;
+    l.n_symbols = h->symbols.size / sizeof(AstFileSymbol_t);
+    l.source_len = h->source_len;
+    l.valid = true;
+    // Locations refer to the caller's source if there is one, else to the copy
+    l.source = source;
+    if (!l.source.begin && h->source.size) {
+        l.source.begin = (const char *)base + h->source.offset;
+        l.source.end = l.source.begin + h->source_len;
+    }
+
+    const AstFileDiagnostic_t *diagnostics = (const AstFileDiagnostic_t *)(base + h->diagnostics.offset);
+    const uint64_t n_diagnostics = h->diagnostics.size / sizeof(AstFileDiagnostic_t);
+    bool valid = h->status != TRY_ERROR || is_valid_diagnostic(&l, &h->error);
+    for (uint64_t i = 0; i < n_diagnostics && valid; ++i) {
+        valid = is_valid_diagnostic(&l, &diagnostics[i]);
+    }
+    const char *desc = valid ? load_tree(&l, context, base, h) : "Corrupt AST file";
+    if (desc) {
+        munmap(base, st.st_size);
+        return desc;
+    }
+    add_mapped_source(context, base, st.st_size);
+    result->status = h->status;
+    if (h->status == TRY_SUCCESS) {
+        result->value = *(const Scope_t *)(l.nodes + h->root);
+    }
+    else if (h->status == TRY_ERROR) {
+        result->error = load_diagnostic(&l, &h->error);
+    }
+    if (errors) {
+        ParseContext_t *prev_context = attach_parse_context(context);
+        for (uint64_t i = 0; i < n_diagnostics; ++i) {
+            **errors = parse_alloc(sizeof(ErrorLinkedListNode_t));
+            (**errors)->next = NULL;
+            (**errors)->value = load_diagnostic(&l, &diagnostics[i]);
+            *errors = &(**errors)->next;
+        }
+        attach_parse_context(prev_context);
+    }
+    return NULL;
+}
+
+TryScope_t load_scope(const char *const path, ParseContext_t *const context) {
+    TryScope_t output;
+    ConstString_t no_source;
+    no_source.begin = NULL;
+    no_source.end = NULL;
+    const char *desc = load_parse_result(path, context, no_source, &output, NULL);
+    if (desc) {
+        output.status = TRY_ERROR;
+        output.error.location = const_string_from_cstr(path);
+        output.error.desc = desc;
+    }
+    return output;
+}
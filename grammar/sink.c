@@ -0,0 +1,128 @@
+#include "util.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+Sink_t new_buffer_sink() {
+    Sink_t output;
+    output.variant = SINK_BUFFER;
+    output.written = 0;
+    output.buffer.capacity = 256;
+    output.buffer.size = 0;
+    output.buffer.data = malloc(output.buffer.capacity);
+    output.buffer.data[0] = 0;
+    return output;
+}
+
+Sink_t new_file_sink(FILE *const file) {
+    Sink_t output;
+    output.variant = SINK_FILE;
+    output.written = 0;
+    output.file = file;
+    return output;
+}
+
+Sink_t new_callback_sink(const SinkCallback_t func, void *const user) {
+    Sink_t output;
+    output.variant = SINK_CALLBACK;
+    output.written = 0;
+    output.callback.func = func;
+    output.callback.user = user;
+    return output;
+}
+
+void free_sink(Sink_t *const sink) {
+    if (sink->variant == SINK_BUFFER) {
+        free(sink->buffer.data);
+        sink->buffer.data = NULL;
+        sink->buffer.size = 0;
+        sink->buffer.capacity = 0;
+    }
+}
+
+void reset_sink(Sink_t *const sink) {
+    sink->written = 0;
+    if (sink->variant == SINK_BUFFER) {
+        sink->buffer.size = 0;
+        sink->buffer.data[0] = 0;
+    }
+}
+
+const char *sink_str(const Sink_t *const sink) {
+    return sink->variant == SINK_BUFFER ? sink->buffer.data : NULL;
+}
+
+/**
+ * Make room for `len` more characters plus the terminator
+ */
+static void reserve_buffer(Sink_t *const sink, const size_t len) {
+    if (sink->buffer.size + len + 1 > sink->buffer.capacity) {
+        size_t capacity = sink->buffer.capacity;
+        while (sink->buffer.size + len + 1 > capacity) {
+            capacity *= 2;
+        }
+        sink->buffer.data = realloc(sink->buffer.data, capacity);
+        sink->buffer.capacity = capacity;
+    }
+}
+
+void sink_write(Sink_t *const sink, const char *const str, const size_t len) {
+    switch (sink->variant) {
+        case SINK_BUFFER:
+            reserve_buffer(sink, len);
+            memcpy(sink->buffer.data + sink->buffer.size, str, len);
+            sink->buffer.size += len;
+            sink->buffer.data[sink->buffer.size] = 0;
+            break;
+        case SINK_FILE:
+            fwrite(str, 1, len, sink->file);
+            break;
+        case SINK_CALLBACK:
+            sink->callback.func(sink->callback.user, str, len);
+            break;
+    }
+    sink->written += len;
+}
+
+void sink_puts(Sink_t *const sink, const char *const str) {
+    sink_write(sink, str, strlen(str));
+}
+
+void sink_printf(Sink_t *const sink, const char *const format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (sink->variant == SINK_FILE) {
+        const int len = vfprintf(sink->file, format, args);
+        sink->written += len > 0 ? len : 0;
+        va_end(args);
+        return;
+    }
+
+    // Most writes are short, so try a small stack buffer before measuring
+    char small[128];
+    va_list retry;
+    va_copy(retry, args);
+    const int len = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (len < 0) {
+        va_end(retry);
+        return;
+    }
+    if ((size_t)len < sizeof(small)) {
+        sink_write(sink, small, len);
+    }
+    else if (sink->variant == SINK_BUFFER) {
+        reserve_buffer(sink, len);
+        vsnprintf(sink->buffer.data + sink->buffer.size, len + 1, format, retry);
+        sink->buffer.size += len;
+        sink->written += len;
+    }
+    else {
+        char *large = malloc(len + 1);
+        vsnprintf(large, len + 1, format, retry);
+        sink_write(sink, large, len);
+        free(large);
+    }
+    va_end(retry);
+}
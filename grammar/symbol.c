@@ -0,0 +1,131 @@
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Open-addressed table of symbol pointers; symbols themselves are allocated
+ * from an arena so that their addresses are stable while the table grows
+ */
+typedef struct {
+    Symbol_t **slots;
+    size_t capacity; // Always a power of 2
+    size_t size;
+    Arena_t arena;
+} SymbolTable_t;
+
+static SymbolTable_t table = { NULL, 0, 0, { NULL, 0 } };
+
+uint32_t hash_const_str(const ConstString_t str) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char *it = str.begin; it < str.end; ++it) {
+        hash ^= (uint8_t)*it;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint64_t fmix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t hash_bytes(const ConstString_t str, const uint64_t seed) {
+    // Word at a time, multiplicative
+    const size_t len = str.end - str.begin;
+    uint64_t h = fmix64(seed ^ (len * 0x9e3779b97f4a7c15ull));
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, str.begin + i, sizeof(uint64_t));
+        h = (h ^ fmix64(word)) * 0x9e3779b97f4a7c15ull;
+    }
+    uint64_t tail = 0;
+    if (i < len) {
+        memcpy(&tail, str.begin + i, len - i);
+    }
+    return fmix64(h ^ tail);
+}
+
+static Symbol_t **find_slot(Symbol_t **const slots, const size_t capacity, const ConstString_t str, const uint32_t hash) {
+    const size_t mask = capacity - 1;
+    const size_t len = str.end - str.begin;
+    size_t i = hash & mask;
+    while (slots[i]) {
+        const Symbol_t *symbol = slots[i];
+        if (    symbol->hash == hash &&
+                (size_t)(symbol->str.end - symbol->str.begin) == len &&
+                !memcmp(symbol->str.begin, str.begin, len)) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return &slots[i];
+}
+
+static void grow_table() {
+    const size_t capacity = table.capacity ? 2 * table.capacity : 1024;
+    Symbol_t **slots = calloc(capacity, sizeof(Symbol_t *));
+    for (size_t i = 0; i < table.capacity; ++i) {
+        Symbol_t *symbol = table.slots[i];
+        if (symbol) {
+            ConstString_t str;
+            str.begin = symbol->str.begin;
+            str.end = symbol->str.end;
+            *find_slot(slots, capacity, str, symbol->hash) = symbol;
+        }
+    }
+    free(table.slots);
+    table.slots = slots;
+    table.capacity = capacity;
+}
+
+const Symbol_t *intern(const ConstString_t str) {
+    if (2 * (table.size + 1) > table.capacity) {
+        grow_table();
+    }
+    const uint32_t hash = hash_const_str(str);
+    Symbol_t **slot = find_slot(table.slots, table.capacity, str, hash);
+    if (!*slot) {
+        const size_t len = str.end - str.begin;
+        Symbol_t *symbol = arena_alloc(&table.arena, sizeof(Symbol_t));
+        char *buffer = arena_alloc(&table.arena, len + 1);
+        memcpy(buffer, str.begin, len);
+        buffer[len] = 0;
+        symbol->id = table.size++;
+        symbol->hash = hash;
+        symbol->str.begin = buffer;
+        symbol->str.end = buffer + len;
+        *slot = symbol;
+    }
+    return *slot;
+}
+
+const Symbol_t *intern_cstr(const char *const str) {
+    return intern(const_string_from_cstr(str));
+}
+
+int cmp_symbol(const Symbol_t *const first, const Symbol_t *const second) {
+    return first->id < second->id ? -1 : first->id > second->id;
+}
+
+uint32_t hash_symbol(const Symbol_t *const symbol) {
+    return symbol->hash;
+}
+
+size_t n_symbols() {
+    return table.size;
+}
+
+void free_symbol_table() {
+    free(table.slots);
+    free_arena(&table.arena);
+    table.slots = NULL;
+    table.capacity = 0;
+    table.size = 0;
+}
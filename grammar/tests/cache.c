@@ -0,0 +1,200 @@
+#include "tests.h"
+#include "../grammar.h"
+#include "../../test_util.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+const static Case_t cases[] = {
+    {true,  "tests/grammar/scope/basic0.in", NULL},
+    {false, "tests/grammar/scope/basic1-bad_braces.in", NULL},
+    {true,  "tests/grammar/scope/basic3-bad_op.in", "tests/grammar/scope/basic3-bad_op.out"},
+    {true,  "tests/grammar/scope/basic4-empty.in", NULL},
+    {true,  "tests/grammar/scope/basic7-bad_typedef.in", "tests/grammar/scope/basic7-bad_typedef.out"},
+    {true,  "tests/grammar/scope/nested3-errors.in", "tests/grammar/scope/nested3-errors.out"},
+    {false, "tests/grammar/scope/cond5-break_no_semicolon.in", NULL},
+    {true,  "tests/grammar/scope/cond17-else_if.in", NULL},
+    {true,  "tests/grammar/scope/func2-func_error.in", "tests/grammar/scope/func2-func_error.out"},
+    {false, NULL, NULL}
+};
+
+static char cache_dir[0x100];
+
+/**
+ * Print the status, the scope or error and every appended error, with
+ * locations as offsets into `str`
+ */
+static void print_result(Sink_t *const sink, const ConstString_t str, const TryScope_t *const result, const ErrorLinkedListNode_t *errors) {
+    sink_printf(sink, "%d\n", (int)result->status);
+    if (result->status == TRY_SUCCESS) {
+        print_scope(sink, &result->value, -1);
+    }
+    else if (result->status == TRY_ERROR) {
+        sink_printf(sink, "%s at %td\n", result->error.desc, result->error.location.begin - str.begin);
+    }
+    for (; errors; errors = errors->next) {
+        sink_printf(sink, "%s at %td-%td\n", errors->value.desc,
+            errors->value.location.begin - str.begin, errors->value.location.end - str.begin);
+    }
+}
+
+/**
+ * Parse without the cache, then twice through it; the miss and the hit must
+ * both match the uncached result exactly, diagnostics included
+ */
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    Sink_t results[3];
+    ParseCache_t cache = new_parse_cache(cache_dir, UINT64_MAX);
+    TryScope_t expected;
+    for (int i = 0; i < 3; ++i) {
+        ErrorLinkedListNode_t *errors = NULL;
+        ErrorLinkedListNode_t **errors_head = &errors;
+        ParseContext_t *context = new_parse_context();
+        TryScope_t result;
+        if (i == 0) {
+            ParseContext_t *prev_context = attach_parse_context(context);
+            result = parse_scope(str, &errors_head);
+            attach_parse_context(prev_context);
+            expected = result;
+        }
+        else {
+            result = parse_scope_cached(&cache, str, context, &errors_head);
+        }
+        results[i] = new_buffer_sink();
+        print_result(&results[i], str, &result, errors);
+        if (i == 0) {
+            Sink_t sink = new_buffer_sink();
+            if (result.status == TRY_SUCCESS) {
+                print_scope(&sink, &result.value, -1);
+            }
+            snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+            free_sink(&sink);
+        }
+        free_parse_context(context);
+    }
+    const bool same =
+        !strcmp(sink_str(&results[0]), sink_str(&results[1])) &&
+        !strcmp(sink_str(&results[0]), sink_str(&results[2]));
+    const bool counted = cache.misses == 1 && cache.hits == 1;
+    for (int i = 0; i < 3; ++i) {
+        free_sink(&results[i]);
+    }
+    free_parse_cache(&cache);
+
+    if (!same || !counted) {
+        output.status = TRY_ERROR;
+        output.error.location = str;
+        output.error.desc = !same ? "Cached result differs" : "Expected one miss and one hit";
+    }
+    else if (expected.status == TRY_SUCCESS) {
+        buffer[strlen(buffer) - 1] = 0;
+        output.status = TRY_SUCCESS;
+        output.value = buffer;
+    }
+    else if (expected.status == TRY_ERROR) {
+        output.status = TRY_ERROR;
+        output.error = expected.error;
+    }
+    else {
+        output.status = TRY_NONE;
+    }
+    return output;
+}
+
+static bool parse_hits(ParseCache_t *const cache, const char *const input) {
+    ErrorLinkedListNode_t *errors = NULL;
+    ErrorLinkedListNode_t **errors_head = &errors;
+    ParseContext_t *context = new_parse_context();
+    const uint64_t hits = cache->hits;
+    parse_scope_cached(cache, const_string_from_cstr(input), context, &errors_head);
+    free_parse_context(context);
+    return cache->hits == hits + 1;
+}
+
+/**
+ * File times are coarse, so wait between uses to order them
+ */
+static void wait_tick() {
+    struct timespec ts;
+    ts.tv_sec = 0;
+    ts.tv_nsec = 20000000;
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * With room for two results, storing a third evicts the least recently used
+ */
+static int test_eviction() {
+    const char *inputs[] = { "{ int a = 1; }", "{ int b = 1; }", "{ int c = 1; }" };
+    ParseCache_t cache = new_parse_cache(cache_dir, UINT64_MAX);
+    parse_hits(&cache, inputs[0]);
+    wait_tick();
+    parse_hits(&cache, inputs[1]);
+    wait_tick();
+    const bool hit_a = parse_hits(&cache, inputs[0]);
+    wait_tick();
+
+    // The inputs only differ in one symbol's spelling, so the files have the same size
+    uint64_t total = 0;
+    DIR *dir = opendir(cache_dir);
+    struct dirent *ent;
+    while (dir && (ent = readdir(dir))) {
+        char path[0x200];
+        FILE *fp;
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, ent->d_name);
+        if (ent->d_name[0] != '.' && (fp = fopen(path, "rb"))) {
+            fseek(fp, 0, SEEK_END);
+            total += ftell(fp);
+            fclose(fp);
+        }
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    const bool counted = cache.total_bytes == total;
+    cache.max_bytes = total;
+    parse_hits(&cache, inputs[2]);
+    const bool kept_a = parse_hits(&cache, inputs[0]);
+    const bool kept_c = parse_hits(&cache, inputs[2]);
+    const bool evicted_b = !parse_hits(&cache, inputs[1]);
+    ParseCache_t reopened = new_parse_cache(cache_dir, total);
+    const bool recounted = reopened.total_bytes == cache.total_bytes && reopened.total_bytes <= total;
+    free_parse_cache(&reopened);
+    free_parse_cache(&cache);
+
+    int n_failed_tests = !check("(LRU eviction) a b a c", hit_a && kept_a && kept_c && evicted_b);
+    n_failed_tests += !check("(running total) matches the directory", counted && recounted);
+    return n_failed_tests;
+}
+
+static void remove_cache_dir() {
+    DIR *dir = opendir(cache_dir);
+    struct dirent *ent;
+    while (dir && (ent = readdir(dir))) {
+        char path[0x200];
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, ent->d_name);
+        if (strcmp(ent->d_name, ".") && strcmp(ent->d_name, "..")) {
+            unlink(path);
+        }
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    rmdir(cache_dir);
+}
+
+int test_cache() {
+    printf("Running test_cache() ...\n");
+    snprintf(cache_dir, sizeof(cache_dir), "/tmp/metac_cache_%d", (int)getpid());
+    remove_cache_dir();
+    int n_failed_tests = test_fixture(cases, case_func, TEST_INPUT_FILE);
+    remove_cache_dir();
+    n_failed_tests += test_eviction();
+    remove_cache_dir();
+    return n_failed_tests;
+}
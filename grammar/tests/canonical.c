@@ -0,0 +1,91 @@
+#include "tests.h"
+#include "../grammar.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Each input is two declarations separated by '|'; the output says whether
+ * their types share a canonical node
+ */
+const static Case_t cases[] = {
+    {true,  "int x | int y", "same"},
+    {true,  "const char *a | const char *b", "same"},
+    {true,  "struct Foo *p | struct Foo *q", "same"},
+    {true,  "int (*f)(int, char) | int (*g)(int, char)", "same"},
+    {true,  "int arr[10] | int other[10]", "same"},
+    {true,  "const char *a | char *b", "different"},
+    {true,  "int *const p | int *q", "different"},
+    {true,  "int arr[10] | int arr[11]", "different"},
+    {true,  "int (*f)(int a) | int (*f)(int b)", "same"},
+    {true,  "int (*f)(int a, char *b) | int (*g)(int, char *)", "same"},
+    {true,  "void (*f)(int (*cb)(int x)) | void (*g)(int (*)(int y))", "same"},
+    {true,  "int (*f)(int a) | int (*g)(long a)", "different"},
+    {true,  "struct A { int x; } a | struct A { int x; } b", "different"},
+    {true,  "unsigned long n | unsigned int m", "different"},
+    {false, NULL, NULL}
+};
+
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    const char *bar = memchr(str.begin, '|', str.end - str.begin);
+    ConstString_t first;
+    ConstString_t second;
+    first.begin = str.begin;
+    first.end = bar;
+    second.begin = bar + 1;
+    second.end = str.end;
+
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryVariable_t a = parse_variable(first);
+    TryVariable_t b = parse_variable(second);
+    attach_parse_context(prev_context);
+
+    if (a.status == TRY_SUCCESS && b.status == TRY_SUCCESS) {
+        output.status = TRY_SUCCESS;
+        output.value = a.value.type == b.value.type ? "same" : "different";
+    }
+    else {
+        output.status = TRY_ERROR;
+        output.error.location = str;
+        output.error.desc = "Could not parse both declarations";
+    }
+    free_parse_context(context);
+    return output;
+}
+
+/**
+ * Declarations whose types share a node still print their own parameter names
+ */
+static int test_param_names() {
+    const char *first = "float (*f(int a))(char b)";
+    const char *second = "float (*g(int c))(char d)";
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryVariable_t a = parse_variable(const_string_from_cstr(first));
+    TryVariable_t b = parse_variable(const_string_from_cstr(second));
+    attach_parse_context(prev_context);
+
+    bool passed = false;
+    if (a.status == TRY_SUCCESS && b.status == TRY_SUCCESS && a.value.type == b.value.type) {
+        Sink_t sink_a = new_buffer_sink();
+        Sink_t sink_b = new_buffer_sink();
+        print_variable(&sink_a, &a.value);
+        print_variable(&sink_b, &b.value);
+        passed = !strcmp(sink_str(&sink_a), first) && !strcmp(sink_str(&sink_b), second);
+        free_sink(&sink_a);
+        free_sink(&sink_b);
+    }
+    free_parse_context(context);
+
+    return !check("(parameter names) float (*f(int a))(char b) | float (*g(int c))(char d)", passed);
+}
+
+int test_canonical() {
+    printf("Running test_canonical() ...\n");
+    int n_failed_tests = test_fixture(cases, case_func, TEST_INPUT_STRING);
+    n_failed_tests += test_param_names();
+    return n_failed_tests;
+}
@@ -0,0 +1,112 @@
+#include "tests.h"
+#include "../grammar.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+
+const static Case_t cases[] = {
+    {true,  "int x = 5", NULL},
+    {true,  "const char *str = \"hello\"", NULL},
+    {true,  "(const void *)(const uint8_t *)bytes", NULL},
+    {true,  "result = (*args->func)(1, 2, 3)", NULL},
+    {true,  "x = (y) - z", "x = y - z"},
+    {true,  "size_t sz = sizeof(int (*)(char)) * 2", NULL},
+    {true,  "int (*fp)(int, char) = (int (*)(int, char))table[0]", NULL},
+    {false, "other = int x", NULL},
+    {false, "(34567)thing", NULL},
+    {false, "size_t sz = sizeof(int x)", NULL},
+    {false, NULL, NULL}
+};
+
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryOperator_t op = parse_operator(str);
+    attach_parse_context(prev_context);
+
+    if (op.status == TRY_SUCCESS) {
+        Sink_t sink = new_buffer_sink();
+        print_operator(&sink, &op.value);
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+        free_sink(&sink);
+        output.status = TRY_SUCCESS;
+        output.value = buffer;
+    }
+    else if (context->arena.allocated || context->expressions.size || context->operators.size) {
+        // Everything from a failed parse is speculative and must be rolled back
+        output.status = TRY_ERROR;
+        output.error.location = str;
+        output.error.desc = "Failed parse left nodes in the arena";
+    }
+    else {
+        output.status = TRY_NONE;
+    }
+    free_parse_context(context);
+    return output;
+}
+
+/**
+ * Every arena allocation is aligned for any scalar type, whatever the sizes
+ * of the ones before it
+ */
+static int test_alignment() {
+    Arena_t arena = new_arena();
+    bool aligned = true;
+    for (size_t size = 1; size < 0x2000; size += 7) {
+        aligned = aligned && !((uintptr_t)arena_alloc(&arena, size) % ARENA_ALIGNMENT);
+    }
+    free_arena(&arena);
+    return !check("(alignment) allocations of 1 to 0x2000 bytes", aligned);
+}
+
+/**
+ * Pooled nodes are found from their IDs, canonical types know their own, and
+ * a rollback hands the same IDs out again
+ */
+static int test_node_pools() {
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryOperator_t op = parse_operator(const_string_from_cstr("x = (long)y + 1"));
+    bool found_operands = op.status == TRY_SUCCESS && op.value.n_operands == 2;
+    for (uint8_t i = 0; found_operands && i < 2; ++i) {
+        const Expression_t *operand = i ? op.value.rop : op.value.lop;
+        bool found = false;
+        for (NodeId_t id = 1; id <= context->expressions.size; ++id) {
+            found = found || expression_at(context, id) == operand;
+        }
+        found_operands = found;
+    }
+    bool typed = context->derived_types.size > 0;
+    for (NodeId_t id = 1; typed && id <= context->derived_types.size; ++id) {
+        typed = derived_type_at(context, id)->id == id;
+    }
+    const bool bounded =
+        !expression_at(context, NO_NODE_ID) &&
+        !expression_at(context, context->expressions.size + 1) &&
+        operator_at(context, context->operators.size);
+
+    const NodeId_t n_expressions = context->expressions.size;
+    const ParseCheckpoint_t checkpoint = parse_checkpoint();
+    for (uint32_t i = 0; i < 3000; ++i) {
+        new_expression();
+    }
+    parse_rollback(checkpoint);
+    Expression_t *again = new_expression();
+    const bool reused = context->expressions.size == n_expressions + 1 && expression_at(context, n_expressions + 1) == again;
+    attach_parse_context(prev_context);
+    free_parse_context(context);
+    int n_failed_tests = !check("(node pools) operands are found by ID", found_operands && bounded);
+    n_failed_tests += !check("(node pools) canonical types know their IDs", typed);
+    n_failed_tests += !check("(node pools) rollback reuses IDs", reused);
+    return n_failed_tests;
+}
+
+int test_context() {
+    printf("Running test_context() ...\n");
+    int n_failed_tests = test_fixture(cases, case_func, TEST_INPUT_STRING);
+    n_failed_tests += test_alignment();
+    n_failed_tests += test_node_pools();
+    return n_failed_tests;
+}
@@ -22,12 +22,12 @@ int test_fixture(const Case_t *const cases, TryCharPtr_t (*const func)(const Con
             const size_t malloc_size = 0x10000;
             FILE *fp = fopen(c->input, "r");
             input = malloc(malloc_size);
-            fread(input, 1, malloc_size, fp);
+            input[fread(input, 1, malloc_size - 1, fp)] = 0;
             fclose(fp);
             if (c->output) {
                 fp = fopen(c->output, "r");
                 output = malloc(malloc_size);
-                fread(output, 1, malloc_size, fp);
+                output[fread(output, 1, malloc_size - 1, fp)] = 0;
                 fclose(fp);
             }
             else {
@@ -0,0 +1,85 @@
+#include "tests.h"
+#include "../grammar.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+
+const static Case_t cases[] = {
+    {true,  "(1 << 4) * 16", "256"},
+    {true,  "a * (2 + 3) + (0 && a)", "a * 5 + 0"},
+    {true,  "(unsigned char)-1 + 'a'", "352"},
+    {true,  "(unsigned int)1 - 2", "4294967295u"},
+    {true,  "-2147483647 - 1", "(int)-2147483648"},
+    {true,  "2147483647 + 1", "2147483647 + 1"},
+    {true,  "0x10 + 010 + 1ul", "25ul"},
+    {true,  "sizeof(int) * 3", "sizeof(int) * 3"},
+    {true,  "(T)1 + (2 + 2)", "(T)1 + 4"},
+    {true,  "f(1 + 1, x)", "f(2, x)"},
+    {false, NULL, NULL}
+};
+
+/**
+ * Fold without a program, so sizeof and casts to typedef names stay
+ */
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    TryExpression_t expr = parse_right_expression(str);
+    GrammarPropagateError(expr, output);
+    if (expr.status == TRY_NONE) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    Sink_t sink = new_buffer_sink();
+    print_expression(&sink, fold_constant_expression(&expr.value, NULL), NULL);
+    snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+    free_sink(&sink);
+    output.status = TRY_SUCCESS;
+    output.value = buffer;
+    return output;
+}
+
+const static Case_t array_cases[] = {
+    {true,  "char a[16]", "16"},
+    {true,  "char a[ 0x10 ]", "16"},
+    {true,  "char a[(1 << 4) * 16]", "256"},
+    {true,  "char a[2][3 + 4]", "2 7"},
+    {true,  "char a[sizeof(int)]", "?"},
+    {true,  "char a[N][-1]", "? ?"},
+    {true,  "char a[]", "-"},
+    {false, NULL, NULL}
+};
+
+/**
+ * Array sizes as stored by the declarator, outermost first: the value, ? for
+ * a size left for flow, or - for none
+ */
+static TryCharPtr_t array_case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    TryVariable_t var = parse_variable(str);
+    GrammarPropagateError(var, output);
+    size_t num_chars = 0;
+    for (const DerivedType_t *der = var.value.type; der->variant == DERIVED_TYPE_ARRAY; der = der->array.inner_type) {
+        const char *separator = num_chars ? " " : "";
+        if (!der->array.has_size) {
+            num_chars += sprintf(buffer + num_chars, "%s-", separator);
+        }
+        else if (der->array.is_size_constant) {
+            num_chars += sprintf(buffer + num_chars, "%s%lu", separator, der->array.size_value);
+        }
+        else {
+            num_chars += sprintf(buffer + num_chars, "%s%s", separator, der->array.size_expr ? "?" : "!");
+        }
+    }
+    output.status = TRY_SUCCESS;
+    output.value = buffer;
+    return output;
+}
+
+int test_fold() {
+    printf("Running test_fold() ...\n");
+    int n_failed_tests = test_fixture(cases, case_func, TEST_INPUT_STRING);
+    n_failed_tests += test_fixture(array_cases, array_case_func, TEST_INPUT_STRING);
+    return n_failed_tests;
+}
@@ -0,0 +1,104 @@
+#include "tests.h"
+#include "../grammar.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEEP_NESTING 70000
+
+const static Case_t cases[] = {
+    {true,  "x", "0"},
+    {true,  "f(a[b]c)", "00112110 1-7 3-5"},
+    {true,  "{([{}])}", "01233210 0-7 1-6 2-5 3-4"},
+    {true,  "(a)(b)[c]", "010010010 0-2 3-5 6-8"},
+    {true,  "f(\")\", ']')", "00121111210 1-10 2-4 7-9"},
+    {true,  "\"(\\\"[\" 'a' \"\"", "0111100010000 0-5 7-9 11-12"},
+    {true,  "'\\''(\"'\")", "011001210 0-3 4-8 5-7"},
+    {true,  "\"\\\\\"()", "011000 0-3 4-5"},
+    {false, "(", NULL},
+    {false, ")", NULL},
+    {false, "(]", NULL},
+    {false, "([)]", NULL},
+    {false, "(a))", NULL},
+    {false, "{\"}\"", NULL},
+    {false, "\"abc", NULL},
+    {false, "'\\'", NULL},
+    {false, "\"a\\\"", NULL},
+    {false, NULL, NULL}
+};
+
+/**
+ * Build an index and print the depth of every position, then its pairs as
+ * "open-close" offsets; every pair must also match backwards, and only the
+ * contents of quote pairs may be marked as literal
+ */
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    SourceIndex_t index = build_source_index(str);
+    if (!index.valid) {
+        free_source_index(&index);
+        output.status = TRY_NONE;
+        return output;
+    }
+
+    const uint32_t len = str.end - str.begin;
+    size_t num_chars = 0;
+    uint32_t literal_end = 0;
+    for (uint32_t i = 0; i < len; ++i) {
+        num_chars += sprintf(buffer + num_chars, "%u", source_index_depth(&index, str.begin + i));
+    }
+    for (uint32_t i = 0; i < len; ++i) {
+        const uint32_t match = index.match[i];
+        const bool in_literal = i < literal_end;
+        const bool is_pair = match != SOURCE_INDEX_NO_MATCH && match != SOURCE_INDEX_LITERAL;
+        if (    in_literal != (match == SOURCE_INDEX_LITERAL) ||
+                (is_pair && (match >= len || index.match[match] != i))) {
+            free_source_index(&index);
+            output.status = TRY_ERROR;
+            output.error.location.begin = str.begin + i;
+            output.error.location.end = str.end;
+            output.error.desc = "Inconsistent match table";
+            return output;
+        }
+        if (is_pair && match > i) {
+            num_chars += sprintf(buffer + num_chars, " %u-%u", i, match);
+            if (str.begin[i] == '"' || str.begin[i] == '\'') {
+                literal_end = match;
+            }
+        }
+    }
+    free_source_index(&index);
+    output.status = TRY_SUCCESS;
+    output.value = buffer;
+    return output;
+}
+
+/**
+ * Depths past what 16 bits can hold
+ */
+static int test_deep_nesting() {
+    char *buffer = malloc(2 * DEEP_NESTING);
+    memset(buffer, '(', DEEP_NESTING);
+    memset(buffer + DEEP_NESTING, ')', DEEP_NESTING);
+    ConstString_t str;
+    str.begin = buffer;
+    str.end = buffer + 2 * DEEP_NESTING;
+    SourceIndex_t index = build_source_index(str);
+    const bool passed = index.valid &&
+        source_index_depth(&index, buffer + DEEP_NESTING - 1) == DEEP_NESTING - 1 &&
+        source_index_depth(&index, buffer + DEEP_NESTING) == DEEP_NESTING - 1 &&
+        index.match[0] == 2 * DEEP_NESTING - 1;
+    free_source_index(&index);
+    free(buffer);
+    return !check("(deep nesting) 70000 open brackets", passed);
+}
+
+int test_index() {
+    printf("Running test_index() ...\n");
+    int n_failed_tests = test_fixture(cases, case_func, TEST_INPUT_STRING);
+    n_failed_tests += test_deep_nesting();
+    return n_failed_tests;
+}
@@ -0,0 +1,70 @@
+#include "tests.h"
+#include "../lexer.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+
+const static Case_t cases[] = {
+    {false, "", NULL},
+    {false, "   ", NULL},
+    {true,  "x", "id:x"},
+    {true,  "int x = 5;", "kw:int id:x =:= int:5 ;:;"},
+    {true,  "  unsigned long long\tx\n", "kw:unsigned kw:long kw:long id:x"},
+    {true,  "char str[0xda]", "kw:char id:str [:[ int:0xda ]:]"},
+    {true,  "str = \"a \\\" b\"", "id:str =:= str:\"a \\\" b\""},
+    {true,  "c = '\\''", "id:c =:= char:'\\''"},
+    {true,  "x <<= y >> z", "id:x <<=:<<= id:y >>:>> id:z"},
+    {true,  "p->q.r", "id:p ->:-> id:q .:. id:r"},
+    {true,  "----time", "-:- -:- -:- -:- id:time"},
+    {true,  "a&&b&c||d|e", "id:a &&:&& id:b &:& id:c ||:|| id:d |:| id:e"},
+    {true,  "f(a, b)[2]{}", "id:f (:( id:a ,:, id:b ):) [:[ int:2 ]:] {:{ }:}"},
+    {true,  "iffy if", "id:iffy kw:if"},
+    {false, "int$ wrong", NULL},
+    {false, "x = \"unterminated", NULL},
+    {false, "x = 'u", NULL},
+    {false, NULL, NULL}
+};
+
+const static char *token_variant_strs[] = {
+    "id",
+    "kw",
+    "int",
+    "str",
+    "char",
+    NULL
+};
+
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    TryTokenArray_t tokens = lex(str);
+    GrammarPropagateError(tokens, output);
+    if (tokens.value.n_tokens == 0) {
+        free_token_array(&tokens.value);
+        output.status = TRY_NONE;
+        return output;
+    }
+    size_t num_chars = 0;
+    for (size_t i = 0; i < tokens.value.n_tokens; ++i) {
+        const Token_t *token = &tokens.value.tokens[i];
+        if (i > 0) {
+            num_chars += sprintf(buffer + num_chars, " ");
+        }
+        if (token->variant == TOKEN_PUNCTUATOR) {
+            num_chars += sprintf(buffer + num_chars, "%.*s:", (int)token->length, token->str.begin);
+        }
+        else {
+            num_chars += sprintf(buffer + num_chars, "%s:", token_variant_strs[token->variant]);
+        }
+        num_chars += sprintf(buffer + num_chars, "%.*s", (int)token->length, str.begin + token->offset);
+    }
+    free_token_array(&tokens.value);
+    output.status = TRY_SUCCESS;
+    output.value = buffer;
+    return output;
+}
+
+int test_lexer() {
+    printf("Running test_lexer() ...\n");
+    return test_fixture(cases, case_func, TEST_INPUT_STRING);
+}
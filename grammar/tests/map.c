@@ -0,0 +1,160 @@
+#include "tests.h"
+#include "../grammar.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static uint32_t hash_clustered(const uint32_t key) {
+    // Consecutive keys share home slots, which makes long probe runs
+    return key / 4;
+}
+
+static int cmp_uint32(const uint32_t a, const uint32_t b) {
+    return a < b ? -1 : a > b;
+}
+
+DEFINE_HASHMAP(Clustered, uint32_t, uint32_t, const uint32_t, const uint32_t, hash_clustered, cmp_uint32)
+DEFINE_HASHMAP(SymbolCount, const Symbol_t *, uint32_t, const Symbol_t *const, const uint32_t, hash_symbol, cmp_symbol)
+DEFINE_ORDERED_MAP(Ordered, uint32_t, uint32_t, const uint32_t, const uint32_t, cmp_uint32)
+
+#define N_KEYS 4096
+
+static void sum_values(const ClusteredMapSlot_t *slot, void *args) {
+    *(uint64_t *)args += slot->value;
+}
+
+/**
+ * Random inserts and removals checked against a plain array
+ */
+static int test_clustered() {
+    static bool present[N_KEYS];
+    int n_failed_tests = 0;
+    ClusteredMap_t map;
+    memset(&map, 0, sizeof(ClusteredMap_t));
+    memset(present, 0, sizeof(present));
+    uint32_t state = 12345;
+    bool consistent = true;
+    for (int i = 0; i < 20 * N_KEYS; ++i) {
+        state = state * 1103515245u + 12345u;
+        const uint32_t key = (state >> 8) % N_KEYS;
+        if ((state >> 4) & 1) {
+            consistent = consistent && (ClusteredMap_insert(&map, key, 2 * key) != NULL) == !present[key];
+            present[key] = true;
+        }
+        else {
+            consistent = consistent && ClusteredMap_remove(&map, key) == present[key];
+            present[key] = false;
+        }
+    }
+    uint32_t n_present = 0;
+    uint64_t expected_sum = 0;
+    for (uint32_t key = 0; key < N_KEYS; ++key) {
+        const ClusteredMapSlot_t *slot = ClusteredMap_find(&map, key);
+        consistent = consistent && (slot != NULL) == present[key] && (!slot || slot->value == 2 * key);
+        n_present += present[key];
+        expected_sum += present[key] ? 2 * key : 0;
+    }
+    uint64_t sum = 0;
+    ClusteredMap_foreach(&map, sum_values, &sum);
+    n_failed_tests += !check("(clustered) insert/remove agree with reference", consistent);
+    n_failed_tests += !check("(clustered) size and foreach", map.size == n_present && sum == expected_sum);
+    ClusteredMap_free(&map);
+    n_failed_tests += !check("(clustered) empty after free", map.size == 0 && !ClusteredMap_find(&map, 0));
+    return n_failed_tests;
+}
+
+static int test_symbols() {
+    int n_failed_tests = 0;
+    SymbolCountMap_t map;
+    memset(&map, 0, sizeof(SymbolCountMap_t));
+    const char *words[] = { "int", "x", "int", "y", "x", "int" };
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); ++i) {
+        const Symbol_t *symbol = intern_cstr(words[i]);
+        SymbolCountMapSlot_t *slot = SymbolCountMap_insert(&map, symbol, 1);
+        if (!slot) {
+            // Find only hands out const slots, so count through a removal
+            const uint32_t count = SymbolCountMap_find(&map, symbol)->value;
+            SymbolCountMap_remove(&map, symbol);
+            SymbolCountMap_insert(&map, symbol, count + 1);
+        }
+    }
+    const SymbolCountMapSlot_t *ints = SymbolCountMap_find(&map, intern_cstr("int"));
+    const SymbolCountMapSlot_t *xs = SymbolCountMap_find(&map, intern_cstr("x"));
+    n_failed_tests += !check("(symbols) counts",
+        map.size == 3 && ints && ints->value == 3 && xs && xs->value == 2 && !SymbolCountMap_find(&map, intern_cstr("z")));
+    SymbolCountMap_free(&map);
+    return n_failed_tests;
+}
+
+typedef struct {
+    uint32_t n_visited;
+    uint32_t prev;
+    bool ascending;
+} OrderCheck_t;
+
+static void check_order(const OrderedMapNode_t *node, void *args) {
+    OrderCheck_t *order = args;
+    order->ascending = order->ascending && (!order->n_visited || order->prev < node->key) && node->value == node->key + 1;
+    order->prev = node->key;
+    ++order->n_visited;
+}
+
+/**
+ * An AVL tree of n nodes is at most 1.44 log2(n + 2) high
+ */
+static int32_t max_avl_height(const uint32_t n) {
+    int32_t log2_ceil = 0;
+    for (uint64_t m = 1; m < (uint64_t)n + 2; m *= 2) {
+        ++log2_ceil;
+    }
+    return 3 * log2_ceil / 2;
+}
+
+/**
+ * Random and sorted insertion orders both keep the tree within the AVL height
+ * bound and iterate in ascending order
+ */
+static int test_ordered() {
+    static bool present[N_KEYS];
+    int n_failed_tests = 0;
+    OrderedMapNode_t *root = NULL;
+    memset(present, 0, sizeof(present));
+    uint32_t state = 54321;
+    uint32_t n_present = 0;
+    bool consistent = true;
+    for (int i = 0; i < 2 * N_KEYS; ++i) {
+        state = state * 1103515245u + 12345u;
+        const uint32_t key = (state >> 8) % N_KEYS;
+        consistent = consistent && (OrderedMap_insert(&root, key, key + 1) != NULL) == !present[key];
+        n_present += !present[key];
+        present[key] = true;
+    }
+    for (uint32_t key = 0; key < N_KEYS; ++key) {
+        const OrderedMapNode_t *node = OrderedMap_find(root, key);
+        consistent = consistent && (node != NULL) == present[key] && (!node || node->value == key + 1);
+    }
+    OrderCheck_t order = { 0, 0, true };
+    OrderedMap_foreach(root, check_order, &order);
+    n_failed_tests += !check("(ordered) random insert and find", consistent);
+    n_failed_tests += !check("(ordered) random foreach ascending", order.ascending && order.n_visited == n_present);
+    n_failed_tests += !check("(ordered) random height", root->height <= max_avl_height(n_present));
+    OrderedMap_free(&root);
+
+    const uint32_t n_sorted = 1 << 20;
+    for (uint32_t key = 0; key < n_sorted; ++key) {
+        OrderedMap_insert(&root, key, key + 1);
+    }
+    order = (OrderCheck_t){ 0, 0, true };
+    OrderedMap_foreach(root, check_order, &order);
+    n_failed_tests += !check("(ordered) sorted foreach ascending", order.ascending && order.n_visited == n_sorted);
+    n_failed_tests += !check("(ordered) sorted height", root->height <= max_avl_height(n_sorted));
+    OrderedMap_free(&root);
+    n_failed_tests += !check("(ordered) empty after free", !root && !OrderedMap_find(root, 0));
+    return n_failed_tests;
+}
+
+int test_map() {
+    printf("Running test_map() ...\n");
+    return test_clustered() + test_symbols() + test_ordered();
+}
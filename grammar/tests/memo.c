@@ -0,0 +1,104 @@
+#include "tests.h"
+#include "../grammar.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const static Case_t cases[] = {
+    {true,  "int x = 5", NULL},
+    {true,  "const char *str = \"hello\"", NULL},
+    {true,  "(const void *)(const uint8_t *)bytes", NULL},
+    {true,  "result = (*args->func)(1, 2, 3)", NULL},
+    {true,  "size_t sz = sizeof(char) * sizeof(int)", NULL},
+    {true,  "x = ((((y))))", "x = y"},
+    {true,  "int (*fp)(int, char) = (int (*)(int, char))table[0]", NULL},
+    {true,  "x = (y) - (int)z", "x = y - (int)z"},
+    {false, "other = int x", NULL},
+    {false, "(34567)thing", NULL},
+    {false, NULL, NULL}
+};
+
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    static char unmemoized_buffer[0x10000];
+
+    TryOperator_t unmemoized = parse_operator(str);
+    set_parse_memo_enabled(true);
+    TryOperator_t op = parse_operator(str);
+    set_parse_memo_enabled(false);
+
+    if (op.status != unmemoized.status) {
+        output.status = TRY_ERROR;
+        output.error.location = str;
+        output.error.desc = "Memoized parse has a different status";
+        return output;
+    }
+    if (op.status != TRY_SUCCESS) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    Sink_t sink = new_buffer_sink();
+    print_operator(&sink, &op.value);
+    snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+    reset_sink(&sink);
+    print_operator(&sink, &unmemoized.value);
+    snprintf(unmemoized_buffer, sizeof(unmemoized_buffer), "%s", sink_str(&sink));
+    free_sink(&sink);
+    if (strcmp(buffer, unmemoized_buffer)) {
+        output.status = TRY_ERROR;
+        output.error.location = str;
+        output.error.desc = "Memoized parse has a different result";
+        return output;
+    }
+    output.status = TRY_SUCCESS;
+    output.value = buffer;
+    return output;
+}
+
+/**
+ * Memoized parse in a context, where rolling back a speculative parse must
+ * also drop the results stored since the checkpoint
+ */
+static TryCharPtr_t context_case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    set_parse_memo_enabled(true);
+    TryOperator_t op = parse_operator(str);
+    set_parse_memo_enabled(false);
+    attach_parse_context(prev_context);
+
+    if (op.status == TRY_SUCCESS) {
+        Sink_t sink = new_buffer_sink();
+        print_operator(&sink, &op.value);
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+        free_sink(&sink);
+        output.status = TRY_SUCCESS;
+        output.value = buffer;
+    }
+    else if (context->arena.allocated) {
+        output.status = TRY_ERROR;
+        output.error.location = str;
+        output.error.desc = "Failed parse left nodes in the arena";
+    }
+    else {
+        output.status = TRY_NONE;
+    }
+    free_parse_context(context);
+    return output;
+}
+
+int test_memo() {
+    printf("Running test_memo() ...\n");
+    reset_parse_memo_stats();
+    int n_failures = test_fixture(cases, case_func, TEST_INPUT_STRING);
+    n_failures += test_fixture(cases, context_case_func, TEST_INPUT_STRING);
+    ParseMemoStats_t stats = get_parse_memo_stats();
+    for (int i = 0; i < N_MEMO_PRODUCTIONS; ++i) {
+        printf("  %-16s %6lu hits %6lu misses\n", memo_production_str(i), stats.hits[i], stats.misses[i]);
+    }
+    return n_failures;
+}
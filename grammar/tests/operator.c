@@ -49,6 +49,12 @@ const static Case_t cases[] = {
     {true,  "bool z = !t", NULL},
     {true,  "bool a = !!t && x", NULL},
     {true,  "uint64_t x = ~4", NULL},
+    {true,  "uint64_t x = 0x1f + 017 + 0 + 5u + 6l + 7ul + 8ll + 9ull", NULL},
+    {true,  "uint64_t x = 0X1F + 5U + 6LU + 7uLL", "uint64_t x = 0x1f + 5u + 6ul + 7ull"},
+    {false, "int x = 5lL", NULL},
+    {false, "int x = 08", NULL},
+    {false, "int x = 5uu", NULL},
+    {false, "int x = 18446744073709551616", NULL},
     {true,  "(int)x", NULL},
     {true,  "(const DerivedType *)der", NULL},
     {true,  "(const void *)(const uint8_t *)bytes", NULL},
@@ -66,6 +72,7 @@ const static Case_t cases[] = {
     {true,  "result = func()", NULL},
     {true,  "result = func(1, 2, 3)", NULL},
     {true,  "result = (*args->func)(1, 2, 3)", NULL},
+    {true,  "result = func(\")\", ')', \"(\")", NULL},
     {true,  "item = things[3]", NULL},
     {true,  "item = things[i]", NULL},
     {true,  "item = things[i][j][k]", NULL},
@@ -76,6 +83,19 @@ const static Case_t cases[] = {
     {true,  "(vec3 *const )pt.x = 6", NULL},
     {true,  "x.value.pointer->object.member->ref = \"Hello\"", NULL},
     {true,  "int x = (x + y) * z", NULL},
+    {true,  "x = a - b - c", NULL},
+    {true,  "x = a - (b - c)", NULL},
+    {true,  "x = (a - b) - c", "x = a - b - c"},
+    {true,  "x = y = z", NULL},
+    {true,  "x = a ? b : c ? d : e", NULL},
+    {true,  "x = (a ? b : c) ? d : e", NULL},
+    {true,  "x = ((a ? b : c) ? d : e) ? f : g", NULL},
+    {true,  "x = (a = b) ? c : d", NULL},
+    {true,  "x = (y) - z", "x = y - z"},
+    {true,  "x = (char)-z", NULL},
+    {true,  "x = sizeof(int) / sizeof(ptr[0])", NULL},
+    {false, "x = a +", NULL},
+    {false, "x = (a + b", NULL},
     {false, NULL, NULL}
 };
 
@@ -84,7 +104,10 @@ static TryCharPtr_t case_func(const ConstString_t str) {
     static char buffer[0x10000];
     TryOperator_t op = parse_operator(str);
     if (op.status == TRY_SUCCESS) {
-        print_operator(buffer, &op.value);
+        Sink_t sink = new_buffer_sink();
+        print_operator(&sink, &op.value);
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+        free_sink(&sink);
         output.status = TRY_SUCCESS;
         output.value = buffer;
         return output;
@@ -0,0 +1,146 @@
+#include "tests.h"
+#include "../grammar.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFFER_LEN (64 * 40 + 37)
+#define N_QUERIES 2000
+
+const static char *classifier_strs[] = {
+    "scalar",
+    "SSE2",
+    "AVX2"
+};
+
+/**
+ * Structural characters, their neighbours in ASCII and the bytes that are
+ * negative as signed chars, which the vector compares must not take for
+ * letters or digits
+ */
+const static char edge_chars[] =
+    " \t\n\r\v\f([{)]}\"'\\;,_"
+    "09/:" "azAZ`@{[" "\x7f\x80\x81\xc1\xda\xdf\xe0\xfa\xfb\xff";
+
+static uint32_t next_random(uint32_t *const state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static bool has_class(const StructuralBitmaps_t *const bitmaps, const uint32_t classes, const size_t offset) {
+    for (int c = 0; c < N_SCAN_CLASSES; ++c) {
+        if ((classes & SCAN_CLASS(c)) && (bitmaps->words[c * bitmaps->n_words + offset / 64] >> (offset % 64) & 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * `scan_next` one byte at a time
+ */
+static const char *reference_next(const StructuralBitmaps_t *const bitmaps, const uint32_t classes, const char *from, const char *const limit, const bool invert) {
+    while (from < limit && has_class(bitmaps, classes, from - bitmaps->source.begin) == invert) {
+        ++from;
+    }
+    return from < limit ? from : limit;
+}
+
+/**
+ * Every classifier gives the scalar bitmaps, and `scan_next` over them agrees
+ * with a byte loop for random class sets and ranges
+ */
+static int test_buffer(const char *const name, const ConstString_t str) {
+    int n_failed_tests = 0;
+    char message[0x100];
+    StructuralBitmaps_t scalar = scan_structure_with(str, SCAN_CLASSIFIER_SCALAR);
+    for (int variant = 0; variant < N_SCAN_CLASSIFIERS; ++variant) {
+        if (!has_scan_classifier(variant)) {
+            continue;
+        }
+        StructuralBitmaps_t bitmaps = scan_structure_with(str, variant);
+        if (variant != SCAN_CLASSIFIER_SCALAR) {
+            snprintf(message, sizeof(message), "(%s) %s classifies like scalar", name, classifier_strs[variant]);
+            n_failed_tests += !check(message,
+                bitmaps.n_words == scalar.n_words &&
+                !memcmp(bitmaps.words, scalar.words, scalar.n_words * N_SCAN_CLASSES * sizeof(uint64_t)));
+        }
+
+        const size_t len = str.end - str.begin;
+        uint32_t state = 2463534242u;
+        bool agrees = true;
+        for (int i = 0; i < N_QUERIES && agrees; ++i) {
+            const uint32_t classes = next_random(&state) & (SCAN_CLASS(N_SCAN_CLASSES) - 1);
+            const char *from = str.begin + next_random(&state) % (len + 1);
+            const char *limit = from + next_random(&state) % (str.end - from + 1);
+            agrees =
+                scan_next(&bitmaps, classes, from, limit) == reference_next(&scalar, classes, from, limit, false) &&
+                scan_next_not(&bitmaps, classes, from, limit) == reference_next(&scalar, classes, from, limit, true);
+        }
+        snprintf(message, sizeof(message), "(%s) %s scan_next agrees with a byte loop", name, classifier_strs[variant]);
+        n_failed_tests += !check(message, agrees);
+        free_structural_bitmaps(&bitmaps);
+    }
+    free_structural_bitmaps(&scalar);
+    return n_failed_tests;
+}
+
+/**
+ * Known classes for a few characters, so that the scalar classifier the
+ * others are compared to is itself right
+ */
+static int test_known_classes() {
+    const ConstString_t str = const_string_from_cstr("a_9 ({\"\\;,)\x80");
+    const uint32_t expected[] = {
+        SCAN_CLASS(SCAN_IDENTIFIER), SCAN_CLASS(SCAN_IDENTIFIER), SCAN_CLASS(SCAN_IDENTIFIER),
+        SCAN_CLASS(SCAN_WHITESPACE), SCAN_CLASS(SCAN_OPEN_BRACKET), SCAN_CLASS(SCAN_OPEN_BRACKET),
+        SCAN_CLASS(SCAN_QUOTE), SCAN_CLASS(SCAN_ESCAPE), SCAN_CLASS(SCAN_SEMICOLON),
+        SCAN_CLASS(SCAN_COMMA), SCAN_CLASS(SCAN_CLOSE_BRACKET), 0
+    };
+    StructuralBitmaps_t bitmaps = scan_structure_with(str, SCAN_CLASSIFIER_SCALAR);
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i) {
+        for (int c = 0; c < N_SCAN_CLASSES; ++c) {
+            passed = passed && has_class(&bitmaps, SCAN_CLASS(c), i) == !!(expected[i] & SCAN_CLASS(c));
+        }
+    }
+    free_structural_bitmaps(&bitmaps);
+    return !check("(known classes) a_9 ({\"\\;,)\\x80", passed);
+}
+
+int test_scan() {
+    printf("Running test_scan() ...\n");
+    int n_failed_tests = test_known_classes();
+    char *buffer = malloc(BUFFER_LEN);
+    ConstString_t str;
+    str.begin = buffer;
+    str.end = buffer + BUFFER_LEN;
+    uint32_t state = 88172645u;
+
+    for (size_t i = 0; i < BUFFER_LEN; ++i) {
+        buffer[i] = (char)next_random(&state);
+    }
+    n_failed_tests += test_buffer("random bytes", str);
+
+    for (size_t i = 0; i < BUFFER_LEN; ++i) {
+        buffer[i] = edge_chars[next_random(&state) % (sizeof(edge_chars) - 1)];
+    }
+    n_failed_tests += test_buffer("edge characters", str);
+
+    // Every byte value, at a different offset in its block on each pass
+    for (size_t i = 0; i < BUFFER_LEN; ++i) {
+        buffer[i] = (char)(i + i / 256);
+    }
+    n_failed_tests += test_buffer("all bytes", str);
+
+    // Shorter than a block, so only the zero-padded tail is classified
+    str.end = buffer + 37;
+    n_failed_tests += test_buffer("short tail", str);
+
+    free(buffer);
+    return n_failed_tests;
+}
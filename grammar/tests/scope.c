@@ -37,6 +37,7 @@ const static Case_t cases[] = {
     {true,  "tests/grammar/scope/cond15-else_stmt.in", NULL},
     {true,  "tests/grammar/scope/cond16-fake_else.in", NULL},
     {true,  "tests/grammar/scope/cond17-else_if.in", NULL},
+    {true,  "tests/grammar/scope/cond18-do_while.in", NULL},
     {true,  "tests/grammar/scope/func0.in", NULL},
     {true,  "tests/grammar/scope/func1-return_func.in", NULL},
     {true,  "tests/grammar/scope/func2-func_error.in", "tests/grammar/scope/func2-func_error.out"},
@@ -48,7 +49,10 @@ static TryCharPtr_t case_func(const ConstString_t str) {
     static char buffer[0x10000];
     ErrorLinkedListNode_t *errors = NULL;
     ErrorLinkedListNode_t **errors_head = &errors;
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
     TryScope_t op = parse_scope(str, &errors_head);
+    attach_parse_context(prev_context);
 
     ErrorLinkedListNode_t *it = errors;
     while (it) {
@@ -58,22 +62,85 @@ static TryCharPtr_t case_func(const ConstString_t str) {
     }
 
     if (op.status == TRY_SUCCESS) {
-        print_scope(buffer, &op.value, -1);
+        Sink_t sink = new_buffer_sink();
+        print_scope(&sink, &op.value, -1);
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+        free_sink(&sink);
         buffer[strlen(buffer) - 1] = 0;
         output.status = TRY_SUCCESS;
         output.value = buffer;
-        return output;
     }
     else if (op.status == TRY_ERROR) {
-        GrammarPropagateError(op, output);
+        output.status = TRY_ERROR;
+        output.error = op.error;
     }
     else {
         output.status = TRY_NONE;
-        return output;
     }
+    free_parse_context(context);
+    return output;
+}
+
+/**
+ * Statements split on the tokens: keywords are whole tokens, and brackets
+ * inside literals do not nest
+ */
+const static Case_t string_cases[] = {
+    {true,  "if (x) y = 1; else return 0;", "if (x) y = 1;\nelse return 0;"},
+    {true,  "if (x) y = 1;\nelsewhere = 2;", "if (x) y = 1;\nelsewhere = 2;"},
+    {true,  "returned = 1; doubled = 2;", "returned = 1;\ndoubled = 2;"},
+    {true,  "int f() {}", "int f() { }"},
+    {true,  "s = \"{(\"; c = ';';", "s = \"{(\";\nc = ';';"},
+    {true,  "struct S { int a; } s; int f(struct S *p) { return p->a; }", "struct S { int a; } s;\nint f(struct S *p) {\n    return p->a;\n}"},
+    {true,  "do x += 1; while (x < 3);", "do x += 1; while (x < 3);"},
+    {false, "if (x { y = 1; }", NULL},
+    {false, "x = 1 $ 2;", NULL},
+    {false, "for (i = 0) { }", NULL},
+    {false, NULL, NULL}
+};
+
+const static Case_t file_cases[] = {
+    {true,  "tests/grammar/scope/basic0.in", "{\n    int x = 0;\n    const char *str = \"Hello World;\";\n    struct Result_t res = func(x, str);\n}"},
+    {true,  "tests/grammar/scope/basic4-empty.in", "{ }"},
+    {true,  "tests/grammar/scope/basic8-global.in", "int x = 0;\nconst char *str = \"Hello World;\";\nstruct Result_t res = func(x, str);"},
+    {false, "tests/grammar/scope/does_not_exist.in", NULL},
+    {false, NULL, NULL}
+};
+
+static TryCharPtr_t file_case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    static char path[0x100];
+    snprintf(path, sizeof(path), "%.*s", (int)(str.end - str.begin), str.begin);
+    ErrorLinkedListNode_t *errors = NULL;
+    ErrorLinkedListNode_t **errors_head = &errors;
+    ParseContext_t *context = new_parse_context();
+    TryScope_t op = parse_file(path, context, &errors_head);
+
+    if (op.status == TRY_SUCCESS) {
+        // The AST points into the mapping, so print before the context is freed
+        Sink_t sink = new_buffer_sink();
+        print_scope(&sink, &op.value, -1);
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+        free_sink(&sink);
+        buffer[strlen(buffer) - 1] = 0;
+        output.status = TRY_SUCCESS;
+        output.value = buffer;
+    }
+    else if (op.status == TRY_ERROR) {
+        output.status = TRY_ERROR;
+        output.error = op.error;
+    }
+    else {
+        output.status = TRY_NONE;
+    }
+    free_parse_context(context);
+    return output;
 }
 
 int test_scope() {
     printf("Running test_scope() ...\n");
-    return test_fixture(cases, case_func, TEST_INPUT_FILE);
+    return test_fixture(cases, case_func, TEST_INPUT_FILE) +
+        test_fixture(string_cases, case_func, TEST_INPUT_STRING) +
+        test_fixture(file_cases, file_case_func, TEST_INPUT_STRING);
 }
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "tests.h"
+#include "../grammar.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+const static Case_t cases[] = {
+    {true,  "tests/grammar/scope/basic0.in", NULL},
+    {true,  "tests/grammar/scope/basic4-empty.in", NULL},
+    {true,  "tests/grammar/scope/basic5-struct.in", NULL},
+    {true,  "tests/grammar/scope/basic6-typedef.in", NULL},
+    {true,  "tests/grammar/scope/basic8-global.in", NULL},
+    {true,  "tests/grammar/scope/nested2-functions.in", NULL},
+    {true,  "tests/grammar/scope/cond1-for.in", NULL},
+    {true,  "tests/grammar/scope/cond6-for_no_check.in", "tests/grammar/scope/cond6-for_no_check.out"},
+    {true,  "tests/grammar/scope/cond12-return_value.in", NULL},
+    {true,  "tests/grammar/scope/cond17-else_if.in", NULL},
+    {true,  "tests/grammar/scope/func1-return_func.in", NULL},
+    {false, NULL, NULL}
+};
+
+/**
+ * Parse, save and free the AST, then load it into a fresh context and print
+ * it; the first statement's location must also survive the round trip
+ */
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    static char path[0x100];
+    snprintf(path, sizeof(path), "/tmp/metac_serialize_%d.ast", (int)getpid());
+
+    ErrorLinkedListNode_t *errors = NULL;
+    ErrorLinkedListNode_t **errors_head = &errors;
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryScope_t parsed = parse_scope(str, &errors_head);
+    attach_parse_context(prev_context);
+    if (parsed.status != TRY_SUCCESS) {
+        free_parse_context(context);
+        output.status = TRY_NONE;
+        return output;
+    }
+    size_t first_offset = 0;
+    if (parsed.value.statements.size) {
+        first_offset = parsed.value.statements.items[0].str.begin - str.begin;
+    }
+    TrySize_t saved = save_scope(path, &parsed.value, str, true);
+    free_parse_context(context);
+    if (saved.status != TRY_SUCCESS) {
+        output.status = TRY_ERROR;
+        output.error = saved.error;
+        return output;
+    }
+
+    context = new_parse_context();
+    TryScope_t loaded = load_scope(path, context);
+    unlink(path);
+    if (loaded.status != TRY_SUCCESS) {
+        free_parse_context(context);
+        output.status = TRY_ERROR;
+        output.error = loaded.error;
+        return output;
+    }
+    if (loaded.value.statements.size) {
+        const ConstString_t loc = loaded.value.statements.items[0].str;
+        if (loc.end - loc.begin < 1 || memcmp(loc.begin, str.begin + first_offset, loc.end - loc.begin)) {
+            free_parse_context(context);
+            output.status = TRY_ERROR;
+            output.error.location = str;
+            output.error.desc = "Statement location was not preserved";
+            return output;
+        }
+    }
+
+    Sink_t sink = new_buffer_sink();
+    print_scope(&sink, &loaded.value, -1);
+    snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+    free_sink(&sink);
+    buffer[strlen(buffer) - 1] = 0;
+    output.status = TRY_SUCCESS;
+    output.value = buffer;
+    free_parse_context(context);
+    return output;
+}
+
+/**
+ * Files that are not ASTs must be rejected rather than loaded
+ */
+static int test_load_invalid() {
+    ParseContext_t *context = new_parse_context();
+    int n_failed_tests = 0;
+    const char *paths[] = { "tests/grammar/scope/basic0.in", "tests/grammar/scope/does_not_exist.ast" };
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); ++i) {
+        char message[0x200];
+        TryScope_t loaded = load_scope(paths[i], context);
+        if (loaded.status == TRY_ERROR) {
+            snprintf(message, sizeof(message), "(expected failure, got \"%s\") %s", loaded.error.desc, paths[i]);
+            print_pass(message);
+        }
+        else {
+            snprintf(message, sizeof(message), "(expected failure) %s", paths[i]);
+            print_fail(message);
+            ++n_failed_tests;
+        }
+    }
+    free_parse_context(context);
+    return n_failed_tests;
+}
+
+/**
+ * An array size that is not constant on its own is stored parsed
+ */
+static int test_array_size() {
+    static char path[0x100];
+    snprintf(path, sizeof(path), "/tmp/metac_serialize_size_%d.ast", (int)getpid());
+    const ConstString_t str = const_string_from_cstr("char a[sizeof(int) + 1];");
+    ErrorLinkedListNode_t *errors = NULL;
+    ErrorLinkedListNode_t **errors_head = &errors;
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryScope_t parsed = parse_scope(str, &errors_head);
+    attach_parse_context(prev_context);
+    bool saved = parsed.status == TRY_SUCCESS && save_scope(path, &parsed.value, str, true).status == TRY_SUCCESS;
+    const Expression_t *saved_expr = saved ? parsed.value.statements.items[0].declaration->type->array.size_expr : NULL;
+    free_parse_context(context);
+
+    context = new_parse_context();
+    TryScope_t loaded;
+    loaded.status = TRY_NONE;
+    if (saved) {
+        loaded = load_scope(path, context);
+        unlink(path);
+    }
+    bool passed = false;
+    if (loaded.status == TRY_SUCCESS && loaded.value.statements.size == 1 &&
+            loaded.value.statements.items[0].variant == STATEMENT_DECLARATION) {
+        const DerivedType_t *type = loaded.value.statements.items[0].declaration->type;
+        if (type->variant == DERIVED_TYPE_ARRAY && !type->array.is_size_constant &&
+                type->array.size_expr && type->array.size_expr != saved_expr) {
+            Sink_t sink = new_buffer_sink();
+            print_expression(&sink, type->array.size_expr, NULL);
+            passed = !strcmp(sink_str(&sink), "sizeof(int) + 1");
+            free_sink(&sink);
+        }
+    }
+    free_parse_context(context);
+    return !check("(array size) kept parsed across a round trip", passed);
+}
+
+/**
+ * Without a copy of the source, locations come from the source given to the
+ * loader, which must be the one that was saved
+ */
+static int test_no_copy() {
+    static char path[0x100];
+    snprintf(path, sizeof(path), "/tmp/metac_serialize_no_copy_%d.ast", (int)getpid());
+    const ConstString_t str = const_string_from_cstr("int x; x = 1;");
+    const ConstString_t other = const_string_from_cstr("int y; y = 1;");
+    ErrorLinkedListNode_t *errors = NULL;
+    ErrorLinkedListNode_t **errors_head = &errors;
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryScope_t parsed = parse_scope(str, &errors_head);
+    attach_parse_context(prev_context);
+    const bool saved = parsed.status == TRY_SUCCESS && save_parse_result(path, &parsed, NULL, str, false).status == TRY_SUCCESS;
+    free_parse_context(context);
+
+    context = new_parse_context();
+    TryScope_t loaded;
+    const bool matched = saved && !load_parse_result(path, context, str, &loaded, NULL) &&
+        loaded.value.statements.size == 2 && loaded.value.statements.items[1].str.begin == str.begin + 7;
+    TryScope_t without_source = load_scope(path, context);
+    const bool empty = without_source.status == TRY_SUCCESS && !without_source.value.statements.items[0].str.begin;
+    const bool rejected = load_parse_result(path, context, other, &loaded, NULL) != NULL;
+    unlink(path);
+    free_parse_context(context);
+    return !check("(no source copy) locations refer to the given source", matched && empty && rejected);
+}
+
+/**
+ * Loaded types are interned in the context they are loaded into, so they are
+ * the same nodes as the types it already parsed
+ */
+static int test_canonical_types() {
+    static char path[0x100];
+    snprintf(path, sizeof(path), "/tmp/metac_serialize_types_%d.ast", (int)getpid());
+    const ConstString_t str = const_string_from_cstr("int a; int *b; int *c;");
+    ErrorLinkedListNode_t *errors = NULL;
+    ErrorLinkedListNode_t **errors_head = &errors;
+    ParseContext_t *context = new_parse_context();
+    ParseContext_t *prev_context = attach_parse_context(context);
+    TryScope_t parsed = parse_scope(str, &errors_head);
+    attach_parse_context(prev_context);
+    const bool saved = parsed.status == TRY_SUCCESS && save_scope(path, &parsed.value, str, false).status == TRY_SUCCESS;
+    free_parse_context(context);
+
+    context = new_parse_context();
+    prev_context = attach_parse_context(context);
+    TryScope_t existing = parse_scope(const_string_from_cstr("int x;"), &errors_head);
+    attach_parse_context(prev_context);
+    TryScope_t loaded = load_scope(path, context);
+    unlink(path);
+    bool passed = saved && existing.status == TRY_SUCCESS && loaded.status == TRY_SUCCESS;
+    if (passed) {
+        const Statement_t *stmts = loaded.value.statements.items;
+        passed =
+            stmts[0].declaration->type == existing.value.statements.items[0].declaration->type &&
+            stmts[1].declaration->type == stmts[2].declaration->type &&
+            stmts[1].declaration->type->pointer.inner_type == stmts[0].declaration->type;
+    }
+    free_parse_context(context);
+    return !check("(canonical types) loaded types are interned in the context", passed);
+}
+
+int test_serialize() {
+    printf("Running test_serialize() ...\n");
+    return test_fixture(cases, case_func, TEST_INPUT_FILE) + test_load_invalid() + test_array_size() + test_no_copy() + test_canonical_types();
+}
@@ -0,0 +1,92 @@
+#include "tests.h"
+#include "../grammar.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const static Case_t cases[] = {
+    {true,  "int x", NULL},
+    {true,  "const char *const *argv[]", NULL},
+    {true,  "int (*(*table[4])(char *, int))[8]", NULL},
+    {true,  "struct Point { int x; int y; } p", "struct Point { int x; int y; } p"},
+    {true,  "enum Color { RED, GREEN = 4, BLUE } c", "enum Color { RED = 0, GREEN = 4, BLUE = 5 } c"},
+    {false, NULL, NULL}
+};
+
+static void append_callback(void *const user, const char *const str, const size_t len) {
+    Sink_t *buffer = user;
+    sink_write(buffer, str, len);
+}
+
+/**
+ * Print through every kind of sink and check that they agree
+ */
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    TryVariable_t var = parse_variable(str);
+    if (var.status != TRY_SUCCESS) {
+        output.status = TRY_NONE;
+        return output;
+    }
+
+    Sink_t buffer_sink = new_buffer_sink();
+    const size_t len = print_variable(&buffer_sink, &var.value);
+
+    Sink_t collected = new_buffer_sink();
+    Sink_t callback_sink = new_callback_sink(append_callback, &collected);
+    print_variable(&callback_sink, &var.value);
+
+    char file_buffer[0x1000] = { 0 };
+    FILE *fp = fmemopen(file_buffer, sizeof(file_buffer), "w");
+    Sink_t file_sink = new_file_sink(fp);
+    print_variable(&file_sink, &var.value);
+    fclose(fp);
+
+    if (    len != strlen(sink_str(&buffer_sink)) ||
+            strcmp(sink_str(&buffer_sink), sink_str(&collected)) ||
+            strcmp(sink_str(&buffer_sink), file_buffer) ||
+            file_sink.written != len) {
+        output.status = TRY_ERROR;
+        output.error.location = str;
+        output.error.desc = "Sinks disagree";
+    }
+    else {
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&buffer_sink));
+        output.status = TRY_SUCCESS;
+        output.value = buffer;
+    }
+    free_sink(&buffer_sink);
+    free_sink(&collected);
+    return output;
+}
+
+/**
+ * A struct far larger than any fixed print buffer
+ */
+static int test_large_definition() {
+    const size_t n_fields = 20000;
+    Sink_t source = new_buffer_sink();
+    sink_puts(&source, "struct Big { ");
+    for (size_t i = 0; i < n_fields; ++i) {
+        sink_printf(&source, "int field%zu; ", i);
+    }
+    sink_puts(&source, "} big");
+
+    TryVariable_t var = parse_variable(const_string_from_cstr(sink_str(&source)));
+    Sink_t printed = new_buffer_sink();
+    if (var.status == TRY_SUCCESS) {
+        print_variable(&printed, &var.value);
+    }
+    const bool passed = check("(expected round trip) large struct definition",
+        var.status == TRY_SUCCESS && !strcmp(sink_str(&printed), sink_str(&source)));
+    free_sink(&source);
+    free_sink(&printed);
+    return !passed;
+}
+
+int test_sink() {
+    printf("Running test_sink() ...\n");
+    return test_fixture(cases, case_func, TEST_INPUT_STRING) + test_large_definition();
+}
@@ -0,0 +1,62 @@
+#include "tests.h"
+#include "../grammar.h"
+#include "../../test_util.h"
+
+#include <stdio.h>
+
+const static Case_t cases[] = {
+    {true,  "x", "x#0"},
+    {true,  "a b a", "a#0 b#1 a#0"},
+    {true,  "value val value_ v value", "value#0 val#1 value_#2 v#3 value#0"},
+    {true,  "int32_t int64_t int32_t", "int32_t#0 int64_t#1 int32_t#0"},
+    {false, "", NULL},
+    {false, NULL, NULL}
+};
+
+/**
+ * Intern each whitespace-separated word and number the words by the first
+ * word that produced the same symbol
+ */
+static TryCharPtr_t case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    const Symbol_t *symbols[64];
+    size_t n_words = 0;
+    size_t num_chars = 0;
+    ConstString_t working = strip_whitespace(str);
+    while (working.begin < working.end) {
+        TryConstString_t word = find_identifier(working);
+        if (word.status != TRY_SUCCESS) {
+            output.status = TRY_NONE;
+            return output;
+        }
+        const Symbol_t *symbol = intern(word.value);
+        if (    symbol != intern(word.value) ||
+                symbol->hash != hash_const_str(word.value) ||
+                symbol->str.begin[symbol->str.end - symbol->str.begin] != 0) {
+            output.status = TRY_ERROR;
+            output.error.location = word.value;
+            output.error.desc = "Interning is not stable";
+            return output;
+        }
+        size_t first = 0;
+        while (first < n_words && symbols[first] != symbol) {
+            ++first;
+        }
+        symbols[n_words++] = symbol;
+        num_chars += sprintf(buffer + num_chars, "%s%s#%zu", num_chars ? " " : "", symbol->str.begin, first);
+        working = strip_whitespace(strip(working, word.value).value);
+    }
+    if (!n_words) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    output.status = TRY_SUCCESS;
+    output.value = buffer;
+    return output;
+}
+
+int test_symbol() {
+    printf("Running test_symbol() ...\n");
+    return test_fixture(cases, case_func, TEST_INPUT_STRING);
+}
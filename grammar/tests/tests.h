@@ -18,9 +18,21 @@ typedef enum {
 
 int test_fixture(const Case_t *const cases, TryCharPtr_t (*const func)(const ConstString_t str), const TestInputVariant_t input_variant);
 
+int test_lexer();
+int test_scan();
+int test_index();
+int test_symbol();
+int test_map();
 int test_types();
 int test_derived_types();
+int test_canonical();
+int test_sink();
 int test_operator();
+int test_fold();
+int test_memo();
+int test_context();
 int test_scope();
+int test_serialize();
+int test_cache();
 
 #endif
\ No newline at end of file
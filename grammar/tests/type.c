@@ -25,6 +25,9 @@ const static Case_t cases[] = {
     {true,  "unsigned long long", NULL},
     {true,  "float", NULL},
     {true,  "double", NULL},
+    {true,  "int64_t", NULL},
+    {true,  "longitude", NULL},
+    {false, "unsigned", NULL},
     {false, "struct int", NULL},
     {false, "struct enum", NULL},
     {false, "struct register", NULL},
@@ -45,6 +48,7 @@ const static Case_t cases[] = {
     {true,  "enum { RED, YELLOW, GREEN }", "enum { RED = 0, YELLOW = 1, GREEN = 2 }"},
     {true,  "enum { RED = 1, YELLOW = 5, GREEN = 1892234 }", NULL},
     {true,  "enum { RED = 5, YELLOW, GREEN }", "enum { RED = 5, YELLOW = 6, GREEN = 7 }"},
+    {true,  "enum { RED = 0x10, YELLOW, GREEN = 010 }", "enum { RED = 16, YELLOW = 17, GREEN = 8 }"},
     {false, "enum { RED = }", NULL},
     {false, "enum { RED GREEN }", NULL},
     {false, "enum { struct }", NULL},
@@ -57,7 +61,10 @@ static TryCharPtr_t case_func(const ConstString_t str) {
     static char buffer[0x10000];
     TryType_t type = parse_type(str);
     if (type.status == TRY_SUCCESS) {
-        print_type(buffer, &type.value);
+        Sink_t sink = new_buffer_sink();
+        print_type(&sink, &type.value);
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+        free_sink(&sink);
         output.status = TRY_SUCCESS;
         output.value = buffer;
         return output;
@@ -71,7 +78,33 @@ static TryCharPtr_t case_func(const ConstString_t str) {
     }
 }
 
+/**
+ * Same cases through the token entry point
+ */
+static TryCharPtr_t token_case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    TryTokenArray_t tokens = lex(str);
+    GrammarPropagateError(tokens, output);
+    TryType_t type = parse_type_tokens(token_range_from_array(&tokens.value));
+    free_token_array(&tokens.value);
+    if (type.status == TRY_SUCCESS) {
+        Sink_t sink = new_buffer_sink();
+        print_type(&sink, &type.value);
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+        free_sink(&sink);
+        output.status = TRY_SUCCESS;
+        output.value = buffer;
+        return output;
+    }
+    GrammarPropagateError(type, output);
+    output.status = TRY_NONE;
+    return output;
+}
+
 int test_types() {
     printf("Running test_types() ...\n");
-    return test_fixture(cases, case_func, TEST_INPUT_STRING);
+    int n_failed_tests = test_fixture(cases, case_func, TEST_INPUT_STRING);
+    n_failed_tests += test_fixture(cases, token_case_func, TEST_INPUT_STRING);
+    return n_failed_tests;
 }
\ No newline at end of file
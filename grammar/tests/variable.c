@@ -12,6 +12,9 @@ const static Case_t cases[] = {
     {true,  "unsigned int x", NULL},
     {true,  "unsigned long long x", NULL},
     {true,  "Thing_t x", NULL},
+    {true,  "int64_t x", NULL},
+    {true,  "unsigned long long_value", NULL},
+    {true,  "doubled x", NULL},
     {true,  "const int x", NULL},
     {true,  "volatile long x", NULL},
     {true,  "const unsigned long long x", NULL},
@@ -97,7 +100,10 @@ static TryCharPtr_t case_func(const ConstString_t str) {
     static char buffer[0x10000];
     TryVariable_t var = parse_variable(str);
     if (var.status == TRY_SUCCESS) {
-        print_variable(buffer, &var.value);
+        Sink_t sink = new_buffer_sink();
+        print_variable(&sink, &var.value);
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+        free_sink(&sink);
         output.status = TRY_SUCCESS;
         output.value = buffer;
         return output;
@@ -111,7 +117,33 @@ static TryCharPtr_t case_func(const ConstString_t str) {
     }
 }
 
+/**
+ * Same cases through the token entry point
+ */
+static TryCharPtr_t token_case_func(const ConstString_t str) {
+    TryCharPtr_t output;
+    static char buffer[0x10000];
+    TryTokenArray_t tokens = lex(str);
+    GrammarPropagateError(tokens, output);
+    TryVariable_t var = parse_variable_tokens(token_range_from_array(&tokens.value));
+    free_token_array(&tokens.value);
+    if (var.status == TRY_SUCCESS) {
+        Sink_t sink = new_buffer_sink();
+        print_variable(&sink, &var.value);
+        snprintf(buffer, sizeof(buffer), "%s", sink_str(&sink));
+        free_sink(&sink);
+        output.status = TRY_SUCCESS;
+        output.value = buffer;
+        return output;
+    }
+    GrammarPropagateError(var, output);
+    output.status = TRY_NONE;
+    return output;
+}
+
 int test_derived_types() {
     printf("Running test_derived_types() ...\n");
-    return test_fixture(cases, case_func, TEST_INPUT_STRING);
+    int n_failed_tests = test_fixture(cases, case_func, TEST_INPUT_STRING);
+    n_failed_tests += test_fixture(cases, token_case_func, TEST_INPUT_STRING);
+    return n_failed_tests;
 }
\ No newline at end of file
@@ -3,38 +3,112 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-typedef struct {
-    PrimitiveVariant_t variant;
-    const char *words[4];
-} PrimitiveMapping_t;
 typedef struct {
     PrimitiveVariant_t variant;
     ConstString_t str;
 } PrimitiveLocation_t;
 typedef GrammarTryType(PrimitiveLocation_t) TryPrimitiveLocation_t;
 
-const static size_t n_mappings = 18;
-const static PrimitiveMapping_t primitive_map[] = {
-    {PRIMITIVE_VOID, {"void", NULL}},
-    {PRIMITIVE_CHAR, {"char", NULL}},
-    {PRIMITIVE_CHAR, {"signed", "char", NULL}},
-    {PRIMITIVE_UNSIGNED_CHAR, {"unsigned", "char", NULL}},
-    {PRIMITIVE_SHORT, {"short", NULL}},
-    {PRIMITIVE_SHORT, {"signed", "short", NULL}},
-    {PRIMITIVE_UNSIGNED_SHORT, {"unsigned", "short", NULL}},
-    {PRIMITIVE_INT, {"int", NULL}},
-    {PRIMITIVE_INT, {"signed", "int", NULL}},
-    {PRIMITIVE_UNSIGNED_INT, {"unsigned", "int", NULL}},
-    {PRIMITIVE_LONG_LONG, {"long", "long", NULL}},
-    {PRIMITIVE_LONG_LONG, {"signed", "long", "long", NULL}},
-    {PRIMITIVE_UNSIGNED_LONG_LONG, {"unsigned", "long", "long", NULL}},
-    {PRIMITIVE_LONG, {"long", NULL}},
-    {PRIMITIVE_LONG, {"signed", "long", NULL}},
-    {PRIMITIVE_UNSIGNED_LONG, {"unsigned", "long", NULL}},
-    {PRIMITIVE_FLOAT, {"float", NULL}},
-    {PRIMITIVE_DOUBLE, {"double", NULL}},
+/**
+ * State machine over the words of multi-word primitive spellings (e.g.
+ * "unsigned long long"); each state accepts a primitive or not, and the
+ * longest accepted spelling wins
+ */
+typedef enum {
+    PRIMITIVE_WORD_VOID,
+    PRIMITIVE_WORD_CHAR,
+    PRIMITIVE_WORD_SHORT,
+    PRIMITIVE_WORD_INT,
+    PRIMITIVE_WORD_LONG,
+    PRIMITIVE_WORD_FLOAT,
+    PRIMITIVE_WORD_DOUBLE,
+    PRIMITIVE_WORD_SIGNED,
+    PRIMITIVE_WORD_UNSIGNED,
+    N_PRIMITIVE_WORDS
+} PrimitiveWordVariant_t;
+typedef enum {
+    PRIMITIVE_STATE_REJECT,
+    PRIMITIVE_STATE_START,
+    PRIMITIVE_STATE_SIGNED,
+    PRIMITIVE_STATE_UNSIGNED,
+    PRIMITIVE_STATE_VOID,
+    PRIMITIVE_STATE_CHAR,
+    PRIMITIVE_STATE_UNSIGNED_CHAR,
+    PRIMITIVE_STATE_SHORT,
+    PRIMITIVE_STATE_UNSIGNED_SHORT,
+    PRIMITIVE_STATE_INT,
+    PRIMITIVE_STATE_UNSIGNED_INT,
+    PRIMITIVE_STATE_LONG,
+    PRIMITIVE_STATE_UNSIGNED_LONG,
+    PRIMITIVE_STATE_LONG_LONG,
+    PRIMITIVE_STATE_UNSIGNED_LONG_LONG,
+    PRIMITIVE_STATE_FLOAT,
+    PRIMITIVE_STATE_DOUBLE,
+    N_PRIMITIVE_STATES
+} PrimitiveStateVariant_t;
+typedef struct {
+    bool accepts;
+    PrimitiveVariant_t variant;
+    PrimitiveStateVariant_t next[N_PRIMITIVE_WORDS]; // Unlisted words go to PRIMITIVE_STATE_REJECT
+} PrimitiveState_t;
+
+const static PrimitiveState_t primitive_states[N_PRIMITIVE_STATES] = {
+    [PRIMITIVE_STATE_START] = {false, 0, {
+        [PRIMITIVE_WORD_VOID] = PRIMITIVE_STATE_VOID,
+        [PRIMITIVE_WORD_CHAR] = PRIMITIVE_STATE_CHAR,
+        [PRIMITIVE_WORD_SHORT] = PRIMITIVE_STATE_SHORT,
+        [PRIMITIVE_WORD_INT] = PRIMITIVE_STATE_INT,
+        [PRIMITIVE_WORD_LONG] = PRIMITIVE_STATE_LONG,
+        [PRIMITIVE_WORD_FLOAT] = PRIMITIVE_STATE_FLOAT,
+        [PRIMITIVE_WORD_DOUBLE] = PRIMITIVE_STATE_DOUBLE,
+        [PRIMITIVE_WORD_SIGNED] = PRIMITIVE_STATE_SIGNED,
+        [PRIMITIVE_WORD_UNSIGNED] = PRIMITIVE_STATE_UNSIGNED}},
+    [PRIMITIVE_STATE_SIGNED] = {false, 0, {
+        [PRIMITIVE_WORD_CHAR] = PRIMITIVE_STATE_CHAR,
+        [PRIMITIVE_WORD_SHORT] = PRIMITIVE_STATE_SHORT,
+        [PRIMITIVE_WORD_INT] = PRIMITIVE_STATE_INT,
+        [PRIMITIVE_WORD_LONG] = PRIMITIVE_STATE_LONG}},
+    [PRIMITIVE_STATE_UNSIGNED] = {false, 0, {
+        [PRIMITIVE_WORD_CHAR] = PRIMITIVE_STATE_UNSIGNED_CHAR,
+        [PRIMITIVE_WORD_SHORT] = PRIMITIVE_STATE_UNSIGNED_SHORT,
+        [PRIMITIVE_WORD_INT] = PRIMITIVE_STATE_UNSIGNED_INT,
+        [PRIMITIVE_WORD_LONG] = PRIMITIVE_STATE_UNSIGNED_LONG}},
+    [PRIMITIVE_STATE_VOID] = {true, PRIMITIVE_VOID},
+    [PRIMITIVE_STATE_CHAR] = {true, PRIMITIVE_CHAR},
+    [PRIMITIVE_STATE_UNSIGNED_CHAR] = {true, PRIMITIVE_UNSIGNED_CHAR},
+    [PRIMITIVE_STATE_SHORT] = {true, PRIMITIVE_SHORT},
+    [PRIMITIVE_STATE_UNSIGNED_SHORT] = {true, PRIMITIVE_UNSIGNED_SHORT},
+    [PRIMITIVE_STATE_INT] = {true, PRIMITIVE_INT},
+    [PRIMITIVE_STATE_UNSIGNED_INT] = {true, PRIMITIVE_UNSIGNED_INT},
+    [PRIMITIVE_STATE_LONG] = {true, PRIMITIVE_LONG, {
+        [PRIMITIVE_WORD_LONG] = PRIMITIVE_STATE_LONG_LONG}},
+    [PRIMITIVE_STATE_UNSIGNED_LONG] = {true, PRIMITIVE_UNSIGNED_LONG, {
+        [PRIMITIVE_WORD_LONG] = PRIMITIVE_STATE_UNSIGNED_LONG_LONG}},
+    [PRIMITIVE_STATE_LONG_LONG] = {true, PRIMITIVE_LONG_LONG},
+    [PRIMITIVE_STATE_UNSIGNED_LONG_LONG] = {true, PRIMITIVE_UNSIGNED_LONG_LONG},
+    [PRIMITIVE_STATE_FLOAT] = {true, PRIMITIVE_FLOAT},
+    [PRIMITIVE_STATE_DOUBLE] = {true, PRIMITIVE_DOUBLE},
 };
 
+/**
+ * Map a keyword to the word it plays in primitive spellings, or
+ * N_PRIMITIVE_WORDS if it does not appear in any
+ */
+static PrimitiveWordVariant_t primitive_word(const KeywordVariant_t keyword) {
+    switch (keyword) {
+        case KEYWORD_VOID: return PRIMITIVE_WORD_VOID;
+        case KEYWORD_CHAR: return PRIMITIVE_WORD_CHAR;
+        case KEYWORD_SHORT: return PRIMITIVE_WORD_SHORT;
+        case KEYWORD_INT: return PRIMITIVE_WORD_INT;
+        case KEYWORD_LONG: return PRIMITIVE_WORD_LONG;
+        case KEYWORD_FLOAT: return PRIMITIVE_WORD_FLOAT;
+        case KEYWORD_DOUBLE: return PRIMITIVE_WORD_DOUBLE;
+        case KEYWORD_SIGNED: return PRIMITIVE_WORD_SIGNED;
+        case KEYWORD_UNSIGNED: return PRIMITIVE_WORD_UNSIGNED;
+        default: return N_PRIMITIVE_WORDS;
+    }
+}
+
 const static char *type_strs[] = {
     "struct",
     "union",
@@ -65,29 +139,34 @@ const static char *primitive_strs[] = {
  */
 static TryPrimitiveLocation_t find_primitive(const ConstString_t str) {
     TryPrimitiveLocation_t output;
-    TryConstString_t word;
-    for (int i = 0; i < n_mappings; ++i) {
-        ConstString_t working = str;
-        const char *const *word = primitive_map[i].words;
-        while (*word) {
-            TryConstString_t try_word = find_string(working, const_string_from_cstr(*word));
-            if (try_word.status != TRY_SUCCESS) {
-                break;
-            }
-            else {
-                working = strip_whitespace(strip(working, try_word.value).value);
-            }
-            ++word;
+    output.status = TRY_NONE;
+    PrimitiveStateVariant_t state = PRIMITIVE_STATE_START;
+    ConstString_t working = str;
+    while (state != PRIMITIVE_STATE_REJECT) {
+        // Words are whole runs of identifier characters, so e.g. "int64_t"
+        // is not read as "int"; the run is looked up as a keyword only once
+        ConstString_t word;
+        word.begin = working.begin;
+        word.end = working.begin;
+        while (word.end < working.end && (
+                *word.end == '_' || ('a' <= *word.end && *word.end <= 'z') ||
+                ('A' <= *word.end && *word.end <= 'Z') || ('0' <= *word.end && *word.end <= '9'))) {
+            ++word.end;
+        }
+        const PrimitiveWordVariant_t word_variant = primitive_word(find_keyword(word));
+        if (word_variant == N_PRIMITIVE_WORDS) {
+            break;
         }
-        if (!*word) {
+        state = primitive_states[state].next[word_variant];
+        working.begin = word.end;
+        working = strip_whitespace(working);
+        if (primitive_states[state].accepts) {
             output.status = TRY_SUCCESS;
-            output.value.variant = primitive_map[i].variant;
+            output.value.variant = primitive_states[state].variant;
             output.value.str.begin = str.begin;
             output.value.str.end = working.begin;
-            return output;
         }
     }
-    output.status = TRY_NONE;
     return output;
 }
 
@@ -106,7 +185,7 @@ TryEnumField_t parse_enum(const ConstString_t str, const int expected_value) {
         output.error.desc = "Enum field needs a name";
         return output;
     }
-    output.value.name = new_alloc_const_string_from_const_str(name.value);
+    output.value.name = intern(name.value);
     working = strip_whitespace(strip(working, name.value).value);
     TryConstString_t equals = find_string(working, const_string_from_cstr("="));
     if (equals.status == TRY_SUCCESS) {
@@ -115,7 +194,7 @@ TryEnumField_t parse_enum(const ConstString_t str, const int expected_value) {
         if (integer.status == TRY_NONE) {
             output.status = TRY_ERROR;
             output.error.location = working;
-            output.error.desc = "Expected a positive, base-10 integer";
+            output.error.desc = "Expected a non-negative integer";
             return output;
         }
         working = strip(working, integer.value.str).value;
@@ -136,7 +215,7 @@ TryEnumField_t parse_enum(const ConstString_t str, const int expected_value) {
     return output;
 }
 
-TryType_t parse_type(const ConstString_t str) {
+static TryType_t parse_type_uncached(const ConstString_t str) {
     TryType_t output;
 
     ConstString_t working = strip_whitespace(str);
@@ -171,7 +250,7 @@ TryType_t parse_type(const ConstString_t str) {
     }
     else if ((id_spec = find_identifier(working)).status == TRY_SUCCESS) {
         output.value.variant = TYPE_NAMED;
-        output.value.named = new_alloc_const_string_from_const_str(id_spec.value);
+        output.value.named = intern(id_spec.value);
         output.value.str.begin = str.begin;
         output.value.str.end = id_spec.value.end;
         output.status = TRY_SUCCESS;
@@ -191,7 +270,7 @@ TryType_t parse_type(const ConstString_t str) {
         TryConstString_t name = find_identifier(working);
         GrammarPropagateError(name, output);
         if (name.status == TRY_SUCCESS) {
-            output.value.compound.name = new_alloc_const_string_from_const_str(name.value);
+            output.value.compound.name = intern(name.value);
             output.value.compound.has_name = true;
             output.value.str.end = name.value.end;
             working = strip(working, name.value).value;
@@ -208,11 +287,11 @@ TryType_t parse_type(const ConstString_t str) {
         working = strip(working, contents.value).value;
         output.value.str.end = contents.value.end;
         output.value.compound.is_definition = true;
-        output.value.compound.su_fields = NULL;
-        output.value.compound.e_fields = NULL;
+        output.value.compound.su_fields.items = NULL;
+        output.value.compound.su_fields.size = 0;
 
         if (output.value.variant == TYPE_STRUCT || output.value.variant == TYPE_UNION) {
-            VariableLinkedListNode_t **head_field = &output.value.compound.su_fields;
+            SpanBuilder_t fields = new_span_builder(sizeof(Variable_t));
             while (braces.begin < braces.end) {
                 TryConstString_t semicolon = find_string_nesting_sensitive(braces, const_string_from_cstr(";"));
                 if (semicolon.status == TRY_SUCCESS) {
@@ -222,22 +301,22 @@ TryType_t parse_type(const ConstString_t str) {
                     braces.begin = semicolon.value.end;
                     TryVariable_t var = parse_variable(field);
                     if (var.status == TRY_ERROR) {
+                        free_span_builder(&fields);
                         GrammarPropagateError(var, output);
                     }
                     else if (var.status == TRY_NONE) {
+                        free_span_builder(&fields);
                         output.status = TRY_ERROR;
                         output.error.location = field;
                         output.error.desc = "Expected a field declaration";
                         return output;
                     }
-                    *head_field = malloc(sizeof(VariableLinkedListNode_t));
-                    (*head_field)->next = NULL;
-                    (*head_field)->value = var.value;
-                    head_field = &(*head_field)->next;
+                    *(Variable_t *)span_builder_push(&fields) = var.value;
                 }
                 else {
                     braces = strip_whitespace(braces);
                     if (braces.begin != braces.end) {
+                        free_span_builder(&fields);
                         output.status = TRY_ERROR;
                         output.error.location = braces;
                         output.error.desc = "Unexpected characters in struct/union definition";
@@ -245,9 +324,11 @@ TryType_t parse_type(const ConstString_t str) {
                     }
                 }
             }
+            output.value.compound.su_fields.items = finish_span(&fields);
+            output.value.compound.su_fields.size = fields.size;
         }
         else {
-            EnumFieldLinkedListNode_t **head_field = &output.value.compound.e_fields;
+            SpanBuilder_t fields = new_span_builder(sizeof(EnumField_t));
             int64_t expected_value = 0;
             while (braces.begin < braces.end) {
                 TryConstString_t comma = find_string_nesting_sensitive(braces, const_string_from_cstr(","));
@@ -263,20 +344,21 @@ TryType_t parse_type(const ConstString_t str) {
                 }
                 TryEnumField_t pair = parse_enum(field, expected_value);
                 if (pair.status == TRY_ERROR) {
+                    free_span_builder(&fields);
                     GrammarPropagateError(pair, output);
                 }
                 else if (pair.status == TRY_NONE) {
+                    free_span_builder(&fields);
                     output.status = TRY_ERROR;
                     output.error.location = field;
                     output.error.desc = "Expected a field declaration";
                     return output;
                 }
-                *head_field = malloc(sizeof(EnumFieldLinkedListNode_t));
-                (*head_field)->next = NULL;
-                (*head_field)->value = pair.value;
-                head_field = &(*head_field)->next;
+                *(EnumField_t *)span_builder_push(&fields) = pair.value;
                 expected_value = pair.value.value + 1;
             }
+            output.value.compound.e_fields.items = finish_span(&fields);
+            output.value.compound.e_fields.size = fields.size;
         }
     }
     else {
@@ -295,55 +377,286 @@ TryType_t parse_type(const ConstString_t str) {
     return output;
 }
 
-size_t print_type(char *buffer, const Type_t *const type) {
-    size_t num_chars = 0;
+TryType_t parse_type(const ConstString_t str) {
+    TryType_t output;
+    WithSourceIndex(str, output, parse_type(str));
+    WithParseMemo(MEMO_TYPE, type, str, output, parse_type_uncached(str));
+}
+
+/**
+ * Parse an enum field from its tokens; see `parse_enum`
+ */
+static TryEnumField_t parse_enum_token_span(const TokenSpan_t span, const int expected_value) {
+    TryEnumField_t output;
+    const Token_t *tokens = span.tokens;
+    size_t pos = span.begin;
+    if (tokens[pos].variant != TOKEN_IDENTIFIER) {
+        output.status = TRY_ERROR;
+        output.error.location = tokens[pos].variant == TOKEN_KEYWORD ? tokens[pos].str : token_span_str(span, span.begin, span.end);
+        output.error.desc = tokens[pos].variant == TOKEN_KEYWORD ? "Identifier cannot be a keyword" : "Enum field needs a name";
+        return output;
+    }
+    output.value.name = tokens[pos++].symbol;
+    output.value.value = expected_value;
+    if (pos < span.end && is_punctuator(&tokens[pos], "=")) {
+        ++pos;
+        TryIntegerLiteral_t integer;
+        integer.status = TRY_NONE;
+        if (pos < span.end && tokens[pos].variant == TOKEN_INTEGER) {
+            integer = find_integer(tokens[pos].str);
+        }
+        if (integer.status != TRY_SUCCESS) {
+            output.status = TRY_ERROR;
+            output.error.location = token_span_str(span, pos, span.end);
+            output.error.desc = "Expected a non-negative integer";
+            return output;
+        }
+        output.value.value = integer.value.integer;
+        if (integer.value.str.end == tokens[pos].str.end) {
+            ++pos;
+        }
+    }
+    if (pos != span.end) {
+        output.status = TRY_ERROR;
+        output.error.location = token_span_str(span, pos, span.end);
+        output.error.desc = "Unexpected characters in enum field";
+        return output;
+    }
+    output.status = TRY_SUCCESS;
+    return output;
+}
+
+/**
+ * Parse the fields between the braces of a struct/union/enum definition
+ */
+static TryType_t parse_compound_fields(const TokenSpan_t span, Type_t *const type) {
+    TryType_t output;
+    const Token_t *tokens = span.tokens;
+    TokenSpan_t field = span;
+    if (type->variant == TYPE_STRUCT || type->variant == TYPE_UNION) {
+        SpanBuilder_t fields = new_span_builder(sizeof(Variable_t));
+        for (size_t it = span.begin; it < span.end; ++it) {
+            if (span.match[it] != NO_TOKEN_MATCH) {
+                it = span.match[it];
+                continue;
+            }
+            if (!is_punctuator(&tokens[it], ";")) {
+                continue;
+            }
+            field.end = it;
+            TryVariable_t var = parse_variable_token_span(field);
+            if (var.status == TRY_ERROR) {
+                free_span_builder(&fields);
+                GrammarPropagateError(var, output);
+            }
+            else if (var.status == TRY_NONE) {
+                free_span_builder(&fields);
+                output.status = TRY_ERROR;
+                output.error.location = tokens[it].str;
+                output.error.desc = "Expected a field declaration";
+                return output;
+            }
+            *(Variable_t *)span_builder_push(&fields) = var.value;
+            field.begin = it + 1;
+        }
+        if (field.begin != span.end) {
+            free_span_builder(&fields);
+            output.status = TRY_ERROR;
+            output.error.location = token_span_str(span, field.begin, span.end);
+            output.error.desc = "Unexpected characters in struct/union definition";
+            return output;
+        }
+        type->compound.su_fields.items = finish_span(&fields);
+        type->compound.su_fields.size = fields.size;
+    }
+    else {
+        SpanBuilder_t fields = new_span_builder(sizeof(EnumField_t));
+        int64_t expected_value = 0;
+        for (size_t it = span.begin; it <= span.end; ++it) {
+            if (it < span.end && span.match[it] != NO_TOKEN_MATCH) {
+                it = span.match[it];
+                continue;
+            }
+            if (it < span.end && !is_punctuator(&tokens[it], ",")) {
+                continue;
+            }
+            field.end = it;
+            // A trailing comma ends the fields
+            if (it == span.end && field.begin == span.end) {
+                break;
+            }
+            if (field.begin == field.end) {
+                free_span_builder(&fields);
+                output.status = TRY_ERROR;
+                output.error.location = tokens[it - 1].str;
+                output.error.desc = "Expected a field declaration";
+                return output;
+            }
+            TryEnumField_t pair = parse_enum_token_span(field, expected_value);
+            if (pair.status == TRY_ERROR) {
+                free_span_builder(&fields);
+                GrammarPropagateError(pair, output);
+            }
+            *(EnumField_t *)span_builder_push(&fields) = pair.value;
+            expected_value = pair.value.value + 1;
+            field.begin = it + 1;
+        }
+        type->compound.e_fields.items = finish_span(&fields);
+        type->compound.e_fields.size = fields.size;
+    }
+    output.status = TRY_SUCCESS;
+    return output;
+}
+
+static TryType_t parse_type_token_span_uncached(const TokenSpan_t span) {
+    TryType_t output;
+    const Token_t *tokens = span.tokens;
+    const ConstString_t str = token_span_str(span, span.begin, span.end);
+    output.value.str.begin = str.begin;
+    size_t pos = span.begin;
+    switch (tokens[pos].keyword) {
+        case KEYWORD_STRUCT:
+            output.value.variant = TYPE_STRUCT;
+            break;
+        case KEYWORD_UNION:
+            output.value.variant = TYPE_UNION;
+            break;
+        case KEYWORD_ENUM:
+            output.value.variant = TYPE_ENUM;
+            break;
+        default: {
+            // Same state machine as `find_primitive`, a keyword token per word
+            PrimitiveStateVariant_t state = PRIMITIVE_STATE_START;
+            output.status = TRY_NONE;
+            for (size_t it = pos; it < span.end && state != PRIMITIVE_STATE_REJECT; ++it) {
+                const PrimitiveWordVariant_t word_variant = primitive_word(tokens[it].keyword);
+                if (word_variant == N_PRIMITIVE_WORDS) {
+                    break;
+                }
+                state = primitive_states[state].next[word_variant];
+                if (primitive_states[state].accepts) {
+                    output.status = TRY_SUCCESS;
+                    output.value.variant = TYPE_PRIMITIVE;
+                    output.value.primitive = primitive_states[state].variant;
+                    output.value.str.end = tokens[it].str.end;
+                }
+            }
+            if (output.status == TRY_NONE && tokens[pos].variant == TOKEN_IDENTIFIER) {
+                output.status = TRY_SUCCESS;
+                output.value.variant = TYPE_NAMED;
+                output.value.named = tokens[pos].symbol;
+                output.value.str.end = tokens[pos].str.end;
+            }
+            else if (output.status == TRY_NONE) {
+                output.status = TRY_ERROR;
+                output.error.location = str;
+                output.error.desc = "Expected an identifier";
+            }
+            return output;
+        }
+    }
+
+    ++pos;
+    output.value.compound.has_name = false;
+    if (pos < span.end && tokens[pos].variant == TOKEN_KEYWORD) {
+        output.status = TRY_ERROR;
+        output.error.location = tokens[pos].str;
+        output.error.desc = "Identifier cannot be a keyword";
+        return output;
+    }
+    if (pos < span.end && tokens[pos].variant == TOKEN_IDENTIFIER) {
+        output.value.compound.name = tokens[pos].symbol;
+        output.value.compound.has_name = true;
+        output.value.str.end = tokens[pos].str.end;
+        ++pos;
+    }
+
+    output.value.compound.is_definition = pos < span.end && is_punctuator(&tokens[pos], "{");
+    if (output.value.compound.is_definition) {
+        TokenSpan_t braces = span;
+        braces.begin = pos + 1;
+        braces.end = span.match[pos];
+        output.value.str.end = tokens[braces.end].str.end;
+        output.value.compound.su_fields.items = NULL;
+        output.value.compound.su_fields.size = 0;
+        TryType_t fields = parse_compound_fields(braces, &output.value);
+        GrammarPropagateError(fields, output);
+    }
+    else if (!output.value.compound.has_name) {
+        output.status = TRY_ERROR;
+        output.error.location = str;
+        output.error.desc = "struct/union/enum needs a name or a definition";
+        return output;
+    }
+
+    output.status = TRY_SUCCESS;
+    return output;
+}
+
+TryType_t parse_type_token_span(const TokenSpan_t span) {
+    TryType_t output;
+    if (span.begin == span.end) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    WithParseMemo(MEMO_TYPE, type, token_span_str(span, span.begin, span.end), output, parse_type_token_span_uncached(span));
+}
+
+TryType_t parse_type_tokens(const TokenRange_t tokens) {
+    TryType_t output;
+    if (tokens.begin == tokens.end) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    WithSourceIndex(token_range_str(tokens), output, parse_type_tokens(tokens));
+    uint32_t *match = malloc((tokens.end - tokens.begin) * sizeof(uint32_t));
+    if (match_token_brackets(tokens, match)) {
+        TokenSpan_t span;
+        span.tokens = tokens.begin;
+        span.match = match;
+        span.begin = 0;
+        span.end = tokens.end - tokens.begin;
+        output = parse_type_token_span(span);
+    }
+    else {
+        // Unbalanced brackets are reported the same way as for the text
+        output = parse_type(token_range_str(tokens));
+    }
+    free(match);
+    return output;
+}
+
+size_t print_type(Sink_t *const sink, const Type_t *const type) {
+    const size_t begin = sink->written;
     if (type->variant == TYPE_PRIMITIVE) {
-        num_chars += sprintf(buffer, "%s", primitive_strs[type->primitive]);
+        sink_puts(sink, primitive_strs[type->primitive]);
     }
     else if (type->variant == TYPE_NAMED) {
-        num_chars += sprintf(buffer, "%s", type->named.begin);
+        sink_puts(sink, type->named->str.begin);
     }
     else {
+        sink_puts(sink, type_strs[type->variant]);
+        if (type->compound.has_name) {
+            sink_printf(sink, " %s", type->compound.name->str.begin);
+        }
         if (type->compound.is_definition) {
-            char field_buffer[0x10000];
-            field_buffer[0] = 0;
-            size_t num_field_chars = 0;
+            sink_puts(sink, " { ");
             if (type->variant == TYPE_STRUCT || type->variant == TYPE_UNION) {
-                VariableLinkedListNode_t *field = type->compound.su_fields;
-                while (field) {
-                    num_field_chars += print_variable(field_buffer + num_field_chars, &field->value);
-                    num_field_chars += sprintf(field_buffer + num_field_chars, "; ");
-                    field = field->next;
+                for (uint32_t i = 0; i < type->compound.su_fields.size; ++i) {
+                    print_variable(sink, &type->compound.su_fields.items[i]);
+                    sink_puts(sink, "; ");
                 }
             }
             else {
-                EnumFieldLinkedListNode_t *field = type->compound.e_fields;
-                while (field) {
-                    num_field_chars += sprintf(field_buffer + num_field_chars, "%.*s = %ld",
-                        (int)(field->value.name.end - field->value.name.begin), field->value.name.begin, field->value.value);
-                    if (field->next) {
-                        num_field_chars += sprintf(field_buffer + num_field_chars, ", ");
-                    }
-                    else {
-                        num_field_chars += sprintf(field_buffer + num_field_chars, " ");
-                    }
-                    field = field->next;
+                for (uint32_t i = 0; i < type->compound.e_fields.size; ++i) {
+                    const EnumField_t *field = &type->compound.e_fields.items[i];
+                    sink_write(sink, field->name->str.begin, field->name->str.end - field->name->str.begin);
+                    sink_printf(sink, " = %ld", field->value);
+                    sink_puts(sink, i + 1 < type->compound.e_fields.size ? ", " : " ");
                 }
             }
-
-            if (type->compound.has_name) {
-                num_chars += sprintf(buffer, "%s %s { %s}",
-                    type_strs[type->variant], type->compound.name.begin, field_buffer);
-            }
-            else {
-                num_chars += sprintf(buffer, "%s { %s}",
-                    type_strs[type->variant], field_buffer);
-            }
-        }
-        else if (type->compound.has_name) {
-            num_chars += sprintf(buffer, "%s %s",
-                type_strs[type->variant], type->compound.name.begin);
+            sink_puts(sink, "}");
         }
     }
-    return num_chars;
+    return sink->written - begin;
 }
\ No newline at end of file
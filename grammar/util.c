@@ -114,7 +114,11 @@ TryConstString_t strip(const ConstString_t parent, const ConstString_t child) {
 TryConstString_t find_whitespace(const ConstString_t str) {
     assert(str.begin <= str.end);
     TryConstString_t output;
+    const SourceIndex_t *index = find_source_index(str);
     const char *it = str.begin;
+    if (index) {
+        it = scan_next_not(&index->bitmaps, SCAN_CLASS(SCAN_WHITESPACE), str.begin, str.end);
+    }
     while (it < str.end && (*it == ' ' || *it == '\t' || *it == '\n')) {
         ++it;
     }
@@ -179,6 +183,10 @@ TryConstString_t find_identifier(const ConstString_t str) {
         return output;
     }
     ++it;
+    const SourceIndex_t *index = find_source_index(str);
+    if (index) {
+        it = scan_next_not(&index->bitmaps, SCAN_CLASS(SCAN_IDENTIFIER), it, str.end);
+    }
     while (it < str.end && (*it == '_' || ('a' <= *it && *it <= 'z') || ('A' <= *it && *it <= 'Z') || ('0' <= *it && *it <= '9'))) {
         ++it;
     }
@@ -193,7 +201,8 @@ TryConstString_t find_identifier(const ConstString_t str) {
     return output;
 }
 
-const char *keywords[] = {
+const static char *keyword_strs[] = {
+    NULL,
     "break",
     "case",
     "char",
@@ -225,47 +234,188 @@ const char *keywords[] = {
     "void",
     "volatile",
     "while",
-    NULL
 };
 
+/**
+ * Perfect hash over the keywords; the multipliers were searched so that no
+ * two keywords share a slot, and the table below is laid out by the compiler
+ * from the same macro
+ */
+#define KEYWORD_HASH_SIZE 64
+#define KEYWORD_HASH(first, second, last, len) \
+    ((4 * (first) + 47 * (second) + 14 * (last) + (len)) % KEYWORD_HASH_SIZE)
+const static KeywordVariant_t keyword_table[KEYWORD_HASH_SIZE] = {
+    [KEYWORD_HASH('b', 'r', 'k', 5)] = KEYWORD_BREAK,
+    [KEYWORD_HASH('c', 'a', 'e', 4)] = KEYWORD_CASE,
+    [KEYWORD_HASH('c', 'h', 'r', 4)] = KEYWORD_CHAR,
+    [KEYWORD_HASH('c', 'o', 't', 5)] = KEYWORD_CONST,
+    [KEYWORD_HASH('c', 'o', 'e', 8)] = KEYWORD_CONTINUE,
+    [KEYWORD_HASH('d', 'e', 't', 7)] = KEYWORD_DEFAULT,
+    [KEYWORD_HASH('d', 'o', 'o', 2)] = KEYWORD_DO,
+    [KEYWORD_HASH('d', 'o', 'e', 6)] = KEYWORD_DOUBLE,
+    [KEYWORD_HASH('e', 'l', 'e', 4)] = KEYWORD_ELSE,
+    [KEYWORD_HASH('e', 'n', 'm', 4)] = KEYWORD_ENUM,
+    [KEYWORD_HASH('e', 'x', 'n', 6)] = KEYWORD_EXTERN,
+    [KEYWORD_HASH('f', 'l', 't', 5)] = KEYWORD_FLOAT,
+    [KEYWORD_HASH('f', 'o', 'r', 3)] = KEYWORD_FOR,
+    [KEYWORD_HASH('g', 'o', 'o', 4)] = KEYWORD_GOTO,
+    [KEYWORD_HASH('i', 'f', 'f', 2)] = KEYWORD_IF,
+    [KEYWORD_HASH('i', 'n', 't', 3)] = KEYWORD_INT,
+    [KEYWORD_HASH('l', 'o', 'g', 4)] = KEYWORD_LONG,
+    [KEYWORD_HASH('r', 'e', 'r', 8)] = KEYWORD_REGISTER,
+    [KEYWORD_HASH('r', 'e', 'n', 6)] = KEYWORD_RETURN,
+    [KEYWORD_HASH('s', 'h', 't', 5)] = KEYWORD_SHORT,
+    [KEYWORD_HASH('s', 'i', 'd', 6)] = KEYWORD_SIGNED,
+    [KEYWORD_HASH('s', 'i', 'f', 6)] = KEYWORD_SIZEOF,
+    [KEYWORD_HASH('s', 't', 'c', 6)] = KEYWORD_STATIC,
+    [KEYWORD_HASH('s', 't', 't', 6)] = KEYWORD_STRUCT,
+    [KEYWORD_HASH('s', 'w', 'h', 6)] = KEYWORD_SWITCH,
+    [KEYWORD_HASH('t', 'y', 'f', 7)] = KEYWORD_TYPEDEF,
+    [KEYWORD_HASH('u', 'n', 'n', 5)] = KEYWORD_UNION,
+    [KEYWORD_HASH('u', 'n', 'd', 8)] = KEYWORD_UNSIGNED,
+    [KEYWORD_HASH('v', 'o', 'd', 4)] = KEYWORD_VOID,
+    [KEYWORD_HASH('v', 'o', 'e', 8)] = KEYWORD_VOLATILE,
+    [KEYWORD_HASH('w', 'h', 'e', 5)] = KEYWORD_WHILE,
+};
+
+KeywordVariant_t find_keyword(const ConstString_t str) {
+    const size_t len = str.end - str.begin;
+    if (len < 2 || len > 8) {
+        return KEYWORD_NONE;
+    }
+    const uint8_t *word = (const uint8_t *)str.begin;
+    const KeywordVariant_t keyword = keyword_table[KEYWORD_HASH(word[0], word[1], word[len - 1], len)];
+    if (keyword == KEYWORD_NONE || strlen(keyword_strs[keyword]) != len || memcmp(keyword_strs[keyword], str.begin, len)) {
+        return KEYWORD_NONE;
+    }
+    return keyword;
+}
+
 bool is_keyword(const ConstString_t str) {
-    const char **keyword = keywords;
-    while (*keyword) {
-        size_t output_len = str.end - str.begin;
-        size_t keyword_len = strlen(*keyword);
-        if (output_len == keyword_len && !strncmp(*keyword, str.begin, output_len)) {
-            return true;
-        }
-        ++keyword;
+    return find_keyword(str) != KEYWORD_NONE;
+}
+
+static int digit_value(const char c) {
+    if ('0' <= c && c <= '9') {
+        return c - '0';
     }
-    return false;
+    if ('a' <= c && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if ('A' <= c && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return 16;
 }
 
 TryIntegerLiteral_t find_integer(const ConstString_t str) {
     TryIntegerLiteral_t output;
+    output.status = TRY_NONE;
     output.value.integer = 0;
+    output.value.base = INTEGER_DECIMAL;
+    output.value.suffix = INTEGER_SUFFIX_NONE;
     const char *it = str.begin;
-    while (it < str.end && '0' <= *it && *it <= '9') {
-        output.value.integer *= 10;
-        output.value.integer += *it - '0';
+    if (it == str.end || *it < '0' || *it > '9') {
+        return output;
+    }
+    unsigned radix = 10;
+    if (*it == '0' && it + 2 < str.end && (it[1] == 'x' || it[1] == 'X') && digit_value(it[2]) < 16) {
+        output.value.base = INTEGER_HEX;
+        radix = 16;
+        it += 2;
+    }
+    else if (*it == '0') {
+        output.value.base = INTEGER_OCTAL;
+        radix = 8;
+    }
+    while (it < str.end && digit_value(*it) < (int)radix) {
+        if (__builtin_mul_overflow(output.value.integer, radix, &output.value.integer) ||
+                __builtin_add_overflow(output.value.integer, digit_value(*it), &output.value.integer)) {
+            return output;
+        }
         ++it;
     }
-    if (it == str.begin) {
-        output.status = TRY_NONE;
-        return output;
+
+    // u and l or ll in either order, the two l's in the same case
+    bool is_unsigned = false;
+    int n_longs = 0;
+    for (int part = 0; part < 2 && it < str.end; ++part) {
+        if (!is_unsigned && (*it == 'u' || *it == 'U')) {
+            is_unsigned = true;
+            ++it;
+        }
+        else if (!n_longs && (*it == 'l' || *it == 'L')) {
+            n_longs = it + 1 < str.end && it[1] == *it ? 2 : 1;
+            it += n_longs;
+        }
     }
+    static const IntegerSuffix_t suffixes[2][3] = {
+        {INTEGER_SUFFIX_NONE, INTEGER_SUFFIX_L, INTEGER_SUFFIX_LL},
+        {INTEGER_SUFFIX_U, INTEGER_SUFFIX_UL, INTEGER_SUFFIX_ULL}
+    };
+    output.value.suffix = suffixes[is_unsigned][n_longs];
     output.status = TRY_SUCCESS;
     output.value.str.begin = str.begin;
     output.value.str.end = it;
     return output;
 }
 
+bool integer_literal_type(const uint64_t value, const IntegerBase_t base, const IntegerSuffix_t suffix, PrimitiveVariant_t *const type) {
+    // Candidates in order; a decimal constant without u is never unsigned
+    static const PrimitiveVariant_t candidates[] = {
+        PRIMITIVE_INT, PRIMITIVE_UNSIGNED_INT, PRIMITIVE_LONG, PRIMITIVE_UNSIGNED_LONG,
+        PRIMITIVE_LONG_LONG, PRIMITIVE_UNSIGNED_LONG_LONG
+    };
+    static const uint64_t max_values[] = {
+        INT32_MAX, UINT32_MAX, INT64_MAX, UINT64_MAX, INT64_MAX, UINT64_MAX
+    };
+    size_t first;
+    switch (suffix) {
+        case INTEGER_SUFFIX_U: first = 1; break;
+        case INTEGER_SUFFIX_L: first = 2; break;
+        case INTEGER_SUFFIX_UL: first = 3; break;
+        case INTEGER_SUFFIX_LL: first = 4; break;
+        case INTEGER_SUFFIX_ULL: first = 5; break;
+        default: first = 0; break;
+    }
+    const bool is_unsigned = suffix == INTEGER_SUFFIX_U || suffix == INTEGER_SUFFIX_UL || suffix == INTEGER_SUFFIX_ULL;
+    for (size_t i = first; i < sizeof(candidates) / sizeof(candidates[0]); ++i) {
+        const bool candidate_unsigned = i % 2;
+        if (candidate_unsigned != is_unsigned && (is_unsigned || base == INTEGER_DECIMAL)) {
+            continue;
+        }
+        if (value <= max_values[i]) {
+            *type = candidates[i];
+            return true;
+        }
+    }
+    return false;
+}
+
 TryConstString_t find_closing(const ConstString_t str, const char opening, const char closing) {
     TryConstString_t output;
     if (str.begin == str.end || *str.begin != opening) {
         output.status = TRY_NONE;
         return output;
     }
+    const SourceIndex_t *index = find_source_index(str);
+    if (index && index->valid) {
+        const uint32_t match = index->match[str.begin - index->source.begin];
+        if (match != SOURCE_INDEX_NO_MATCH && match != SOURCE_INDEX_LITERAL && index->source.begin[match] == closing) {
+            const char *end = index->source.begin + match + 1;
+            if (end > str.end) {
+                output.status = TRY_ERROR;
+                output.error.location = str;
+                output.error.desc = "No closing character";
+            }
+            else {
+                output.status = TRY_SUCCESS;
+                output.value.begin = str.begin;
+                output.value.end = end;
+            }
+            return output;
+        }
+    }
     size_t depth = 1;
     const char *it = str.begin + 1;
     while (depth > 0 && it < str.end) {
@@ -296,14 +446,39 @@ TryConstString_t find_string_lit(const ConstString_t str, const char quote, cons
         output.status = TRY_NONE;
         return output;
     }
+    const SourceIndex_t *index = find_source_index(str);
+    if (index && index->valid && escape == '\\') {
+        const uint32_t offset = str.begin - index->source.begin;
+        const uint32_t match = index->match[offset];
+        if (match != SOURCE_INDEX_NO_MATCH && match != SOURCE_INDEX_LITERAL && match > offset) {
+            const char *end = index->source.begin + match + 1;
+            if (end > str.end) {
+                output.status = TRY_ERROR;
+                output.error.location = str;
+                output.error.desc = "No closing quote";
+            }
+            else {
+                output.status = TRY_SUCCESS;
+                output.value.begin = str.begin;
+                output.value.end = end;
+            }
+            return output;
+        }
+    }
     const char *it = str.begin + 1;
-    while (*it != quote && it < str.end) {
+    if (index && escape == '\\') {
+        const uint32_t literal = SCAN_CLASS(SCAN_QUOTE) | SCAN_CLASS(SCAN_ESCAPE);
+        while ((it = scan_next(&index->bitmaps, literal, it, str.end)) < str.end && *it != quote) {
+            it += *it == escape ? 2 : 1;
+        }
+    }
+    while (it < str.end && *it != quote) {
         if (*it == escape) {
             ++it;
         }
         ++it;
     }
-    if (it == str.end) {
+    if (it >= str.end) {
         output.status = TRY_ERROR;
         output.error.location = str;
         output.error.desc = "No closing quote";
@@ -319,6 +494,57 @@ TryConstString_t find_string_lit(const ConstString_t str, const char quote, cons
 TryConstString_t find_string_nesting_sensitive(const ConstString_t str, const ConstString_t pattern) {
     TryConstString_t output;
     ConstString_t working = str;
+
+    // Jump between candidate positions (openers and possible pattern starts)
+    // using the bitmaps, and over closures using the index; literal contents
+    // cannot be skipped from the inside, so a string starting inside a literal
+    // is scanned below instead
+    const SourceIndex_t *index = find_source_index(str);
+    if (    index && index->valid && pattern.begin < pattern.end &&
+            index->match[str.begin - index->source.begin] != SOURCE_INDEX_LITERAL) {
+        uint32_t candidates = SCAN_CLASS(SCAN_OPEN_BRACKET) | SCAN_CLASS(SCAN_QUOTE);
+        bool search_first_char = false;
+        switch (*pattern.begin) {
+            case ';': candidates |= SCAN_CLASS(SCAN_SEMICOLON); break;
+            case ',': candidates |= SCAN_CLASS(SCAN_COMMA); break;
+            case '(': case '[': case '{': case '"': case '\'': break;
+            default: search_first_char = true; break;
+        }
+        while (working.begin < working.end) {
+            const char *next = scan_next(&index->bitmaps, candidates, working.begin, working.end);
+            if (search_first_char) {
+                const char *first_char = memchr(working.begin, *pattern.begin, next - working.begin);
+                if (first_char) {
+                    next = first_char;
+                }
+            }
+            working.begin = next;
+            if (working.begin >= working.end) {
+                break;
+            }
+            const uint32_t offset = working.begin - index->source.begin;
+            const uint32_t match = index->match[offset];
+            TryConstString_t found = find_string(working, pattern);
+            if (found.status == TRY_SUCCESS) {
+                return found;
+            }
+            if (match != SOURCE_INDEX_NO_MATCH && match > offset) {
+                const char *closure_end = index->source.begin + match + 1;
+                if (closure_end > working.end) {
+                    const char c = *working.begin;
+                    output.status = TRY_ERROR;
+                    output.error.location = working;
+                    output.error.desc = c == '"' || c == '\'' ? "No closing quote" : "No closing character";
+                    return output;
+                }
+                working.begin = closure_end;
+            }
+            else {
+                ++working.begin;
+            }
+        }
+    }
+
     while (working.begin < working.end) {
         TryConstString_t match = find_string(working, pattern);
         if (match.status == TRY_SUCCESS) {
@@ -5,6 +5,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 
 /**
  * STRING DATA STRUCTURE
@@ -27,6 +28,116 @@ AConstString_t new_alloc_const_string_from_alloc_const_str(const AConstString_t
 void free_alloc_const_string(AConstString_t *const str);
 int cmp_alloc_const_str(AConstString_t const first, AConstString_t const second);
 
+/**
+ * OUTPUT SINKS
+ *
+ * Destination of the print_* functions: a growable NUL-terminated buffer, a
+ * FILE *, or a callback that receives each chunk; `written` counts the
+ * characters written so far
+ */
+typedef enum {
+    SINK_BUFFER,
+    SINK_FILE,
+    SINK_CALLBACK
+} SinkVariant_t;
+typedef void (*SinkCallback_t)(void *const user, const char *const str, const size_t len);
+typedef struct Sink {
+    SinkVariant_t variant;
+    size_t written;
+    union {
+        struct {
+            char *data;
+            size_t size;
+            size_t capacity;
+        } buffer;
+        FILE *file;
+        struct {
+            SinkCallback_t func;
+            void *user;
+        } callback;
+    };
+} Sink_t;
+Sink_t new_buffer_sink();
+Sink_t new_file_sink(FILE *const file);
+Sink_t new_callback_sink(const SinkCallback_t func, void *const user);
+void free_sink(Sink_t *const sink);
+
+/**
+ * Empty a buffer sink while keeping its memory; `sink_str` is its contents
+ */
+void reset_sink(Sink_t *const sink);
+const char *sink_str(const Sink_t *const sink);
+
+void sink_write(Sink_t *const sink, const char *const str, const size_t len);
+void sink_puts(Sink_t *const sink, const char *const str);
+void sink_printf(Sink_t *const sink, const char *const format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * SYMBOLS
+ *
+ * Interned spellings of names and literals: each unique spelling has exactly
+ * one Symbol_t for the lifetime of the symbol table, so symbols compare by
+ * pointer (or id) and carry their hash. The text is NUL-terminated.
+ */
+typedef struct Symbol {
+    uint32_t id;
+    uint32_t hash;
+    AConstString_t str;
+} Symbol_t;
+const Symbol_t *intern(const ConstString_t str);
+const Symbol_t *intern_cstr(const char *const str);
+uint32_t hash_const_str(const ConstString_t str);
+/**
+ * A 64-bit hash of a whole buffer, such as a source file, for `seed`
+ */
+uint64_t hash_bytes(const ConstString_t str, const uint64_t seed);
+int cmp_symbol(const Symbol_t *const first, const Symbol_t *const second);
+uint32_t hash_symbol(const Symbol_t *const symbol);
+size_t n_symbols();
+
+/**
+ * Release every symbol; previously returned symbols must no longer be used
+ */
+void free_symbol_table();
+
+/**
+ * KEYWORDS
+ */
+typedef enum {
+    KEYWORD_NONE,
+    KEYWORD_BREAK,
+    KEYWORD_CASE,
+    KEYWORD_CHAR,
+    KEYWORD_CONST,
+    KEYWORD_CONTINUE,
+    KEYWORD_DEFAULT,
+    KEYWORD_DO,
+    KEYWORD_DOUBLE,
+    KEYWORD_ELSE,
+    KEYWORD_ENUM,
+    KEYWORD_EXTERN,
+    KEYWORD_FLOAT,
+    KEYWORD_FOR,
+    KEYWORD_GOTO,
+    KEYWORD_IF,
+    KEYWORD_INT,
+    KEYWORD_LONG,
+    KEYWORD_REGISTER,
+    KEYWORD_RETURN,
+    KEYWORD_SHORT,
+    KEYWORD_SIGNED,
+    KEYWORD_SIZEOF,
+    KEYWORD_STATIC,
+    KEYWORD_STRUCT,
+    KEYWORD_SWITCH,
+    KEYWORD_TYPEDEF,
+    KEYWORD_UNION,
+    KEYWORD_UNSIGNED,
+    KEYWORD_VOID,
+    KEYWORD_VOLATILE,
+    KEYWORD_WHILE
+} KeywordVariant_t;
+
 /**
  * TRY MACROS
  */
@@ -65,17 +176,29 @@ struct DerivedType;
 struct Variable;
 struct Expression;
 struct Operator;
-struct EnumFieldLinkedListNode;
-struct VariableLinkedListNode;
 
 struct Scope;
 struct Statement;
 struct Control;
 struct GlobalContext;
 struct GlobalDefinition;
-struct StatementLinkedListNode;
 struct GlobalDefinitionLinkedListNode;
 
+/**
+ * SPANS
+ *
+ * Child lists are stored contiguously: a pointer to the first element and a
+ * 32-bit count, allocated in one piece once the list is complete
+ */
+#define GrammarSpanType(type) \
+    struct { \
+        type *items; \
+        uint32_t size; \
+    }
+typedef GrammarSpanType(struct EnumField) EnumFieldSpan_t;
+typedef GrammarSpanType(struct Variable) VariableSpan_t;
+typedef GrammarSpanType(struct Statement) StatementSpan_t;
+
 /**
  * DATA TYPES
  */
@@ -102,7 +225,7 @@ typedef enum {
     PRIMITIVE_DOUBLE,
 } PrimitiveVariant_t;
 typedef struct EnumField {
-    AConstString_t name;
+    const Symbol_t *name;
     int64_t value;
 } EnumField_t;
 typedef struct Type {
@@ -110,15 +233,15 @@ typedef struct Type {
     union {
         PrimitiveVariant_t primitive;
         struct {
-            AConstString_t name;
+            const Symbol_t *name;
             bool has_name;
             bool is_definition;
             union {
-                struct VariableLinkedListNode *su_fields;
-                struct EnumFieldLinkedListNode *e_fields;
+                VariableSpan_t su_fields;
+                EnumFieldSpan_t e_fields;
             };
         } compound;
-        AConstString_t named;
+        const Symbol_t *named;
     };
     ConstString_t str;
 } Type_t;
@@ -139,10 +262,15 @@ typedef enum {
 } QualifierVariant_t;
 typedef struct DerivedType {
     DerivedTypeVariant_t variant;
+    uint32_t hash; // Structural hash, see TYPE INTERNING
+    uint32_t id; // In the context's type pool, see NODE POOLS
     union {
         struct {
             QualifierVariant_t qualifier;
             Type_t type;
+            // What a typedef name or struct/union tag stood for where flow
+            // declared a variable of this type, or NULL as parsed
+            const struct DerivedType *resolved;
         } terminal;
         struct {
             QualifierVariant_t qualifier;
@@ -150,12 +278,21 @@ typedef struct DerivedType {
         } pointer;
         struct {
             struct DerivedType *inner_type;
-            AConstString_t size;
+            AConstString_t size; // As written, which is what identifies the type
             bool has_size;
+            // Evaluated once when the declarator is parsed; a size that is
+            // not constant on its own, like one using sizeof or an enum, is
+            // kept parsed for flow to evaluate in its scope, or NULL if it
+            // is not an expression
+            bool is_size_constant;
+            union {
+                uint64_t size_value;
+                const struct Expression *size_expr;
+            };
         } array;
         struct {
             struct DerivedType *return_type;
-            struct VariableLinkedListNode *params;
+            VariableSpan_t params;
         } function;
     };
 } DerivedType_t;
@@ -164,11 +301,32 @@ typedef struct DerivedType {
  * VARIABLES
  */
 typedef struct Variable {
-    AConstString_t name;
+    const Symbol_t *name;
     bool has_name;
     struct DerivedType *type;
+    // Parameters of every function type in `type` as declared, outermost
+    // function first, since canonical function types drop parameter names
+    VariableSpan_t params;
 } Variable_t;
 
+/**
+ * How an integer constant was written; together with its value this decides
+ * its type
+ */
+typedef enum {
+    INTEGER_DECIMAL,
+    INTEGER_OCTAL,
+    INTEGER_HEX
+} IntegerBase_t;
+typedef enum {
+    INTEGER_SUFFIX_NONE,
+    INTEGER_SUFFIX_U,
+    INTEGER_SUFFIX_L,
+    INTEGER_SUFFIX_UL,
+    INTEGER_SUFFIX_LL,
+    INTEGER_SUFFIX_ULL
+} IntegerSuffix_t;
+
 /**
  * EXPRESSIONS
  */
@@ -184,13 +342,15 @@ typedef enum {
 } ExpressionVariant_t;
 typedef struct Expression {
     ExpressionVariant_t variant;
+    uint8_t uint_lit_base; // IntegerBase_t of an EXPRESSION_UINT_LIT
+    uint8_t uint_lit_suffix; // IntegerSuffix_t of an EXPRESSION_UINT_LIT
     union {
         struct Operator *operator;
-        AConstString_t identifier;
+        const Symbol_t *identifier;
         struct DerivedType *type;
         struct Variable *decl;
-        AConstString_t str_lit;
-        AConstString_t char_lit;
+        const Symbol_t *str_lit;
+        const Symbol_t *char_lit;
         uint64_t uint_lit;
     };
 } Expression_t;
@@ -219,7 +379,7 @@ typedef struct Operator {
  * INTERNAL SCOPE
  */
 typedef struct Scope {
-    struct StatementLinkedListNode *statements;
+    StatementSpan_t statements;
 } Scope_t;
 typedef struct Function {
     struct Variable signature;
@@ -279,7 +439,9 @@ typedef struct Control {
  */
 typedef struct {
     ConstString_t str;
-    int64_t integer;
+    uint64_t integer;
+    IntegerBase_t base;
+    IntegerSuffix_t suffix;
 } IntegerLiteral_t;
 typedef GrammarTryType(IntegerLiteral_t) TryIntegerLiteral_t;
 
@@ -290,6 +452,7 @@ typedef GrammarTryType(EnumField_t) TryEnumField_t;
 typedef GrammarTryType(Expression_t) TryExpression_t;
 typedef GrammarTryType(Operator_t) TryOperator_t;
 typedef GrammarTryType(char *) TryCharPtr_t;
+typedef GrammarTryType(size_t) TrySize_t;
 typedef GrammarTryType(Scope_t) TryScope_t;
 typedef GrammarTryType(Statement_t) TryStatement_t;
 
@@ -297,18 +460,353 @@ typedef struct ErrorLinkedListNode {
     struct ErrorLinkedListNode *next;
     struct Error value;
 } ErrorLinkedListNode_t;
-typedef struct EnumFieldLinkedListNode {
-    struct EnumFieldLinkedListNode *next;
-    struct EnumField value;
-} EnumFieldLinkedListNode_t;
-typedef struct VariableLinkedListNode {
-    struct VariableLinkedListNode *next;
-    struct Variable value;
-} VariableLinkedListNode_t;
-typedef struct StatementLinkedListNode {
-    struct StatementLinkedListNode *next;
-    struct Statement value;
-} StatementLinkedListNode_t;
+
+/**
+ * STRUCTURAL BITMAPS
+ *
+ * One bit per input byte for each character class, built by a vectorized
+ * pre-pass over the whole buffer (SSE2, or AVX2 when the CPU supports it)
+ */
+typedef enum {
+    SCAN_WHITESPACE,
+    SCAN_OPEN_BRACKET,
+    SCAN_CLOSE_BRACKET,
+    SCAN_QUOTE,
+    SCAN_ESCAPE,
+    SCAN_SEMICOLON,
+    SCAN_COMMA,
+    SCAN_IDENTIFIER,
+    N_SCAN_CLASSES
+} ScanClassVariant_t;
+#define SCAN_CLASS(variant) ((uint32_t)1 << (variant))
+typedef struct StructuralBitmaps {
+    ConstString_t source;
+    size_t n_words; // Words per class
+    uint64_t *words; // Class-major: class `c` starts at `words + c * n_words`
+} StructuralBitmaps_t;
+StructuralBitmaps_t scan_structure(const ConstString_t str);
+void free_structural_bitmaps(StructuralBitmaps_t *const bitmaps);
+
+/**
+ * `scan_structure` with a given classifier instead of the widest one the CPU
+ * supports, so that tests can compare them; the classifier must be available
+ */
+typedef enum {
+    SCAN_CLASSIFIER_SCALAR,
+    SCAN_CLASSIFIER_SSE2,
+    SCAN_CLASSIFIER_AVX2,
+    N_SCAN_CLASSIFIERS
+} ScanClassifierVariant_t;
+bool has_scan_classifier(const ScanClassifierVariant_t variant);
+StructuralBitmaps_t scan_structure_with(const ConstString_t str, const ScanClassifierVariant_t variant);
+
+/**
+ * Find the first position in [from, limit) whose character belongs (or, for
+ * `scan_next_not`, does not belong) to any of the classes in the
+ * `SCAN_CLASS` set; returns `limit` if there is none
+ */
+const char *scan_next(const StructuralBitmaps_t *const bitmaps, const uint32_t classes, const char *const from, const char *const limit);
+const char *scan_next_not(const StructuralBitmaps_t *const bitmaps, const uint32_t classes, const char *const from, const char *const limit);
+
+/**
+ * PARSE CONTEXT
+ *
+ * Owns the memory of everything parsed while it is attached: AST nodes and
+ * copied strings are bump-allocated from an arena of chunks, speculative
+ * parses roll the arena back when they are thrown away, and freeing the
+ * context releases a whole translation unit at once. Without an attached
+ * context, nodes are allocated with malloc as before.
+ */
+#define ARENA_ALIGNMENT 16 // Enough for any scalar type, like malloc
+typedef struct ArenaChunk {
+    struct ArenaChunk *prev;
+    size_t size;
+    size_t used;
+    _Alignas(ARENA_ALIGNMENT) char data[];
+} ArenaChunk_t;
+typedef struct {
+    ArenaChunk_t *head;
+    size_t allocated; // Total bytes handed out, used to order allocations
+} Arena_t;
+typedef struct {
+    ArenaChunk_t *head;
+    size_t used;
+    size_t allocated;
+} ArenaCheckpoint_t;
+Arena_t new_arena();
+void *arena_alloc(Arena_t *const arena, const size_t size);
+ArenaCheckpoint_t arena_checkpoint(const Arena_t *const arena);
+void arena_rollback(Arena_t *const arena, const ArenaCheckpoint_t checkpoint);
+void free_arena(Arena_t *const arena);
+
+/**
+ * NODE POOLS
+ *
+ * Expressions, operators and derived types are small and numerous, so each
+ * kind has a pool of its own in the context. Nodes of one kind sit next to
+ * each other in chunks that never move, and are numbered from 1 in the order
+ * they were allocated, so a node is found from its 32-bit ID in O(1) and
+ * tables over the nodes of a kind can be dense arrays. Nodes still link to
+ * each other by pointer; canonical derived types also record their own ID.
+ * Pools are rolled back along with the arena
+ */
+typedef uint32_t NodeId_t;
+#define NO_NODE_ID 0
+#define NODE_POOL_CHUNK_BITS 10 // 1024 nodes per chunk
+typedef struct {
+    char **chunks;
+    uint32_t n_chunks;
+    uint32_t size; // Nodes handed out, which is also the ID of the last one
+    size_t node_size;
+} NodePool_t;
+
+typedef struct MappedSource {
+    struct MappedSource *next;
+    void *addr;
+    size_t size;
+} MappedSource_t;
+typedef struct ParseContext {
+    Arena_t arena;
+    MappedSource_t *sources; // Unmapped when the context is freed
+    bool zero_copy; // Strings are views into the source instead of copies
+    struct TypeTable *types; // Canonical derived types, created on first use
+    NodePool_t expressions;
+    NodePool_t operators;
+    NodePool_t derived_types;
+} ParseContext_t;
+ParseContext_t *new_parse_context();
+void free_parse_context(ParseContext_t *const context);
+
+/**
+ * Allocate a node from its pool in the attached context, where its ID is the
+ * pool's new size, or with malloc if there is none; like `parse_alloc`, the
+ * node is not zeroed
+ */
+Expression_t *new_expression();
+Operator_t *new_operator();
+DerivedType_t *new_derived_type();
+
+/**
+ * The node with an ID in a context's pool; NULL for NO_NODE_ID or an ID that
+ * was never handed out
+ */
+Expression_t *expression_at(const ParseContext_t *const context, const NodeId_t id);
+Operator_t *operator_at(const ParseContext_t *const context, const NodeId_t id);
+DerivedType_t *derived_type_at(const ParseContext_t *const context, const NodeId_t id);
+
+/**
+ * Map a file read-only for the lifetime of the context
+ *  SUCCESS: the file contents
+ *  ERROR: the file could not be opened or mapped
+ */
+TryConstString_t map_source_file(ParseContext_t *const context, const char *const path);
+
+/**
+ * Hand a mapping to the context, which unmaps it when it is freed
+ */
+void add_mapped_source(ParseContext_t *const context, void *const addr, const size_t size);
+
+/**
+ * Attach a context so that parse functions allocate from it; returns the
+ * previously attached context so that it can be restored
+ */
+ParseContext_t *attach_parse_context(ParseContext_t *const context);
+ParseContext_t *get_attached_parse_context();
+
+/**
+ * Allocate from the attached context, or with malloc if there is none;
+ * `parse_free` only frees memory that did not come from a context; in
+ * zero-copy mode `parse_alloc_const_string` returns the source view itself
+ */
+void *parse_alloc(const size_t size);
+void parse_free(void *const ptr);
+AConstString_t parse_alloc_const_string(const ConstString_t str);
+
+/**
+ * Collect the elements of a span in a growable scratch buffer while its
+ * children are parsed, then copy them into one parse allocation; an empty
+ * span has NULL items, and `free_span_builder` discards an unfinished span
+ */
+typedef struct {
+    void *items;
+    uint32_t size;
+    uint32_t capacity;
+    size_t item_size;
+} SpanBuilder_t;
+SpanBuilder_t new_span_builder(const size_t item_size);
+void *span_builder_push(SpanBuilder_t *const builder);
+void *finish_span(SpanBuilder_t *const builder);
+void free_span_builder(SpanBuilder_t *const builder);
+
+/**
+ * Checkpoint before a speculative parse and roll back if its result is
+ * discarded; both are no-ops without an attached context
+ */
+typedef struct {
+    ArenaCheckpoint_t arena;
+    uint32_t n_expressions;
+    uint32_t n_operators;
+    uint32_t n_derived_types;
+} ParseCheckpoint_t;
+ParseCheckpoint_t parse_checkpoint();
+void parse_rollback(const ParseCheckpoint_t checkpoint);
+
+/**
+ * TYPE INTERNING
+ *
+ * Derived types are hash-consed in the attached context: structurally
+ * identical types share one immutable canonical node with a cached hash, so
+ * two types are the same exactly when their pointers are equal. Children must
+ * already be canonical. Struct/union/enum definitions are only equal to
+ * themselves. Function parameter names are not part of a type, so canonical
+ * function types keep unnamed copies of their parameters. A name resolved by
+ * flow, and an array size it evaluated, are part of the type, so the same
+ * name bound in two scopes gives two types. Without a context every call
+ * returns a fresh copy
+ */
+DerivedType_t *canonical_derived_type(const DerivedType_t *const proto);
+size_t n_canonical_types();
+
+/**
+ * Keys for maps over canonical types
+ */
+int cmp_canonical_type(const DerivedType_t *const first, const DerivedType_t *const second);
+uint32_t hash_canonical_type(const DerivedType_t *const type);
+
+/**
+ * Forget canonical types allocated after an arena checkpoint; called by
+ * `parse_rollback`
+ */
+void invalidate_canonical_types(const size_t allocated);
+void free_type_table(struct TypeTable *const table);
+
+/**
+ * SOURCE INDEX
+ *
+ * Side table built once per input buffer: every opening bracket or quote is
+ * mapped to its matching close (and every close back to its opening), and
+ * every position is mapped to its nesting depth. While an index is attached,
+ * the closure helpers below jump straight to the match for any string inside
+ * the indexed buffer instead of counting depth again.
+ */
+#define SOURCE_INDEX_NO_MATCH ((uint32_t)-1)
+#define SOURCE_INDEX_LITERAL ((uint32_t)-2)
+typedef struct SourceIndex {
+    ConstString_t source;
+    uint32_t *match; // Offset of the matching character, or one of the markers above
+    uint32_t *depth;
+    StructuralBitmaps_t bitmaps;
+    bool valid; // False if brackets/quotes are unbalanced; helpers then scan as usual
+    struct ParseMemo *memo; // NULL if memoization is disabled
+} SourceIndex_t;
+SourceIndex_t build_source_index(const ConstString_t str);
+void free_source_index(SourceIndex_t *const index);
+
+/**
+ * Attach an index so that the helpers use it; returns the previously attached
+ * index so that it can be restored
+ */
+const SourceIndex_t *attach_source_index(const SourceIndex_t *const index);
+const SourceIndex_t *get_attached_source_index();
+
+/**
+ * Get the attached index if it covers the whole string, NULL otherwise
+ */
+const SourceIndex_t *find_source_index(const ConstString_t str);
+
+/**
+ * Nesting depth of a position covered by the index; literal contents are one
+ * level deeper than their quotes
+ */
+uint32_t source_index_depth(const SourceIndex_t *const index, const char *const pos);
+
+/**
+ * Run `call` with an index for `str` attached, building one first if no
+ * attached index covers `str` yet; used by the top-level parse entry points
+ * so that each input buffer is indexed once
+ */
+#define WithSourceIndex(str, output, call) \
+    if (!find_source_index(str)) { \
+        SourceIndex_t index = build_source_index(str); \
+        const SourceIndex_t *prev_index = attach_source_index(&index); \
+        output = call; \
+        attach_source_index(prev_index); \
+        free_source_index(&index); \
+        return output; \
+    }
+
+/**
+ * PARSE MEMO
+ *
+ * Packrat table owned by the source index: results of the backtracking
+ * productions are cached by (span begin, span end, production), so a span
+ * that is tried again by another alternative is parsed only once per buffer.
+ * Results share their trees, which are never modified after parsing.
+ */
+typedef enum {
+    MEMO_TYPE,
+    MEMO_VARIABLE,
+    MEMO_LEFT_EXPRESSION,
+    MEMO_RIGHT_EXPRESSION,
+    MEMO_TYPE_EXPRESSION,
+    N_MEMO_PRODUCTIONS
+} MemoProductionVariant_t;
+typedef union {
+    TryType_t type;
+    TryVariable_t variable;
+    TryExpression_t expression;
+} MemoResult_t;
+typedef struct {
+    uint64_t hits[N_MEMO_PRODUCTIONS];
+    uint64_t misses[N_MEMO_PRODUCTIONS];
+} ParseMemoStats_t;
+struct ParseMemo *new_parse_memo();
+void free_parse_memo(struct ParseMemo *const memo);
+
+/**
+ * Enable or disable memoization for indexes built from now on; disabled by
+ * default, since it only pays off when alternatives re-parse the same spans
+ */
+void set_parse_memo_enabled(const bool enabled);
+bool is_parse_memo_enabled();
+
+/**
+ * Look up a result in the memo of the attached index; returns NULL on a miss
+ * or if there is no memo for the string
+ */
+const MemoResult_t *lookup_parse_memo(const MemoProductionVariant_t production, const ConstString_t str);
+void store_parse_memo(const MemoProductionVariant_t production, const ConstString_t str, const MemoResult_t *const result);
+
+/**
+ * Forget results stored after the given arena position, since a rollback
+ * has released their memory
+ */
+void invalidate_parse_memo(const size_t allocated);
+
+/**
+ * Hit/miss counts per production, accumulated over all parses since the last
+ * reset
+ */
+ParseMemoStats_t get_parse_memo_stats();
+void reset_parse_memo_stats();
+const char *memo_production_str(const MemoProductionVariant_t production);
+
+/**
+ * Return the memoized result for `str` if there is one, otherwise return
+ * `call` and remember its result; `field` selects the `MemoResult_t` member
+ */
+#define WithParseMemo(production, field, str, output, call) \
+    { \
+        const MemoResult_t *memoized = lookup_parse_memo(production, str); \
+        if (memoized) { \
+            return memoized->field; \
+        } \
+        output = call; \
+        MemoResult_t result; \
+        result.field = output; \
+        store_parse_memo(production, str, &result); \
+        return output; \
+    }
 
 /**
  * Prefixes:
@@ -366,13 +864,27 @@ TryConstString_t find_identifier(const ConstString_t str);
 bool is_keyword(const ConstString_t str);
 
 /**
- * If the string begins with an integer, return the ConstString and parsed
+ * Classify the string as one of the keywords in a constant number of steps;
+ * returns KEYWORD_NONE if the string is not exactly a keyword
+ */
+KeywordVariant_t find_keyword(const ConstString_t str);
+
+/**
+ * If the string begins with an integer constant, decimal, octal or hex and
+ * with an optional u and l/ll suffix, return the ConstString and parsed
  * integer
  *  SUCCESS: an integer was found
- *  NONE: an integer was not found
+ *  NONE: an integer was not found, or it does not fit in 64 bits
  */
 TryIntegerLiteral_t find_integer(const ConstString_t str);
 
+/**
+ * The type of an integer constant: the first type its base and suffix allow
+ * that holds its value, with long and long long both 64 bits wide
+ *  false: no type holds it, as for an unsuffixed decimal above LONG_MAX
+ */
+bool integer_literal_type(const uint64_t value, const IntegerBase_t base, const IntegerSuffix_t suffix, PrimitiveVariant_t *const type);
+
 /**
  * Find the closing token, return the string enclosing the tokens
  *  SUCCESS: the first and last characters of the enclosed string are valid
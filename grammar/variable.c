@@ -1,6 +1,7 @@
 #include "grammar.h"
 
 #include <assert.h>
+#include <ctype.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -48,7 +49,234 @@ TryQualifierString_t find_qualifier(const ConstString_t str) {
     return output;
 }
 
-TryVariable_t parse_variable(const ConstString_t str) {
+/**
+ * The size of an array is kept as written and evaluated here, once: most
+ * sizes are integer literals, which need no parsing, and other constant
+ * ones are folded without a scope. What is left is kept parsed; `tokens`
+ * holds the tokens of `contents` if they were lexed, and is NULL otherwise
+ */
+static void set_array_size(DerivedType_t *const der, ConstString_t contents, const TokenSpan_t *const tokens) {
+    der->array.has_size = contents.begin < contents.end;
+    der->array.is_size_constant = false;
+    der->array.size_expr = NULL;
+    if (!der->array.has_size) {
+        return;
+    }
+    der->array.size = parse_alloc_const_string(contents);
+
+    while (contents.begin < contents.end && isspace(*contents.begin)) {
+        ++contents.begin;
+    }
+    while (contents.begin < contents.end && isspace(contents.end[-1])) {
+        --contents.end;
+    }
+    PrimitiveVariant_t primitive;
+    const TryIntegerLiteral_t literal = find_integer(contents);
+    if (literal.status == TRY_SUCCESS && literal.value.str.end == contents.end &&
+            integer_literal_type(literal.value.integer, literal.value.base, literal.value.suffix, &primitive)) {
+        der->array.is_size_constant = true;
+        der->array.size_value = literal.value.integer;
+        return;
+    }
+    const TryExpression_t expr = tokens ? parse_right_expression_token_span(*tokens) : parse_right_expression(contents);
+    if (expr.status != TRY_SUCCESS) {
+        return;
+    }
+    IntegerConstant_t value;
+    if (evaluate_constant(&expr.value, NULL, &value, NULL) && !(value.is_signed && (int64_t)value.bits < 0)) {
+        der->array.is_size_constant = true;
+        der->array.size_value = value.bits;
+        return;
+    }
+    Expression_t *size_expr = new_expression();
+    *size_expr = expr.value;
+    der->array.size_expr = size_expr;
+}
+
+/**
+ * Parse a comma-separated parameter list into a span of variables
+ */
+static TryVariable_t parse_params(ConstString_t contents, VariableSpan_t *const params) {
+    TryVariable_t output;
+    SpanBuilder_t builder = new_span_builder(sizeof(Variable_t));
+    while (contents.begin < contents.end) {
+        ConstString_t param_str;
+        param_str.begin = contents.begin;
+        TryConstString_t comma = find_string_nesting_sensitive(contents, const_string_from_cstr(","));
+        if (comma.status == TRY_ERROR) {
+            free_span_builder(&builder);
+            GrammarPropagateError(comma, output);
+        }
+        else if (comma.status == TRY_NONE) {
+            param_str.end = contents.end;
+            contents.begin = contents.end;
+        }
+        else {
+            param_str.end = comma.value.begin;
+            contents.begin = comma.value.end;
+        }
+        TryVariable_t param = parse_variable(param_str);
+        if (param.status == TRY_ERROR) {
+            free_span_builder(&builder);
+            GrammarPropagateError(param, output);
+        }
+        else if (param.status == TRY_NONE) {
+            free_span_builder(&builder);
+            output.status = TRY_ERROR;
+            output.error.location = param_str;
+            output.error.desc = "Tried to parse a parameter, got NONE";
+            return output;
+        }
+        *(Variable_t *)span_builder_push(&builder) = param.value;
+    }
+    params->items = finish_span(&builder);
+    params->size = builder.size;
+    output.status = TRY_SUCCESS;
+    return output;
+}
+
+/**
+ * Wrap `inner` in the derived types of a declarator, walking the declarator
+ * once from left to right: leading pointers, then the core (a name, a
+ * parenthesized declarator or nothing), then array/function suffixes. Suffixes
+ * bind tighter than the pointers and apply right to left, and a parenthesized
+ * core is the declarator of the type built so far. The named parameters of
+ * each function type are pushed onto `param_lists`, innermost function first.
+ */
+static TryVariable_t parse_declarator(DerivedType_t *head_der, const ConstString_t str, SpanBuilder_t *const param_lists) {
+    TryVariable_t output;
+    output.value.has_name = false;
+    ConstString_t working = strip_whitespace(str);
+
+    TryConstString_t ast_str;
+    while ((ast_str = find_string(working, const_string_from_cstr("*"))).status == TRY_SUCCESS) {
+        working = strip(working, ast_str.value).value;
+        DerivedType_t next_der;
+        next_der.variant = DERIVED_TYPE_POINTER;
+        next_der.pointer.inner_type = head_der;
+        next_der.pointer.qualifier = QUALIFIER_NONE;
+        TryQualifierString_t qual_str = find_qualifier(working);
+        if (qual_str.status == TRY_SUCCESS) {
+            next_der.pointer.qualifier = qual_str.value.variant;
+            working = strip(working, qual_str.value.str).value;
+        }
+        head_der = canonical_derived_type(&next_der);
+        working = strip_whitespace(working);
+    }
+
+    bool grouped = false;
+    ConstString_t group;
+    if (working.begin < working.end && *working.begin == '(') {
+        TryConstString_t parens_str = find_closing(working, '(', ')');
+        GrammarPropagateError(parens_str, output);
+        if (parens_str.value.end - parens_str.value.begin == 2) {
+            output.status = TRY_ERROR;
+            output.error.location = parens_str.value;
+            output.error.desc = "Declaration cannot start with ()";
+            return output;
+        }
+        grouped = true;
+        group.begin = parens_str.value.begin + 1;
+        group.end = parens_str.value.end - 1;
+        working.begin = parens_str.value.end;
+    }
+    else {
+        TryConstString_t id_str = find_identifier(working);
+        GrammarPropagateError(id_str, output);
+        if (id_str.status == TRY_SUCCESS) {
+            output.value.has_name = true;
+            output.value.name = intern(id_str.value);
+            working.begin = id_str.value.end;
+        }
+    }
+
+    // Suffixes are collected first since the rightmost one wraps the type first
+    size_t n_suffixes = 0;
+    size_t suffixes_capacity = 4;
+    ConstString_t *suffixes = malloc(suffixes_capacity * sizeof(ConstString_t));
+    while (1) {
+        working = strip_whitespace(working);
+        if (working.begin == working.end || (*working.begin != '[' && *working.begin != '(')) {
+            break;
+        }
+        TryConstString_t closure_str = find_closing(working, *working.begin, *working.begin == '[' ? ']' : ')');
+        if (closure_str.status == TRY_ERROR) {
+            free(suffixes);
+            GrammarPropagateError(closure_str, output);
+        }
+        if (n_suffixes == suffixes_capacity) {
+            suffixes_capacity *= 2;
+            suffixes = realloc(suffixes, suffixes_capacity * sizeof(ConstString_t));
+        }
+        suffixes[n_suffixes++] = closure_str.value;
+        working.begin = closure_str.value.end;
+    }
+    if (working.begin != working.end) {
+        free(suffixes);
+        output.status = TRY_ERROR;
+        output.error.location = working;
+        output.error.desc = "Unexpected characters";
+        return output;
+    }
+
+    for (size_t i = n_suffixes; i-- > 0;) {
+        ConstString_t contents;
+        contents.begin = suffixes[i].begin + 1;
+        contents.end = suffixes[i].end - 1;
+        DerivedType_t next_der;
+        if (*suffixes[i].begin == '[') {
+            next_der.variant = DERIVED_TYPE_ARRAY;
+            next_der.array.inner_type = head_der;
+            set_array_size(&next_der, contents, NULL);
+        }
+        else {
+            next_der.variant = DERIVED_TYPE_FUNCTION;
+            next_der.function.params.items = NULL;
+            next_der.function.params.size = 0;
+            next_der.function.return_type = head_der;
+            TryVariable_t params = parse_params(contents, &next_der.function.params);
+            if (params.status == TRY_ERROR) {
+                free(suffixes);
+                GrammarPropagateError(params, output);
+            }
+            *(VariableSpan_t *)span_builder_push(param_lists) = next_der.function.params;
+        }
+        head_der = canonical_derived_type(&next_der);
+    }
+    free(suffixes);
+
+    if (grouped) {
+        return parse_declarator(head_der, group, param_lists);
+    }
+    output.value.type = head_der;
+    output.status = TRY_SUCCESS;
+    return output;
+}
+
+/**
+ * Join the parameter lists of a declarator, outermost function first
+ */
+static VariableSpan_t join_param_lists(SpanBuilder_t *const param_lists) {
+    VariableSpan_t output;
+    const VariableSpan_t *lists = param_lists->items;
+    if (param_lists->size == 1) {
+        output = lists[0];
+        free_span_builder(param_lists);
+        return output;
+    }
+    SpanBuilder_t params = new_span_builder(sizeof(Variable_t));
+    for (size_t i = param_lists->size; i-- > 0;) {
+        for (uint32_t j = 0; j < lists[i].size; ++j) {
+            *(Variable_t *)span_builder_push(&params) = lists[i].items[j];
+        }
+    }
+    free_span_builder(param_lists);
+    output.items = finish_span(&params);
+    output.size = params.size;
+    return output;
+}
+
+static TryVariable_t parse_variable_uncached(const ConstString_t str) {
     TryVariable_t output;
     output.value.has_name = false;
 
@@ -61,6 +289,7 @@ TryVariable_t parse_variable(const ConstString_t str) {
     DerivedType_t terminal;
     terminal.variant = DERIVED_TYPE_TERMINAL;
     terminal.terminal.qualifier = QUALIFIER_NONE;
+    terminal.terminal.resolved = NULL;
     TryQualifierString_t qual_str = find_qualifier(working);
     if (qual_str.status == TRY_SUCCESS) {
         terminal.terminal.qualifier = qual_str.value.variant;
@@ -79,227 +308,341 @@ TryVariable_t parse_variable(const ConstString_t str) {
         output.status = TRY_ERROR;
         output.error.location = working;
         output.error.desc = "No type found";
+        return output;
     }
 
-    DerivedType_t *head_der = malloc(sizeof(DerivedType_t));
-    memcpy(head_der, &terminal, sizeof(DerivedType_t));
+    DerivedType_t *head_der = canonical_derived_type(&terminal);
 
-    while (1) {
-        working = strip_whitespace(working);
+    SpanBuilder_t param_lists = new_span_builder(sizeof(VariableSpan_t));
+    TryVariable_t declarator = parse_declarator(head_der, working, &param_lists);
+    if (declarator.status == TRY_ERROR) {
+        free_span_builder(&param_lists);
+        GrammarPropagateError(declarator, output);
+    }
+    output.value.has_name = declarator.value.has_name;
+    output.value.name = declarator.value.name;
+    output.value.type = declarator.value.type;
+    output.value.params = join_param_lists(&param_lists);
+    output.status = TRY_SUCCESS;
 
-        TryConstString_t ast_str = find_string(working, const_string_from_cstr("*"));
-        if (ast_str.status == TRY_SUCCESS) {
-            working = strip(working, ast_str.value).value;
-            DerivedType_t *next_der = malloc(sizeof(DerivedType_t));
-            next_der->variant = DERIVED_TYPE_POINTER;
-            next_der->pointer.inner_type = head_der;
-            next_der->pointer.qualifier = QUALIFIER_NONE;
-            qual_str = find_qualifier(working);
-            if (qual_str.status == TRY_SUCCESS) {
-                next_der->pointer.qualifier = qual_str.value.variant;
-                working = strip(working, qual_str.value.str).value;
-            }
-            head_der = next_der;
-            continue;
-        }
+    return output;
+}
+
+TryVariable_t parse_variable(const ConstString_t str) {
+    TryVariable_t output;
+    WithSourceIndex(str, output, parse_variable(str));
+    WithParseMemo(MEMO_VARIABLE, variable, str, output, parse_variable_uncached(str));
+}
 
-        TryConstString_t brackets_str = find_last_closure_nesting_sensitive(working, '[', ']');
-        if (brackets_str.status == TRY_ERROR) {
-            GrammarPropagateError(brackets_str, output);
+static bool is_qualifier_token(const Token_t *const token) {
+    return token->keyword == KEYWORD_CONST || token->keyword == KEYWORD_VOLATILE;
+}
+
+/**
+ * Parse a comma-separated parameter list from its tokens; see `parse_params`
+ */
+static TryVariable_t parse_param_token_span(const TokenSpan_t span, VariableSpan_t *const params) {
+    TryVariable_t output;
+    SpanBuilder_t builder = new_span_builder(sizeof(Variable_t));
+    TokenSpan_t param = span;
+    for (size_t it = span.begin; it <= span.end; ++it) {
+        if (it < span.end && span.match[it] != NO_TOKEN_MATCH) {
+            it = span.match[it];
+            continue;
         }
-        else if (brackets_str.status == TRY_SUCCESS) {
-            working.end = brackets_str.value.begin;
-            DerivedType_t *next_der = malloc(sizeof(DerivedType_t));
-            next_der->variant = DERIVED_TYPE_ARRAY;
-            next_der->array.inner_type = head_der;
-            next_der->array.has_size = false;
-            if (brackets_str.value.end - brackets_str.value.begin > 2) {
-                next_der->array.has_size = true;
-                ConstString_t size_str;
-                size_str.begin = brackets_str.value.begin + 1;
-                size_str.end = brackets_str.value.end - 1;
-                next_der->array.size = new_alloc_const_string_from_const_str(size_str);
-            }
-            head_der = next_der;
+        if (it < span.end && !is_punctuator(&span.tokens[it], ",")) {
             continue;
         }
-
-        TryConstString_t parens_str = find_last_closure_nesting_sensitive(working, '(', ')');
-        if (parens_str.status == TRY_ERROR) {
-            GrammarPropagateError(parens_str, output);
+        param.end = it;
+        // Nothing after the last comma is not a parameter
+        if (it == span.end && param.begin == span.end) {
+            break;
         }
-        else if (parens_str.status == TRY_SUCCESS) {
-            if (parens_str.value.end != working.end) {
-                ConstString_t leftover;
-                leftover.begin = parens_str.value.end;
-                leftover.end = working.end;
-                TryConstString_t leftover_ws = find_whitespace(leftover);
-                if (leftover_ws.status == TRY_NONE || leftover_ws.value.end != working.end) {
-                    output.status = TRY_ERROR;
-                    output.error.location = leftover;
-                    output.error.desc = "Unexpected characters";
-                    return output;
-                }
-            }
-            ConstString_t contents;
-            contents.begin = parens_str.value.begin + 1;
-            contents.end = parens_str.value.end - 1;
-            if (parens_str.value.begin == working.begin) {
-                if (contents.begin == contents.end) {
-                    output.status = TRY_ERROR;
-                    output.error.location = parens_str.value;
-                    output.error.desc = "Declaration cannot start with ()";
-                    return output;
-                }
-                working = contents;
-                continue;
-            }
-            working.end = parens_str.value.begin;
-            DerivedType_t *next_der = malloc(sizeof(DerivedType_t));
-            next_der->variant = DERIVED_TYPE_FUNCTION;
-            next_der->function.params = NULL;
-            next_der->function.return_type = head_der;
-            VariableLinkedListNode_t **head_param = &next_der->function.params;
-            while (contents.begin < contents.end) {
-                ConstString_t param_str;
-                param_str.begin = contents.begin;
-                TryConstString_t comma = find_string_nesting_sensitive(contents, const_string_from_cstr(","));
-                if (comma.status == TRY_ERROR) {
-                    GrammarPropagateError(comma, output);
-                }
-                else if (comma.status == TRY_NONE) {
-                    param_str.end = contents.end;
-                    contents.begin = contents.end;
-                }
-                else {
-                    param_str.end = comma.value.begin;
-                    contents.begin = comma.value.end;
-                }
-                TryVariable_t param = parse_variable(param_str);
-                if (param.status == TRY_ERROR) {
-                    GrammarPropagateError(param, output);
-                }
-                else if (param.status == TRY_NONE) {
-                    output.status = TRY_ERROR;
-                    output.error.location = param_str;
-                    output.error.desc = "Tried to parse a parameter, got NONE";
-                    return output;
-                }
-                *head_param = malloc(sizeof(VariableLinkedListNode_t));
-                (*head_param)->next = NULL;
-                (*head_param)->value = param.value;
-                head_param = &(*head_param)->next;
-            }
-            head_der = next_der;
-            continue;
+        TryVariable_t var = parse_variable_token_span(param);
+        if (var.status == TRY_ERROR) {
+            free_span_builder(&builder);
+            GrammarPropagateError(var, output);
+        }
+        else if (var.status == TRY_NONE) {
+            free_span_builder(&builder);
+            output.status = TRY_ERROR;
+            output.error.location = span.tokens[it - 1].str;
+            output.error.desc = "Tried to parse a parameter, got NONE";
+            return output;
         }
+        *(Variable_t *)span_builder_push(&builder) = var.value;
+        param.begin = it + 1;
+    }
+    params->items = finish_span(&builder);
+    params->size = builder.size;
+    output.status = TRY_SUCCESS;
+    return output;
+}
 
-        TryConstString_t id_str = find_identifier(working);
-        GrammarPropagateError(id_str, output);
-        if (id_str.status == TRY_SUCCESS) {
-            working = strip_whitespace(strip(working, id_str.value).value);
-            if (working.begin == working.end) {
-                output.value.has_name = true;
-                output.value.name = new_alloc_const_string_from_const_str(id_str.value);
-                break;
-            }
+/**
+ * Same walk as `parse_declarator` over tokens; since the brackets are matched
+ * the suffixes are applied from the last one backwards without collecting them
+ */
+static TryVariable_t parse_declarator_token_span(DerivedType_t *head_der, const TokenSpan_t span, SpanBuilder_t *const param_lists) {
+    TryVariable_t output;
+    output.value.has_name = false;
+    const Token_t *tokens = span.tokens;
+    size_t pos = span.begin;
+
+    while (pos < span.end && is_punctuator(&tokens[pos], "*")) {
+        ++pos;
+        DerivedType_t next_der;
+        next_der.variant = DERIVED_TYPE_POINTER;
+        next_der.pointer.inner_type = head_der;
+        next_der.pointer.qualifier = QUALIFIER_NONE;
+        if (pos < span.end && is_qualifier_token(&tokens[pos])) {
+            next_der.pointer.qualifier = tokens[pos].keyword == KEYWORD_CONST ? QUALIFIER_CONST : QUALIFIER_VOLATILE;
+            ++pos;
         }
+        head_der = canonical_derived_type(&next_der);
+    }
 
-        break;
+    bool grouped = false;
+    TokenSpan_t group = span;
+    if (pos < span.end && is_punctuator(&tokens[pos], "(")) {
+        const size_t closing = span.match[pos];
+        if (closing == pos + 1) {
+            output.status = TRY_ERROR;
+            output.error.location = token_span_str(span, pos, closing + 1);
+            output.error.desc = "Declaration cannot start with ()";
+            return output;
+        }
+        grouped = true;
+        group.begin = pos + 1;
+        group.end = closing;
+        pos = closing + 1;
+    }
+    else if (pos < span.end && tokens[pos].variant == TOKEN_KEYWORD) {
+        output.status = TRY_ERROR;
+        output.error.location = tokens[pos].str;
+        output.error.desc = "Identifier cannot be a keyword";
+        return output;
+    }
+    else if (pos < span.end && tokens[pos].variant == TOKEN_IDENTIFIER) {
+        output.value.has_name = true;
+        output.value.name = tokens[pos].symbol;
+        ++pos;
     }
 
-    working = strip_whitespace(working);
-    if (working.begin != working.end) {
+    size_t suffixes_end = pos;
+    while (suffixes_end < span.end && (is_punctuator(&tokens[suffixes_end], "[") || is_punctuator(&tokens[suffixes_end], "("))) {
+        suffixes_end = span.match[suffixes_end] + 1;
+    }
+    if (suffixes_end != span.end) {
         output.status = TRY_ERROR;
-        output.error.location = working;
+        output.error.location = token_span_str(span, suffixes_end, span.end);
         output.error.desc = "Unexpected characters";
         return output;
     }
 
+    for (size_t end = suffixes_end; end > pos;) {
+        const size_t closing = end - 1;
+        const size_t opening = span.match[closing];
+        end = opening;
+        DerivedType_t next_der;
+        if (is_punctuator(&tokens[opening], "[")) {
+            next_der.variant = DERIVED_TYPE_ARRAY;
+            next_der.array.inner_type = head_der;
+            ConstString_t contents;
+            contents.begin = tokens[opening].str.end;
+            contents.end = closing > opening + 1 ? tokens[closing].str.begin : contents.begin;
+            TokenSpan_t size_tokens = span;
+            size_tokens.begin = opening + 1;
+            size_tokens.end = closing;
+            set_array_size(&next_der, contents, &size_tokens);
+        }
+        else {
+            next_der.variant = DERIVED_TYPE_FUNCTION;
+            next_der.function.return_type = head_der;
+            TokenSpan_t contents = span;
+            contents.begin = opening + 1;
+            contents.end = closing;
+            TryVariable_t params = parse_param_token_span(contents, &next_der.function.params);
+            GrammarPropagateError(params, output);
+            *(VariableSpan_t *)span_builder_push(param_lists) = next_der.function.params;
+        }
+        head_der = canonical_derived_type(&next_der);
+    }
+
+    if (grouped) {
+        return parse_declarator_token_span(head_der, group, param_lists);
+    }
     output.value.type = head_der;
     output.status = TRY_SUCCESS;
+    return output;
+}
+
+static TryVariable_t parse_variable_token_span_uncached(const TokenSpan_t span) {
+    TryVariable_t output;
+    output.value.has_name = false;
+    const Token_t *tokens = span.tokens;
+    size_t pos = span.begin;
+
+    DerivedType_t terminal;
+    terminal.variant = DERIVED_TYPE_TERMINAL;
+    terminal.terminal.qualifier = QUALIFIER_NONE;
+    terminal.terminal.resolved = NULL;
+    if (is_qualifier_token(&tokens[pos])) {
+        terminal.terminal.qualifier = tokens[pos].keyword == KEYWORD_CONST ? QUALIFIER_CONST : QUALIFIER_VOLATILE;
+        ++pos;
+    }
+
+    TokenSpan_t rest = span;
+    rest.begin = pos;
+    TryType_t type = parse_type_token_span(rest);
+    GrammarPropagateError(type, output);
+    if (type.status == TRY_NONE) {
+        output.status = TRY_ERROR;
+        output.error.location = token_span_str(span, span.begin, span.end);
+        output.error.desc = "No type found";
+        return output;
+    }
+    terminal.terminal.type = type.value;
+    while (rest.begin < span.end && tokens[rest.begin].str.begin < type.value.str.end) {
+        ++rest.begin;
+    }
 
+    DerivedType_t *head_der = canonical_derived_type(&terminal);
+
+    SpanBuilder_t param_lists = new_span_builder(sizeof(VariableSpan_t));
+    TryVariable_t declarator = parse_declarator_token_span(head_der, rest, &param_lists);
+    if (declarator.status == TRY_ERROR) {
+        free_span_builder(&param_lists);
+        GrammarPropagateError(declarator, output);
+    }
+    output.value.has_name = declarator.value.has_name;
+    output.value.name = declarator.value.name;
+    output.value.type = declarator.value.type;
+    output.value.params = join_param_lists(&param_lists);
+    output.status = TRY_SUCCESS;
     return output;
 }
 
-size_t print_variable(char *buffer, const Variable_t* const var) {
-    char swap1[0x10000];
-    char swap2[0x10000];
-    char swap3[0x10000];
-    char *buffer_in = swap1;
-    char *buffer_out = swap2;
-    char *buffer_ex = swap3;
+TryVariable_t parse_variable_token_span(const TokenSpan_t span) {
+    TryVariable_t output;
+    if (span.begin == span.end) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    WithParseMemo(MEMO_VARIABLE, variable, token_span_str(span, span.begin, span.end), output, parse_variable_token_span_uncached(span));
+}
 
-    buffer_in[0] = 0;
-    if (var->has_name) {
-        sprintf(buffer_out, "%.*s",
-            (int)(var->name.end - var->name.begin), var->name.begin);
+TryVariable_t parse_variable_tokens(const TokenRange_t tokens) {
+    TryVariable_t output;
+    if (tokens.begin == tokens.end) {
+        output.status = TRY_NONE;
+        return output;
+    }
+    WithSourceIndex(token_range_str(tokens), output, parse_variable_tokens(tokens));
+    uint32_t *match = malloc((tokens.end - tokens.begin) * sizeof(uint32_t));
+    if (match_token_brackets(tokens, match)) {
+        TokenSpan_t span;
+        span.tokens = tokens.begin;
+        span.match = match;
+        span.begin = 0;
+        span.end = tokens.end - tokens.begin;
+        output = parse_variable_token_span(span);
     }
     else {
-        buffer_out[0] = 0;
-    }
-
-    DerivedType_t *der = var->type;
-    while (der) {
-        char *temp = buffer_in;
-        buffer_in = buffer_out;
-        buffer_out = temp;
-        size_t num_chars = 0;
-        switch (der->variant) {
-            case DERIVED_TYPE_TERMINAL:
-                print_type(buffer_ex, &der->terminal.type);
-                if (buffer_in[0]) {
-                    sprintf(buffer_out, "%s%s %s",
-                        qualifier_strs[der->terminal.qualifier], buffer_ex, buffer_in);
-                }
-                else {
-                    sprintf(buffer_out, "%s%s",
-                        qualifier_strs[der->terminal.qualifier], buffer_ex);
-                }
-                der = NULL;
-                break;
-            case DERIVED_TYPE_POINTER:
-                if (der->pointer.inner_type->variant == DERIVED_TYPE_ARRAY) {
-                    sprintf(buffer_out, "(*%s%s)",
-                        qualifier_strs[der->pointer.qualifier], buffer_in);
-                }
-                else {
-                    sprintf(buffer_out, "*%s%s",
-                        qualifier_strs[der->pointer.qualifier], buffer_in);
-                }
-                der = der->pointer.inner_type;
-                break;
-            case DERIVED_TYPE_ARRAY:
-                if (der->array.has_size) {
-                    sprintf(buffer_out, "%s[%.*s]",
-                        buffer_in, (int)(der->array.size.end - der->array.size.begin), der->array.size.begin);
-                }
-                else {
-                    sprintf(buffer_out, "%s[]", buffer_in);
-                }
-                der = der->array.inner_type;
-                break;
-            case DERIVED_TYPE_FUNCTION:
-                if (find_identifier(const_string_from_cstr(buffer_in)).status == TRY_SUCCESS) {
-                    num_chars += sprintf(buffer_out, "%s(", buffer_in);
-                }
-                else {
-                    num_chars += sprintf(buffer_out, "(%s)(", buffer_in);
-                }
-                VariableLinkedListNode_t *param = der->function.params;
-                while (param) {
-                    num_chars += print_variable(buffer_out + num_chars, &param->value);
-                    if (param->next) {
-                        num_chars += sprintf(buffer_out + num_chars, ", ");
-                    }
-                    param = param->next;
+        // Unbalanced brackets are reported the same way as for the text
+        output = parse_variable(token_range_str(tokens));
+    }
+    free(match);
+    return output;
+}
+
+static const DerivedType_t *inner_derived_type(const DerivedType_t *const der) {
+    switch (der->variant) {
+        case DERIVED_TYPE_POINTER: return der->pointer.inner_type;
+        case DERIVED_TYPE_ARRAY: return der->array.inner_type;
+        case DERIVED_TYPE_FUNCTION: return der->function.return_type;
+        default: return NULL;
+    }
+}
+
+/**
+ * Each derived type wraps the declarator text of the ones before it (starting
+ * from the name) in a prefix and a suffix, so a declarator is every prefix
+ * from the terminal inwards, then the name, then every suffix from the name
+ * outwards. `bare` is whether the text being wrapped is just the name, in
+ * which case a function needs no parentheses around it.
+ */
+static void print_declarator_prefix(Sink_t *const sink, const DerivedType_t *const der, const bool bare) {
+    if (!der || der->variant == DERIVED_TYPE_TERMINAL) {
+        return;
+    }
+    print_declarator_prefix(sink, inner_derived_type(der), bare && der->variant != DERIVED_TYPE_POINTER);
+    if (der->variant == DERIVED_TYPE_POINTER) {
+        sink_puts(sink, der->pointer.inner_type->variant == DERIVED_TYPE_ARRAY ? "(*" : "*");
+        sink_puts(sink, qualifier_strs[der->pointer.qualifier]);
+    }
+    else if (der->variant == DERIVED_TYPE_FUNCTION && !bare) {
+        sink_puts(sink, "(");
+    }
+}
+
+/**
+ * `params` are the declared parameters of `der` and the function types inside
+ * it, or NULL to print the unnamed parameters of the types themselves
+ */
+static void print_declarator_suffix(Sink_t *const sink, const DerivedType_t *const der, const bool bare, const Variable_t *params) {
+    if (!der || der->variant == DERIVED_TYPE_TERMINAL) {
+        return;
+    }
+    switch (der->variant) {
+        case DERIVED_TYPE_POINTER:
+            if (der->pointer.inner_type->variant == DERIVED_TYPE_ARRAY) {
+                sink_puts(sink, ")");
+            }
+            break;
+        case DERIVED_TYPE_ARRAY:
+            sink_puts(sink, "[");
+            if (der->array.has_size) {
+                sink_write(sink, der->array.size.begin, der->array.size.end - der->array.size.begin);
+            }
+            sink_puts(sink, "]");
+            break;
+        case DERIVED_TYPE_FUNCTION:
+            sink_puts(sink, bare ? "(" : ")(");
+            for (uint32_t i = 0; i < der->function.params.size; ++i) {
+                print_variable(sink, params ? &params[i] : &der->function.params.items[i]);
+                if (i + 1 < der->function.params.size) {
+                    sink_puts(sink, ", ");
                 }
-                sprintf(buffer_out + num_chars, ")");
-                der = der->function.return_type;
-                break;
+            }
+            sink_puts(sink, ")");
+            if (params) {
+                params += der->function.params.size;
+            }
+            break;
+        default:
+            break;
+    }
+    print_declarator_suffix(sink, inner_derived_type(der), bare && der->variant != DERIVED_TYPE_POINTER, params);
+}
+
+size_t print_variable(Sink_t *const sink, const Variable_t* const var) {
+    const size_t begin = sink->written;
+    const DerivedType_t *terminal = var->type;
+    while (terminal && terminal->variant != DERIVED_TYPE_TERMINAL) {
+        terminal = inner_derived_type(terminal);
+    }
+    if (terminal) {
+        sink_puts(sink, qualifier_strs[terminal->terminal.qualifier]);
+        print_type(sink, &terminal->terminal.type);
+        if (var->has_name || terminal != var->type) {
+            sink_puts(sink, " ");
         }
     }
-    size_t output = strlen(buffer_out);
-    memcpy(buffer, buffer_out, output + 1);
-    return output;
+    print_declarator_prefix(sink, var->type, var->has_name);
+    if (var->has_name) {
+        sink_write(sink, var->name->str.begin, var->name->str.end - var->name->str.begin);
+    }
+    print_declarator_suffix(sink, var->type, var->has_name, var->params.size ? var->params.items : NULL);
+    return sink->written - begin;
 }
\ No newline at end of file
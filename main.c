@@ -1,14 +1,34 @@
 #include "grammar/tests/tests.h"
+#include "flow/tests/tests.h"
 
 #include <stdio.h>
 #include <string.h>
 
 int main() {
     size_t num_failures = 0;
+    num_failures += test_lexer();
+    num_failures += test_scan();
+    num_failures += test_index();
+    num_failures += test_symbol();
+    num_failures += test_map();
     num_failures += test_types();
     num_failures += test_derived_types();
+    num_failures += test_canonical();
+    num_failures += test_sink();
     num_failures += test_operator();
+    num_failures += test_fold();
+    num_failures += test_memo();
+    num_failures += test_context();
     num_failures += test_scope();
+    num_failures += test_serialize();
+    num_failures += test_cache();
+    num_failures += test_flow_scope();
+    num_failures += test_flow_layout();
+    num_failures += test_flow_fold();
+    num_failures += test_flow_statement();
+    num_failures += test_flow_frame();
+    num_failures += test_flow_ssa();
+    num_failures += test_flow_sccp();
     printf("\e[1;38;5;207m%zu failures\e[1;0m\n", num_failures);
     return 0;
 }
\ No newline at end of file
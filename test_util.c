@@ -8,4 +8,14 @@ void print_pass(const char *message) {
 
 void print_fail(const char *message) {
     printf(" - \e[1;38;5;1mFAIL\e[1;0m %s\n", message);
+}
+
+bool check(const char *message, const bool passed) {
+    if (passed) {
+        print_pass(message);
+    }
+    else {
+        print_fail(message);
+    }
+    return passed;
 }
\ No newline at end of file
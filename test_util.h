@@ -1,7 +1,14 @@
 #ifndef _TEST_UTIL_H_
 #define _TEST_UTIL_H_
 
+#include <stdbool.h>
+
 void print_pass(const char *message);
 void print_fail(const char *message);
 
+/**
+ * Print a pass or a fail for `message`; returns `passed`
+ */
+bool check(const char *message, const bool passed);
+
 #endif
\ No newline at end of file